@@ -0,0 +1,5 @@
+#include "btree/btree_1024.h"
+
+#define BT(x) x##_1024
+#include "btree/template_impl.h"
+#undef BT
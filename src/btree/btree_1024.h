@@ -0,0 +1,11 @@
+#ifndef BTREE_1024_H
+#define BTREE_1024_H
+
+// B-tree with 1024 B nodes. See btree/btree.h.
+#define BTREE_NODE_BYTES 1024
+#define BT(x) x##_1024
+#include "btree/template.h"
+#undef BT
+#undef BTREE_NODE_BYTES
+
+#endif
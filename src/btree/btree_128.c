@@ -0,0 +1,5 @@
+#include "btree/btree_128.h"
+
+#define BT(x) x##_128
+#include "btree/template_impl.h"
+#undef BT
@@ -0,0 +1,11 @@
+#ifndef BTREE_128_H
+#define BTREE_128_H
+
+// B-tree with 128 B nodes. See btree/btree.h.
+#define BTREE_NODE_BYTES 128
+#define BT(x) x##_128
+#include "btree/template.h"
+#undef BT
+#undef BTREE_NODE_BYTES
+
+#endif
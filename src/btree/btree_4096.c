@@ -0,0 +1,5 @@
+#include "btree/btree_4096.h"
+
+#define BT(x) x##_4096
+#include "btree/template_impl.h"
+#undef BT
@@ -0,0 +1,11 @@
+#ifndef BTREE_4096_H
+#define BTREE_4096_H
+
+// B-tree with 4096 B nodes. See btree/btree.h.
+#define BTREE_NODE_BYTES 4096
+#define BT(x) x##_4096
+#include "btree/template.h"
+#undef BT
+#undef BTREE_NODE_BYTES
+
+#endif
@@ -0,0 +1,5 @@
+#include "btree/btree_512.h"
+
+#define BT(x) x##_512
+#include "btree/template_impl.h"
+#undef BT
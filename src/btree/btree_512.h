@@ -0,0 +1,11 @@
+#ifndef BTREE_512_H
+#define BTREE_512_H
+
+// B-tree with 512 B nodes. See btree/btree.h.
+#define BTREE_NODE_BYTES 512
+#define BT(x) x##_512
+#include "btree/template.h"
+#undef BT
+#undef BTREE_NODE_BYTES
+
+#endif
@@ -0,0 +1,5 @@
+#include "btree/btree_64.h"
+
+#define BT(x) x##_64
+#include "btree/template_impl.h"
+#undef BT
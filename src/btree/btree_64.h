@@ -0,0 +1,11 @@
+#ifndef BTREE_64_H
+#define BTREE_64_H
+
+// B-tree with 64 B nodes. See btree/btree.h.
+#define BTREE_NODE_BYTES 64
+#define BT(x) x##_64
+#include "btree/template.h"
+#undef BT
+#undef BTREE_NODE_BYTES
+
+#endif
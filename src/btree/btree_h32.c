@@ -0,0 +1,7 @@
+#include "btree/btree_h32.h"
+
+#define BTREE_NODE_HANDLES
+#define BT(x) x##_h32
+#include "btree/template_impl.h"
+#undef BT
+#undef BTREE_NODE_HANDLES
@@ -0,0 +1,16 @@
+#ifndef BTREE_H32_H
+#define BTREE_H32_H
+
+// B-tree with 256 B nodes, whose internal nodes refer to their children
+// by 32-bit indices into a node pool instead of by 64-bit pointers.
+// Internal nodes then hold 20 keys instead of 15, so trees are shallower.
+// See btree/btree.h.
+#define BTREE_NODE_BYTES 256
+#define BTREE_NODE_HANDLES
+#define BT(x) x##_h32
+#include "btree/template.h"
+#undef BT
+#undef BTREE_NODE_HANDLES
+#undef BTREE_NODE_BYTES
+
+#endif
@@ -0,0 +1,159 @@
+#include "btree/frozen.h"
+
+#include <stdlib.h>
+
+#include "btree/search.h"
+#include "log/log.h"
+
+#define NODE_KEYS BTREE_FROZEN_NODE_KEYS
+#define FANOUT BTREE_FROZEN_FANOUT
+#define PADDING UINT64_MAX
+
+static uint64_t* alloc_aligned(uint64_t count) {
+	uint64_t* array;
+	CHECK(posix_memalign((void**) &array, 64,
+				sizeof(uint64_t) * (count > 0 ? count : 1)) == 0,
+			"cannot allocate frozen B-tree");
+	return array;
+}
+
+static uint64_t blocks_for(uint64_t items, uint64_t per_block) {
+	return (items + per_block - 1) / per_block;
+}
+
+// Smallest key under child `child` of a node `height` levels above keys.
+static uint64_t smallest_key_under(const btree_frozen* this, uint64_t child,
+		uint8_t height) {
+	uint64_t block = child;
+	for (uint8_t i = 1; i < height && block * NODE_KEYS < this->size; i++) {
+		block *= FANOUT;
+	}
+	if (block * NODE_KEYS >= this->size) {
+		return PADDING;
+	}
+	return this->keys[block * NODE_KEYS];
+}
+
+static void build_nodes(btree_frozen* this) {
+	uint64_t level_nodes[BTREE_FROZEN_MAX_LEVELS + 1];
+	uint64_t below = blocks_for(this->size, NODE_KEYS);
+	this->levels = 0;
+	while (below > 1) {
+		CHECK(this->levels < BTREE_FROZEN_MAX_LEVELS,
+				"frozen B-tree too deep");
+		below = blocks_for(below, FANOUT);
+		level_nodes[++this->levels] = below;
+	}
+
+	// The root level goes first.
+	uint64_t total = 0;
+	for (uint8_t height = this->levels; height >= 1; height--) {
+		this->level_start[height] = total;
+		total += level_nodes[height];
+	}
+	this->node_count = total;
+	this->nodes = alloc_aligned(total * NODE_KEYS);
+	for (uint8_t height = 1; height <= this->levels; height++) {
+		for (uint64_t k = 0; k < level_nodes[height]; k++) {
+			uint64_t* node = &this->nodes[
+					(this->level_start[height] + k) * NODE_KEYS];
+			for (uint64_t j = 0; j < NODE_KEYS; j++) {
+				node[j] = smallest_key_under(this,
+						k * FANOUT + j + 1, height);
+			}
+		}
+	}
+}
+
+void btree_freeze(btree* tree, btree_frozen* this) {
+	btree_cursor cursor;
+	btree_cursor_init(&cursor, tree);
+
+	uint64_t size = 0;
+	for (bool more = btree_cursor_seek(&cursor, 0); more;
+			more = btree_cursor_next(&cursor)) {
+		size++;
+	}
+
+	this->size = size;
+	const uint64_t padded = blocks_for(size, NODE_KEYS) * NODE_KEYS;
+	this->keys = alloc_aligned(padded);
+	this->values = alloc_aligned(size);
+	uint64_t i = 0;
+	for (bool more = btree_cursor_seek(&cursor, 0); more;
+			more = btree_cursor_next(&cursor)) {
+		this->keys[i] = btree_cursor_key(&cursor);
+		this->values[i] = btree_cursor_value(&cursor);
+		i++;
+	}
+	for (; i < padded; i++) {
+		this->keys[i] = PADDING;
+	}
+	build_nodes(this);
+}
+
+void btree_frozen_destroy(btree_frozen* this) {
+	free(this->keys);
+	free(this->values);
+	free(this->nodes);
+	this->keys = this->values = this->nodes = NULL;
+	this->size = 0;
+	this->node_count = 0;
+	this->levels = 0;
+}
+
+// Index of the first key >= key, possibly a padding slot past size.
+static uint64_t lower_bound(const btree_frozen* this, uint64_t key) {
+	uint64_t k = 0;
+	for (uint8_t height = this->levels; height >= 1; height--) {
+		const uint64_t* node = &this->nodes[
+				(this->level_start[height] + k) * NODE_KEYS];
+		k = k * FANOUT + search_count_lt(node, NODE_KEYS, key);
+	}
+	if (this->size == 0) {
+		return 0;
+	}
+	return k * NODE_KEYS + search_count_lt(&this->keys[k * NODE_KEYS],
+			NODE_KEYS, key);
+}
+
+bool btree_frozen_find(const btree_frozen* this, uint64_t key,
+		uint64_t *value) {
+	const uint64_t i = lower_bound(this, key);
+	if (i < this->size && this->keys[i] == key) {
+		if (value) {
+			*value = this->values[i];
+		}
+		return true;
+	}
+	return false;
+}
+
+bool btree_frozen_find_next(const btree_frozen* this, uint64_t key,
+		uint64_t *next_key) {
+	if (key == UINT64_MAX) {
+		return false;
+	}
+	const uint64_t i = lower_bound(this, key + 1);
+	if (i < this->size) {
+		*next_key = this->keys[i];
+		return true;
+	}
+	return false;
+}
+
+bool btree_frozen_find_prev(const btree_frozen* this, uint64_t key,
+		uint64_t *prev_key) {
+	const uint64_t i = lower_bound(this, key);
+	if (i > 0) {
+		*prev_key = this->keys[i - 1];
+		return true;
+	}
+	return false;
+}
+
+uint64_t btree_frozen_memory_usage(const btree_frozen* this) {
+	const uint64_t padded = blocks_for(this->size, NODE_KEYS) * NODE_KEYS;
+	return sizeof(uint64_t) * (padded + this->size +
+			this->node_count * NODE_KEYS);
+}
@@ -0,0 +1,54 @@
+#ifndef BTREE_FROZEN_H
+#define BTREE_FROZEN_H
+
+// Read-only snapshot of a B-tree in a pointer-free layout (an "S+-tree",
+// Khuong & Morin, "Array layouts for comparison-based searching", 2017).
+//
+// Keys are in one sorted array, padded with UINT64_MAX to whole blocks
+// of BTREE_FROZEN_NODE_KEYS. Above them are implicit levels of nodes with
+// BTREE_FROZEN_NODE_KEYS keys: children of node k are nodes
+// k * BTREE_FROZEN_FANOUT ... k * BTREE_FROZEN_FANOUT + BTREE_FROZEN_FANOUT - 1
+// on the level below, and key j of a node is the smallest key under its
+// child j + 1. Lookups only compute indices, and every node is a pair
+// of aligned cache lines compared with SIMD (see btree/search.h).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "btree/btree.h"
+
+#define BTREE_FROZEN_NODE_KEYS 16
+#define BTREE_FROZEN_FANOUT (BTREE_FROZEN_NODE_KEYS + 1)
+// Enough for 2^64 keys.
+#define BTREE_FROZEN_MAX_LEVELS 16
+
+typedef struct {
+	uint64_t size;
+	// Keys padded to whole blocks, then values of the first size keys.
+	uint64_t* keys;
+	uint64_t* values;
+	// Levels above the keys, from the root down.
+	uint64_t* nodes;
+	uint64_t node_count;
+	uint8_t levels;
+	// Index of the first node of each level above the keys,
+	// level_start[1] for the level just above the keys.
+	uint64_t level_start[BTREE_FROZEN_MAX_LEVELS + 1];
+} btree_frozen;
+
+// Builds a snapshot of the pairs in the tree. The tree is not changed,
+// and later changes of the tree don't show in the snapshot.
+void btree_freeze(btree*, btree_frozen*);
+void btree_frozen_destroy(btree_frozen*);
+
+bool btree_frozen_find(const btree_frozen*, uint64_t key, uint64_t *value);
+bool btree_frozen_find_next(const btree_frozen*, uint64_t key,
+		uint64_t *next_key);
+bool btree_frozen_find_prev(const btree_frozen*, uint64_t key,
+		uint64_t *prev_key);
+
+// Bytes of the key, value and node arrays. Does not count the btree_frozen
+// struct itself.
+uint64_t btree_frozen_memory_usage(const btree_frozen*);
+
+#endif
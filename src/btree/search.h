@@ -0,0 +1,175 @@
+#ifndef BTREE_SEARCH_H
+#define BTREE_SEARCH_H
+
+// Searching in sorted arrays of keys within one B-tree node.
+// Instead of a branch per key, keys are compared with the searched key
+// in vectors and the comparison masks are counted.
+//
+// The implementation is picked at build time: AVX-512 if __AVX512F__ is
+// defined (e.g. by -march=native), AVX2 if __AVX2__ is, scalar otherwise.
+// Only keys[0..n) are read.
+
+#include <stdint.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+
+static inline __mmask8 search_lanes(uint16_t n, uint16_t i) {
+	return (n - i >= 8) ? 0xFF : (__mmask8) ((1U << (n - i)) - 1);
+}
+
+// Returns how many of keys[0..n) are <= key.
+static inline uint16_t search_count_le(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	const __m512i needle = _mm512_set1_epi64(key);
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i += 8) {
+		const __mmask8 lanes = search_lanes(n, i);
+		const __m512i chunk = _mm512_maskz_loadu_epi64(lanes, keys + i);
+		count += __builtin_popcount(
+				_mm512_mask_cmple_epu64_mask(lanes, chunk, needle));
+	}
+	return count;
+}
+
+// Returns how many of keys[0..n) are < key.
+static inline uint16_t search_count_lt(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	const __m512i needle = _mm512_set1_epi64(key);
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i += 8) {
+		const __mmask8 lanes = search_lanes(n, i);
+		const __m512i chunk = _mm512_maskz_loadu_epi64(lanes, keys + i);
+		count += __builtin_popcount(
+				_mm512_mask_cmplt_epu64_mask(lanes, chunk, needle));
+	}
+	return count;
+}
+
+// Returns the index of key in keys[0..n), or n if it's not there.
+static inline uint16_t search_find(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	const __m512i needle = _mm512_set1_epi64(key);
+	for (uint16_t i = 0; i < n; i += 8) {
+		const __mmask8 lanes = search_lanes(n, i);
+		const __m512i chunk = _mm512_maskz_loadu_epi64(lanes, keys + i);
+		const __mmask8 equal =
+				_mm512_mask_cmpeq_epu64_mask(lanes, chunk, needle);
+		if (equal) {
+			return i + __builtin_ctz(equal);
+		}
+	}
+	return n;
+}
+
+#elif defined(__AVX2__)
+
+// AVX2 only compares signed 64-bit integers. Flipping the sign bit of both
+// sides turns the signed comparison into an unsigned one.
+#define SEARCH_SIGN_BIT ((long long) 0x8000000000000000ULL)
+
+// Loads keys[i..i+4) that are below n, *lanes is set to their bit mask.
+static inline __m256i search_load(const uint64_t* keys, uint16_t n, uint16_t i,
+		int* lanes) {
+	const __m256i lane_index = _mm256_set_epi64x(3, 2, 1, 0);
+	const __m256i valid = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n - i),
+			lane_index);
+	*lanes = _mm256_movemask_pd(_mm256_castsi256_pd(valid));
+	return _mm256_maskload_epi64((const long long*) (keys + i), valid);
+}
+
+static inline int search_mask(__m256i comparison) {
+	return _mm256_movemask_pd(_mm256_castsi256_pd(comparison));
+}
+
+// Returns how many of keys[0..n) are <= key.
+static inline uint16_t search_count_le(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	const __m256i sign = _mm256_set1_epi64x(SEARCH_SIGN_BIT);
+	const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x(key), sign);
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i += 4) {
+		int lanes;
+		const __m256i chunk = _mm256_xor_si256(
+				search_load(keys, n, i, &lanes), sign);
+		const int greater = search_mask(
+				_mm256_cmpgt_epi64(chunk, needle));
+		count += __builtin_popcount(lanes & ~greater);
+	}
+	return count;
+}
+
+// Returns how many of keys[0..n) are < key.
+static inline uint16_t search_count_lt(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	const __m256i sign = _mm256_set1_epi64x(SEARCH_SIGN_BIT);
+	const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x(key), sign);
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i += 4) {
+		int lanes;
+		const __m256i chunk = _mm256_xor_si256(
+				search_load(keys, n, i, &lanes), sign);
+		const int less = search_mask(
+				_mm256_cmpgt_epi64(needle, chunk));
+		count += __builtin_popcount(lanes & less);
+	}
+	return count;
+}
+
+// Returns the index of key in keys[0..n), or n if it's not there.
+static inline uint16_t search_find(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	const __m256i needle = _mm256_set1_epi64x(key);
+	for (uint16_t i = 0; i < n; i += 4) {
+		int lanes;
+		const __m256i chunk = search_load(keys, n, i, &lanes);
+		const int equal = lanes & search_mask(
+				_mm256_cmpeq_epi64(chunk, needle));
+		if (equal) {
+			return i + __builtin_ctz(equal);
+		}
+	}
+	return n;
+}
+
+#undef SEARCH_SIGN_BIT
+
+#else
+
+// Returns how many of keys[0..n) are <= key.
+static inline uint16_t search_count_le(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i++) {
+		count += (keys[i] <= key);
+	}
+	return count;
+}
+
+// Returns how many of keys[0..n) are < key.
+static inline uint16_t search_count_lt(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < n; i++) {
+		count += (keys[i] < key);
+	}
+	return count;
+}
+
+// Returns the index of key in keys[0..n), or n if it's not there.
+static inline uint16_t search_find(const uint64_t* keys, uint16_t n,
+		uint64_t key) {
+	for (uint16_t i = 0; i < n; i++) {
+		if (keys[i] == key) {
+			return i;
+		}
+	}
+	return n;
+}
+
+#endif
+
+#endif
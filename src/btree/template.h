@@ -0,0 +1,166 @@
+// Declarations of one B-tree instance. Include one of the instance headers
+// (btree/btree.h, btree/btree_64.h, ...) instead of this file.
+//
+// The instance header defines BTREE_NODE_BYTES and BT(x), which appends
+// the instance suffix to a name. If it also defines BTREE_NODE_HANDLES,
+// internal nodes refer to their children by 32-bit indices into a node pool
+// (pool/pool.h) instead of by pointers, which gives them more keys.
+// Within this file and btree/template_impl.h, plain names (btree,
+// btree_insert, LEAF_MAX_KEYS, ...) are renamed by btree/template_begin.h,
+// so the code reads like for a single B-tree.
+// No include guard on purpose.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pool/pool.h"
+#include "slab/slab.h"
+
+#include "btree/template_begin.h"
+
+#ifdef BTREE_NODE_HANDLES
+typedef uint32_t btree_node_ref;
+#else
+typedef struct btree_node_persisted* btree_node_ref;
+#endif
+
+enum {
+	LEAF_MAX_KEYS = (BTREE_NODE_BYTES - 2 * sizeof(void*)) /
+			(sizeof(uint64_t) * 2),
+	LEAF_MIN_KEYS = LEAF_MAX_KEYS / 2,
+	// The key count takes up to 8 bytes with padding.
+	INTERNAL_MAX_KEYS = (BTREE_NODE_BYTES - sizeof(uint64_t) -
+			sizeof(btree_node_ref)) /
+			(sizeof(uint64_t) + sizeof(btree_node_ref)),
+	// Merging two internal nodes adds the key between them.
+	INTERNAL_MIN_KEYS = (INTERNAL_MAX_KEYS - 1) / 2
+};
+
+typedef struct btree_node_persisted {
+	union {
+		struct {
+			uint16_t key_count;
+			uint64_t keys[INTERNAL_MAX_KEYS];
+			btree_node_ref pointers[INTERNAL_MAX_KEYS + 1];
+		} internal;
+
+		struct {
+			uint64_t keys[LEAF_MAX_KEYS];
+			uint64_t values[LEAF_MAX_KEYS];
+			// Neighbouring leaves in key order, NULL at the ends.
+			struct btree_node_persisted* previous;
+			struct btree_node_persisted* next;
+		} leaf;
+	};
+} btree_node_persisted;
+
+typedef struct {
+	uint8_t levels_above_leaves;  // levels_above_leaves 0 == just root
+	btree_node_persisted* root;
+	// Rightmost leaf. Keys above all others are appended to it without
+	// descending from the root while it has room, and when it is full,
+	// it is split unevenly (see split_last_leaf). So it may hold fewer
+	// than LEAF_MIN_KEYS keys.
+	btree_node_persisted* last_leaf;
+#ifdef BTREE_NODE_HANDLES
+	pool nodes;
+#else
+	slab nodes;
+#endif
+	// B*-tree mode: full nodes first shift keys to a neighbour, and when
+	// both are full, the two are split into three. Insertions then keep
+	// nodes at least about 2/3 full.
+	bool bstar;
+	// Relaxed deletion: nodes are never merged or rebalanced, only
+	// removed when they become empty. See btree_init_relaxed.
+	bool relaxed_deletion;
+} btree;
+
+void split_leaf(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key);
+void split_internal(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key);
+void insert_pointer(btree_node_persisted* node, uint64_t key,
+		btree_node_ref pointer);
+
+void btree_init(btree*);
+// Deletions still only keep non-root nodes half full, like in a B-tree.
+void btree_init_bstar(btree*);
+// Deletions only remove keys from leaves, and leaves and internal nodes
+// left empty, so they never move keys between nodes. Leaves may get
+// sparse; btree_compact packs them again.
+void btree_init_relaxed(btree*);
+bool btree_insert(btree*, uint64_t key, uint64_t value);
+bool btree_delete(btree*, uint64_t key);
+bool btree_find(btree*, uint64_t key, uint64_t *value);
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the tree is next modified.
+bool btree_upsert(btree*, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
+// Looks up n keys, overlapping their cache misses.
+void btree_find_batch(btree*, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found);
+void btree_destroy(btree*);
+
+typedef struct {
+	uint64_t key;
+	uint64_t value;
+} btree_pair;
+
+// Builds an empty B-tree from n pairs with sorted unique keys, bottom-up.
+// Nodes are filled to about `fill` (in (0;1]) of their capacity.
+void btree_bulk_load(btree*, const btree_pair* pairs, uint64_t n,
+		double fill);
+// Rebuilds the tree with nodes filled to about `fill` of their capacity,
+// like btree_bulk_load. Meant for relaxed trees after many deletions.
+void btree_compact(btree*, double fill);
+
+// Bytes of the slab chunks holding the nodes of the tree, including unused
+// slots. Does not count the btree struct itself.
+uint64_t btree_memory_usage(btree*);
+
+bool btree_find_next(btree*, uint64_t key, uint64_t *next_key);
+bool btree_find_prev(btree*, uint64_t key, uint64_t *prev_key);
+
+typedef struct {
+	uint8_t levels_above_leaves;
+	btree_node_persisted* persisted;
+} btree_node_traversed;
+
+// Points at one key-value pair in a leaf.
+// Invalidated by any change to the tree.
+typedef struct {
+	btree* tree;
+	btree_node_persisted* leaf;
+	uint16_t index;
+} btree_cursor;
+
+void btree_cursor_init(btree_cursor*, btree*);
+// Moves to the smallest key >= key. Returns false if there is no such key.
+bool btree_cursor_seek(btree_cursor*, uint64_t key);
+// Moves to the largest key. Returns false if the tree is empty.
+bool btree_cursor_last(btree_cursor*);
+// Move to the next/previous key. Return false if there is none.
+bool btree_cursor_next(btree_cursor*);
+bool btree_cursor_prev(btree_cursor*);
+uint64_t btree_cursor_key(const btree_cursor*);
+uint64_t btree_cursor_value(const btree_cursor*);
+
+bool nt_is_leaf(btree_node_traversed node);
+btree_node_traversed nt_root(btree* tree);
+uint16_t get_n_leaf_keys(const btree_node_persisted* node);
+
+void btree_dump_dot(const btree* this, FILE* output);
+
+typedef struct {
+	uint64_t internal_n_keys_histogram[INTERNAL_MAX_KEYS + 1];
+	uint64_t total_kvp_path_length;
+	uint64_t total_kvps;
+	uint64_t leaf_count;
+} btree_stats;
+
+btree_stats btree_collect_stats(btree* this);
+
+#include "btree/template_end.h"
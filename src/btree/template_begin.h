@@ -0,0 +1,51 @@
+// Renames B-tree types and functions to the instance selected by BT(x).
+// Included at the start of btree/template.h and btree/template_impl.h,
+// undone by btree/template_end.h. No include guard on purpose.
+
+#ifndef BT
+#error "BT(x) must be defined to name the B-tree instance"
+#endif
+
+#define LEAF_MAX_KEYS BT(BTREE_LEAF_MAX_KEYS)
+#define LEAF_MIN_KEYS BT(BTREE_LEAF_MIN_KEYS)
+#define INTERNAL_MAX_KEYS BT(BTREE_INTERNAL_MAX_KEYS)
+#define INTERNAL_MIN_KEYS BT(BTREE_INTERNAL_MIN_KEYS)
+
+#define btree_node_persisted BT(btree_node_persisted)
+#define btree_node_ref BT(btree_node_ref)
+#define btree BT(btree)
+#define btree_node_traversed BT(btree_node_traversed)
+#define btree_cursor BT(btree_cursor)
+#define btree_pair BT(btree_pair)
+#define btree_stats BT(btree_stats)
+#define split_leaf BT(split_leaf)
+#define split_internal BT(split_internal)
+#define insert_pointer BT(insert_pointer)
+#define insert_key_value_pair BT(insert_key_value_pair)
+#define btree_init BT(btree_init)
+#define btree_init_bstar BT(btree_init_bstar)
+#define btree_init_relaxed BT(btree_init_relaxed)
+#define btree_insert BT(btree_insert)
+#define btree_delete BT(btree_delete)
+#define btree_find BT(btree_find)
+#define btree_upsert BT(btree_upsert)
+#define btree_find_batch BT(btree_find_batch)
+#define btree_destroy BT(btree_destroy)
+#define btree_bulk_load BT(btree_bulk_load)
+#define btree_compact BT(btree_compact)
+#define btree_memory_usage BT(btree_memory_usage)
+#define btree_find_next BT(btree_find_next)
+#define btree_find_prev BT(btree_find_prev)
+#define btree_cursor_init BT(btree_cursor_init)
+#define btree_cursor_seek BT(btree_cursor_seek)
+#define btree_cursor_last BT(btree_cursor_last)
+#define btree_cursor_next BT(btree_cursor_next)
+#define btree_cursor_prev BT(btree_cursor_prev)
+#define btree_cursor_key BT(btree_cursor_key)
+#define btree_cursor_value BT(btree_cursor_value)
+#define nt_is_leaf BT(nt_is_leaf)
+#define nt_root BT(nt_root)
+#define get_n_leaf_keys BT(get_n_leaf_keys)
+#define btree_dump_dot BT(btree_dump_dot)
+#define btree_collect_stats BT(btree_collect_stats)
+#define btree_collect_stats_recursive BT(btree_collect_stats_recursive)
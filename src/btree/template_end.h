@@ -0,0 +1,44 @@
+// Undoes btree/template_begin.h. No include guard on purpose.
+
+#undef LEAF_MAX_KEYS
+#undef LEAF_MIN_KEYS
+#undef INTERNAL_MAX_KEYS
+#undef INTERNAL_MIN_KEYS
+#undef btree_node_persisted
+#undef btree_node_ref
+#undef btree
+#undef btree_node_traversed
+#undef btree_cursor
+#undef btree_pair
+#undef btree_stats
+#undef split_leaf
+#undef split_internal
+#undef insert_pointer
+#undef insert_key_value_pair
+#undef btree_init
+#undef btree_init_bstar
+#undef btree_init_relaxed
+#undef btree_insert
+#undef btree_delete
+#undef btree_find
+#undef btree_upsert
+#undef btree_find_batch
+#undef btree_destroy
+#undef btree_bulk_load
+#undef btree_compact
+#undef btree_memory_usage
+#undef btree_find_next
+#undef btree_find_prev
+#undef btree_cursor_init
+#undef btree_cursor_seek
+#undef btree_cursor_last
+#undef btree_cursor_next
+#undef btree_cursor_prev
+#undef btree_cursor_key
+#undef btree_cursor_value
+#undef nt_is_leaf
+#undef nt_root
+#undef get_n_leaf_keys
+#undef btree_dump_dot
+#undef btree_collect_stats
+#undef btree_collect_stats_recursive
@@ -0,0 +1,1361 @@
+// Implementation of B-trees, included by one .c file per node size.
+// The including file first includes the instance header and defines BT(x)
+// to mangle public names of the instance (see btree/template.h).
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "btree/search.h"
+#include "log/log.h"
+
+#include "btree/template_begin.h"
+
+// TODO: static_assert's for min-keys/max-keys conditions
+
+// TODO: Travis is being a dinosaur
+// static_assert(sizeof(btree_node_persisted) == 64,
+// 		"btree_node_persisted not aligned on cache line");
+
+// Details of node representation:
+// TODO: document empty slots; TODO: trick to represent SLOT_UNUSED=SLOT_UNUSED
+
+// Equal to dict DICT_RESERVED_KEY
+#define SLOT_UNUSED UINT64_MAX
+
+#define ASSERT_ALIGNED(x,alignment) ASSERT(((uint64_t) x) % (alignment) == 0)
+
+// Nodes come from the tree's slab or pool, which align them to cache lines.
+static btree_node_persisted* alloc_node(btree* this) {
+#ifdef BTREE_NODE_HANDLES
+	btree_node_persisted* node = pool_alloc(&this->nodes);
+	ASSERT_ALIGNED(node, POOL_ALIGNMENT);
+#else
+	btree_node_persisted* node = slab_alloc(&this->nodes);
+	ASSERT_ALIGNED(node, SLAB_ALIGNMENT);
+#endif
+	return node;
+}
+
+static void free_node(btree* this, btree_node_persisted* node) {
+#ifdef BTREE_NODE_HANDLES
+	pool_free(&this->nodes, node);
+#else
+	slab_free(&this->nodes, node);
+#endif
+}
+
+// Child i of an internal node.
+static btree_node_persisted* get_child(const btree* this,
+		const btree_node_persisted* node, uint16_t i) {
+#ifdef BTREE_NODE_HANDLES
+	return pool_slot(&this->nodes, node->internal.pointers[i]);
+#else
+	(void) this;
+	return node->internal.pointers[i];
+#endif
+}
+
+// What a parent stores to refer to the node.
+static btree_node_ref get_ref(const btree* this, btree_node_persisted* node) {
+#ifdef BTREE_NODE_HANDLES
+	return pool_index(&this->nodes, node);
+#else
+	(void) this;
+	return node;
+#endif
+}
+
+static btree_node_persisted* new_empty_leaf(btree* this);
+static btree_node_persisted* new_fork_node(btree* this, uint64_t middle_key,
+		btree_node_persisted* left, btree_node_persisted* right);
+void split_leaf(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key);
+void split_internal(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key);
+void insert_pointer(btree_node_persisted* node, uint64_t key,
+		btree_node_ref pointer);
+static void remove_ptr_from_node(btree_node_persisted* parent,
+		btree_node_ref remove);
+bool insert_key_value_pair(btree_node_persisted* leaf,
+		uint64_t key, uint64_t value);
+static bool remove_from_leaf(btree_node_persisted* leaf, uint64_t key);
+static void rebalance_internal(btree_node_persisted* parent,
+		btree_node_persisted* left, btree_node_persisted* right,
+		const uint16_t right_index,
+		const uint16_t to_left, const uint16_t to_right);
+static void rebalance_leaves(
+		btree_node_persisted* left, btree_node_persisted* right,
+		const uint16_t to_left, const uint16_t to_right,
+		uint64_t* right_min_key);
+static void append_internal(btree_node_persisted* target, uint64_t appended_key,
+		const btree_node_persisted* source);
+static void append_leaf(btree_node_persisted* target,
+		btree_node_persisted* source);
+static void link_leaf_after(btree_node_persisted* leaf,
+		btree_node_persisted* new_next);
+static void unlink_leaf(btree_node_persisted* leaf);
+static uint16_t get_n_internal_keys(const btree_node_persisted* node);
+static void find_siblings(const btree* this, btree_node_persisted* node,
+		btree_node_persisted* parent,
+		btree_node_persisted** left, btree_node_persisted** right,
+		uint16_t* right_index);
+
+// B-tree "meta-algorithm":
+enum side_preference { LEFT, RIGHT };
+
+bool nt_is_leaf(btree_node_traversed node) {
+	return node.levels_above_leaves == 0;
+}
+
+btree_node_traversed nt_root(btree* tree) {
+	return (btree_node_traversed) {
+		.persisted = tree->root,
+		.levels_above_leaves = tree->levels_above_leaves
+	};
+}
+
+// Index of the child of an internal node where key belongs.
+static uint16_t child_index(const btree_node_persisted* node, uint64_t key) {
+	return search_count_le(node->internal.keys, get_n_internal_keys(node),
+			key);
+}
+
+static btree_node_traversed nt_advance(const btree* this,
+		const btree_node_traversed node, uint64_t key) {
+	return (btree_node_traversed) {
+		.persisted = get_child(this, node.persisted,
+				child_index(node.persisted, key)),
+		.levels_above_leaves = node.levels_above_leaves - 1,
+	};
+}
+
+static void split_keys_with_preference(uint16_t total_keys,
+		enum side_preference preference,
+		uint16_t *to_left, uint16_t *to_right) {
+	if (preference == LEFT) {
+		*to_right = total_keys / 2;
+		*to_left = total_keys - *to_right;
+		assert(*to_left >= *to_right);
+	} else {
+		*to_left = total_keys / 2;
+		*to_right = total_keys - *to_left;
+		assert(*to_right >= *to_left);
+	}
+}
+
+void btree_init(btree* this) {
+#ifdef BTREE_NODE_HANDLES
+	pool_init(&this->nodes, sizeof(btree_node_persisted));
+#else
+	slab_init(&this->nodes, sizeof(btree_node_persisted));
+#endif
+	this->root = new_empty_leaf(this);
+	this->last_leaf = this->root;
+	this->levels_above_leaves = 0;
+	this->bstar = false;
+	this->relaxed_deletion = false;
+}
+
+void btree_init_bstar(btree* this) {
+	btree_init(this);
+	this->bstar = true;
+}
+
+void btree_init_relaxed(btree* this) {
+	btree_init(this);
+	this->relaxed_deletion = true;
+}
+
+void btree_destroy(btree* tree) {
+#ifdef BTREE_NODE_HANDLES
+	pool_destroy(&tree->nodes);
+#else
+	slab_destroy(&tree->nodes);
+#endif
+	tree->root = NULL;
+	tree->last_leaf = NULL;
+}
+
+// Number of nodes to split `items` entries (pairs or children) into, so that
+// nodes hold about `per_node` entries, but never less than `min_per_node`.
+static uint64_t bulk_node_count(uint64_t items, uint64_t per_node,
+		uint64_t min_per_node) {
+	uint64_t count = (items + per_node - 1) / per_node;
+	if (count > items / min_per_node) {
+		count = items / min_per_node;
+	}
+	return (count == 0) ? 1 : count;
+}
+
+// Index of the first entry of node i when spreading entries evenly.
+static uint64_t bulk_node_start(uint64_t items, uint64_t count, uint64_t i) {
+	const uint64_t remainder = items % count;
+	return (items / count) * i + ((i < remainder) ? i : remainder);
+}
+
+static uint64_t bulk_per_node(double fill, uint64_t min, uint64_t max) {
+	const uint64_t per_node = fill * max + 0.5;
+	if (per_node < min) {
+		return min;
+	}
+	return (per_node > max) ? max : per_node;
+}
+
+void btree_bulk_load(btree* this, const btree_pair* pairs, uint64_t n,
+		double fill) {
+	CHECK(this->levels_above_leaves == 0 &&
+			get_n_leaf_keys(this->root) == 0,
+			"bulk loading into non-empty B-tree");
+	CHECK(fill > 0 && fill <= 1, "bad B-tree fill factor: %lf", fill);
+	if (n == 0) {
+		return;
+	}
+	free_node(this, this->root);
+
+	// Build packed leaves, then build every level above from the
+	// one below. nodes[i] is the i-th node of the current level,
+	// min_keys[i] is the smallest key in its subtree.
+	uint64_t count = bulk_node_count(n,
+			bulk_per_node(fill, LEAF_MIN_KEYS, LEAF_MAX_KEYS),
+			LEAF_MIN_KEYS);
+	btree_node_persisted** nodes = malloc(
+			sizeof(btree_node_persisted*) * count);
+	uint64_t* min_keys = malloc(sizeof(uint64_t) * count);
+	CHECK(nodes && min_keys, "cannot allocate B-tree bulk load buffers");
+
+	for (uint64_t i = 0; i < count; i++) {
+		const uint64_t begin = bulk_node_start(n, count, i),
+				end = bulk_node_start(n, count, i + 1);
+		btree_node_persisted* leaf = new_empty_leaf(this);
+		for (uint64_t j = begin; j < end; j++) {
+			leaf->leaf.keys[j - begin] = pairs[j].key;
+			leaf->leaf.values[j - begin] = pairs[j].value;
+		}
+		if (i > 0) {
+			link_leaf_after(nodes[i - 1], leaf);
+		}
+		nodes[i] = leaf;
+		min_keys[i] = pairs[begin].key;
+	}
+	this->last_leaf = nodes[count - 1];
+	this->levels_above_leaves = 0;
+
+	const uint64_t per_internal = bulk_per_node(fill,
+			INTERNAL_MIN_KEYS + 1, INTERNAL_MAX_KEYS + 1);
+	while (count > 1) {
+		const uint64_t parents = bulk_node_count(count, per_internal,
+				INTERNAL_MIN_KEYS + 1);
+		// Parent i only reads children at indices >= i,
+		// so the level can be rebuilt in place.
+		for (uint64_t i = 0; i < parents; i++) {
+			const uint64_t begin = bulk_node_start(count, parents, i),
+					end = bulk_node_start(count, parents, i + 1);
+			btree_node_persisted* parent = alloc_node(this);
+			parent->internal.key_count = end - begin - 1;
+			for (uint64_t j = begin; j < end; j++) {
+				parent->internal.pointers[j - begin] =
+						get_ref(this, nodes[j]);
+				if (j > begin) {
+					parent->internal.keys[j - begin - 1] =
+						min_keys[j];
+				}
+			}
+			nodes[i] = parent;
+			min_keys[i] = min_keys[begin];
+		}
+		count = parents;
+		++this->levels_above_leaves;
+	}
+
+	this->root = nodes[0];
+	free(nodes);
+	free(min_keys);
+}
+
+void btree_compact(btree* this, double fill) {
+	btree_cursor cursor;
+	btree_cursor_init(&cursor, this);
+	uint64_t n = 0;
+	for (bool more = btree_cursor_seek(&cursor, 0); more;
+			more = btree_cursor_next(&cursor)) {
+		n++;
+	}
+	btree_pair* pairs = malloc(sizeof(btree_pair) * (n > 0 ? n : 1));
+	CHECK(pairs, "cannot allocate B-tree compaction buffer");
+	uint64_t i = 0;
+	for (bool more = btree_cursor_seek(&cursor, 0); more;
+			more = btree_cursor_next(&cursor)) {
+		pairs[i++] = (btree_pair) {
+			.key = btree_cursor_key(&cursor),
+			.value = btree_cursor_value(&cursor)
+		};
+	}
+
+	const bool bstar = this->bstar,
+			relaxed_deletion = this->relaxed_deletion;
+	btree_destroy(this);
+	btree_init(this);
+	this->bstar = bstar;
+	this->relaxed_deletion = relaxed_deletion;
+	btree_bulk_load(this, pairs, n, fill);
+	free(pairs);
+}
+
+static void set_new_root(btree* this, uint64_t middle_key,
+		btree_node_persisted* left, btree_node_persisted* right) {
+	this->root = new_fork_node(this, middle_key, left, right);
+}
+
+static bool is_full(btree_node_traversed node) {
+	if (nt_is_leaf(node)) {
+		return get_n_leaf_keys(node.persisted) == LEAF_MAX_KEYS;
+	} else {
+		return get_n_internal_keys(node.persisted) == INTERNAL_MAX_KEYS;
+	}
+}
+
+// B*-tree: a neighbour takes keys from a full node if it has at least
+// 2 free slots, so that neither node is full afterwards.
+static bool can_take_keys(const btree_node_persisted* node, bool leaf) {
+	if (leaf) {
+		return get_n_leaf_keys(node) + 2 <= LEAF_MAX_KEYS;
+	} else {
+		return get_n_internal_keys(node) + 2 <= INTERNAL_MAX_KEYS;
+	}
+}
+
+// Spreads the keys of children left_index and left_index + 1 of the parent
+// evenly between them.
+static void even_out_children(const btree* this,
+		btree_node_persisted* parent, uint16_t left_index, bool leaf) {
+	btree_node_persisted* left = get_child(this, parent, left_index);
+	btree_node_persisted* right = get_child(this, parent, left_index + 1);
+	if (leaf) {
+		const uint16_t total_keys =
+				get_n_leaf_keys(left) + get_n_leaf_keys(right);
+		rebalance_leaves(left, right, total_keys / 2,
+				total_keys - total_keys / 2,
+				&parent->internal.keys[left_index]);
+	} else {
+		const uint16_t total_keys =
+				get_n_internal_keys(left) + get_n_internal_keys(right);
+		rebalance_internal(parent, left, right, left_index + 1,
+				total_keys / 2, total_keys - total_keys / 2);
+	}
+}
+
+// Splits children left_index and left_index + 1 of the parent, which are
+// both (nearly) full, into three nodes about 2/3 full.
+static void split_two_into_three(btree* this, btree_node_persisted* parent,
+		uint16_t left_index, bool leaf) {
+	btree_node_persisted* left = get_child(this, parent, left_index);
+	btree_node_persisted* right = get_child(this, parent, left_index + 1);
+	btree_node_persisted* middle;
+	uint64_t middle_min_key;
+	if (leaf) {
+		const uint16_t left_keys = get_n_leaf_keys(left);
+		const uint16_t total_keys = left_keys + get_n_leaf_keys(right);
+		const uint16_t to_left = total_keys / 3;
+		const uint16_t to_middle = (total_keys - to_left) / 2;
+		middle = new_empty_leaf(this);
+		link_leaf_after(left, middle);
+		rebalance_leaves(left, middle, to_left, left_keys - to_left,
+				NULL);
+		rebalance_leaves(middle, right, to_middle,
+				total_keys - to_left - to_middle,
+				&parent->internal.keys[left_index]);
+		middle_min_key = middle->leaf.keys[0];
+	} else {
+		// Keys of both nodes and the separator between them.
+		// Two of them go up to the parent.
+		const uint16_t total_keys = get_n_internal_keys(left) + 1 +
+				get_n_internal_keys(right);
+		uint64_t keys[total_keys];
+		btree_node_ref pointers[total_keys + 1];
+		for (uint16_t i = 0; i < left->internal.key_count; i++) {
+			keys[i] = left->internal.keys[i];
+			pointers[i] = left->internal.pointers[i];
+		}
+		pointers[left->internal.key_count] =
+				left->internal.pointers[left->internal.key_count];
+		keys[left->internal.key_count] =
+				parent->internal.keys[left_index];
+		for (uint16_t i = 0; i <= right->internal.key_count; i++) {
+			if (i < right->internal.key_count) {
+				keys[left->internal.key_count + 1 + i] =
+						right->internal.keys[i];
+			}
+			pointers[left->internal.key_count + 1 + i] =
+					right->internal.pointers[i];
+		}
+
+		const uint16_t to_left = (total_keys - 2) / 3;
+		const uint16_t to_middle = (total_keys - 2 - to_left) / 2;
+		const uint16_t to_right = total_keys - 2 - to_left - to_middle;
+		middle = alloc_node(this);
+		btree_node_persisted* nodes[3] = { left, middle, right };
+		const uint16_t counts[3] = { to_left, to_middle, to_right };
+		uint16_t next = 0;
+		for (uint8_t n = 0; n < 3; n++) {
+			nodes[n]->internal.key_count = counts[n];
+			for (uint16_t i = 0; i < counts[n]; i++) {
+				nodes[n]->internal.keys[i] = keys[next + i];
+			}
+			for (uint16_t i = 0; i <= counts[n]; i++) {
+				nodes[n]->internal.pointers[i] =
+						pointers[next + i];
+			}
+			next += counts[n] + 1;
+		}
+		middle_min_key = keys[to_left];
+		parent->internal.keys[left_index] = keys[to_left + 1 + to_middle];
+	}
+	insert_pointer(parent, middle_min_key, get_ref(this, middle));
+}
+
+// Makes room in a full non-root node of a B*-tree, whose parent is not full.
+static void make_room_bstar(btree* this, btree_node_persisted* parent,
+		btree_node_traversed node, uint64_t key) {
+	const bool leaf = nt_is_leaf(node);
+	const uint16_t i = child_index(parent, key);
+	const uint16_t parent_keys = get_n_internal_keys(parent);
+	assert(get_child(this, parent, i) == node.persisted &&
+			parent_keys > 0);
+	if (i > 0 && can_take_keys(get_child(this, parent, i - 1), leaf)) {
+		log_verbose(1, "shifting keys left from %p", node.persisted);
+		even_out_children(this, parent, i - 1, leaf);
+	} else if (i < parent_keys &&
+			can_take_keys(get_child(this, parent, i + 1), leaf)) {
+		log_verbose(1, "shifting keys right from %p", node.persisted);
+		even_out_children(this, parent, i, leaf);
+	} else {
+		log_verbose(1, "splitting %p and a neighbour into 3",
+				node.persisted);
+		split_two_into_three(this, parent, (i < parent_keys) ? i : i - 1,
+				leaf);
+	}
+}
+
+// Whether the key goes after all keys of the tree, into the last leaf.
+static bool is_append(const btree* this, const btree_node_persisted* leaf,
+		uint64_t key) {
+	const uint16_t key_count = get_n_leaf_keys(leaf);
+	return leaf == this->last_leaf &&
+			(key_count == 0 || key > leaf->leaf.keys[key_count - 1]);
+}
+
+// Splitting the last leaf in half for an append would leave the left half
+// half empty for good, since appends only go to the right. The left part
+// keeps about 90% of the keys instead.
+static void split_last_leaf(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key) {
+	const uint16_t total_keys = get_n_leaf_keys(node);
+	const uint16_t to_right = (total_keys + 9) / 10;
+	link_leaf_after(node, new_right_sibling);
+	rebalance_leaves(node, new_right_sibling, total_keys - to_right,
+			to_right, middle_key);
+}
+
+// Descends to the leaf where the key belongs, splitting full nodes
+// on the way, so that the leaf has room for one more key.
+static btree_node_persisted* split_down_to_leaf(btree* this, uint64_t key) {
+	btree_node_persisted* parent = NULL;
+	btree_node_traversed node = nt_root(this);
+
+	do {
+		const bool append = nt_is_leaf(node) &&
+				is_append(this, node.persisted, key);
+		if (is_full(node) && this->bstar && parent != NULL && !append) {
+			make_room_bstar(this, parent, node, key);
+			// The key may now belong to a neighbour.
+			node.persisted = get_child(this, parent,
+					child_index(parent, key));
+			assert(!is_full(node));
+		} else if (is_full(node)) {
+			log_verbose(1, "splitting %p", node.persisted);
+			// We need to split the node now.
+			btree_node_persisted* new_right_sibling;
+			uint64_t middle_key;
+			if (nt_is_leaf(node)) {
+				new_right_sibling = new_empty_leaf(this);
+				if (append) {
+					split_last_leaf(node.persisted,
+							new_right_sibling,
+							&middle_key);
+				} else {
+					split_leaf(node.persisted,
+							new_right_sibling,
+							&middle_key);
+				}
+				if (node.persisted == this->last_leaf) {
+					this->last_leaf = new_right_sibling;
+				}
+			} else {
+				new_right_sibling = alloc_node(this);
+				split_internal(node.persisted,
+						new_right_sibling, &middle_key);
+			}
+			log_verbose(1, "middle key: %" PRIu64, middle_key);
+			if (parent == NULL) {
+				set_new_root(this, middle_key, node.persisted,
+						new_right_sibling);
+				++this->levels_above_leaves;
+				IF_LOG_VERBOSE(1) {
+					log_info("setting new root %p", this->root);
+					log_info("I now look like this:");
+					//dump_recursive(this->root, 0);
+				}
+			} else {
+				insert_pointer(parent, middle_key,
+						get_ref(this, new_right_sibling));
+			}
+			if (key >= middle_key) {
+				log_verbose(1, "going to right sibling (%p)",
+						new_right_sibling);
+				node.persisted = new_right_sibling;
+			}
+		}
+		if (nt_is_leaf(node)) {
+			break;
+		}
+		log_verbose(1, "now at: parent=%p node=%p",
+				parent, node.persisted);
+		parent = node.persisted;
+		node = nt_advance(this, node, key);
+		log_verbose(1, "went to: parent=%p node=%p",
+				parent, node.persisted);
+	} while (true);
+	return node.persisted;
+}
+
+bool btree_insert(btree* this, uint64_t key, uint64_t value) {
+	if (key == SLOT_UNUSED && value == SLOT_UNUSED) {
+		log_fatal("Attempted to insert reserved value.");
+	}
+	btree_node_persisted* last = this->last_leaf;
+	const uint16_t last_keys = get_n_leaf_keys(last);
+	if (last_keys < LEAF_MAX_KEYS && is_append(this, last, key)) {
+		last->leaf.keys[last_keys] = key;
+		last->leaf.values[last_keys] = value;
+		return true;
+	}
+	return insert_key_value_pair(split_down_to_leaf(this, key), key, value);
+}
+
+static void collapse_if_singleton_root(btree* this,
+		btree_node_persisted* node) {
+	if (node == this->root && get_n_internal_keys(node) == 0) {
+		// Singleton parent.
+		this->root = get_child(this, node, 0);
+		free_node(this, node);
+		--this->levels_above_leaves;
+	}
+}
+
+// Removes child i of an internal node with at least one key,
+// together with a key next to it.
+static void remove_child(btree_node_persisted* node, uint16_t i) {
+	const uint16_t key_count = get_n_internal_keys(node);
+	assert(key_count > 0 && i <= key_count);
+	// The first child takes the key after it along, others the key
+	// before them.
+	for (uint16_t k = (i == 0) ? 0 : i - 1; k + 1 < key_count; k++) {
+		node->internal.keys[k] = node->internal.keys[k + 1];
+	}
+	for (uint16_t p = i; p < key_count; p++) {
+		node->internal.pointers[p] = node->internal.pointers[p + 1];
+	}
+	--node->internal.key_count;
+}
+
+// Relaxed deletion (Sen & Tarjan, "Deletion without rebalancing in
+// multiway search trees", 2009): only a leaf left empty is removed,
+// together with ancestors left without children.
+static bool delete_relaxed(btree* this, uint64_t key) {
+	btree_node_persisted* path[UINT8_MAX];
+	uint8_t depth = 0;
+	btree_node_traversed node = nt_root(this);
+	while (!nt_is_leaf(node)) {
+		path[depth++] = node.persisted;
+		node = nt_advance(this, node, key);
+	}
+	btree_node_persisted* leaf = node.persisted;
+	if (!remove_from_leaf(leaf, key)) {
+		return false;
+	}
+	if (depth == 0 || get_n_leaf_keys(leaf) > 0) {
+		return true;
+	}
+
+	if (leaf == this->last_leaf) {
+		this->last_leaf = leaf->leaf.previous;
+	}
+	unlink_leaf(leaf);
+	free_node(this, leaf);
+	while (depth > 0) {
+		btree_node_persisted* parent = path[--depth];
+		if (get_n_internal_keys(parent) > 0) {
+			remove_child(parent, child_index(parent, key));
+			break;
+		}
+		// The removed node was the only child.
+		free_node(this, parent);
+		if (depth == 0) {
+			// That was the root, so the tree is empty now.
+			this->root = new_empty_leaf(this);
+			this->last_leaf = this->root;
+			this->levels_above_leaves = 0;
+		}
+	}
+	while (!nt_is_leaf(nt_root(this)) &&
+			get_n_internal_keys(this->root) == 0) {
+		collapse_if_singleton_root(this, this->root);
+	}
+	return true;
+}
+
+bool btree_delete(btree* this, uint64_t key) {
+	if (this->relaxed_deletion) {
+		return delete_relaxed(this, key);
+	}
+	btree_node_persisted* parent = NULL;
+	btree_node_traversed node = nt_root(this);
+
+	// TODO: maybe something ultraspecial when deleting pivotal nodes?
+	do {
+		// Only the last leaf can have less than LEAF_MIN_KEYS keys.
+		if (parent && ((nt_is_leaf(node) && get_n_leaf_keys(node.persisted) <= LEAF_MIN_KEYS) ||
+				(!nt_is_leaf(node) && get_n_internal_keys(node.persisted) == INTERNAL_MIN_KEYS))) {
+			uint16_t right_index;
+			btree_node_persisted *left, *right;
+			find_siblings(this, node.persisted, parent, &left, &right,
+					&right_index);
+
+			enum side_preference preference;
+			if (left == node.persisted) {
+				preference = LEFT;
+			} else {
+				preference = RIGHT;
+			}
+
+			uint16_t total_keys;
+			if (nt_is_leaf(node)) {
+				total_keys = get_n_leaf_keys(left) + get_n_leaf_keys(right);
+				assert(total_keys >= LEAF_MIN_KEYS);
+				assert(total_keys <= 2 * LEAF_MAX_KEYS);
+
+				if (total_keys <= 2 * LEAF_MIN_KEYS) {
+					log_verbose(1, "concatting leaves");
+					append_leaf(left, right);
+					if (right == this->last_leaf) {
+						this->last_leaf = left;
+					}
+					node.persisted = left;
+					remove_ptr_from_node(parent,
+							get_ref(this, right));
+					free_node(this, right);
+					collapse_if_singleton_root(
+							this, parent);
+				} else {
+					log_verbose(1, "leaf rebalance");
+					uint16_t to_left, to_right;
+					split_keys_with_preference(total_keys,
+							preference,
+							&to_left, &to_right);
+
+					uint64_t right_min_key;
+					assert(to_left >= LEAF_MIN_KEYS &&
+							to_right >= LEAF_MIN_KEYS &&
+							to_left <= LEAF_MAX_KEYS &&
+							to_right <= LEAF_MAX_KEYS);
+					rebalance_leaves(left, right,
+							to_left, to_right,
+							&right_min_key);
+
+					//assert(parent->internal.pointers[right_index - 1] == left);
+					//assert(parent->internal.pointers[right_index] == right);
+					parent->internal.keys[right_index - 1] = right_min_key;
+
+					// AKA: node = advance(parent, key);
+					if (key < parent->internal.keys[right_index - 1]) {
+						node.persisted = left;
+					} else {
+						node.persisted = right;
+					}
+				}
+			} else {
+				total_keys = get_n_internal_keys(left) + get_n_internal_keys(right);
+				assert(total_keys >= INTERNAL_MIN_KEYS);
+				assert(total_keys <= 2 * INTERNAL_MAX_KEYS);
+
+				if (total_keys <= 2 * INTERNAL_MIN_KEYS) {
+					log_verbose(1, "concatting internals");
+					append_internal(left,
+							parent->internal.keys[right_index - 1],
+							right);
+					node.persisted = left;
+					remove_ptr_from_node(parent,
+							get_ref(this, right));
+					free_node(this, right);
+					collapse_if_singleton_root(
+							this, parent);
+				} else {
+					log_verbose(1, "internal rebalance");
+					uint16_t to_left, to_right;
+					split_keys_with_preference(total_keys,
+							preference,
+							&to_left, &to_right);
+					rebalance_internal(parent, left, right,
+							right_index,
+							to_left, to_right);
+					// AKA: node = advance(parent, key);
+					if (key < parent->internal.keys[right_index - 1]) {
+						node.persisted = left;
+					} else {
+						node.persisted = right;
+					}
+				}
+			}
+		}
+		if (nt_is_leaf(node)) {
+			break;
+		}
+		log_verbose(1, "now at: parent=%p node=%p",
+				parent, node.persisted);
+		parent = node.persisted;
+		node = nt_advance(this, node, key);
+		log_verbose(1, "went to: parent=%p node=%p",
+				parent, node.persisted);
+	} while (true);
+	assert(node.persisted == this->root ||
+			get_n_leaf_keys(node.persisted) > LEAF_MIN_KEYS);
+	if (!remove_from_leaf(node.persisted, key)) {
+		return false;
+	}
+	if (parent && get_n_leaf_keys(node.persisted) == 0) {
+		if (node.persisted == this->last_leaf) {
+			this->last_leaf = node.persisted->leaf.previous;
+		}
+		remove_ptr_from_node(parent, get_ref(this, node.persisted));
+		unlink_leaf(node.persisted);
+		free_node(this, node.persisted);
+		collapse_if_singleton_root(this, parent);
+	} else {
+		if (node.persisted != this->root) {
+			assert(get_n_leaf_keys(node.persisted) >= LEAF_MIN_KEYS);
+		}
+	}
+	return true;
+}
+
+static bool find_in_leaf(const btree_node_persisted* leaf, uint64_t key,
+		uint64_t *value) {
+	const uint16_t key_count = get_n_leaf_keys(leaf);
+	const uint16_t i = search_find(leaf->leaf.keys, key_count, key);
+	if (i == key_count) {
+		return false;
+	}
+	if (value) {
+		*value = leaf->leaf.values[i];
+	}
+	return true;
+}
+
+static btree_node_persisted* find_leaf(btree* this, uint64_t key) {
+	btree_node_traversed node = nt_root(this);
+
+	while (!nt_is_leaf(node)) {
+		node = nt_advance(this, node, key);
+	}
+	return node.persisted;
+}
+
+bool btree_find(btree* this, uint64_t key, uint64_t *value) {
+	return find_in_leaf(find_leaf(this, key), key, value);
+}
+
+static uint64_t* find_slot_in_leaf(btree_node_persisted* leaf, uint64_t key) {
+	const uint16_t key_count = get_n_leaf_keys(leaf);
+	const uint16_t i = search_find(leaf->leaf.keys, key_count, key);
+	return (i == key_count) ? NULL : &leaf->leaf.values[i];
+}
+
+bool btree_upsert(btree* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	*slot = find_slot_in_leaf(find_leaf(this, key), key);
+	if (*slot != NULL) {
+		return false;
+	}
+	if (key == SLOT_UNUSED && default_value == SLOT_UNUSED) {
+		log_fatal("Attempted to insert reserved value.");
+	}
+	// Missing keys need a second descent that makes room in the leaf.
+	btree_node_persisted* leaf = split_down_to_leaf(this, key);
+	ASSERT(insert_key_value_pair(leaf, key, default_value));
+	*slot = find_slot_in_leaf(leaf, key);
+	return true;
+}
+
+static void prefetch_node(const btree_node_persisted* node) {
+	for (uint64_t offset = 0; offset < sizeof(btree_node_persisted);
+			offset += 64) {
+		__builtin_prefetch((const char*) node + offset);
+	}
+}
+
+// Batched lookups walk a group of keys down the tree one level at a time.
+// Every node on the next level is prefetched before any of them is read,
+// so the cache misses of the whole group overlap.
+#define FIND_BATCH_GROUP 16
+
+void btree_find_batch(btree* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	btree_node_traversed nodes[FIND_BATCH_GROUP];
+	for (uint64_t begin = 0; begin < n; begin += FIND_BATCH_GROUP) {
+		const uint64_t group = (n - begin < FIND_BATCH_GROUP) ?
+				(n - begin) : FIND_BATCH_GROUP;
+		for (uint64_t i = 0; i < group; i++) {
+			nodes[i] = nt_root(this);
+		}
+		for (uint8_t level = 0; level < this->levels_above_leaves;
+				level++) {
+			for (uint64_t i = 0; i < group; i++) {
+				nodes[i] = nt_advance(this, nodes[i],
+						keys[begin + i]);
+				prefetch_node(nodes[i].persisted);
+			}
+		}
+		for (uint64_t i = 0; i < group; i++) {
+			found[begin + i] = find_in_leaf(nodes[i].persisted,
+					keys[begin + i],
+					values ? &values[begin + i] : NULL);
+		}
+	}
+}
+
+static bool find_next_in_leaf(const btree_node_persisted* node,
+		uint64_t key, uint64_t *next) {
+	const uint16_t key_count = get_n_leaf_keys(node);
+	const uint16_t i = search_count_le(node->leaf.keys, key_count, key);
+	if (i == key_count) {
+		return false;
+	}
+	*next = node->leaf.keys[i];
+	return true;
+}
+
+static bool find_prev_in_leaf(const btree_node_persisted* node,
+		uint64_t key, uint64_t *prev) {
+	const uint16_t i = search_count_lt(node->leaf.keys,
+			get_n_leaf_keys(node), key);
+	if (i == 0) {
+		return false;
+	}
+	*prev = node->leaf.keys[i - 1];
+	return true;
+}
+
+bool btree_find_next(btree* this, uint64_t key, uint64_t *next) {
+	// TODO: check against key == UINT64_MAX
+	const btree_node_persisted* leaf = find_leaf(this, key);
+	if (find_next_in_leaf(leaf, key, next)) {
+		return true;
+	}
+	// Only the root leaf can be empty, so the next leaf has a minimum.
+	leaf = leaf->leaf.next;
+	if (leaf == NULL) {
+		return false;
+	}
+	*next = leaf->leaf.keys[0];
+	return true;
+}
+
+bool btree_find_prev(btree* this, uint64_t key, uint64_t *prev) {
+	// TODO: check against key == UINT64_MAX
+	const btree_node_persisted* leaf = find_leaf(this, key);
+	if (find_prev_in_leaf(leaf, key, prev)) {
+		return true;
+	}
+	leaf = leaf->leaf.previous;
+	if (leaf == NULL) {
+		return false;
+	}
+	*prev = leaf->leaf.keys[get_n_leaf_keys(leaf) - 1];
+	return true;
+}
+
+void btree_cursor_init(btree_cursor* cursor, btree* tree) {
+	cursor->tree = tree;
+	cursor->leaf = NULL;
+	cursor->index = 0;
+}
+
+bool btree_cursor_seek(btree_cursor* cursor, uint64_t key) {
+	cursor->leaf = find_leaf(cursor->tree, key);
+	const uint16_t key_count = get_n_leaf_keys(cursor->leaf);
+	cursor->index = search_count_lt(cursor->leaf->leaf.keys, key_count, key);
+	if (cursor->index < key_count) {
+		return true;
+	}
+	cursor->leaf = cursor->leaf->leaf.next;
+	cursor->index = 0;
+	return cursor->leaf != NULL;
+}
+
+bool btree_cursor_last(btree_cursor* cursor) {
+	cursor->leaf = find_leaf(cursor->tree, UINT64_MAX);
+	const uint16_t key_count = get_n_leaf_keys(cursor->leaf);
+	if (key_count == 0) {
+		return false;
+	}
+	cursor->index = key_count - 1;
+	return true;
+}
+
+bool btree_cursor_next(btree_cursor* cursor) {
+	if (cursor->index + 1 < get_n_leaf_keys(cursor->leaf)) {
+		++cursor->index;
+		return true;
+	}
+	cursor->leaf = cursor->leaf->leaf.next;
+	cursor->index = 0;
+	return cursor->leaf != NULL;
+}
+
+bool btree_cursor_prev(btree_cursor* cursor) {
+	if (cursor->index > 0) {
+		--cursor->index;
+		return true;
+	}
+	cursor->leaf = cursor->leaf->leaf.previous;
+	if (cursor->leaf == NULL) {
+		return false;
+	}
+	cursor->index = get_n_leaf_keys(cursor->leaf) - 1;
+	return true;
+}
+
+uint64_t btree_cursor_key(const btree_cursor* cursor) {
+	return cursor->leaf->leaf.keys[cursor->index];
+}
+
+uint64_t btree_cursor_value(const btree_cursor* cursor) {
+	return cursor->leaf->leaf.values[cursor->index];
+}
+
+// Details of node representation:
+
+// Empties the keys and values of a leaf. Sibling links are kept.
+static void clear_leaf(btree_node_persisted* leaf) {
+	for (uint16_t i = 0; i < LEAF_MAX_KEYS; ++i) {
+		leaf->leaf.keys[i] = SLOT_UNUSED;
+		leaf->leaf.values[i] = SLOT_UNUSED;
+	}
+}
+
+static btree_node_persisted* new_empty_leaf(btree* this) {
+	btree_node_persisted* new_node = alloc_node(this);
+	clear_leaf(new_node);
+	new_node->leaf.previous = NULL;
+	new_node->leaf.next = NULL;
+	return new_node;
+}
+
+static btree_node_persisted* new_fork_node(btree* this, uint64_t middle_key,
+		btree_node_persisted* left, btree_node_persisted* right) {
+	btree_node_persisted* new_node = alloc_node(this);
+	new_node->internal.key_count = 1;
+	new_node->internal.keys[0] = middle_key;
+	new_node->internal.pointers[0] = get_ref(this, left);
+	new_node->internal.pointers[1] = get_ref(this, right);
+	return new_node;
+}
+
+void split_leaf(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key) {
+	assert(get_n_leaf_keys(new_right_sibling) == 0);
+
+	const uint16_t total_keys = get_n_leaf_keys(node);
+	const uint16_t to_left = total_keys / 2;
+	const uint16_t to_right = total_keys - to_left;
+	assert(to_left >= LEAF_MIN_KEYS && to_right >= LEAF_MIN_KEYS &&
+			to_left <= LEAF_MAX_KEYS && to_right <= LEAF_MAX_KEYS);
+	link_leaf_after(node, new_right_sibling);
+	rebalance_leaves(node, new_right_sibling, to_left, to_right, middle_key);
+}
+
+void split_internal(btree_node_persisted* node,
+		btree_node_persisted* new_right_sibling, uint64_t *middle_key) {
+	const uint16_t to_left = node->internal.key_count / 2;
+	const uint16_t to_right = node->internal.key_count - to_left - 1;
+
+	assert(to_left + 1 + to_right == node->internal.key_count);
+
+	node->internal.key_count = to_left;
+	new_right_sibling->internal.key_count = to_right;
+
+	*middle_key = node->internal.keys[to_left];
+	for (uint16_t i = to_left + 1; i < to_left + 1 + to_right; i++) {
+		new_right_sibling->internal.keys[i - to_left - 1] = node->internal.keys[i];
+	}
+	for (uint16_t i = 0; i < to_right + 1; i++) {
+		new_right_sibling->internal.pointers[i] =
+			node->internal.pointers[to_left + 1 + i];
+	}
+}
+
+void insert_pointer(btree_node_persisted* node, uint64_t key,
+		btree_node_ref pointer) {
+	assert(node->internal.key_count < INTERNAL_MAX_KEYS);
+	const uint16_t insert_at = search_count_le(node->internal.keys,
+			node->internal.key_count, key);
+	log_verbose(2, "inserting at %" PRIu16, insert_at);
+	for (uint16_t i = node->internal.key_count; i > insert_at; --i) {
+		log_verbose(2, "key %" PRIu16 " <- %" PRIu16 " (%" PRIu64 ")",
+				i - 1, i, node->internal.keys[i - 1]);
+		node->internal.keys[i] = node->internal.keys[i - 1];
+	}
+	for (uint16_t i = node->internal.key_count + 1; i > insert_at + 1; --i) {
+		node->internal.pointers[i] = node->internal.pointers[i - 1];
+	}
+	node->internal.keys[insert_at] = key;
+	node->internal.pointers[insert_at + 1] = pointer;
+	++node->internal.key_count;
+}
+
+static void remove_ptr_from_node(btree_node_persisted* parent,
+		btree_node_ref remove) {
+	assert(parent->internal.pointers[0] != remove);
+	bool found = false;
+	for (uint16_t i = 1; i < parent->internal.key_count + 1; ++i) {
+		if (!found && parent->internal.pointers[i] == remove) {
+			found = true;
+		}
+		if (found && i < parent->internal.key_count) {
+			parent->internal.keys[i - 1] = parent->internal.keys[i];
+			parent->internal.pointers[i] = parent->internal.pointers[i + 1];
+		}
+	}
+	assert(found);
+	--parent->internal.key_count;
+}
+
+bool insert_key_value_pair(btree_node_persisted* leaf,
+		uint64_t key, uint64_t value) {
+	assert(get_n_leaf_keys(leaf) < LEAF_MAX_KEYS);
+	uint16_t insert_at;
+	for (insert_at = 0; insert_at < LEAF_MAX_KEYS; insert_at++) {
+		if (leaf->leaf.keys[insert_at] == SLOT_UNUSED &&
+				leaf->leaf.values[insert_at] == SLOT_UNUSED) {
+			break;
+		}
+		if (leaf->leaf.keys[insert_at] == key) {
+			return false;  // Duplicate keys.
+		}
+		if (leaf->leaf.keys[insert_at] > key) {
+			break;
+		}
+	}
+	for (uint16_t i = get_n_leaf_keys(leaf); i > insert_at; --i) {
+		leaf->leaf.keys[i] = leaf->leaf.keys[i - 1];
+		leaf->leaf.values[i] = leaf->leaf.values[i - 1];
+	}
+	leaf->leaf.keys[insert_at] = key;
+	leaf->leaf.values[insert_at] = value;
+	return true;
+}
+
+static bool remove_from_leaf(btree_node_persisted* leaf, uint64_t key) {
+	bool found = false;
+	for (uint16_t i = 0; i < LEAF_MAX_KEYS; i++) {
+		if (leaf->leaf.keys[i] == SLOT_UNUSED &&
+				leaf->leaf.values[i] == SLOT_UNUSED) {
+			break;
+		}
+		if (!found && leaf->leaf.keys[i] == key) {
+			found = true;
+		}
+		if (found && i < LEAF_MAX_KEYS - 1) {
+			leaf->leaf.keys[i] = leaf->leaf.keys[i + 1];
+			leaf->leaf.values[i] = leaf->leaf.values[i + 1];
+		}
+	}
+	if (found) {
+		leaf->leaf.keys[LEAF_MAX_KEYS - 1] = SLOT_UNUSED;
+		leaf->leaf.values[LEAF_MAX_KEYS - 1] = SLOT_UNUSED;
+	}
+	return found;
+}
+
+static void rebalance_internal(btree_node_persisted* parent,
+		btree_node_persisted* left, btree_node_persisted* right,
+		const uint16_t right_index,
+		const uint16_t to_left, const uint16_t to_right) {
+	// TODO: optimize
+	const uint16_t total_keys = left->internal.key_count + right->internal.key_count;
+
+	assert(to_left >= INTERNAL_MIN_KEYS && to_right >= INTERNAL_MIN_KEYS &&
+			to_left <= INTERNAL_MAX_KEYS &&
+			to_right <= INTERNAL_MAX_KEYS);
+
+	uint64_t keys[total_keys + 1];
+	btree_node_ref pointers[total_keys + 2];
+
+	for (uint16_t i = 0; i < left->internal.key_count; i++) {
+		keys[i] = left->internal.keys[i];
+	}
+	keys[left->internal.key_count] = parent->internal.keys[right_index - 1];
+	for (uint16_t i = 0; i < right->internal.key_count; i++) {
+		keys[left->internal.key_count + 1 + i] = right->internal.keys[i];
+	}
+
+	for (uint16_t i = 0; i < left->internal.key_count + 1; i++) {
+		pointers[i] = left->internal.pointers[i];
+	}
+	for (uint16_t i = 0; i < right->internal.key_count + 1; i++) {
+		pointers[left->internal.key_count + 1 + i] = right->internal.pointers[i];
+	}
+
+	left->internal.key_count = to_left;
+	for (uint16_t i = 0; i < to_left; i++) {
+		left->internal.keys[i] = keys[i];
+	}
+	for (uint16_t i = 0; i < to_left + 1; i++) {
+		left->internal.pointers[i] = pointers[i];
+	}
+	log_verbose(1, "setting parent->keys[%" PRIu16 "]=%" PRIu64,
+			right_index - 1, keys[to_left]);
+	parent->internal.keys[right_index - 1] = keys[to_left];
+	for (uint16_t i = 0; i < to_right; i++) {
+		right->internal.keys[i] = keys[to_left + 1 + i];
+	}
+	for (uint16_t i = 0; i < to_right + 1; i++) {
+		right->internal.pointers[i] = pointers[to_left + 1 + i];
+	}
+	right->internal.key_count = to_right;
+}
+
+static void rebalance_leaves(
+		btree_node_persisted* left, btree_node_persisted* right,
+		const uint16_t to_left, const uint16_t to_right,
+		uint64_t* right_min_key) {
+	// TODO: optimize
+	const uint16_t total_keys = get_n_leaf_keys(left) + get_n_leaf_keys(right);
+	// Keys only move between neighbours, so sibling links stay as they are.
+	assert(left->leaf.next == right && right->leaf.previous == left);
+
+	uint64_t keys[total_keys];
+	uint64_t values[total_keys];
+
+	const uint16_t left_keys = get_n_leaf_keys(left);
+	const uint16_t right_keys = get_n_leaf_keys(right);
+
+	for (uint16_t i = 0; i < left_keys; i++) {
+		keys[i] = left->leaf.keys[i];
+		values[i] = left->leaf.values[i];
+	}
+	for (uint16_t i = 0; i < right_keys; i++) {
+		keys[i + left_keys] = right->leaf.keys[i];
+		values[i + left_keys] = right->leaf.values[i];
+	}
+	clear_leaf(left);
+	for (uint16_t i = 0; i < to_left; i++) {
+		left->leaf.keys[i] = keys[i];
+		left->leaf.values[i] = values[i];
+	}
+	clear_leaf(right);
+	for (uint16_t i = 0; i < to_right; i++) {
+		right->leaf.keys[i] = keys[i + to_left];
+		right->leaf.values[i] = values[i + to_left];
+	}
+	if (right_min_key != NULL) {
+		*right_min_key = right->leaf.keys[0];
+	}
+}
+
+static void append_internal(btree_node_persisted* target, uint64_t appended_key,
+		const btree_node_persisted* source) {
+	assert(target->internal.key_count + 1 + source->internal.key_count <= INTERNAL_MAX_KEYS);
+	target->internal.keys[target->internal.key_count] = appended_key;
+	for (uint16_t i = 0; i < source->internal.key_count; ++i) {
+		assert(target->internal.key_count + 1 + i < INTERNAL_MAX_KEYS);
+		target->internal.keys[target->internal.key_count + 1 + i] =
+				source->internal.keys[i];
+	}
+	for (uint16_t i = 0; i < source->internal.key_count + 1; ++i) {
+		target->internal.pointers[target->internal.key_count + 1 + i] =
+				source->internal.pointers[i];
+	}
+	target->internal.key_count += source->internal.key_count + 1;
+}
+
+static void append_leaf(btree_node_persisted* target,
+		btree_node_persisted* source) {
+	const uint16_t total_keys = get_n_leaf_keys(source) + get_n_leaf_keys(target);
+	assert(total_keys >= LEAF_MIN_KEYS && total_keys <= LEAF_MAX_KEYS);
+	assert(target->leaf.next == source);
+	rebalance_leaves(target, source, total_keys, 0, NULL);
+	unlink_leaf(source);
+}
+
+static void link_leaf_after(btree_node_persisted* leaf,
+		btree_node_persisted* new_next) {
+	new_next->leaf.previous = leaf;
+	new_next->leaf.next = leaf->leaf.next;
+	if (leaf->leaf.next != NULL) {
+		leaf->leaf.next->leaf.previous = new_next;
+	}
+	leaf->leaf.next = new_next;
+}
+
+static void unlink_leaf(btree_node_persisted* leaf) {
+	if (leaf->leaf.previous != NULL) {
+		leaf->leaf.previous->leaf.next = leaf->leaf.next;
+	}
+	if (leaf->leaf.next != NULL) {
+		leaf->leaf.next->leaf.previous = leaf->leaf.previous;
+	}
+	leaf->leaf.previous = leaf->leaf.next = NULL;
+}
+
+uint16_t get_n_leaf_keys(const btree_node_persisted* node) {
+	// Keys are sorted and unused slots are at the end, so the first
+	// SLOT_UNUSED key is either unused, or a stored SLOT_UNUSED key
+	// with some other value, followed by unused slots.
+	const uint16_t i = search_find(node->leaf.keys, LEAF_MAX_KEYS,
+			SLOT_UNUSED);
+	if (i < LEAF_MAX_KEYS && node->leaf.values[i] != SLOT_UNUSED) {
+		return i + 1;
+	}
+	return i;
+}
+
+static uint16_t get_n_internal_keys(const btree_node_persisted* node) {
+	return node->internal.key_count;
+}
+
+static void find_siblings(const btree* this, btree_node_persisted* node,
+		btree_node_persisted* parent,
+		btree_node_persisted** left, btree_node_persisted** right,
+		uint16_t* right_index) {
+	if (get_child(this, parent, 0) == node) {
+		*left = node;
+		*right_index = 1;
+		*right = get_child(this, parent, 1);
+	} else {
+		for (uint16_t i = 1; i < get_n_internal_keys(parent) + 1; ++i) {
+			if (get_child(this, parent, i) == node) {
+				*left = get_child(this, parent, i - 1);
+				*right_index = i;
+				*right = node;
+				return;
+			}
+		}
+		log_fatal("node not found in parent when looking for sibling");
+	}
+}
+
+#define BTREE_DOT_POINTERS_IN_LABELS false
+#define BTREE_DOT_VALUES_IN_LABELS false
+
+static void _dump_dot(const btree* this, btree_node_traversed node,
+		FILE* output) {
+	fprintf(output, "    node%p[label = \"", node.persisted);
+
+	if (BTREE_DOT_POINTERS_IN_LABELS) {
+		fprintf(output, "{%p|", node.persisted);
+	} else {
+		fprintf(output, "{");
+	}
+	fprintf(output, "{");
+	if (nt_is_leaf(node)) {
+		for (uint16_t i = 0; i < get_n_leaf_keys(node.persisted); ++i) {
+			if (i != 0) {
+				fprintf(output, "|");
+			}
+			fprintf(output, "%" PRIu64,
+					node.persisted->leaf.keys[i]);
+			if (BTREE_DOT_VALUES_IN_LABELS) {
+				fprintf(output, "=%" PRIu64,
+					node.persisted->leaf.values[i]);
+			}
+		}
+	} else {
+		for (uint16_t i = 0; i < get_n_internal_keys(node.persisted);
+				++i) {
+			fprintf(output, "<child%d>|%" PRIu64 "|",
+					i, node.persisted->internal.keys[i]);
+		}
+		fprintf(output, "<child%d>",
+				get_n_internal_keys(node.persisted));
+	}
+	fprintf(output, "}}\"];\n");
+
+	if (!nt_is_leaf(node)) {
+		for (uint16_t i = 0; i <= get_n_internal_keys(node.persisted);
+				++i) {
+			fprintf(output, "    \"node%p\":child%d -> \"node%p\";\n",
+					node.persisted, i,
+					get_child(this, node.persisted, i));
+		}
+
+		for (uint16_t i = 0; i <= get_n_internal_keys(node.persisted);
+				++i) {
+			btree_node_traversed child = {
+				.persisted = get_child(this, node.persisted, i),
+				.levels_above_leaves = node.levels_above_leaves - 1
+			};
+			_dump_dot(this, child, output);
+		}
+	}
+}
+
+void btree_dump_dot(const btree* this, FILE* output) {
+	fprintf(output, "digraph btree_%p {\n", this);
+	fprintf(output, "    splines = polyline;\n");
+	fprintf(output, "    node [shape = record, height = .1];\n");
+	// TODO: constness trouble and all, can't use nt_root here :(
+	btree_node_traversed root = {
+		.persisted = this->root,
+		.levels_above_leaves = this->levels_above_leaves
+	};
+	_dump_dot(this, root, output);
+	fprintf(output, "}\n");
+}
+
+void btree_collect_stats_recursive(const btree* this,
+		btree_node_traversed node, uint64_t depth, btree_stats* stats) {
+	if (nt_is_leaf(node)) {
+		stats->total_kvp_path_length += get_n_leaf_keys(node.persisted) * depth;
+		stats->total_kvps += get_n_leaf_keys(node.persisted);
+		stats->leaf_count++;
+		return;
+	}
+	stats->internal_n_keys_histogram[get_n_internal_keys(node.persisted)]++;
+	for (uint16_t i = 0; i <= get_n_internal_keys(node.persisted); ++i) {
+		btree_collect_stats_recursive(this, (btree_node_traversed) {
+			.persisted = get_child(this, node.persisted, i),
+			.levels_above_leaves = node.levels_above_leaves - 1
+		}, depth + 1, stats);
+	}
+}
+
+uint64_t btree_memory_usage(btree* this) {
+#ifdef BTREE_NODE_HANDLES
+	return pool_memory_usage(&this->nodes);
+#else
+	return slab_memory_usage(&this->nodes);
+#endif
+}
+
+btree_stats btree_collect_stats(btree* this) {
+	btree_stats stats = {
+		.internal_n_keys_histogram = { 0 }
+	};
+	btree_collect_stats_recursive(this, nt_root(this), 0, &stats);
+	return stats;
+}
+
+#include "btree/template_end.h"
@@ -1,7 +1,12 @@
 #include "btree/btree.h"
+#include "btree/btree_h32.h"
+#include "btree/frozen.h"
+#include "btree/search.h"
 #include "log/log.h"
+#include "rand/rand.h"
 
 #include <assert.h>
+#include <inttypes.h>
 
 #define MOCK(x) ((void*) (x))
 
@@ -121,9 +126,361 @@ static void test_deletion(void) {
 	btree_destroy(&tree);
 }
 
+// Walks the leaves by sibling links in both directions and checks that
+// they hold `expected` keys in increasing order.
+static void check_leaf_links(btree* tree, uint64_t expected) {
+	btree_node_persisted* leaf = tree->root;
+	for (uint8_t i = 0; i < tree->levels_above_leaves; i++) {
+		leaf = leaf->internal.pointers[0];
+	}
+	ASSERT(leaf->leaf.previous == NULL);
+
+	uint64_t count = 0, last_key = 0;
+	btree_node_persisted* last_leaf = NULL;
+	for (; leaf != NULL; last_leaf = leaf, leaf = leaf->leaf.next) {
+		ASSERT(leaf->leaf.previous == last_leaf);
+		for (uint16_t i = 0; i < get_n_leaf_keys(leaf); i++) {
+			ASSERT(count == 0 || leaf->leaf.keys[i] > last_key);
+			last_key = leaf->leaf.keys[i];
+			++count;
+		}
+	}
+	ASSERT(count == expected);
+
+	for (leaf = last_leaf; leaf != NULL; leaf = leaf->leaf.previous) {
+		count -= get_n_leaf_keys(leaf);
+	}
+	ASSERT(count == 0);
+}
+
+static void test_leaf_links(void) {
+	rand_generator generator = { .state = 0 };
+	btree tree;
+	btree_init(&tree);
+	uint64_t size = 0;
+	for (uint64_t i = 0; i < 20000; i++) {
+		const uint64_t key = rand_next(&generator, 2000);
+		if (i < 10000 || rand_next(&generator, 2)) {
+			size += btree_insert(&tree, key, key);
+		} else {
+			size -= btree_delete(&tree, key);
+		}
+		if (i % 1000 == 0) {
+			check_leaf_links(&tree, size);
+		}
+	}
+	for (uint64_t key = 0; key < 2000; key++) {
+		size -= btree_delete(&tree, key);
+		check_leaf_links(&tree, size);
+	}
+	ASSERT(size == 0);
+	btree_destroy(&tree);
+}
+
+static uint64_t count_nodes(const btree_stats* stats) {
+	uint64_t count = stats->leaf_count;
+	for (uint16_t i = 0; i <= BTREE_INTERNAL_MAX_KEYS; i++) {
+		count += stats->internal_n_keys_histogram[i];
+	}
+	return count;
+}
+
+// Random insertions leave B-tree leaves about 69% full. B*-tree leaves
+// should be fuller, so the B*-tree needs fewer nodes. Deletions then work
+// like in a B-tree.
+static void test_bstar(void) {
+	const uint64_t N = 100000;
+	btree plain, bstar;
+	btree_init(&plain);
+	btree_init_bstar(&bstar);
+	rand_generator generator = { .state = 0 };
+	uint64_t size = 0;
+	for (uint64_t i = 0; i < N; i++) {
+		const uint64_t key = rand_next(&generator, 4 * N);
+		const bool inserted = btree_insert(&bstar, key, key);
+		ASSERT(btree_insert(&plain, key, key) == inserted);
+		size += inserted;
+		if (i % 10000 == 0) {
+			check_leaf_links(&bstar, size);
+		}
+	}
+	check_leaf_links(&bstar, size);
+
+	const btree_stats plain_stats = btree_collect_stats(&plain);
+	const btree_stats bstar_stats = btree_collect_stats(&bstar);
+	const double plain_fill = (double) plain_stats.total_kvps /
+			(plain_stats.leaf_count * BTREE_LEAF_MAX_KEYS);
+	const double bstar_fill = (double) bstar_stats.total_kvps /
+			(bstar_stats.leaf_count * BTREE_LEAF_MAX_KEYS);
+	log_info("leaf fill: B-tree %.2lf, B*-tree %.2lf; nodes: %" PRIu64
+			" vs. %" PRIu64, plain_fill, bstar_fill,
+			count_nodes(&plain_stats), count_nodes(&bstar_stats));
+	ASSERT(bstar_fill > 0.8 && plain_fill < 0.75);
+	ASSERT(count_nodes(&bstar_stats) * 10 < count_nodes(&plain_stats) * 9);
+
+	generator = (rand_generator) { .state = 0 };
+	for (uint64_t i = 0; i < N; i++) {
+		const uint64_t key = rand_next(&generator, 4 * N);
+		uint64_t value;
+		ASSERT(btree_find(&bstar, key, &value) && value == key);
+	}
+	for (uint64_t key = 0; key < 4 * N; key += 2) {
+		size -= btree_delete(&bstar, key);
+	}
+	check_leaf_links(&bstar, size);
+	btree_destroy(&plain);
+	btree_destroy(&bstar);
+}
+
+// The snapshot answers like the tree it was frozen from. Sizes around
+// multiples of the node size and of its fanout check partial nodes.
+static void test_freeze(void) {
+	const uint64_t sizes[] = {
+		0, 1, 15, 16, 17, 272, 273, 289, 1000, 4913, 100000
+	};
+	for (uint64_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+		const uint64_t size = sizes[s];
+		btree tree;
+		btree_init(&tree);
+		for (uint64_t i = 0; i < size; i++) {
+			ASSERT(btree_insert(&tree, 3 * i + 1, i));
+		}
+		btree_frozen frozen;
+		btree_freeze(&tree, &frozen);
+		ASSERT(frozen.size == size);
+
+		for (uint64_t key = 0; key < 3 * size + 3; key++) {
+			uint64_t expected, actual;
+			const bool found = btree_find(&tree, key, &expected);
+			ASSERT(btree_frozen_find(&frozen, key, &actual) == found);
+			ASSERT(!found || actual == expected);
+
+			bool any = btree_find_next(&tree, key, &expected);
+			ASSERT(btree_frozen_find_next(&frozen, key, &actual) == any);
+			ASSERT(!any || actual == expected);
+
+			any = btree_find_prev(&tree, key, &expected);
+			ASSERT(btree_frozen_find_prev(&frozen, key, &actual) == any);
+			ASSERT(!any || actual == expected);
+		}
+		uint64_t key;
+		ASSERT(!btree_frozen_find(&frozen, UINT64_MAX, NULL));
+		ASSERT(!btree_frozen_find_next(&frozen, UINT64_MAX, &key));
+		ASSERT(btree_frozen_find_prev(&frozen, UINT64_MAX, &key) ==
+				(size > 0));
+		ASSERT(size == 0 || key == 3 * size - 2);
+
+		// Changes of the tree don't show in the snapshot.
+		btree_insert(&tree, 0, 0);
+		ASSERT(!btree_frozen_find(&frozen, 0, NULL));
+
+		btree_frozen_destroy(&frozen);
+		btree_destroy(&tree);
+	}
+}
+
+// Ascending keys go to the last leaf without descending from the root,
+// and full last leaves are split unevenly, so leaves end up almost full.
+// The last leaf may then be nearly empty, which deletions must handle.
+static void test_appends(void) {
+	const uint64_t N = 100000;
+	for (uint8_t bstar = 0; bstar < 2; bstar++) {
+		btree tree;
+		if (bstar) {
+			btree_init_bstar(&tree);
+		} else {
+			btree_init(&tree);
+		}
+		for (uint64_t i = 0; i < N; i++) {
+			ASSERT(btree_insert(&tree, 2 * i, i));
+		}
+		check_leaf_links(&tree, N);
+		const btree_stats stats = btree_collect_stats(&tree);
+		const double fill = (double) stats.total_kvps /
+				(stats.leaf_count * BTREE_LEAF_MAX_KEYS);
+		log_info("leaf fill after appends: %.2lf", fill);
+		ASSERT(fill > 0.85);
+
+		ASSERT(!btree_insert(&tree, 2 * (N - 1), 0));
+		// Keys between the appended ones go through the usual path.
+		for (uint64_t i = 0; i < N; i += 7) {
+			ASSERT(btree_insert(&tree, 2 * i + 1, i));
+		}
+		uint64_t size = N + (N + 6) / 7;
+		check_leaf_links(&tree, size);
+		for (uint64_t key = 2 * N; key-- > 0;) {
+			uint64_t value;
+			if (btree_find(&tree, key, &value)) {
+				ASSERT(value == key / 2);
+				ASSERT(btree_delete(&tree, key));
+				--size;
+			}
+			if (key % 1000 == 0) {
+				check_leaf_links(&tree, size);
+			}
+			// Appends again after the last leaf got emptied.
+			if (key == N) {
+				ASSERT(btree_insert(&tree, 3 * N, 3 * N / 2));
+				ASSERT(btree_find(&tree, 3 * N, NULL));
+				ASSERT(btree_delete(&tree, 3 * N));
+			}
+		}
+		ASSERT(size == 0);
+		check_leaf_links(&tree, 0);
+		btree_destroy(&tree);
+	}
+}
+
+// Relaxed deletions only remove emptied nodes. Sparse leaves are packed
+// again by compaction.
+static void test_relaxed_deletion(void) {
+	const uint64_t N = 100000;
+	btree tree;
+	btree_init_relaxed(&tree);
+	rand_generator generator = { .state = 0 };
+	uint64_t size = 0;
+	for (uint64_t i = 0; i < N; i++) {
+		const uint64_t key = 2 * rand_next(&generator, 2 * N);
+		size += btree_insert(&tree, key, key);
+	}
+	check_leaf_links(&tree, size);
+	const btree_stats full_stats = btree_collect_stats(&tree);
+	const uint64_t full_nodes = count_nodes(&full_stats);
+
+	// Missing keys don't touch the tree.
+	const uint64_t usage = btree_memory_usage(&tree);
+	for (uint64_t key = 1; key < 4 * N; key += 2) {
+		ASSERT(!btree_delete(&tree, key));
+	}
+	ASSERT(btree_memory_usage(&tree) == usage);
+
+	// Leave every 16th key.
+	for (uint64_t key = 0; key < 4 * N; key += 2) {
+		if (key % 32 != 0) {
+			size -= btree_delete(&tree, key);
+		}
+		if (key % 20000 == 0) {
+			check_leaf_links(&tree, size);
+		}
+	}
+	check_leaf_links(&tree, size);
+	for (uint64_t key = 0; key < 4 * N; key += 32) {
+		uint64_t value;
+		if (btree_find(&tree, key, &value)) {
+			ASSERT(value == key);
+		}
+	}
+
+	btree_compact(&tree, 1.0);
+	check_leaf_links(&tree, size);
+	const btree_stats stats = btree_collect_stats(&tree);
+	log_info("nodes: %" PRIu64 " before deletions, %" PRIu64
+			" after compaction", full_nodes, count_nodes(&stats));
+	ASSERT(count_nodes(&stats) * 8 < full_nodes);
+	ASSERT(tree.relaxed_deletion);
+
+	// Emptying the tree removes all nodes but the root.
+	for (uint64_t key = 0; key < 4 * N; key += 32) {
+		size -= btree_delete(&tree, key);
+	}
+	ASSERT(size == 0 && tree.levels_above_leaves == 0);
+	check_leaf_links(&tree, 0);
+	for (uint64_t i = 0; i < N; i++) {
+		ASSERT(btree_insert(&tree, i, i));
+	}
+	check_leaf_links(&tree, N);
+	btree_destroy(&tree);
+}
+
+// With 32-bit child indices, internal nodes of the same size have about
+// a third more keys, so trees get shallower.
+static void test_node_handles(void) {
+	ASSERT(BTREE_INTERNAL_MAX_KEYS_h32 * 3 >= BTREE_INTERNAL_MAX_KEYS * 4);
+	ASSERT(sizeof(btree_node_persisted_h32) <= 256);
+
+	const uint64_t N = 100000;
+	btree plain;
+	btree_h32 handles;
+	btree_init(&plain);
+	btree_init_h32(&handles);
+	rand_generator generator = { .state = 0 };
+	for (uint64_t i = 0; i < N; i++) {
+		const uint64_t key = rand_next(&generator, 4 * N);
+		ASSERT(btree_insert(&plain, key, key) ==
+				btree_insert_h32(&handles, key, key));
+	}
+	for (uint64_t key = 0; key < 4 * N; key++) {
+		uint64_t value;
+		const bool found = btree_find(&plain, key, NULL);
+		ASSERT(btree_find_h32(&handles, key, &value) == found);
+		ASSERT(!found || value == key);
+	}
+	const btree_stats plain_stats = btree_collect_stats(&plain);
+	const btree_stats_h32 handles_stats =
+			btree_collect_stats_h32(&handles);
+	// Internal nodes hold more children, so fewer of them are needed.
+	uint64_t plain_internal = 0, handles_internal = 0;
+	for (uint64_t i = 0; i <= BTREE_INTERNAL_MAX_KEYS; i++) {
+		plain_internal += plain_stats.internal_n_keys_histogram[i];
+	}
+	for (uint64_t i = 0; i <= BTREE_INTERNAL_MAX_KEYS_h32; i++) {
+		handles_internal += handles_stats.internal_n_keys_histogram[i];
+	}
+	ASSERT(handles_internal < plain_internal);
+	ASSERT(handles_stats.total_kvp_path_length <=
+			plain_stats.total_kvp_path_length);
+
+	for (uint64_t key = 0; key < 4 * N; key += 2) {
+		ASSERT(btree_delete(&plain, key) ==
+				btree_delete_h32(&handles, key));
+	}
+	for (uint64_t key = 0; key < 4 * N; key++) {
+		ASSERT(btree_find(&plain, key, NULL) ==
+				btree_find_h32(&handles, key, NULL));
+	}
+	btree_destroy(&plain);
+	btree_destroy_h32(&handles);
+}
+
+static void test_search(void) {
+	rand_generator generator = { .state = 0 };
+	uint64_t keys[24];
+	for (uint64_t iteration = 0; iteration < 10000; iteration++) {
+		const uint8_t n = rand_next(&generator, 25);
+		// Keys near 0 and near UINT64_MAX check unsigned comparisons.
+		uint64_t key = rand_next(&generator, 2) ? 0 : (1ULL << 63);
+		for (uint8_t i = 0; i < n; i++) {
+			key += 1 + rand_next(&generator, 3);
+			keys[i] = key;
+		}
+		const uint64_t needle = (iteration % 2) ?
+				rand_next(&generator, key + 3) :
+				rand_next64(&generator);
+
+		uint8_t le = 0, lt = 0, index = n;
+		for (uint8_t i = 0; i < n; i++) {
+			le += keys[i] <= needle;
+			lt += keys[i] < needle;
+			if (keys[i] == needle) {
+				index = i;
+			}
+		}
+		ASSERT(search_count_le(keys, n, needle) == le);
+		ASSERT(search_count_lt(keys, n, needle) == lt);
+		ASSERT(search_find(keys, n, needle) == index);
+	}
+}
+
 void test_btree(void) {
+	test_search();
 	test_internal_splitting();
 	test_insert_pointer();
 	test_inserting();
 	test_deletion();
+	test_leaf_links();
+	test_bstar();
+	test_appends();
+	test_relaxed_deletion();
+	test_node_handles();
+	test_freeze();
 }
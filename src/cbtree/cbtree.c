@@ -0,0 +1,521 @@
+#include "cbtree/cbtree.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "btree/search.h"
+#include "log/log.h"
+
+#define DATA_BYTES (sizeof(((cbtree_node*) NULL)->data))
+// Most keys a node can hold, i.e. with the shortest key encoding.
+#define LEAF_MAX_KEYS (DATA_BYTES / (sizeof(uint64_t) + 2))
+#define INTERNAL_MAX_KEYS ((DATA_BYTES - sizeof(cbtree_node*)) / \
+		(sizeof(cbtree_node*) + 1))
+
+// Largest integer that fits into the given number of bytes.
+static uint64_t max_value(uint8_t bytes) {
+	return (bytes == 8) ? UINT64_MAX : (1ULL << (8 * bytes)) - 1;
+}
+
+// Packed arrays hold integers of 1, 2, 4 or 8 bytes.
+static uint64_t packed_get(const void* array, uint8_t bytes, uint16_t i) {
+	switch (bytes) {
+	case 1: return ((const uint8_t*) array)[i];
+	case 2: return ((const uint16_t*) array)[i];
+	case 4: return ((const uint32_t*) array)[i];
+	default: return ((const uint64_t*) array)[i];
+	}
+}
+
+static void packed_set(void* array, uint8_t bytes, uint16_t i, uint64_t x) {
+	switch (bytes) {
+	case 1: ((uint8_t*) array)[i] = x; break;
+	case 2: ((uint16_t*) array)[i] = x; break;
+	case 4: ((uint32_t*) array)[i] = x; break;
+	default: ((uint64_t*) array)[i] = x; break;
+	}
+}
+
+// Counts integers < x among the first n. The loops have no branches,
+// so the compiler vectorizes them.
+static uint16_t packed_count_lt(const void* array, uint8_t bytes, uint16_t n,
+		uint64_t x) {
+	if (bytes == 8) {
+		return search_count_lt(array, n, x);
+	}
+	if (x > max_value(bytes)) {
+		return n;
+	}
+	uint16_t count = 0;
+	switch (bytes) {
+	case 1:
+		for (uint16_t i = 0; i < n; i++) {
+			count += ((const uint8_t*) array)[i] < x;
+		}
+		break;
+	case 2:
+		for (uint16_t i = 0; i < n; i++) {
+			count += ((const uint16_t*) array)[i] < x;
+		}
+		break;
+	default:
+		for (uint16_t i = 0; i < n; i++) {
+			count += ((const uint32_t*) array)[i] < x;
+		}
+		break;
+	}
+	return count;
+}
+
+// Counts integers <= x among the first n.
+static uint16_t packed_count_le(const void* array, uint8_t bytes, uint16_t n,
+		uint64_t x) {
+	if (bytes == 8) {
+		return search_count_le(array, n, x);
+	}
+	if (x >= max_value(bytes)) {
+		return n;
+	}
+	return packed_count_lt(array, bytes, n, x + 1);
+}
+
+static cbtree_node* alloc_node(cbtree* this) {
+	return slab_alloc(&this->nodes);
+}
+
+static void free_node(cbtree* this, cbtree_node* node) {
+	slab_free(&this->nodes, node);
+}
+
+// Leaves: values, then keys as deltas from the base (or full keys).
+
+static const void* leaf_keys(const cbtree_node* leaf) {
+	return (const uint8_t*) leaf->data + sizeof(uint64_t) * leaf->key_count;
+}
+
+static uint64_t leaf_key(const cbtree_node* leaf, uint16_t i) {
+	const uint64_t stored = packed_get(leaf_keys(leaf), leaf->key_bytes, i);
+	return (leaf->key_bytes == 8) ? stored : leaf->base + stored;
+}
+
+// Number of keys in the leaf that are < key.
+static uint16_t leaf_count_lt(const cbtree_node* leaf, uint64_t key) {
+	if (leaf->key_bytes == 8) {
+		return search_count_lt(leaf_keys(leaf), leaf->key_count, key);
+	}
+	if (leaf->key_count == 0 || key <= leaf->base) {
+		return 0;
+	}
+	return packed_count_lt(leaf_keys(leaf), leaf->key_bytes,
+			leaf->key_count, key - leaf->base);
+}
+
+// Number of keys in the leaf that are <= key.
+static uint16_t leaf_count_le(const cbtree_node* leaf, uint64_t key) {
+	if (leaf->key_bytes == 8) {
+		return search_count_le(leaf_keys(leaf), leaf->key_count, key);
+	}
+	if (leaf->key_count == 0 || key < leaf->base) {
+		return 0;
+	}
+	return packed_count_le(leaf_keys(leaf), leaf->key_bytes,
+			leaf->key_count, key - leaf->base);
+}
+
+static uint8_t leaf_key_bytes(const uint64_t* keys, uint16_t n) {
+	const uint64_t span = (n == 0) ? 0 : keys[n - 1] - keys[0];
+	if (span <= UINT16_MAX) {
+		return 2;
+	}
+	return (span <= UINT32_MAX) ? 4 : 8;
+}
+
+// Encodes n pairs with sorted keys into the leaf. Returns false and leaves
+// the leaf alone if they don't fit.
+static bool encode_leaf(cbtree_node* leaf, const uint64_t* keys,
+		const uint64_t* values, uint16_t n) {
+	const uint8_t bytes = leaf_key_bytes(keys, n);
+	if (n * (sizeof(uint64_t) + bytes) > DATA_BYTES) {
+		return false;
+	}
+	leaf->key_count = n;
+	leaf->key_bytes = bytes;
+	leaf->base = (n == 0) ? 0 : keys[0];
+	memcpy(leaf->data, values, sizeof(uint64_t) * n);
+	void* packed = (uint8_t*) leaf->data + sizeof(uint64_t) * n;
+	for (uint16_t i = 0; i < n; i++) {
+		packed_set(packed, bytes, i,
+				(bytes == 8) ? keys[i] : keys[i] - leaf->base);
+	}
+	return true;
+}
+
+static void decode_leaf(const cbtree_node* leaf, uint64_t* keys,
+		uint64_t* values) {
+	for (uint16_t i = 0; i < leaf->key_count; i++) {
+		keys[i] = leaf_key(leaf, i);
+	}
+	memcpy(values, leaf->data, sizeof(uint64_t) * leaf->key_count);
+}
+
+// Internal nodes: key_count + 1 children, then key suffixes.
+
+static cbtree_node** children_of(const cbtree_node* node) {
+	return (cbtree_node**) node->data;
+}
+
+static const void* internal_suffixes(const cbtree_node* node) {
+	return (const uint8_t*) node->data +
+			sizeof(cbtree_node*) * (node->key_count + 1);
+}
+
+static uint64_t internal_key(const cbtree_node* node, uint16_t i) {
+	return node->base | packed_get(internal_suffixes(node),
+			node->key_bytes, i);
+}
+
+// Index of the child of an internal node where key belongs.
+static uint16_t child_index(const cbtree_node* node, uint64_t key) {
+	const uint64_t mask = max_value(node->key_bytes);
+	const uint64_t prefix = key & ~mask;
+	if (node->key_count == 0 || prefix < node->base) {
+		return 0;
+	}
+	if (prefix > node->base) {
+		return node->key_count;
+	}
+	return packed_count_le(internal_suffixes(node), node->key_bytes,
+			node->key_count, key & mask);
+}
+
+// All keys between the first and the last share the bytes above the
+// highest byte where the first and the last differ.
+static uint8_t internal_key_bytes(const uint64_t* keys, uint16_t n) {
+	const uint64_t differing = (n == 0) ? 0 : keys[0] ^ keys[n - 1];
+	if (differing <= UINT8_MAX) {
+		return 1;
+	}
+	if (differing <= UINT16_MAX) {
+		return 2;
+	}
+	return (differing <= UINT32_MAX) ? 4 : 8;
+}
+
+// Encodes n sorted keys and n + 1 children into the node. Returns false
+// and leaves the node alone if they don't fit.
+static bool encode_internal(cbtree_node* node, const uint64_t* keys,
+		cbtree_node* const* children, uint16_t n) {
+	const uint8_t bytes = internal_key_bytes(keys, n);
+	if (sizeof(cbtree_node*) * (n + 1) + bytes * n > DATA_BYTES) {
+		return false;
+	}
+	const uint64_t mask = max_value(bytes);
+	node->key_count = n;
+	node->key_bytes = bytes;
+	node->base = (n == 0) ? 0 : keys[0] & ~mask;
+	memcpy(node->data, children, sizeof(cbtree_node*) * (n + 1));
+	void* packed = (uint8_t*) node->data + sizeof(cbtree_node*) * (n + 1);
+	for (uint16_t i = 0; i < n; i++) {
+		packed_set(packed, bytes, i, keys[i] & mask);
+	}
+	return true;
+}
+
+static void decode_internal(const cbtree_node* node, uint64_t* keys,
+		cbtree_node** children) {
+	for (uint16_t i = 0; i < node->key_count; i++) {
+		keys[i] = internal_key(node, i);
+	}
+	memcpy(children, children_of(node),
+			sizeof(cbtree_node*) * (node->key_count + 1));
+}
+
+static cbtree_node* new_empty_leaf(cbtree* this) {
+	cbtree_node* leaf = alloc_node(this);
+	leaf->key_count = 0;
+	leaf->key_bytes = leaf_key_bytes(NULL, 0);
+	leaf->base = 0;
+	return leaf;
+}
+
+void cbtree_init(cbtree* this) {
+	slab_init(&this->nodes, sizeof(cbtree_node));
+	this->root = new_empty_leaf(this);
+	this->levels_above_leaves = 0;
+}
+
+void cbtree_destroy(cbtree* this) {
+	slab_destroy(&this->nodes);
+	this->root = NULL;
+}
+
+static const cbtree_node* find_leaf(const cbtree* this, uint64_t key) {
+	const cbtree_node* node = this->root;
+	for (uint8_t level = this->levels_above_leaves; level > 0; level--) {
+		node = children_of(node)[child_index(node, key)];
+	}
+	return node;
+}
+
+bool cbtree_find(cbtree* this, uint64_t key, uint64_t *value) {
+	const cbtree_node* leaf = find_leaf(this, key);
+	const uint16_t i = leaf_count_lt(leaf, key);
+	if (i == leaf->key_count || leaf_key(leaf, i) != key) {
+		return false;
+	}
+	if (value) {
+		*value = leaf->data[i];
+	}
+	return true;
+}
+
+// Set when a node splits: the new right node and the smallest key in it.
+// right is NULL if the node didn't split.
+typedef struct {
+	cbtree_node* right;
+	uint64_t key;
+} split_result;
+
+// Any half of a node that didn't fit holds at most as many keys as fit
+// even without compression, so splits always succeed.
+static bool insert_into_leaf(cbtree* this, cbtree_node* leaf, uint64_t key,
+		uint64_t value, split_result* split) {
+	uint16_t n = leaf->key_count;
+	const uint16_t i = leaf_count_lt(leaf, key);
+	if (i < n && leaf_key(leaf, i) == key) {
+		return false;
+	}
+	uint64_t keys[LEAF_MAX_KEYS + 1], values[LEAF_MAX_KEYS + 1];
+	decode_leaf(leaf, keys, values);
+	memmove(keys + i + 1, keys + i, sizeof(uint64_t) * (n - i));
+	memmove(values + i + 1, values + i, sizeof(uint64_t) * (n - i));
+	keys[i] = key;
+	values[i] = value;
+	++n;
+
+	split->right = NULL;
+	if (!encode_leaf(leaf, keys, values, n)) {
+		const uint16_t to_left = n / 2;
+		split->right = alloc_node(this);
+		split->key = keys[to_left];
+		ASSERT(encode_leaf(leaf, keys, values, to_left));
+		ASSERT(encode_leaf(split->right, keys + to_left,
+					values + to_left, n - to_left));
+	}
+	return true;
+}
+
+static bool insert_recursive(cbtree* this, cbtree_node* node, uint8_t level,
+		uint64_t key, uint64_t value, split_result* split) {
+	if (level == 0) {
+		return insert_into_leaf(this, node, key, value, split);
+	}
+	const uint16_t i = child_index(node, key);
+	split_result child_split;
+	if (!insert_recursive(this, children_of(node)[i], level - 1,
+				key, value, &child_split)) {
+		return false;
+	}
+	split->right = NULL;
+	if (child_split.right == NULL) {
+		return true;
+	}
+
+	uint16_t n = node->key_count;
+	uint64_t keys[INTERNAL_MAX_KEYS + 1];
+	cbtree_node* children[INTERNAL_MAX_KEYS + 2];
+	decode_internal(node, keys, children);
+	memmove(keys + i + 1, keys + i, sizeof(uint64_t) * (n - i));
+	memmove(children + i + 2, children + i + 1,
+			sizeof(cbtree_node*) * (n - i));
+	keys[i] = child_split.key;
+	children[i + 1] = child_split.right;
+	++n;
+
+	if (!encode_internal(node, keys, children, n)) {
+		const uint16_t to_left = n / 2;
+		split->right = alloc_node(this);
+		split->key = keys[to_left];
+		ASSERT(encode_internal(node, keys, children, to_left));
+		ASSERT(encode_internal(split->right, keys + to_left + 1,
+					children + to_left + 1,
+					n - to_left - 1));
+	}
+	return true;
+}
+
+bool cbtree_insert(cbtree* this, uint64_t key, uint64_t value) {
+	split_result split;
+	if (!insert_recursive(this, this->root, this->levels_above_leaves,
+				key, value, &split)) {
+		return false;
+	}
+	if (split.right != NULL) {
+		cbtree_node* root = alloc_node(this);
+		cbtree_node* children[2] = { this->root, split.right };
+		ASSERT(encode_internal(root, &split.key, children, 1));
+		this->root = root;
+		++this->levels_above_leaves;
+	}
+	return true;
+}
+
+// Removes the key from the subtree. Sets *emptied if the node has no keys
+// (leaves) or no children (internal nodes) left. Removing keys never
+// makes the encoding longer.
+static bool delete_recursive(cbtree* this, cbtree_node* node, uint8_t level,
+		uint64_t key, bool* emptied) {
+	uint16_t n = node->key_count;
+	if (level == 0) {
+		const uint16_t i = leaf_count_lt(node, key);
+		if (i == n || leaf_key(node, i) != key) {
+			return false;
+		}
+		uint64_t keys[LEAF_MAX_KEYS], values[LEAF_MAX_KEYS];
+		decode_leaf(node, keys, values);
+		memmove(keys + i, keys + i + 1, sizeof(uint64_t) * (n - i - 1));
+		memmove(values + i, values + i + 1,
+				sizeof(uint64_t) * (n - i - 1));
+		ASSERT(encode_leaf(node, keys, values, n - 1));
+		*emptied = (n == 1);
+		return true;
+	}
+
+	const uint16_t i = child_index(node, key);
+	cbtree_node* child = children_of(node)[i];
+	bool child_emptied;
+	if (!delete_recursive(this, child, level - 1, key, &child_emptied)) {
+		return false;
+	}
+	*emptied = false;
+	if (!child_emptied) {
+		return true;
+	}
+	free_node(this, child);
+	if (n == 0) {
+		*emptied = true;
+		return true;
+	}
+
+	// The key range of the removed child goes to its neighbour.
+	uint64_t keys[INTERNAL_MAX_KEYS];
+	cbtree_node* children[INTERNAL_MAX_KEYS + 1];
+	decode_internal(node, keys, children);
+	const uint16_t removed_key = (i == 0) ? 0 : i - 1;
+	memmove(keys + removed_key, keys + removed_key + 1,
+			sizeof(uint64_t) * (n - removed_key - 1));
+	memmove(children + i, children + i + 1,
+			sizeof(cbtree_node*) * (n - i));
+	ASSERT(encode_internal(node, keys, children, n - 1));
+	return true;
+}
+
+bool cbtree_delete(cbtree* this, uint64_t key) {
+	bool emptied;
+	if (!delete_recursive(this, this->root, this->levels_above_leaves, key,
+				&emptied)) {
+		return false;
+	}
+	// Internal roots have at least one key, so they can't lose all
+	// children at once.
+	ASSERT(!emptied || this->levels_above_leaves == 0);
+	while (this->levels_above_leaves > 0 && this->root->key_count == 0) {
+		cbtree_node* child = children_of(this->root)[0];
+		free_node(this, this->root);
+		this->root = child;
+		--this->levels_above_leaves;
+	}
+	return true;
+}
+
+// Only the root can be an empty leaf, but internal nodes may have
+// a single child, so the search may go on into following subtrees.
+static bool find_next_recursive(const cbtree_node* node, uint8_t level,
+		uint64_t key, uint64_t *next_key) {
+	if (level == 0) {
+		const uint16_t i = leaf_count_le(node, key);
+		if (i == node->key_count) {
+			return false;
+		}
+		*next_key = leaf_key(node, i);
+		return true;
+	}
+	for (uint16_t i = child_index(node, key); i <= node->key_count; i++) {
+		if (find_next_recursive(children_of(node)[i], level - 1, key,
+					next_key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool find_prev_recursive(const cbtree_node* node, uint8_t level,
+		uint64_t key, uint64_t *prev_key) {
+	if (level == 0) {
+		const uint16_t i = leaf_count_lt(node, key);
+		if (i == 0) {
+			return false;
+		}
+		*prev_key = leaf_key(node, i - 1);
+		return true;
+	}
+	for (uint16_t i = child_index(node, key) + 1; i > 0; i--) {
+		if (find_prev_recursive(children_of(node)[i - 1], level - 1,
+					key, prev_key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool cbtree_find_next(cbtree* this, uint64_t key, uint64_t *next_key) {
+	return find_next_recursive(this->root, this->levels_above_leaves, key,
+			next_key);
+}
+
+bool cbtree_find_prev(cbtree* this, uint64_t key, uint64_t *prev_key) {
+	return find_prev_recursive(this->root, this->levels_above_leaves, key,
+			prev_key);
+}
+
+uint64_t cbtree_memory_usage(const cbtree* this) {
+	return slab_memory_usage(&this->nodes);
+}
+
+// Checks that keys in the subtree are sorted, within [min;max] and stored
+// in the shortest encoding.
+static void check_recursive(const cbtree_node* node, uint8_t level,
+		uint64_t min, uint64_t max, bool is_root) {
+	const uint16_t n = node->key_count;
+	uint64_t keys[INTERNAL_MAX_KEYS > LEAF_MAX_KEYS ?
+			INTERNAL_MAX_KEYS : LEAF_MAX_KEYS];
+	for (uint16_t i = 0; i < n; i++) {
+		keys[i] = (level == 0) ? leaf_key(node, i) :
+				internal_key(node, i);
+		CHECK(keys[i] >= min && keys[i] <= max,
+				"key %" PRIu64 " out of [%" PRIu64 ";%" PRIu64 "]",
+				keys[i], min, max);
+		CHECK(i == 0 || keys[i - 1] < keys[i],
+				"keys %" PRIu64 " and %" PRIu64 " not sorted",
+				keys[i - 1], keys[i]);
+	}
+	if (level == 0) {
+		CHECK(is_root || n > 0, "empty non-root leaf");
+		CHECK(node->key_bytes == leaf_key_bytes(keys, n),
+				"leaf keys not compressed");
+		return;
+	}
+	CHECK(node->key_bytes == internal_key_bytes(keys, n),
+			"internal keys not compressed");
+	for (uint16_t i = 0; i <= n; i++) {
+		check_recursive(children_of(node)[i], level - 1,
+				(i == 0) ? min : keys[i - 1],
+				(i == n) ? max : keys[i] - 1, false);
+	}
+}
+
+void cbtree_check(const cbtree* this) {
+	check_recursive(this->root, this->levels_above_leaves, 0, UINT64_MAX,
+			true);
+}
@@ -0,0 +1,57 @@
+#ifndef CBTREE_CBTREE_H
+#define CBTREE_CBTREE_H
+
+// Compressed B+-tree: a B+-tree whose nodes store keys in as few bytes
+// as the keys in the node allow.
+//
+// Leaves store the smallest key as a base and the other keys as 16-bit or
+// 32-bit deltas from it if they fit, otherwise full 64-bit keys.
+// Internal nodes store the high bytes shared by all their keys once, and
+// only the remaining 1, 2, 4 or 8 low bytes of each key.
+//
+// Clustered keys (e.g. timestamps) thus fit more keys into a node.
+// How many keys fit depends on the keys, so nodes split when the new
+// encoding doesn't fit. Deletion doesn't merge underfull nodes, but empty
+// nodes are removed.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "slab/slab.h"
+
+#define CBTREE_NODE_BYTES 256
+
+typedef struct {
+	uint16_t key_count;
+	// Bytes per stored key: deltas or full keys in leaves (2, 4 or 8),
+	// key suffixes in internal nodes (1, 2, 4 or 8).
+	uint8_t key_bytes;
+	// Leaves: the smallest key. Internal nodes: the high bytes shared
+	// by all keys, with the suffix bytes zeroed.
+	uint64_t base;
+	// Leaves: key_count values, then the keys.
+	// Internal nodes: key_count + 1 child pointers, then the key suffixes.
+	uint64_t data[(CBTREE_NODE_BYTES - 2 * sizeof(uint64_t)) /
+			sizeof(uint64_t)];
+} cbtree_node;
+
+typedef struct {
+	uint8_t levels_above_leaves;  // 0 == root is a leaf
+	cbtree_node* root;
+	slab nodes;
+} cbtree;
+
+void cbtree_init(cbtree*);
+void cbtree_destroy(cbtree*);
+bool cbtree_find(cbtree*, uint64_t key, uint64_t *value);
+bool cbtree_insert(cbtree*, uint64_t key, uint64_t value);
+bool cbtree_delete(cbtree*, uint64_t key);
+bool cbtree_find_next(cbtree*, uint64_t key, uint64_t *next_key);
+bool cbtree_find_prev(cbtree*, uint64_t key, uint64_t *prev_key);
+
+// Bytes of the slab chunks holding the nodes. Does not count the cbtree
+// struct itself.
+uint64_t cbtree_memory_usage(const cbtree*);
+void cbtree_check(const cbtree*);
+
+#endif
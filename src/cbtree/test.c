@@ -0,0 +1,72 @@
+#include "cbtree/test.h"
+
+#include "btree/btree.h"
+#include "cbtree/cbtree.h"
+#include "log/log.h"
+#include "rand/rand.h"
+
+// Inserts and deletes keys spread by the given stride around a large base,
+// so that nodes use all key encodings.
+static void test_stride(uint64_t stride) {
+	const uint64_t base = 1ULL << 60;
+	const uint64_t N = 20000;
+	rand_generator generator = { .state = stride };
+	cbtree tree;
+	cbtree_init(&tree);
+	for (uint64_t i = 0; i < N; i++) {
+		const uint64_t key = base + rand_next(&generator, N) * stride;
+		cbtree_insert(&tree, key, ~key);
+		if (i % 2000 == 0) {
+			cbtree_check(&tree);
+		}
+	}
+	for (uint64_t i = 0; i < N; i++) {
+		const uint64_t key = base + i * stride;
+		uint64_t value;
+		if (cbtree_find(&tree, key, &value)) {
+			ASSERT(value == ~key);
+		}
+		if (i % 2 == 0) {
+			cbtree_delete(&tree, key);
+			ASSERT(!cbtree_find(&tree, key, NULL));
+		}
+		if (i % 2000 == 0) {
+			cbtree_check(&tree);
+		}
+	}
+	for (uint64_t i = 0; i < N; i++) {
+		cbtree_delete(&tree, base + i * stride);
+	}
+	cbtree_check(&tree);
+	ASSERT(tree.levels_above_leaves == 0 && tree.root->key_count == 0);
+	cbtree_destroy(&tree);
+}
+
+// Clustered keys should take less memory than in an uncompressed B-tree.
+// Keys are not inserted in ascending order, which the B-tree packs tighter
+// (see split_last_leaf in btree/template_impl.h).
+static void test_compression(void) {
+	const uint64_t base = 1500000000000000000ULL;
+	const uint64_t N = 1000000;
+	cbtree compressed;
+	btree plain;
+	cbtree_init(&compressed);
+	btree_init(&plain);
+	for (uint64_t j = 0; j < N; j++) {
+		const uint64_t i = (j * 7919) % N;
+		cbtree_insert(&compressed, base + i * 1000, i);
+		btree_insert(&plain, base + i * 1000, i);
+	}
+	ASSERT(cbtree_memory_usage(&compressed) <
+			btree_memory_usage(&plain));
+	cbtree_destroy(&compressed);
+	btree_destroy(&plain);
+}
+
+void test_cbtree(void) {
+	test_stride(1);
+	test_stride(1000);
+	test_stride(1ULL << 20);
+	test_stride(1ULL << 40);
+	test_compression();
+}
@@ -0,0 +1,6 @@
+#ifndef CBTREE_TEST_H
+#define CBTREE_TEST_H
+
+void test_cbtree(void);
+
+#endif
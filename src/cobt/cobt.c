@@ -14,6 +14,33 @@
 
 typedef cob_piece_item piece_item;
 
+// During a migration, every update moves this many pieces.
+#define MIGRATION_STEP 16
+// Smaller PMAs grow and change their piece size all at once.
+#define MIGRATION_MIN_CAPACITY 4096
+// Batched inserts look this many pieces ahead before using the tree.
+#define BATCH_SCAN_PIECES 8
+// adequate_piece only grows pieces up to ceil_log2(size) items,
+// so pieces never have more than 64 items.
+#define MAX_PIECE 64
+
+// Groups sorted pairs into half-full pieces and streams them into a new PMA.
+typedef struct {
+	pma_stream stream;
+	piece_item* buffer;
+	uint8_t buffer_size;
+	uint8_t piece;
+} piece_stream;
+
+struct cob_migration {
+	cob incoming;  // Holds the pieces keyed below the boundary.
+	piece_stream stream;  // Appends pieces to incoming.file.
+	// The tree of the new PMA is built a few leaves per update before
+	// any piece moves.
+	uint64_t prepared;
+	uint64_t prepare_step;
+};
+
 static void fix_range(cob* this, pma_range range_to_fix) {
 	cobt_tree_refresh(&this->tree, (cobt_tree_range) {
 		.begin = range_to_fix.begin,
@@ -21,21 +48,28 @@ static void fix_range(cob* this, pma_range range_to_fix) {
 	});
 }
 
-static void entirely_reset_veb(cob* this) {
+// Bulk operations build big trees on all CPUs, single updates on one.
+static void entirely_reset_veb(cob* this, uint64_t threads) {
+	const cobt_tree_layout layout = this->tree.layout;
 	cobt_tree_destroy(&this->tree);
-	cobt_tree_init(&this->tree, this->file.keys, this->file.occupied,
-			this->file.capacity);
+	cobt_tree_init_unrefreshed(&this->tree, layout, this->file.keys,
+			this->file.occupied, this->file.capacity);
+	cobt_tree_rebuild(&this->tree, threads);
 }
 
-static void insert_piece_before(cob* this, piece_item* piece,
+// Copies the piece into a new PMA slot.
+static void insert_piece_before(cob* this, const piece_item* piece,
 		uint64_t insert_before) {
 	const uint64_t prior_capacity = this->file.capacity;
-	pma_range reorg_range =  pma_insert_before(&this->file,
-			piece[0].key, piece, insert_before);
+	pma_range reorg_range = (this->stream != NULL) ?
+			pma_stream_insert_before(this->stream, piece[0].key,
+					piece, insert_before) :
+			pma_insert_before(&this->file, piece[0].key, piece,
+					insert_before);
 	if (this->file.capacity == prior_capacity) {
 		fix_range(this, reorg_range);
 	} else {
-		entirely_reset_veb(this);
+		entirely_reset_veb(this, 1);
 	}
 }
 
@@ -45,13 +79,41 @@ static piece_item* get_piece_start(const cob* this, uint64_t index) {
 
 static void delete_piece(cob* this, uint64_t index) {
 	const uint64_t prior_capacity = this->file.capacity;
-	free(get_piece_start(this, index));
-	pma_range reorg_range = pma_delete(&this->file, index);
+	pma_range reorg_range = (this->stream != NULL) ?
+			pma_stream_delete(this->stream, index) :
+			pma_delete(&this->file, index);
 	if (this->file.capacity == prior_capacity) {
 		fix_range(this, reorg_range);
 	} else {
-		entirely_reset_veb(this);
+		entirely_reset_veb(this, 1);
+	}
+}
+
+// Whether the index holds a piece that has not migrated away.
+static bool is_live(const cob* this, uint64_t index) {
+	return pma_is_occupied(&this->file, index) &&
+			this->file.keys[index] >= this->boundary;
+}
+
+// The COB whose PMA holds the key.
+static cob* part_for(cob* this, uint64_t key) {
+	if (key < this->boundary) {
+		return &this->migration->incoming;
 	}
+	return this;
+}
+
+// Index of the first live piece, or capacity if there is none.
+static uint64_t first_live(cob* this) {
+	uint64_t index = 0;
+	if (this->boundary > 0) {
+		// Finds the last piece that has migrated.
+		index = cobt_tree_find_le(&this->tree, this->boundary - 1);
+	}
+	if (is_live(this, index)) {
+		return index;
+	}
+	return pma_next_occupied(&this->file, index + 1);
 }
 
 static void describe_piece(char* buffer, const cob* this, uint64_t index) {
@@ -59,7 +121,8 @@ static void describe_piece(char* buffer, const cob* this, uint64_t index) {
 	uint8_t z = 0;
 	z += sprintf(buffer + z, "[%" PRIu64 " =%p %s key=%" PRIu64 "]: ",
 			index, piece,
-			this->file.occupied[index] ? "occupied" : "unoccupied",
+			pma_is_occupied(&this->file, index) ?
+				"occupied" : "unoccupied",
 			this->file.keys[index]);
 	for (uint8_t i = 0; i < this->piece; i++) {
 		if (piece[i].key == EMPTY) {
@@ -73,10 +136,13 @@ static void describe_piece(char* buffer, const cob* this, uint64_t index) {
 
 void cob_check_invariants(const cob* this) {
 	for (uint64_t i = 0; i < this->file.capacity; i++) {
-		if (this->file.occupied[i]) {
+		if (is_live(this, i)) {
 			char description[1024];
 			describe_piece(description, this, i);
-			assert(this->file.keys[i] != EMPTY);
+			// The first piece of a new PMA may be empty until
+			// its migration finishes.
+			assert(this->file.keys[i] != EMPTY ||
+					(this->stream != NULL && i == 0));
 
 			piece_item* piece = get_piece_start(this, i);
 			CHECK(this->file.keys[i] == piece[0].key,
@@ -88,9 +154,22 @@ void cob_check_invariants(const cob* this) {
 			}
 		}
 	}
+	if (this->migration != NULL) {
+		cob_check_invariants(&this->migration->incoming);
+	}
 	// Possibly add more checks later.
 }
 
+uint64_t cob_memory_usage(const cob* this) {
+	uint64_t usage = pma_memory_usage(&this->file) +
+			cobt_tree_memory_usage(&this->tree);
+	if (this->migration != NULL) {
+		usage += sizeof(struct cob_migration) +
+				cob_memory_usage(&this->migration->incoming);
+	}
+	return usage;
+}
+
 void cob_dump(const cob* this) {
 	for (uint64_t i = 0; i < this->file.capacity; i++) {
 		char description[1024];
@@ -98,9 +177,14 @@ void cob_dump(const cob* this) {
 		log_info("%s", description);
 	}
 	cobt_tree_dump(&this->tree);
+	if (this->migration != NULL) {
+		log_info("migrating keys below %" PRIu64 " into:",
+				this->boundary);
+		cob_dump(&this->migration->incoming);
+	}
 }
 
-static uint8_t piece_size(cob* this, piece_item* piece) {
+static uint8_t piece_size(const cob* this, const piece_item* piece) {
 	uint8_t n = 0;
 	for (uint8_t i = 0; i < this->piece; i++) {
 		if (piece[i].key != EMPTY) {
@@ -111,24 +195,44 @@ static uint8_t piece_size(cob* this, piece_item* piece) {
 }
 
 static pma rebuild_file(cob* this, uint64_t new_size, uint8_t new_piece);
+static void start_migration(cob* this, uint8_t new_piece);
+static void migrate_step(cob* this);
 
-static void enforce_piece_policy(cob* this, uint64_t new_size) {
-	const uint8_t log = new_size == 0 ? 1 : ceil_log2(new_size);
-	uint8_t new_piece = this->piece;
-	while (log >= new_piece + 4) {
-		new_piece += 4;
+static uint8_t adequate_piece(uint8_t piece, uint64_t size) {
+	const uint8_t log = size == 0 ? 1 : ceil_log2(size);
+	while (log >= piece + 4) {
+		piece += 4;
 	}
-	while (new_piece > 4 && log <= new_piece - 4) {
-		new_piece -= 4;
+	while (piece > 4 && log <= piece - 4) {
+		piece -= 4;
+	}
+	return piece;
+}
+
+// Runs before every update. Big PMAs are grown or repieced by migrations,
+// which move a few pieces per update. Small ones are rebuilt at once.
+static void enforce_piece_policy(cob* this, uint64_t new_size) {
+	if (this->migration != NULL) {
+		migrate_step(this);
+		return;
 	}
-	if (this->piece != new_piece) {
+	const uint8_t new_piece = adequate_piece(this->piece, new_size);
+	if (this->file.capacity >= MIGRATION_MIN_CAPACITY) {
+		// Grow before the PMA resizes itself above 0.75 density.
+		const bool dense =
+				this->file.size * 10 > this->file.capacity * 7;
+		if (this->piece != new_piece || dense) {
+			start_migration(this, new_piece);
+			migrate_step(this);
+		}
+	} else if (this->piece != new_piece) {
 		log_verbose(1, "%" PRIu64 " repiecing: %" PRIu8 " -> %" PRIu8,
 				new_size, this->piece, new_piece);
 		const pma new_file = rebuild_file(this, new_size, new_piece);
 		pma_destroy(&this->file);
 		this->file = new_file;
 
-		entirely_reset_veb(this);
+		entirely_reset_veb(this, 1);
 		this->piece = new_piece;
 	}
 }
@@ -207,20 +311,6 @@ static void clear_piece(cob* this, piece_item* piece) {
 	}
 }
 
-static piece_item* new_piece2(uint64_t size) {
-	piece_item* piece = malloc(size * sizeof(piece_item));
-	assert(piece != NULL);
-	for (uint8_t i = 0; i < size; i++) {
-		piece[i].key = EMPTY;
-		piece[i].value = EMPTY;
-	}
-	return piece;
-}
-
-static piece_item* new_piece(cob* this) {
-	return new_piece2(this->piece);
-}
-
 static void split_piece(cob* this, uint64_t index) {
 	piece_item* old_piece = get_piece_start(this, index);
 
@@ -231,7 +321,9 @@ static void split_piece(cob* this, uint64_t index) {
 
 	log_verbose(2, "splitting piece %" PRIu64, index);
 
-	piece_item* piece = new_piece(this);
+	ASSERT(this->piece <= MAX_PIECE);
+	piece_item piece[MAX_PIECE];
+	clear_piece(this, piece);
 	const uint8_t start = this->piece / 2;
 	for (uint8_t i = start; i < this->piece; i++) {
 		piece[i - start].key = old_piece[i].key;
@@ -241,13 +333,8 @@ static void split_piece(cob* this, uint64_t index) {
 		old_piece[i].value = EMPTY;
 	}
 
-	uint64_t after;
-	for (after = index + 1; after < this->file.capacity; after++) {
-		if (this->file.occupied[after]) {
-			break;
-		}
-	}
-	insert_piece_before(this, piece, after);
+	insert_piece_before(this, piece,
+			pma_next_occupied(&this->file, index + 1));
 
 	IF_LOG_VERBOSE(2) {
 		log_verbose(2, "After split:");
@@ -255,11 +342,13 @@ static void split_piece(cob* this, uint64_t index) {
 	}
 }
 
-bool cob_insert(cob* this, uint64_t key, uint64_t value) {
-	validate_key(key);
-	enforce_piece_policy(this, this->size + 1);
-
-	const uint64_t index = cobt_tree_find_le(&this->tree, key);
+// Inserts into the PMA of this part of the COB.
+static bool insert(cob* this, uint64_t key, uint64_t value) {
+	uint64_t index = cobt_tree_find_le(&this->tree, key);
+	if (pma_is_occupied(&this->file, index) && !is_live(this, index)) {
+		// The key is below the first piece left to migrate.
+		index = pma_next_occupied(&this->file, index + 1);
+	}
 
 	piece_item* piece = get_piece_start(this, index);
 	IF_LOG_VERBOSE(2) {
@@ -267,11 +356,11 @@ bool cob_insert(cob* this, uint64_t key, uint64_t value) {
 		describe_piece(buffer, this, index);
 		log_info("inserting key %" PRIu64 " to piece %s", key, buffer);
 	}
-	if (this->file.occupied[index]) {
+	if (pma_is_occupied(&this->file, index)) {
 		for (uint8_t i = 0; i < this->piece; i++) {
 			if (piece[i].key == key) {
 				// Duplicate key.
-				goto duplicate_key;
+				return false;
 			}
 		}
 		insert_into_piece(this, index, key, value);
@@ -281,24 +370,33 @@ bool cob_insert(cob* this, uint64_t key, uint64_t value) {
 		// old pointer.
 		split_piece(this, index);
 	} else {
-		assert(this->size == 0);
+		assert(this->file.size == 0);
 		// Special case: create new piece.
-		piece_item* piece = new_piece(this);
+		ASSERT(this->piece <= MAX_PIECE);
+		piece_item piece[MAX_PIECE];
+		clear_piece(this, piece);
 		piece[0].key = key;
 		piece[0].value = value;
 		insert_piece_before(this, piece, this->file.capacity);
 	}
+	return true;
+}
+
+bool cob_insert(cob* this, uint64_t key, uint64_t value) {
+	validate_key(key);
+	enforce_piece_policy(this, this->size + 1);
+
+	if (!insert(part_for(this, key), key, value)) {
+		log_verbose(1, "cob_insert(%" PRIu64 "=%" PRIu64 "): "
+				"duplicate", key, value);
+		// internal_check(this);
+		return false;
+	}
 	++this->size;
 
 	log_verbose(1, "cob_insert(%" PRIu64 "=%" PRIu64 "): done", key, value);
 	// internal_check(this);
 	return true;
-
-duplicate_key:
-	log_verbose(1, "cob_insert(%" PRIu64 "=%" PRIu64 "): duplicate",
-			key, value);
-	// internal_check(this);
-	return false;
 }
 
 static void merge_pieces(cob* this, uint64_t left, uint64_t right) {
@@ -324,8 +422,8 @@ static void merge_pieces(cob* this, uint64_t left, uint64_t right) {
 	} else {
 		// Redistribute keys between left and right.
 		// TODO: fuj
-		piece_item* items = alloca(
-				(left_size + right_size) * sizeof(piece_item));
+		ASSERT(this->piece <= MAX_PIECE);
+		piece_item items[2 * MAX_PIECE];
 		for (uint8_t i = 0; i < left_size; i++) {
 			items[i].key = l[i].key;
 			items[i].value = l[i].value;
@@ -362,34 +460,31 @@ static void merge_piece(cob* this, uint64_t piece_index) {
 	}
 
 	// Try to find a right neighbour.
-	uint64_t right_neighbour_index;
-	for (right_neighbour_index = piece_index + 1;
-			right_neighbour_index < this->file.capacity;
-			right_neighbour_index++) {
-		if (this->file.occupied[right_neighbour_index]) {
-			log_verbose(2, "will merge piece %" PRIu64 " "
-					"with right: %" PRIu64,
-					piece_index, right_neighbour_index);
-			merge_pieces(this, piece_index, right_neighbour_index);
-			return;
-		}
+	const uint64_t right_neighbour_index =
+			pma_next_occupied(&this->file, piece_index + 1);
+	if (right_neighbour_index < this->file.capacity) {
+		log_verbose(2, "will merge piece %" PRIu64 " "
+				"with right: %" PRIu64,
+				piece_index, right_neighbour_index);
+		merge_pieces(this, piece_index, right_neighbour_index);
+		return;
 	}
 
-	uint64_t left_neighbour_index;
-	for (uint64_t i = 0; i < piece_index; i++) {
-		left_neighbour_index = piece_index - 1 - i;
-		if (this->file.occupied[left_neighbour_index]) {
-			log_verbose(2, "will merge piece %" PRIu64 " "
-					"with left: %" PRIu64,
-					piece_index, left_neighbour_index);
-			merge_pieces(this, left_neighbour_index, piece_index);
-			return;
-		}
+	const uint64_t left_neighbour_index =
+			pma_previous_occupied(&this->file, piece_index);
+	if (left_neighbour_index != UINT64_MAX &&
+			is_live(this, left_neighbour_index)) {
+		log_verbose(2, "will merge piece %" PRIu64 " "
+				"with left: %" PRIu64,
+				piece_index, left_neighbour_index);
+		merge_pieces(this, left_neighbour_index, piece_index);
+		return;
 	}
 	// Got nothing to merge with. This is not a problem, since it's
 	// a singeton block.
-	// We may need to mark it unoccupied, through.
-	if (piece_size(this, piece) == 0) {
+	// We may need to mark it unoccupied, through. (Not in a new PMA
+	// being migrated into, which needs its first piece at index 0.)
+	if (piece_size(this, piece) == 0 && this->stream == NULL) {
 		delete_piece(this, piece_index);
 	}
 }
@@ -401,22 +496,23 @@ bool cob_delete(cob* this, uint64_t key) {
 		enforce_piece_policy(this, this->size - 1);
 	}
 
-	const uint64_t index = cobt_tree_find_le(&this->tree, key);
-	if (!this->file.occupied[index]) {
+	cob* part = part_for(this, key);
+	const uint64_t index = cobt_tree_find_le(&part->tree, key);
+	if (!is_live(part, index)) {
 		goto no_such_key;
 	}
 
-	piece_item* piece = get_piece_start(this, index);
-	if (!delete_from_piece(this, piece, key)) {
+	piece_item* piece = get_piece_start(part, index);
+	if (!delete_from_piece(part, piece, key)) {
 		goto no_such_key;
 	}
 
 	log_verbose(2, "updating piece key to reflect deletion of %" PRIu64,
 			key);
-	refresh_piece_key(this, index);
+	refresh_piece_key(part, index);
 
 	log_verbose(2, "merging piece with neighbours");
-	merge_piece(this, index);
+	merge_piece(part, index);
 	--this->size;
 	log_verbose(1, "cob_delete(%" PRIu64 "): done", key);
 	return true;
@@ -429,11 +525,12 @@ no_such_key:
 
 bool cob_find(cob* this, uint64_t key, uint64_t *value) {
 	validate_key(key);
-	const uint64_t index = cobt_tree_find_le(&this->tree, key);
-	if (this->file.occupied[index]) {
+	cob* part = part_for(this, key);
+	const uint64_t index = cobt_tree_find_le(&part->tree, key);
+	if (is_live(part, index)) {
 		// Look up the key in this piece.
-		piece_item* piece = get_piece_start(this, index);
-		for (uint8_t i = 0; i < this->piece; i++) {
+		piece_item* piece = get_piece_start(part, index);
+		for (uint8_t i = 0; i < part->piece; i++) {
 			if (piece[i].key == key) {
 				if (value != NULL) {
 					*value = piece[i].value;
@@ -448,11 +545,92 @@ bool cob_find(cob* this, uint64_t key, uint64_t *value) {
 	return false;
 }
 
-bool cob_next_key(cob* this, uint64_t key, uint64_t *next_key) {
+static bool find_in_piece(const cob* this, const piece_item* piece,
+		uint64_t key, uint64_t *value) {
+	for (uint8_t i = 0; i < this->piece; i++) {
+		if (piece[i].key == key) {
+			if (value != NULL) {
+				*value = piece[i].value;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint64_t* find_slot(cob* this, uint64_t key) {
+	cob* part = part_for(this, key);
+	const uint64_t index = cobt_tree_find_le(&part->tree, key);
+	if (is_live(part, index)) {
+		piece_item* piece = get_piece_start(part, index);
+		for (uint8_t i = 0; i < part->piece; i++) {
+			if (piece[i].key == key) {
+				return &piece[i].value;
+			}
+		}
+	}
+	return NULL;
+}
+
+bool cob_upsert(cob* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
 	validate_key(key);
+	*slot = find_slot(this, key);
+	if (*slot != NULL) {
+		return false;
+	}
+	// Inserting may split pieces or reorganize the PMA, so we look
+	// for the new slot only afterwards.
+	ASSERT(cob_insert(this, key, default_value));
+	*slot = find_slot(this, key);
+	return true;
+}
+
+#define FIND_BATCH_GROUP 16
+
+void cob_find_batch(cob* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	if (this->migration != NULL) {
+		// Keys may be in either PMA. Migrations are short, so we
+		// do not batch them.
+		for (uint64_t i = 0; i < n; i++) {
+			found[i] = cob_find(this, keys[i],
+					values ? &values[i] : NULL);
+		}
+		return;
+	}
+	uint64_t indexes[FIND_BATCH_GROUP];
+	const piece_item* pieces[FIND_BATCH_GROUP];
+	for (uint64_t begin = 0; begin < n; begin += FIND_BATCH_GROUP) {
+		const uint64_t group = (n - begin < FIND_BATCH_GROUP) ?
+				(n - begin) : FIND_BATCH_GROUP;
+		for (uint64_t i = 0; i < group; i++) {
+			validate_key(keys[begin + i]);
+		}
+		cobt_tree_find_le_batch(&this->tree, keys + begin, group,
+				indexes);
+		for (uint64_t i = 0; i < group; i++) {
+			__builtin_prefetch(
+					&this->file.occupied[indexes[i] / 64]);
+			__builtin_prefetch(get_piece_start(this, indexes[i]));
+		}
+		for (uint64_t i = 0; i < group; i++) {
+			pieces[i] = pma_is_occupied(&this->file, indexes[i]) ?
+					get_piece_start(this, indexes[i]) : NULL;
+		}
+		for (uint64_t i = 0; i < group; i++) {
+			found[begin + i] = pieces[i] != NULL &&
+					find_in_piece(this, pieces[i],
+						keys[begin + i],
+						values ? &values[begin + i] : NULL);
+		}
+	}
+}
+
+static bool next_key_in(cob* this, uint64_t key, uint64_t *next_key) {
 	const uint64_t index = cobt_tree_find_le(&this->tree, key);
 
-	if (this->file.occupied[index]) {
+	if (is_live(this, index)) {
 		// Look for next key within the piece.
 		piece_item* piece = get_piece_start(this, index);
 		for (uint8_t i = 0; i < this->piece; i++) {
@@ -465,10 +643,9 @@ bool cob_next_key(cob* this, uint64_t key, uint64_t *next_key) {
 		}
 	}
 	// Look in pieces to the right.
-	for (uint64_t i = index + 1; i < this->file.capacity; i++) {
-		if (!this->file.occupied[i]) {
-			continue;
-		}
+	for (uint64_t i = pma_next_occupied(&this->file, index + 1);
+			i < this->file.capacity;
+			i = pma_next_occupied(&this->file, i + 1)) {
 		piece_item* piece = get_piece_start(this, i);
 		if (piece[0].key != EMPTY) {
 			if (next_key) {
@@ -480,11 +657,23 @@ bool cob_next_key(cob* this, uint64_t key, uint64_t *next_key) {
 	return false;
 }
 
-bool cob_previous_key(cob* this, uint64_t key, uint64_t *previous_key) {
+bool cob_next_key(cob* this, uint64_t key, uint64_t *next_key) {
 	validate_key(key);
+	if (key < this->boundary) {
+		if (next_key_in(&this->migration->incoming, key, next_key)) {
+			return true;
+		}
+		// Keys that have not migrated are all >= boundary.
+		key = this->boundary - 1;
+	}
+	return next_key_in(this, key, next_key);
+}
+
+static bool previous_key_in(cob* this, uint64_t key,
+		uint64_t *previous_key) {
 	const uint64_t index = cobt_tree_find_le(&this->tree, key);
 
-	if (this->file.occupied[index]) {
+	if (is_live(this, index)) {
 		// Look for next key within the piece.
 		piece_item* piece = get_piece_start(this, index);
 		for (uint8_t i = 0; i < this->piece; i++) {
@@ -497,12 +686,10 @@ bool cob_previous_key(cob* this, uint64_t key, uint64_t *previous_key) {
 			}
 		}
 	}
-	// Look in pieces to the right.
-	for (uint64_t i = 0; i < index; i++) {
-		uint64_t idx = index - 1 - i;
-		if (!this->file.occupied[idx]) {
-			continue;
-		}
+	// Look in pieces to the left.
+	for (uint64_t idx = pma_previous_occupied(&this->file, index);
+			idx != UINT64_MAX && is_live(this, idx);
+			idx = pma_previous_occupied(&this->file, idx)) {
 		piece_item* piece = get_piece_start(this, idx);
 		for (uint8_t i = 0; i < this->piece; i++) {
 			uint8_t piece_idx = this->piece - i - 1;
@@ -517,69 +704,735 @@ bool cob_previous_key(cob* this, uint64_t key, uint64_t *previous_key) {
 	return false;
 }
 
-static pma rebuild_file(cob* this, uint64_t new_size, uint8_t new_piece) {
-	pma new_file = { .occupied = NULL, .keys = NULL, .values = NULL };
-	const uint8_t preferred_piece = new_piece / 2;
-	const uint64_t piece_count = (new_size / preferred_piece) + 1;
-	log_verbose(1, "preparing to store %" PRIu64 " pieces of size %" PRIu8,
-			piece_count, new_piece);
-	pma_stream stream;
-	pma_stream_start(&new_file, piece_count, &stream);
+bool cob_previous_key(cob* this, uint64_t key, uint64_t *previous_key) {
+	validate_key(key);
+	if (previous_key_in(this, key, previous_key)) {
+		return true;
+	}
+	// Migrated keys are all below the keys left in this PMA.
+	return this->migration != NULL && previous_key_in(
+			&this->migration->incoming, key, previous_key);
+}
 
-	uint8_t buffer_size = 0;
-	piece_item* buffer = new_piece2(new_piece);
+// Cursors skip empty pieces, which new PMAs can have during migrations.
+static bool cursor_enter_piece_from_left(cob_cursor* cursor, cob* part,
+		uint64_t index) {
+	for (index = pma_next_occupied(&part->file, index);
+			index < part->file.capacity;
+			index = pma_next_occupied(&part->file, index + 1)) {
+		if (get_piece_start(part, index)[0].key != EMPTY) {
+			cursor->part = part;
+			cursor->index = index;
+			cursor->offset = 0;
+			return true;
+		}
+	}
+	if (part != cursor->tree) {
+		// Continue with the pieces that have not migrated.
+		return cursor_enter_piece_from_left(cursor, cursor->tree,
+				first_live(cursor->tree));
+	}
+	return false;
+}
 
-	for (uint64_t i = 0; i < this->file.capacity; i++) {
-		if (!this->file.occupied[i]) {
+static bool cursor_enter_piece_from_right(cob_cursor* cursor, cob* part,
+		uint64_t index) {
+	for (index = pma_previous_occupied(&part->file, index);
+			index != UINT64_MAX && is_live(part, index);
+			index = pma_previous_occupied(&part->file, index)) {
+		const piece_item* piece = get_piece_start(part, index);
+		const uint8_t size = piece_size(part, piece);
+		if (size > 0) {
+			cursor->part = part;
+			cursor->index = index;
+			cursor->offset = size - 1;
+			return true;
+		}
+	}
+	if (part->migration != NULL) {
+		// Continue with the migrated pieces.
+		cob* incoming = &part->migration->incoming;
+		return cursor_enter_piece_from_right(cursor, incoming,
+				incoming->file.capacity);
+	}
+	return false;
+}
+
+void cob_cursor_init(cob_cursor* cursor, cob* tree) {
+	cursor->tree = tree;
+	cursor->part = tree;
+	cursor->index = 0;
+	cursor->offset = 0;
+}
+
+bool cob_cursor_seek(cob_cursor* cursor, uint64_t key) {
+	validate_key(key);
+	cob* part = part_for(cursor->tree, key);
+	const uint64_t index = cobt_tree_find_le(&part->tree, key);
+	if (!is_live(part, index)) {
+		// All live pieces are keyed above the key.
+		return cursor_enter_piece_from_left(cursor, part, index + 1);
+	}
+	const piece_item* piece = get_piece_start(part, index);
+	for (uint8_t i = 0; i < part->piece; i++) {
+		if (piece[i].key == EMPTY) {
+			break;
+		}
+		if (piece[i].key >= key) {
+			cursor->part = part;
+			cursor->index = index;
+			cursor->offset = i;
+			return true;
+		}
+	}
+	return cursor_enter_piece_from_left(cursor, part, index + 1);
+}
+
+bool cob_cursor_last(cob_cursor* cursor) {
+	return cursor_enter_piece_from_right(cursor, cursor->tree,
+			cursor->tree->file.capacity);
+}
+
+bool cob_cursor_next(cob_cursor* cursor) {
+	const cob* part = cursor->part;
+	const piece_item* piece = get_piece_start(part, cursor->index);
+	if (cursor->offset + 1 < part->piece &&
+			piece[cursor->offset + 1].key != EMPTY) {
+		++cursor->offset;
+		return true;
+	}
+	return cursor_enter_piece_from_left(cursor, cursor->part,
+			cursor->index + 1);
+}
+
+bool cob_cursor_prev(cob_cursor* cursor) {
+	if (cursor->offset > 0) {
+		--cursor->offset;
+		return true;
+	}
+	return cursor_enter_piece_from_right(cursor, cursor->part,
+			cursor->index);
+}
+
+uint64_t cob_cursor_key(const cob_cursor* cursor) {
+	return get_piece_start(cursor->part, cursor->index)[cursor->offset].key;
+}
+
+uint64_t cob_cursor_value(const cob_cursor* cursor) {
+	return get_piece_start(cursor->part,
+			cursor->index)[cursor->offset].value;
+}
+
+uint64_t cob_slot_count(const cob* this) {
+	uint64_t count = this->file.capacity;
+	if (this->migration != NULL) {
+		count += this->migration->incoming.file.capacity;
+	}
+	return count;
+}
+
+const cob_piece_item* cob_piece_near(cob* this, uint64_t slot,
+		uint8_t* piece) {
+	cob* const parts[2] = {
+		this,
+		(this->migration != NULL) ? &this->migration->incoming : NULL
+	};
+	uint8_t part_index = 0;
+	if (slot >= this->file.capacity) {
+		part_index = 1;
+		slot -= this->file.capacity;
+	}
+	// Start at the slot, look through the other part and wrap around.
+	for (uint8_t i = 0; i < 3; i++, part_index = 1 - part_index) {
+		cob* part = parts[part_index];
+		if (part == NULL) {
 			continue;
 		}
+		uint64_t index = pma_next_occupied(&part->file, slot);
+		slot = 0;
+		if (index < part->file.capacity && !is_live(part, index)) {
+			index = first_live(part);
+		}
+		for (; index < part->file.capacity;
+				index = pma_next_occupied(&part->file,
+					index + 1)) {
+			const piece_item* found = get_piece_start(part, index);
+			if (found[0].key != EMPTY) {
+				*piece = part->piece;
+				return found;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void clear_buffer(piece_stream* stream) {
+	for (uint8_t i = 0; i < stream->piece; i++) {
+		stream->buffer[i].key = EMPTY;
+		stream->buffer[i].value = EMPTY;
+	}
+}
+
+// Number of half-full pieces holding `size` pairs.
+static uint64_t half_full_pieces(uint64_t size, uint8_t piece) {
+	return size / (piece / 2) + 1;
+}
+
+// Spaces the pieces for `room` >= `pieces` pieces (see
+// pma_stream_start_with_room).
+static void piece_stream_start(pma* file, uint64_t pieces, uint64_t room,
+		uint8_t piece, piece_stream* stream) {
+	log_verbose(1, "preparing to store %" PRIu64 " pieces of size %" PRIu8,
+			pieces, piece);
+	pma_stream_start_with_room(file, pieces, room,
+			piece * sizeof(piece_item), &stream->stream);
+	stream->buffer = malloc(piece * sizeof(piece_item));
+	CHECK(stream->buffer != NULL, "cannot allocate piece buffer");
+	stream->buffer_size = 0;
+	stream->piece = piece;
+	clear_buffer(stream);
+}
+
+static void piece_stream_flush(piece_stream* stream) {
+	if (stream->buffer_size > 0) {
+		log_verbose(2, "flush");
+		pma_stream_push(&stream->stream, stream->buffer[0].key,
+				stream->buffer);
+		stream->buffer_size = 0;
+		clear_buffer(stream);
+	}
+}
+
+static void piece_stream_push(piece_stream* stream,
+		uint64_t key, uint64_t value) {
+	assert(stream->buffer_size < stream->piece / 2);
+	stream->buffer[stream->buffer_size].key = key;
+	stream->buffer[stream->buffer_size].value = value;
+	++stream->buffer_size;
+
+	log_verbose(2, "push %" PRIu64 "=%" PRIu64, key, value);
+
+	if (stream->buffer_size == stream->piece / 2) {
+		piece_stream_flush(stream);
+	}
+}
+
+static void piece_stream_finish(piece_stream* stream) {
+	piece_stream_flush(stream);
+	free(stream->buffer);
+	stream->buffer = NULL;
+}
+
+static pma rebuild_file(cob* this, uint64_t new_size, uint8_t new_piece) {
+	pma new_file = { .occupied = NULL, .keys = NULL, .values = NULL };
+	piece_stream stream;
+	const uint64_t pieces = half_full_pieces(new_size, new_piece);
+	piece_stream_start(&new_file, pieces, pieces, new_piece, &stream);
+
+	for (uint64_t i = pma_next_occupied(&this->file, 0);
+			i < this->file.capacity;
+			i = pma_next_occupied(&this->file, i + 1)) {
 		piece_item* this_piece = get_piece_start(this, i);
 		for (uint8_t j = 0; j < this->piece; j++) {
 			if (this_piece[j].key == EMPTY) {
 				continue;
 			}
-			assert(buffer_size < preferred_piece);
-			buffer[buffer_size].key = this_piece[j].key;
-			buffer[buffer_size].value = this_piece[j].value;
-			++buffer_size;
-
-			log_verbose(2, "push %" PRIu64 "=%" PRIu64,
-					this_piece[j].key, this_piece[j].value);
-
-			if (buffer_size == preferred_piece) {
-				log_verbose(2, "flush");
-				pma_stream_push(&stream, buffer[0].key, buffer);
-				buffer_size = 0;
-				buffer = new_piece2(new_piece);
+			piece_stream_push(&stream, this_piece[j].key,
+					this_piece[j].value);
+		}
+	}
+
+	piece_stream_finish(&stream);
+	log_verbose(1, "rebuilt file to piece %" PRIu8, new_piece);
+	return new_file;
+}
+
+// Migrations move the pieces into a new PMA in key order, a few per update.
+// Keys below the boundary are served by the new PMA, the rest by the old
+// one. Pieces are streamed into the new PMA, which is sized with enough
+// slack to also take the pieces split while the migration runs. Should the
+// slack run out anyway, the new PMA grows, and its tree is rebuilt.
+static void start_migration(cob* this, uint8_t new_piece) {
+	log_verbose(1, "%" PRIu64 " migrating: capacity %" PRIu64 ", "
+			"piece %" PRIu8 " -> %" PRIu8, this->size,
+			this->file.capacity, this->piece, new_piece);
+	struct cob_migration* migration = malloc(sizeof(*migration));
+	CHECK(migration != NULL, "cannot allocate migration");
+
+	// Every update adds at most one pair, and so at most one piece.
+	const uint64_t pieces = this->file.size;
+	const uint64_t prepare_updates = pieces / MIGRATION_STEP + 1;
+	const uint64_t migrate_updates = (pieces + prepare_updates) /
+			(MIGRATION_STEP - 1) + 1;
+	const uint64_t updates = prepare_updates + migrate_updates;
+	uint64_t new_pieces, pushes;
+	if (new_piece == this->piece) {
+		// Pieces are moved as they are.
+		new_pieces = pieces;
+		pushes = pieces + updates;
+	} else {
+		// Pairs are regrouped, with a partial piece after every update.
+		new_pieces = half_full_pieces(this->size, new_piece);
+		pushes = half_full_pieces(this->size + updates, new_piece) +
+				migrate_updates;
+	}
+	// Pieces split in the new PMA take room too.
+	const uint64_t room = pushes + 2 * migrate_updates;
+
+	cob* incoming = &migration->incoming;
+	incoming->size = 0;
+	incoming->piece = new_piece;
+	incoming->file = (pma) {
+		.occupied = NULL, .keys = NULL, .values = NULL
+	};
+	piece_stream_start(&incoming->file, new_pieces, room, new_piece,
+			&migration->stream);
+	cobt_tree_init_unrefreshed(&incoming->tree, this->tree.layout,
+			incoming->file.keys, incoming->file.occupied,
+			incoming->file.capacity);
+	incoming->boundary = 0;
+	incoming->migration = NULL;
+	incoming->stream = &migration->stream.stream;
+
+	migration->prepared = 0;
+	migration->prepare_step = cobt_tree_leaf_count(&incoming->tree) /
+			prepare_updates + 1;
+	this->migration = migration;
+}
+
+static void finish_migration(cob* this) {
+	struct cob_migration* migration = this->migration;
+	cob* incoming = &migration->incoming;
+	log_verbose(1, "%" PRIu64 " migrated: capacity %" PRIu64 ", "
+			"piece %" PRIu8, this->size, incoming->file.capacity,
+			incoming->piece);
+	piece_stream_finish(&migration->stream);
+	const uint64_t prior_capacity = incoming->file.capacity;
+	const pma_range reorg_range =
+			pma_stream_end(&migration->stream.stream);
+
+	pma_destroy(&this->file);
+	cobt_tree_destroy(&this->tree);
+	this->file = incoming->file;
+	this->tree = incoming->tree;
+	this->piece = incoming->piece;
+	this->boundary = 0;
+	this->migration = NULL;
+	free(migration);
+	if (this->file.capacity == prior_capacity) {
+		fix_range(this, reorg_range);
+	} else {
+		entirely_reset_veb(this, 1);
+	}
+
+	// The first piece may have been left empty.
+	if (this->file.size > 0 && get_piece_start(this, 0)[0].key == EMPTY) {
+		delete_piece(this, 0);
+	}
+}
+
+static void migrate_step(cob* this) {
+	struct cob_migration* migration = this->migration;
+	cob* incoming = &migration->incoming;
+	const uint64_t leaves = cobt_tree_leaf_count(&incoming->tree);
+	// Once pieces have moved, the tree is kept up to date, also when
+	// the new PMA grows and the tree is rebuilt.
+	if (incoming->file.size == 0 && migration->prepared < leaves) {
+		uint64_t end = migration->prepared + migration->prepare_step;
+		if (end > leaves) {
+			end = leaves;
+		}
+		cobt_tree_refresh(&incoming->tree, (cobt_tree_range) {
+			.begin = migration->prepared,
+			.end = end
+		});
+		migration->prepared = end;
+		return;
+	}
+
+	const uint64_t begin = migration->stream.stream.frontier;
+	uint64_t index = first_live(this);
+	for (uint8_t i = 0; i < MIGRATION_STEP && index < this->file.capacity;
+			i++) {
+		const piece_item* piece = get_piece_start(this, index);
+		if (incoming->piece == this->piece) {
+			pma_stream_push(&migration->stream.stream,
+					this->file.keys[index], piece);
+		} else {
+			for (uint8_t j = 0; j < this->piece &&
+					piece[j].key != EMPTY; j++) {
+				piece_stream_push(&migration->stream,
+						piece[j].key, piece[j].value);
 			}
 		}
-		free(this_piece);
+		index = pma_next_occupied(&this->file, index + 1);
 	}
+	piece_stream_flush(&migration->stream);
+	fix_range(incoming, (pma_range) {
+		.begin = begin,
+		.size = migration->stream.stream.frontier - begin
+	});
 
-	if (buffer_size > 0) {
-		log_verbose(2, "final flush");
-		pma_stream_push(&stream, buffer[0].key, buffer);
+	if (index < this->file.capacity) {
+		this->boundary = this->file.keys[index];
 	} else {
-		free(buffer);
+		finish_migration(this);
 	}
-	log_verbose(1, "rebuilt file to piece %" PRIu8, new_piece);
-	return new_file;
 }
 
-void cob_init(cob* this) {
+void cob_bulk_load(cob* this, const cob_piece_item* pairs, uint64_t n) {
+	CHECK(this->size == 0, "bulk loading into non-empty COB");
+	while (this->migration != NULL) {
+		migrate_step(this);
+	}
+	pma_destroy(&this->file);
+
+	const uint8_t piece = adequate_piece(this->piece, n);
+	piece_stream stream;
+	const uint64_t pieces = half_full_pieces(n, piece);
+	piece_stream_start(&this->file, pieces, pieces, piece, &stream);
+	for (uint64_t i = 0; i < n; i++) {
+		validate_key(pairs[i].key);
+		piece_stream_push(&stream, pairs[i].key, pairs[i].value);
+	}
+	piece_stream_finish(&stream);
+
+	this->piece = piece;
+	this->size = n;
+	entirely_reset_veb(this, cobt_tree_online_cpus());
+}
+
+// Sorts pairs by key, keeping pairs with equal keys in their order.
+// Runs that are already sorted are not merged again, so sorted batches
+// take linear time.
+static void sort_pairs(piece_item* pairs, uint64_t n) {
+	if (n < 2) {
+		return;
+	}
+	piece_item* buffer = malloc(n * sizeof(piece_item));
+	CHECK(buffer != NULL, "cannot allocate sorting buffer");
+	for (uint64_t width = 1; width < n; width *= 2) {
+		for (uint64_t begin = 0; begin + width < n;
+				begin += 2 * width) {
+			const uint64_t middle = begin + width;
+			const uint64_t end = (middle + width < n) ?
+					(middle + width) : n;
+			if (pairs[middle - 1].key <= pairs[middle].key) {
+				continue;
+			}
+			uint64_t left = begin, right = middle, out = begin;
+			while (left < middle && right < end) {
+				if (pairs[right].key < pairs[left].key) {
+					buffer[out++] = pairs[right++];
+				} else {
+					buffer[out++] = pairs[left++];
+				}
+			}
+			while (left < middle) {
+				buffer[out++] = pairs[left++];
+			}
+			while (right < end) {
+				buffer[out++] = pairs[right++];
+			}
+			memcpy(&pairs[begin], &buffer[begin],
+					(end - begin) * sizeof(piece_item));
+		}
+	}
+	free(buffer);
+}
+
+// Keeps the first of every run of pairs with equal keys.
+// Returns the number of pairs kept.
+static uint64_t drop_duplicates(piece_item* pairs, uint64_t n) {
+	uint64_t kept = 0;
+	for (uint64_t i = 0; i < n; i++) {
+		if (kept == 0 || pairs[kept - 1].key != pairs[i].key) {
+			pairs[kept++] = pairs[i];
+		}
+	}
+	return kept;
+}
+
+static void push_merged(piece_stream* stream, const piece_item* pair,
+		uint64_t* merged) {
+	if (stream != NULL) {
+		piece_stream_push(stream, pair->key, pair->value);
+	}
+	++*merged;
+}
+
+// Merges sorted unique pairs with the pairs of the COB, which win on equal
+// keys. The result goes into the stream, unless it is NULL.
+// Returns the number of merged pairs.
+static uint64_t merge_all(const cob* this, const piece_item* pairs,
+		uint64_t n, piece_stream* stream) {
+	uint64_t merged = 0, next = 0;
+	for (uint64_t i = pma_next_occupied(&this->file, 0);
+			i < this->file.capacity;
+			i = pma_next_occupied(&this->file, i + 1)) {
+		const piece_item* piece = get_piece_start(this, i);
+		for (uint8_t j = 0; j < this->piece && piece[j].key != EMPTY;
+				j++) {
+			for (; next < n && pairs[next].key <= piece[j].key;
+					next++) {
+				if (pairs[next].key < piece[j].key) {
+					push_merged(stream, &pairs[next],
+							&merged);
+				}
+			}
+			push_merged(stream, &piece[j], &merged);
+		}
+	}
+	for (; next < n; next++) {
+		push_merged(stream, &pairs[next], &merged);
+	}
+	return merged;
+}
+
+// Builds a new PMA with the pairs merged in. Returns the number of new keys.
+static uint64_t rebuild_with(cob* this, const piece_item* pairs, uint64_t n) {
+	const uint64_t merged = merge_all(this, pairs, n, NULL);
+	const uint8_t new_piece = adequate_piece(this->piece, merged);
+	log_verbose(1, "rebuilding with %" PRIu64 " new pairs, piece %" PRIu8,
+			merged - this->size, new_piece);
+
+	pma new_file = { .occupied = NULL, .keys = NULL, .values = NULL };
+	piece_stream stream;
+	const uint64_t pieces = half_full_pieces(merged, new_piece);
+	piece_stream_start(&new_file, pieces, pieces, new_piece, &stream);
+	merge_all(this, pairs, n, &stream);
+	piece_stream_finish(&stream);
+
+	pma_destroy(&this->file);
+	this->file = new_file;
+	this->piece = new_piece;
+	entirely_reset_veb(this, cobt_tree_online_cpus());
+	return merged - this->size;
+}
+
+// Refreshes the tree over the slots whose keys changed and the windows the
+// PMA spread. Both lists are sorted, and slots may lie in windows.
+static void refresh_batch(cob* this, const uint64_t* slots, uint64_t n_slots,
+		const pma_range* windows, uint64_t n_windows) {
+	cobt_tree_range* ranges = malloc((n_slots + n_windows) *
+			sizeof(cobt_tree_range));
+	CHECK(n_slots + n_windows == 0 || ranges != NULL,
+			"cannot allocate refreshed ranges");
+	uint64_t n = 0;
+	for (uint64_t i = 0, j = 0; i < n_slots || j < n_windows; ) {
+		cobt_tree_range range;
+		if (j == n_windows || (i < n_slots &&
+					slots[i] < windows[j].begin)) {
+			range = (cobt_tree_range) {
+				.begin = slots[i],
+				.end = slots[i] + 1
+			};
+			++i;
+		} else {
+			range = (cobt_tree_range) {
+				.begin = windows[j].begin,
+				.end = windows[j].begin + windows[j].size
+			};
+			++j;
+		}
+		if (n > 0 && range.begin < ranges[n - 1].end) {
+			if (range.end > ranges[n - 1].end) {
+				ranges[n - 1].end = range.end;
+			}
+		} else {
+			ranges[n++] = range;
+		}
+	}
+	cobt_tree_refresh_ranges(&this->tree, ranges, n);
+	free(ranges);
+}
+
+// Finds the piece of a key above the keys of the previous run, which ended
+// before the piece `after`. Sorted batches often continue a few pieces
+// further, so these are tried before descending from the root.
+static uint64_t find_run_piece(cob* this, uint64_t after, uint64_t key) {
+	uint64_t index = after;
+	for (uint8_t i = 0; i < BATCH_SCAN_PIECES &&
+			index < this->file.capacity; i++) {
+		const uint64_t next = pma_next_occupied(&this->file,
+				index + 1);
+		if (next == this->file.capacity ||
+				this->file.keys[next] > key) {
+			return index;
+		}
+		index = next;
+	}
+	return cobt_tree_find_le(&this->tree, key);
+}
+
+// Merges sorted unique pairs into the pieces they belong to. Overflowing
+// pieces are split, and all new pieces go into the PMA in one batch.
+// Returns the number of new keys.
+static uint64_t merge_into_pieces(cob* this, const piece_item* pairs,
+		uint64_t n) {
+	const uint64_t piece_bytes = this->piece * sizeof(piece_item);
+	piece_item* merged = malloc((this->piece + n) * sizeof(piece_item));
+	uint64_t* slots = malloc(n * sizeof(uint64_t));
+	CHECK(merged != NULL && slots != NULL, "cannot allocate batch");
+	uint64_t n_slots = 0, inserted = 0;
+
+	// New pieces, with their keys and the indexes they go before.
+	uint64_t added = 0, added_capacity = 16;
+	piece_item* added_pieces = malloc(added_capacity * piece_bytes);
+	uint64_t* added_keys = malloc(added_capacity * sizeof(uint64_t));
+	uint64_t* added_before = malloc(added_capacity * sizeof(uint64_t));
+
+	uint64_t next = this->file.capacity;
+	for (uint64_t i = 0; i < n; ) {
+		const uint64_t index = find_run_piece(this, next,
+				pairs[i].key);
+		assert(pma_is_occupied(&this->file, index));
+		next = pma_next_occupied(&this->file, index + 1);
+		const uint64_t limit = (next < this->file.capacity) ?
+				this->file.keys[next] : COB_INFINITY;
+		piece_item* piece = get_piece_start(this, index);
+
+		// Merges the pairs below the next piece into this one.
+		uint64_t count = 0;
+		uint8_t j = 0;
+		for (; i < n && pairs[i].key < limit; i++) {
+			for (; j < this->piece && piece[j].key != EMPTY &&
+					piece[j].key <= pairs[i].key; j++) {
+				merged[count++] = piece[j];
+			}
+			if (count == 0 ||
+					merged[count - 1].key != pairs[i].key) {
+				merged[count++] = pairs[i];
+				++inserted;
+			}
+		}
+		for (; j < this->piece && piece[j].key != EMPTY; j++) {
+			merged[count++] = piece[j];
+		}
+
+		// Like split_piece, keeps at most piece - 2 pairs per piece.
+		const uint64_t pieces = (count <= this->piece - 2u) ? 1 :
+				(count + this->piece / 2 - 1) /
+				(this->piece / 2);
+		for (uint64_t k = 0, begin = 0; k < pieces; k++) {
+			const uint64_t end = begin +
+					(count - begin) / (pieces - k);
+			piece_item* target = piece;
+			if (k > 0) {
+				if (added == added_capacity) {
+					added_capacity *= 2;
+					added_pieces = realloc(added_pieces,
+							added_capacity *
+							piece_bytes);
+					added_keys = realloc(added_keys,
+							added_capacity *
+							sizeof(uint64_t));
+					added_before = realloc(added_before,
+							added_capacity *
+							sizeof(uint64_t));
+				}
+				CHECK(added_pieces != NULL &&
+						added_keys != NULL &&
+						added_before != NULL,
+						"cannot allocate new pieces");
+				target = &added_pieces[added * this->piece];
+				added_keys[added] = merged[begin].key;
+				added_before[added] = next;
+				++added;
+			}
+			clear_piece(this, target);
+			memcpy(target, &merged[begin],
+					(end - begin) * sizeof(piece_item));
+			begin = end;
+		}
+		if (this->file.keys[index] != piece[0].key) {
+			this->file.keys[index] = piece[0].key;
+			slots[n_slots++] = index;
+		}
+	}
+	free(merged);
+
+	pma_range* windows = malloc(added * sizeof(pma_range));
+	CHECK(added == 0 || windows != NULL, "cannot allocate windows");
+	const uint64_t prior_capacity = this->file.capacity;
+	const uint64_t n_windows = pma_insert_batch(&this->file, added_keys,
+			added_pieces, added_before, added, windows);
+	log_verbose(1, "merged %" PRIu64 " pairs, %" PRIu64 " new pieces, "
+			"%" PRIu64 " windows", inserted, added, n_windows);
+	if (this->file.capacity == prior_capacity) {
+		refresh_batch(this, slots, n_slots, windows, n_windows);
+	} else {
+		entirely_reset_veb(this, cobt_tree_online_cpus());
+	}
+
+	free(windows);
+	free(slots);
+	free(added_pieces);
+	free(added_keys);
+	free(added_before);
+	return inserted;
+}
+
+uint64_t cob_insert_batch(cob* this, const cob_piece_item* pairs,
+		uint64_t n) {
+	piece_item* sorted = malloc(n * sizeof(piece_item));
+	CHECK(n == 0 || sorted != NULL, "cannot allocate batch");
+	for (uint64_t i = 0; i < n; i++) {
+		validate_key(pairs[i].key);
+		sorted[i] = pairs[i];
+	}
+	sort_pairs(sorted, n);
+	n = drop_duplicates(sorted, n);
+
+	// The batch is merged into one PMA.
+	while (this->migration != NULL) {
+		migrate_step(this);
+	}
+
+	uint64_t inserted = 0;
+	if (n == 0) {
+		// Nothing to insert.
+	} else if (n * 4 >= this->size ||
+			adequate_piece(this->piece, this->size + n) !=
+					this->piece) {
+		// Big batches are cheaper to merge into a new PMA.
+		inserted = rebuild_with(this, sorted, n);
+	} else {
+		inserted = merge_into_pieces(this, sorted, n);
+	}
+	this->size += inserted;
+	free(sorted);
+	log_verbose(1, "cob_insert_batch: %" PRIu64 " of %" PRIu64 " inserted",
+			inserted, n);
+	return inserted;
+}
+
+static void init_with_layout(cob* this, cobt_tree_layout layout) {
 	log_verbose(1, "cob_init(%p)", this);
 	this->size = 0;
 	this->piece = 4;  // Initial piece size: 4
-	pma_init(&this->file);
-	cobt_tree_init(&this->tree, this->file.keys, this->file.occupied,
-			this->file.capacity);
+	pma_init(&this->file, this->piece * sizeof(piece_item));
+	cobt_tree_init(&this->tree, layout, this->file.keys,
+			this->file.occupied, this->file.capacity);
+	this->boundary = 0;
+	this->migration = NULL;
+	this->stream = NULL;
+}
+
+void cob_init(cob* this) {
+	init_with_layout(this, COBT_TREE_BINARY);
+}
+
+void cob_init_blocked(cob* this) {
+	init_with_layout(this, COBT_TREE_BLOCKED);
 }
 
 void cob_destroy(cob* this) {
-	for (uint64_t i = 0; i < this->file.capacity; i++) {
-		if (this->file.occupied[i]) {
-			free(get_piece_start(this, i));
-		}
+	if (this->migration != NULL) {
+		cob_destroy(&this->migration->incoming);
+		free(this->migration->stream.buffer);
+		free(this->migration);
+		this->migration = NULL;
 	}
 	pma_destroy(&this->file);
 	cobt_tree_destroy(&this->tree);
@@ -17,26 +17,92 @@ typedef struct {
 
 #define COB_EMPTY UINT64_MAX
 
+struct cob_migration;
+
 typedef struct {
-	// The PMA stores groups of key-value pairs called "pieces".
-	// They are keyed by their minimal keys.
+	// The PMA stores groups of key-value pairs called "pieces" inline
+	// in its value slots. They are keyed by their minimal keys.
 	// Piece sizes are O(log N) multiples of 4.
 
 	uint64_t size;  // Number of stored elements.
 	uint8_t piece;  // Piece size in number of key-value pairs
 	pma file;
 	cobt_tree tree;
+
+	// Big PMAs grow (or change piece size) incrementally: every update
+	// moves a few pieces into a new PMA, which holds the keys below
+	// `boundary` until the migration finishes. The migrated pieces stay
+	// behind in `file` until then, but they are no longer used.
+	// Outside migrations, `boundary` is 0 and `migration` is NULL.
+	uint64_t boundary;
+	struct cob_migration* migration;
+
+	// Set while this is the new PMA of a migration: pieces are then
+	// added and removed through the stream, which rebalances windows
+	// below the next push and respaces the file when it gets too dense.
+	pma_stream* stream;
 } cob;
 
 void cob_init(cob* this);
+// Like cob_init, but the pieces are indexed by a tree of cache line blocks
+// (see COBT_TREE_BLOCKED).
+void cob_init_blocked(cob* this);
 void cob_destroy(cob* this);
 bool cob_insert(cob* this, uint64_t key, uint64_t value);
+// Builds an empty COB from n pairs with sorted unique keys in linear time.
+void cob_bulk_load(cob* this, const cob_piece_item* pairs, uint64_t n);
+// Inserts n pairs in any order, skipping keys that are present or came
+// earlier in the batch. The batch is sorted and merged into the pieces
+// in one pass, and the pieces split by the merge go into the PMA at once.
+// Batches of at least a quarter of the size rebuild the PMA. Any running
+// migration is finished first. Returns the number of inserted pairs.
+uint64_t cob_insert_batch(cob* this, const cob_piece_item* pairs,
+		uint64_t n);
 bool cob_delete(cob* this, uint64_t key);
 bool cob_find(cob* this, uint64_t key, uint64_t *value);
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the tree is next modified.
+bool cob_upsert(cob* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
+void cob_find_batch(cob* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found);
 bool cob_next_key(cob* this, uint64_t key, uint64_t *next_key);
 bool cob_previous_key(cob* this, uint64_t key, uint64_t *previous_key);
 void cob_check(cob* this);
 
+// Bytes allocated for the PMA (which holds the pieces) and the vEB tree.
+// Does not count the cob struct itself.
+uint64_t cob_memory_usage(const cob* this);
+
+// Picks pieces for sampling keys. Slots cover the PMA (both PMAs during
+// a migration). Returns the first nonempty piece at or after the slot,
+// wrapping around, and sets *piece to its piece size (some of its
+// pairs may be COB_EMPTY). Returns NULL if the COB is empty.
+uint64_t cob_slot_count(const cob* this);
+const cob_piece_item* cob_piece_near(cob* this, uint64_t slot,
+		uint8_t* piece);
+
+// Points at one key-value pair within a piece.
+// Invalidated by any change to the tree.
+typedef struct {
+	cob* tree;
+	cob* part;  // Holds the piece. Differs from tree during migrations.
+	uint64_t index;  // PMA index of the piece
+	uint8_t offset;  // Offset within the piece
+} cob_cursor;
+
+void cob_cursor_init(cob_cursor* cursor, cob* tree);
+// Moves to the smallest key >= key. Returns false if there is no such key.
+bool cob_cursor_seek(cob_cursor* cursor, uint64_t key);
+// Moves to the largest key. Returns false if the tree is empty.
+bool cob_cursor_last(cob_cursor* cursor);
+// Move to the next/previous key. Return false if there is none.
+bool cob_cursor_next(cob_cursor* cursor);
+bool cob_cursor_prev(cob_cursor* cursor);
+uint64_t cob_cursor_key(const cob_cursor* cursor);
+uint64_t cob_cursor_value(const cob_cursor* cursor);
+
 void cob_dump(const cob* this);
 void cob_check_invariants(const cob* this);
 
@@ -0,0 +1,129 @@
+#include "cobt/cobt_test.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cobt/cobt.h"
+#include "log/log.h"
+#include "rand/rand.h"
+
+#define KEYS (1 << 18)
+
+static uint64_t value_of(uint64_t key) {
+	return key * 3 + 1;
+}
+
+// Checks lookups, key scans and cursors against the set of present keys.
+static void check_equivalence(cob* tree, const bool* present,
+		rand_generator* generator) {
+	for (uint64_t i = 0; i < 200; i++) {
+		const uint64_t key = rand_next(generator, KEYS);
+		uint64_t value;
+		ASSERT(cob_find(tree, key, &value) == present[key]);
+		if (present[key]) {
+			ASSERT(value == value_of(key));
+		}
+
+		uint64_t next = key + 1;
+		while (next < KEYS && !present[next]) {
+			++next;
+		}
+		uint64_t found;
+		if (next < KEYS) {
+			ASSERT(cob_next_key(tree, key, &found) &&
+					found == next);
+		} else {
+			ASSERT(!cob_next_key(tree, key, NULL));
+		}
+
+		uint64_t previous = key;
+		while (previous > 0 && !present[previous - 1]) {
+			--previous;
+		}
+		if (previous > 0) {
+			ASSERT(cob_previous_key(tree, key, &found) &&
+					found == previous - 1);
+		} else {
+			ASSERT(!cob_previous_key(tree, key, NULL));
+		}
+	}
+
+	cob_cursor cursor;
+	cob_cursor_init(&cursor, tree);
+	uint64_t key = 0;
+	for (bool more = cob_cursor_seek(&cursor, 0); more;
+			more = cob_cursor_next(&cursor)) {
+		while (!present[key]) {
+			++key;
+		}
+		ASSERT(cob_cursor_key(&cursor) == key);
+		ASSERT(cob_cursor_value(&cursor) == value_of(key));
+		++key;
+	}
+	while (key < KEYS) {
+		ASSERT(!present[key++]);
+	}
+
+	key = KEYS;
+	for (bool more = cob_cursor_last(&cursor); more;
+			more = cob_cursor_prev(&cursor)) {
+		while (!present[key - 1]) {
+			--key;
+		}
+		ASSERT(cob_cursor_key(&cursor) == key - 1);
+		--key;
+	}
+	while (key > 0) {
+		ASSERT(!present[--key]);
+	}
+	cob_check_invariants(tree);
+}
+
+// Grows a COB through several migrations, then shrinks it until its pieces
+// get smaller, checking it whenever a migration is running.
+void test_cobt_migration(void) {
+	bool* present = calloc(KEYS, sizeof(bool));
+	CHECK(present != NULL, "cannot allocate reference");
+	rand_generator generator = { .state = 0 };
+	cob tree;
+	memset(&tree, 0, sizeof(tree));
+	cob_init(&tree);
+
+	uint64_t migrations = 0, checks = 0;
+	bool was_migrating = false;
+	for (uint64_t i = 0; i < 3 * KEYS; i++) {
+		const uint64_t key = rand_next(&generator, KEYS);
+		// Mostly inserts first, mostly deletes later.
+		const bool insert = (i < KEYS) ?
+				(rand_next(&generator, 4) > 0) :
+				(rand_next(&generator, 4) == 0);
+		if (insert) {
+			ASSERT(cob_insert(&tree, key, value_of(key)) ==
+					!present[key]);
+			present[key] = true;
+		} else {
+			ASSERT(cob_delete(&tree, key) == present[key]);
+			present[key] = false;
+		}
+
+		const bool migrating = tree.migration != NULL;
+		if (migrating && !was_migrating) {
+			++migrations;
+		}
+		was_migrating = migrating;
+		if (migrating && i % 256 == 0) {
+			check_equivalence(&tree, present, &generator);
+			++checks;
+		}
+	}
+	log_info("%" PRIu64 " migrations, checked %" PRIu64 " times",
+			migrations, checks);
+	CHECK(migrations >= 2 && checks > 0, "expected some migrations");
+
+	check_equivalence(&tree, present, &generator);
+	cob_destroy(&tree);
+	free(present);
+}
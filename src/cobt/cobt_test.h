@@ -0,0 +1,6 @@
+#ifndef COBT_COBT_TEST_H
+#define COBT_COBT_TEST_H
+
+void test_cobt_migration(void);
+
+#endif
@@ -26,6 +26,10 @@ void range_describe(pma file, pma_range range, char* buffer) {
 }
 */
 
+static uint64_t bitmap_words(uint64_t capacity) {
+	return (capacity + 63) / 64;
+}
+
 static void alloc_file(pma* file) {
 	assert(!file->keys && !file->values && !file->occupied);
 	file->keys = calloc(file->capacity, sizeof(uint64_t));
@@ -33,22 +37,61 @@ static void alloc_file(pma* file) {
 		log_fatal("couldn't allocate %" PRIu64 " uint64 keys for pma",
 			file->capacity);
 	}
-	file->values = calloc(file->capacity, sizeof(pma_value));
+	file->values = calloc(file->capacity, file->value_bytes);
 	if (file->values == NULL) {
-		log_fatal("couldn't allocate %" PRIu64 " values for pma",
-				file->capacity);
+		log_fatal("couldn't allocate %" PRIu64 " values of %" PRIu64 " "
+				"bytes for pma", file->capacity,
+				file->value_bytes);
 	}
-	file->occupied = calloc(file->capacity, sizeof(bool));
+	file->occupied = calloc(bitmap_words(file->capacity),
+			sizeof(uint64_t));
 	if (file->occupied == NULL) {
-		log_fatal("couldn't allocate %" PRIu64 " bools for pma",
-				file->capacity);
+		log_fatal("couldn't allocate %" PRIu64 " occupancy bits "
+				"for pma", file->capacity);
 	}
 }
 
+static void set_occupied(pma* file, uint64_t index) {
+	file->occupied[index / 64] |= 1ULL << (index % 64);
+}
+
+static void clear_occupied(pma* file, uint64_t index) {
+	file->occupied[index / 64] &= ~(1ULL << (index % 64));
+}
+
+uint64_t pma_next_occupied(const pma* file, uint64_t index) {
+	while (index < file->capacity) {
+		const uint64_t bits =
+				file->occupied[index / 64] >> (index % 64);
+		if (bits != 0) {
+			// Bits past the capacity are never set.
+			return index + CTZ64(bits);
+		}
+		index = (index / 64 + 1) * 64;
+	}
+	return file->capacity;
+}
+
+uint64_t pma_previous_occupied(const pma* file, uint64_t index) {
+	while (index > 0) {
+		const uint64_t last = index - 1;
+		const uint64_t bits = file->occupied[last / 64] <<
+				(63 - last % 64);
+		if (bits != 0) {
+			return last - CLZ64(bits);
+		}
+		index = last / 64 * 64;
+	}
+	return UINT64_MAX;
+}
+
 static void copy_item(pma* target, uint64_t target_index,
 		pma* source, uint64_t source_index) {
 	target->keys[target_index] = source->keys[source_index];
-	target->values[target_index] = source->values[source_index];
+	// Spreading may move an item onto itself.
+	memmove(pma_get_value(target, target_index),
+			pma_get_value(source, source_index),
+			target->value_bytes);
 }
 
 void pma_dump(pma file) {
@@ -59,7 +102,7 @@ void pma_dump(pma file) {
 		if (i % file.block_size == 0) {
 			z += sprintf(buffer + z, "\n    ");
 		}
-		if (file.occupied[i]) {
+		if (pma_is_occupied(&file, i)) {
 			z += sprintf(buffer + z, "%4" PRIu64 " ",
 					file.keys[i]);
 		} else {
@@ -130,11 +173,28 @@ static pma_range get_leaf(pma* file, uint64_t index) {
 	};
 }
 
-static bool pma_block_full(pma_range block) {
-	for (uint64_t i = block.begin; i < block.begin + block.size; i++) {
-		if (!block.file->occupied[i]) return false;
+// Number of occupied slots in [begin;end).
+static uint64_t count_occupied(const pma* file, uint64_t begin, uint64_t end) {
+	uint64_t count = 0;
+	while (begin < end) {
+		uint64_t bits = file->occupied[begin / 64] >> (begin % 64);
+		const uint64_t width = 64 - begin % 64;
+		if (end - begin < width) {
+			bits &= (1ULL << (end - begin)) - 1;
+		}
+		count += POPCOUNT64(bits);
+		begin += width;
 	}
-	return true;
+	return count;
+}
+
+static uint64_t pma_count_occupied(pma_range block) {
+	return count_occupied(block.file, block.begin,
+			block.begin + block.size);
+}
+
+static bool pma_block_full(pma_range block) {
+	return pma_count_occupied(block) == block.size;
 }
 
 static pma_range block_parent(pma_range block) {
@@ -153,22 +213,23 @@ static void pma_move(pma file, uint64_t to, uint64_t from, uint64_t *watch) {
 	if (watch != NULL && *watch == from) {
 		*watch = to;
 	}
-	if (file.occupied[from]) {
+	if (pma_is_occupied(&file, from)) {
 		copy_item(&file, to, &file, from);
-		file.occupied[from] = false;
-		file.occupied[to] = true;
+		clear_occupied(&file, from);
+		set_occupied(&file, to);
 	}
 }
 
 static void pma_compact_left(pma_range block, uint64_t *watch) {
 	log_verbose(2, "compact_left(%" PRIu64 "+%" PRIu64 ")",
 			block.begin, block.size);
+	// Items only move left, past slots we have already seen.
+	const uint64_t end = block.begin + block.size;
 	uint64_t to = block.begin;
-	for (uint64_t i = 0; i < block.size; i++) {
-		uint64_t from = block.begin + i;
-		if (block.file->occupied[from]) {
-			pma_move(*block.file, to++, from, watch);
-		}
+	for (uint64_t from = pma_next_occupied(block.file, block.begin);
+			from < end;
+			from = pma_next_occupied(block.file, from + 1)) {
+		pma_move(*block.file, to++, from, watch);
 	}
 	IF_LOG_VERBOSE(3) {
 		pma_dump(*block.file);
@@ -179,31 +240,19 @@ static void pma_compact_right(pma_range block, uint64_t *watch) {
 	log_verbose(2, "compact_right[%" PRIu64 "+%" PRIu64 "]",
 			block.begin, block.size);
 	uint64_t to = block.begin + block.size - 1;
-	for (uint64_t i = 0; i < block.size; i++) {
-		uint64_t from = block.begin + block.size - 1 - i;
+	for (uint64_t from = pma_previous_occupied(block.file,
+				block.begin + block.size);
+			from != UINT64_MAX && from >= block.begin;
+			from = pma_previous_occupied(block.file, from)) {
 		assert(from <= to);
-		if (block.file->occupied[from]) {
-			log_verbose(3, "i=%" PRIu64 " "
-					"to=%" PRIu64 " from=%" PRIu64,
-					i, to, from);
-			pma_move(*block.file, to--, from, watch);
-		}
+		log_verbose(3, "to=%" PRIu64 " from=%" PRIu64, to, from);
+		pma_move(*block.file, to--, from, watch);
 	}
 	IF_LOG_VERBOSE(3) {
 		pma_dump(*block.file);
 	}
 }
 
-static uint64_t pma_count_occupied(pma_range block) {
-	uint64_t occupied = 0;
-	for (uint64_t i = block.begin; i < block.begin + block.size; i++) {
-		if (block.file->occupied[i]) {
-			++occupied;
-		}
-	}
-	return occupied;
-}
-
 static void pma_spread(pma_range block, uint64_t *watch) {
 	log_verbose(2, "pma_spread");
 	pma_compact_right(block, watch);
@@ -219,17 +268,21 @@ static void pma_spread(pma_range block, uint64_t *watch) {
 	}
 }
 
-static bool pma_block_within_threshold(pma_range block) {
+static void density_bounds(pma_range block, double* min_density,
+		double* max_density) {
 	uint64_t leaf_depth = exact_log2(
 			block.file->capacity / block.file->block_size);
 	if (leaf_depth == 0) leaf_depth = 1;  // avoid 0 division
 	const uint64_t block_depth = leaf_depth - exact_log2(
 			block.size / block.file->block_size);
 
-	const double min_density = 1./2 -
-		((double) block_depth / leaf_depth) / 4;
-	const double max_density = 3./4 +
-		((double) block_depth / leaf_depth) / 4;
+	*min_density = 1./2 - ((double) block_depth / leaf_depth) / 4;
+	*max_density = 3./4 + ((double) block_depth / leaf_depth) / 4;
+}
+
+static bool pma_block_within_threshold(pma_range block) {
+	double min_density, max_density;
+	density_bounds(block, &min_density, &max_density);
 	const double density = ((double) pma_count_occupied(block)) /
 		block.size;
 	log_verbose(2, "bs=%" PRIu64 " leaf_size=%" PRIu64 " d=%lf "
@@ -239,6 +292,43 @@ static bool pma_block_within_threshold(pma_range block) {
 	return min_density <= density && density <= max_density;
 }
 
+static void* realloc_array(void* array, uint64_t count, uint64_t bytes) {
+	array = realloc(array, count * bytes);
+	if (array == NULL) {
+		log_fatal("couldn't reallocate %" PRIu64 " items "
+				"of %" PRIu64 " bytes for pma", count, bytes);
+	}
+	return array;
+}
+
+// Resizes the file in place. The arrays are reallocated, which large
+// allocations can usually do without copying, and the caller then spreads
+// the items over the whole new file.
+static void resize(pma* file, struct parameters parameters, uint64_t *watch) {
+	if (parameters.capacity < file->capacity) {
+		// Move all items below the new capacity first.
+		pma_compact_left((pma_range) {
+			.begin = 0,
+			.size = file->capacity,
+			.file = file
+		}, watch);
+	}
+	const uint64_t old_words = bitmap_words(file->capacity),
+		      new_words = bitmap_words(parameters.capacity);
+	file->keys = realloc_array(file->keys, parameters.capacity,
+			sizeof(uint64_t));
+	file->values = realloc_array(file->values, parameters.capacity,
+			file->value_bytes);
+	file->occupied = realloc_array(file->occupied, new_words,
+			sizeof(uint64_t));
+	if (new_words > old_words) {
+		memset(file->occupied + old_words, 0,
+				(new_words - old_words) * sizeof(uint64_t));
+	}
+	file->capacity = parameters.capacity;
+	file->block_size = parameters.block_size;
+}
+
 static pma_range rebalance(pma* file, pma_range start_block, uint64_t *watch) {
 	pma_range range = start_block;
 
@@ -257,21 +347,7 @@ static pma_range rebalance(pma* file, pma_range start_block, uint64_t *watch) {
 			log_verbose(1, "ignoring, parameters are "
 					"still adequate.");
 		} else {
-			pma new_file = {
-				.keys = NULL,
-				.values = NULL,
-				.occupied = NULL,
-			};
-			pma_stream stream;
-			pma_stream_start(&new_file, count, &stream);
-			for (uint64_t i = 0; i < file->capacity; i++) {
-				if (file->occupied[i]) {
-					pma_stream_push(&stream, file->keys[i],
-							file->values[i]);
-				}
-			}
-			pma_destroy(file);
-			*file = new_file;
+			resize(file, parameters, watch);
 
 			const pma_range whole_file = {
 				.begin = 0,
@@ -299,16 +375,16 @@ static void step_right(pma_range block, uint64_t step_start) {
 	log_verbose(2, "step_right");
 	// There needs to be some free space at the end.
 	for (uint64_t i = block.begin + block.size - 1; i > step_start; i--) {
-		assert(!block.file->occupied[i]);
+		assert(!pma_is_occupied(block.file, i));
 		pma_move(*block.file, i, i - 1, NULL);
 	}
 }
 
-pma_value pma_get_value(const pma* file, uint64_t index) {
-	return file->values[index];
+void* pma_get_value(const pma* file, uint64_t index) {
+	return file->values + index * file->value_bytes;
 }
 
-pma_range pma_insert_before(pma* file, uint64_t key, const pma_value value,
+pma_range pma_insert_before(pma* file, uint64_t key, const void* value,
 		uint64_t insert_before_index) {
 	// log_verbose(2, "pma_insert_before(%" PRIu64 "=%" PRIu64 ", "
 	// 		"before_index=%" PRIu64 ")", item.key, item.value,
@@ -324,7 +400,7 @@ pma_range pma_insert_before(pma* file, uint64_t key, const pma_value value,
 		// We will shift everything to the left,
 		// then shift everything after `insert_before_index`
 		// by 1 to the right and reshuffle.
-		assert(file->occupied[insert_before_index]);
+		assert(pma_is_occupied(file, insert_before_index));
 		block = get_leaf(file, insert_before_index);
 	}
 
@@ -355,25 +431,173 @@ pma_range pma_insert_before(pma* file, uint64_t key, const pma_value value,
 				insert_before_index < block.begin + block.size);
 		step_right(block, insert_before_index);
 	}
-	assert(!file->occupied[insert_before_index]);
-	file->occupied[insert_before_index] = true;
+	assert(!pma_is_occupied(file, insert_before_index));
+	set_occupied(file, insert_before_index);
+	++file->size;
 	file->keys[insert_before_index] = key;
-	file->values[insert_before_index] = value;
+	memcpy(pma_get_value(file, insert_before_index), value,
+			file->value_bytes);
 	return rebalance(file, block, NULL);
 }
 
 pma_range pma_delete(pma* file, uint64_t index) {
-	assert(file->occupied[index]);
-	file->occupied[index] = false;
+	assert(pma_is_occupied(file, index));
+	clear_occupied(file, index);
+	--file->size;
 	return rebalance(file, get_leaf(file, index), NULL);
 }
 
-void pma_init(pma* file) {
+// Whether the block stays within its upper density threshold after
+// `added` more items.
+static bool block_fits(pma_range block, uint64_t added) {
+	double min_density, max_density;
+	density_bounds(block, &min_density, &max_density);
+	return pma_count_occupied(block) + added <= max_density * block.size;
+}
+
+// Batched items inserted before an index go into the block of the index.
+// Items inserted at the end go into the last block.
+static uint64_t batch_position(const pma* file, uint64_t insert_before_index) {
+	if (insert_before_index == file->capacity) {
+		return file->capacity - 1;
+	}
+	return insert_before_index;
+}
+
+// Returns the first of the n batched items positioned at or after the slot.
+static uint64_t first_batched_from(const pma* file,
+		const uint64_t* insert_before_indexes, uint64_t n,
+		uint64_t slot) {
+	uint64_t begin = 0, end = n;
+	while (begin < end) {
+		const uint64_t middle = begin + (end - begin) / 2;
+		if (batch_position(file, insert_before_indexes[middle]) <
+				slot) {
+			begin = middle + 1;
+		} else {
+			end = middle;
+		}
+	}
+	return begin;
+}
+
+// Spreads the items of the block evenly together with the new items
+// [first;last), which go before the items at their insert_before_indexes.
+static void spread_with(pma_range block, const uint64_t* keys,
+		const char* values, const uint64_t* insert_before_indexes,
+		uint64_t first, uint64_t last, uint64_t* ranks) {
+	pma* file = block.file;
+	// ranks[i]: number of items in the block that go before new item i
+	uint64_t rank = 0, counted = block.begin;
+	for (uint64_t i = first; i < last; i++) {
+		const uint64_t before = insert_before_indexes[i];
+		rank += count_occupied(file, counted, before);
+		counted = before;
+		ranks[i] = rank;
+	}
+
+	const uint64_t existing = pma_count_occupied(block),
+		      total = existing + (last - first);
+	pma_compact_right(block, NULL);
+	// Like pma_spread, this never overwrites an item before moving it.
+	const double gap = ((double) block.size) / total;
+	uint64_t from = block.begin + block.size - existing, moved = 0;
+	for (uint64_t i = 0; i < total; i++) {
+		const uint64_t to = block.begin + floor(gap * i);
+		if (first < last && ranks[first] <= moved) {
+			assert(to < from || moved == existing);
+			set_occupied(file, to);
+			file->keys[to] = keys[first];
+			memcpy(pma_get_value(file, to),
+					values + first * file->value_bytes,
+					file->value_bytes);
+			++first;
+		} else {
+			assert(to <= from);
+			pma_move(*file, to, from++, NULL);
+			++moved;
+		}
+	}
+	PMA_COUNTERS.reorganized_size += block.size;
+}
+
+uint64_t pma_insert_batch(pma* file, const uint64_t* keys,
+		const void* values, const uint64_t* insert_before_indexes,
+		uint64_t n, pma_range* windows) {
+	for (uint64_t i = 0; i < n; i++) {
+		assert(i == 0 || insert_before_indexes[i - 1] <=
+				insert_before_indexes[i]);
+		assert(insert_before_indexes[i] == file->capacity ||
+				pma_is_occupied(file,
+					insert_before_indexes[i]));
+	}
+
+	// Plans all windows first. Every item gets the smallest window that
+	// stays under its density threshold with all new items inside it.
+	// A window replaces the earlier windows it contains, so the planned
+	// windows never overlap and each is spread once.
+	uint64_t planned = 0;
+	for (uint64_t i = 0; i < n; ) {
+		pma_range window = get_leaf(file,
+				batch_position(file, insert_before_indexes[i]));
+		uint64_t first, last;
+		while (true) {
+			first = first_batched_from(file, insert_before_indexes,
+					n, window.begin);
+			last = first_batched_from(file, insert_before_indexes,
+					n, window.begin + window.size);
+			if (block_fits(window, last - first) ||
+					is_entire_file(window)) {
+				break;
+			}
+			window = block_parent(window);
+		}
+		if (!block_fits(window, last - first)) {
+			// Growing keeps all indexes, so the items can
+			// then be merged into the entire new file.
+			log_verbose(1, "batch overfills file");
+			resize(file, adequate_parameters(file->size + n), NULL);
+			windows[0] = (pma_range) {
+				.begin = 0,
+				.size = file->capacity,
+				.file = file
+			};
+			planned = 1;
+			break;
+		}
+		while (planned > 0 && windows[planned - 1].begin >=
+				window.begin) {
+			--planned;
+		}
+		windows[planned++] = window;
+		i = last;
+	}
+
+	uint64_t* ranks = malloc(n * sizeof(uint64_t));
+	CHECK(n == 0 || ranks != NULL, "cannot allocate batch ranks");
+	for (uint64_t i = 0; i < planned; i++) {
+		const pma_range window = windows[i];
+		const uint64_t first = first_batched_from(file,
+				insert_before_indexes, n, window.begin);
+		const uint64_t last = first_batched_from(file,
+				insert_before_indexes, n,
+				window.begin + window.size);
+		spread_with(window, keys, values, insert_before_indexes,
+				first, last, ranks);
+	}
+	free(ranks);
+	file->size += n;
+	return planned;
+}
+
+void pma_init(pma* file, uint64_t value_bytes) {
 	// TODO: copy over?
 	// TODO: merge with new_ordered_file
 	assert(!file->keys && !file->values && !file->occupied);
 	file->capacity = 4;
 	file->block_size = 4;
+	file->size = 0;
+	file->value_bytes = value_bytes;
 	file->keys = NULL;
 	file->values = NULL;
 	file->occupied = NULL;
@@ -389,23 +613,220 @@ void pma_destroy(pma* file) {
 	file->occupied = NULL;
 }
 
-void pma_stream_start(pma* file, uint64_t size, pma_stream* stream) {
+uint64_t pma_memory_usage(const pma* file) {
+	return file->capacity * (sizeof(uint64_t) + file->value_bytes) +
+			bitmap_words(file->capacity) * sizeof(uint64_t);
+}
+
+void pma_stream_start(pma* file, uint64_t size, uint64_t value_bytes,
+		pma_stream* stream) {
+	pma_stream_start_with_room(file, size, size, value_bytes, stream);
+}
+
+void pma_stream_start_with_room(pma* file, uint64_t size, uint64_t room,
+		uint64_t value_bytes, pma_stream* stream) {
 	struct parameters parameters = adequate_parameters(size);
+	if (parameters.capacity < room) {
+		parameters = adequate_parameters(room);
+	}
 	file->block_size = parameters.block_size;
 	file->capacity = parameters.capacity;
+	file->size = 0;
+	file->value_bytes = value_bytes;
 	alloc_file(file);
-	// TODO: This will be soon followed by an expensive
-	// rebalancing. Perhaps we should build it rebalanced
-	// in the first place.
-	stream->allowed_capacity = size;
+	// Items are spread evenly as they are pushed, so the file
+	// needs no rebalancing after the stream ends.
+	stream->allowed_capacity = room;
+	stream->gap = (room > 0) ? ((double) file->capacity) / room : 0;
 	stream->file = file;
 	stream->scratch = 0;
+	stream->frontier = 0;
 }
 
-void pma_stream_push(pma_stream* stream, uint64_t key, const pma_value value) {
+static void stream_place(pma_stream* stream, uint64_t index, uint64_t key,
+		const void* value) {
+	pma* file = stream->file;
+	assert(index < file->capacity && !pma_is_occupied(file, index));
+	set_occupied(file, index);
+	++file->size;
+	file->keys[index] = key;
+	memcpy(pma_get_value(file, index), value, file->value_bytes);
+	if (index >= stream->frontier) {
+		stream->frontier = index + 1;
+	}
+}
+
+uint64_t pma_stream_push(pma_stream* stream, uint64_t key,
+		const void* value) {
 	assert(stream->scratch < stream->allowed_capacity);
-	stream->file->occupied[stream->scratch] = true;
-	stream->file->keys[stream->scratch] = key;
-	stream->file->values[stream->scratch] = value;
+	uint64_t index = floor(stream->gap * stream->scratch);
+	if (index < stream->frontier) {
+		index = stream->frontier;
+	}
+	stream_place(stream, index, key, value);
 	++stream->scratch;
+	return index;
+}
+
+// The next push goes to this slot, so inserts and deletes only move items
+// below it.
+static uint64_t stream_limit(const pma_stream* stream) {
+	uint64_t limit = floor(stream->gap * stream->scratch);
+	if (limit < stream->frontier) {
+		limit = stream->frontier;
+	}
+	return (limit < stream->file->capacity) ?
+			limit : stream->file->capacity;
+}
+
+// The part of the block below the limit.
+static pma_range clip_block(pma_range block, uint64_t limit) {
+	if (block.begin + block.size > limit) {
+		block.size = limit - block.begin;
+	}
+	return block;
+}
+
+// Whether the part of the block below the limit stays within its upper
+// density threshold after `added` more items.
+static bool stream_block_fits(pma_range block, uint64_t limit,
+		uint64_t added) {
+	double min_density, max_density;
+	density_bounds(block, &min_density, &max_density);
+	const pma_range part = clip_block(block, limit);
+	return pma_count_occupied(part) + added <= max_density * part.size;
+}
+
+// Whether the part of the block below the limit stays above its lower
+// density threshold.
+static bool stream_block_dense_enough(pma_range block, uint64_t limit) {
+	double min_density, max_density;
+	density_bounds(block, &min_density, &max_density);
+	const pma_range part = clip_block(block, limit);
+	return pma_count_occupied(part) >= min_density * part.size;
+}
+
+// Spreads a window below the limit.
+static void stream_spread(pma_stream* stream, pma_range window,
+		uint64_t *watch) {
+	pma_spread(window, watch);
+	PMA_COUNTERS.reorganized_size += window.size;
+	const uint64_t last = pma_previous_occupied(stream->file,
+			window.begin + window.size);
+	if (last != UINT64_MAX && last >= stream->frontier) {
+		stream->frontier = last + 1;
+	}
+}
+
+// Spreads the items twice as far apart as pushes, so that as many items
+// again fit between them, and leaves room for the pushes still to come.
+// Grows the file if it is too small for that.
+static void stream_respace(pma_stream* stream, uint64_t *watch) {
+	pma* file = stream->file;
+	const uint64_t room = stream->allowed_capacity - stream->scratch +
+			2 * file->size;
+	const struct parameters parameters = adequate_parameters(room);
+	log_verbose(1, "pma stream out of room, respacing for %" PRIu64
+			" items", room);
+	if (parameters.capacity > file->capacity) {
+		resize(file, parameters, watch);
+	}
+	const pma_range whole_file = {
+		.begin = 0,
+		.size = file->capacity,
+		.file = file
+	};
+	pma_compact_right(whole_file, watch);
+	// Like pma_spread, this never overwrites an item before moving it.
+	stream->gap = ((double) file->capacity) / room;
+	for (uint64_t i = 0; i < file->size; i++) {
+		pma_move(*file, floor(stream->gap * 2 * i),
+				file->capacity - file->size + i, watch);
+	}
+	PMA_COUNTERS.reorganized_size += file->capacity;
+	stream->allowed_capacity = room;
+	stream->scratch = 2 * file->size;
+	stream->frontier = (file->size > 0) ? (uint64_t) floor(
+			stream->gap * 2 * (file->size - 1)) + 1 : 0;
+}
+
+// Inserts after stream_respace, which moved every item.
+static pma_range respaced_insert(pma_stream* stream, uint64_t key,
+		const void* value, uint64_t insert_before_index) {
+	pma_stream_insert_before(stream, key, value, insert_before_index);
+	return (pma_range) {
+		.begin = 0,
+		.size = stream->file->capacity,
+		.file = stream->file
+	};
+}
+
+pma_range pma_stream_insert_before(pma_stream* stream, uint64_t key,
+		const void* value, uint64_t insert_before_index) {
+	pma* file = stream->file;
+	if (insert_before_index == file->capacity) {
+		if (stream->frontier == file->capacity) {
+			stream_respace(stream, NULL);
+			return respaced_insert(stream, key, value,
+					file->capacity);
+		}
+		const uint64_t index = stream->frontier;
+		stream_place(stream, index, key, value);
+		return (pma_range) { .begin = index, .size = 1, .file = file };
+	}
+	assert(pma_is_occupied(file, insert_before_index));
+	if (insert_before_index > 0 &&
+			!pma_is_occupied(file, insert_before_index - 1)) {
+		const uint64_t index = insert_before_index - 1;
+		stream_place(stream, index, key, value);
+		return (pma_range) { .begin = index, .size = 1, .file = file };
+	}
+
+	// Like pma_insert_before, but only within the items below the limit.
+	const uint64_t limit = stream_limit(stream);
+	pma_range block = get_leaf(file, insert_before_index);
+	while (!stream_block_fits(block, limit, 1) && !is_entire_file(block)) {
+		block = block_parent(block);
+	}
+	if (!stream_block_fits(block, limit, 1)) {
+		stream_respace(stream, &insert_before_index);
+		return respaced_insert(stream, key, value,
+				insert_before_index);
+	}
+	const pma_range window = clip_block(block, limit);
+	pma_compact_left(window, &insert_before_index);
+	step_right(window, insert_before_index);
+	stream_place(stream, insert_before_index, key, value);
+	stream_spread(stream, window, NULL);
+	return window;
+}
+
+pma_range pma_stream_delete(pma_stream* stream, uint64_t index) {
+	pma* file = stream->file;
+	assert(pma_is_occupied(file, index));
+	clear_occupied(file, index);
+	--file->size;
+
+	// Like pma_delete, but only within the items below the limit.
+	// Windows too sparse up to the entire file are left for
+	// pma_stream_end.
+	const uint64_t limit = stream_limit(stream);
+	pma_range block = get_leaf(file, index);
+	while (!stream_block_dense_enough(block, limit) &&
+			!is_entire_file(block)) {
+		block = block_parent(block);
+	}
+	if (!stream_block_dense_enough(block, limit)) {
+		return (pma_range) { .begin = index, .size = 1, .file = file };
+	}
+	const pma_range window = clip_block(block, limit);
+	stream_spread(stream, window, NULL);
+	return window;
+}
+
+pma_range pma_stream_end(pma_stream* stream) {
+	pma* file = stream->file;
+	const uint64_t tail = (stream->frontier < file->capacity) ?
+			stream->frontier : (file->capacity - 1);
+	return rebalance(file, get_leaf(file, tail), NULL);
 }
@@ -8,20 +8,21 @@ struct {
 	uint64_t reorganized_size;
 } PMA_COUNTERS;
 
-// Stores an ordered list with uint64_t keys and void* values (typedefed
-// as pma_value).
+// Stores an ordered list with uint64_t keys and fixed-size values.
+// Values are stored inline in one array of value_bytes-sized slots,
+// so neighbouring items are also neighbours in memory.
 // The density of the entire structure is within [0.5;0.75].
 
-typedef void* pma_value;
-
 typedef struct {
-	// TODO: store as bitmap
-	bool* occupied;
+	// Bit (i % 64) of word (i / 64) says whether slot i is occupied.
+	uint64_t* occupied;
 	uint64_t* keys;
-	pma_value* values;
+	char* values;
 
 	uint64_t capacity;
+	uint64_t size;  // Number of occupied slots
 	uint64_t block_size;
+	uint64_t value_bytes;
 } pma;
 
 typedef struct {
@@ -32,21 +33,65 @@ typedef struct {
 } pma_range;
 
 void pma_dump(pma file);
-pma_range pma_insert_before(pma* file, uint64_t key, pma_value value,
+// Copies value_bytes from `value` into the slot of the new item.
+pma_range pma_insert_before(pma* file, uint64_t key, const void* value,
 		uint64_t insert_before_index);
 pma_range pma_delete(pma* file, uint64_t index);
-void pma_init(pma* file);
+// Inserts n items at once. The items must be sorted, and so must their
+// insert_before_indexes (which mean the same as in pma_insert_before).
+// Their values are stored back to back in `values`. Each block that needs
+// rebalancing is spread once, and the blocks are stored in `windows`,
+// which needs room for n ranges. Returns the number of blocks.
+// If the file had to grow, the only block is the entire file.
+uint64_t pma_insert_batch(pma* file, const uint64_t* keys,
+		const void* values, const uint64_t* insert_before_indexes,
+		uint64_t n, pma_range* windows);
+void pma_init(pma* file, uint64_t value_bytes);
 void pma_destroy(pma* file);
 
-pma_value pma_get_value(const pma* file, uint64_t index);
+// The value slot of an index. Invalidated by any change to the file.
+void* pma_get_value(const pma* file, uint64_t index);
+
+static inline bool pma_is_occupied(const pma* file, uint64_t index) {
+	return (file->occupied[index / 64] >> (index % 64)) & 1;
+}
+
+// Returns the first occupied index >= index, or capacity if there is none.
+uint64_t pma_next_occupied(const pma* file, uint64_t index);
+// Returns the last occupied index < index, or UINT64_MAX if there is none.
+uint64_t pma_previous_occupied(const pma* file, uint64_t index);
+// Bytes allocated for the keys, values and occupancy flags.
+uint64_t pma_memory_usage(const pma* file);
 
 typedef struct {
 	pma* file;
 	uint64_t scratch;
 	uint64_t allowed_capacity;
+	double gap;
+	uint64_t frontier;  // Slots from here on are unoccupied.
 } pma_stream;
 
-void pma_stream_start(pma* file, uint64_t size, pma_stream *stream);
-void pma_stream_push(pma_stream* stream, uint64_t key, pma_value value);
+// Builds a new PMA from at most `size` items pushed in sorted order.
+// Items are spread evenly across the file.
+void pma_stream_start(pma* file, uint64_t size, uint64_t value_bytes,
+		pma_stream *stream);
+// Like pma_stream_start, but sizes the file for `size` items while spacing
+// them for `room` >= size items. The slack lets the stream take items
+// out of order through pma_stream_insert_before.
+void pma_stream_start_with_room(pma* file, uint64_t size, uint64_t room,
+		uint64_t value_bytes, pma_stream* stream);
+// Returns the index of the pushed item.
+uint64_t pma_stream_push(pma_stream* stream, uint64_t key, const void* value);
+// Inserts and deletes items while the file is still being streamed into.
+// Windows are rebalanced like in pma_insert_before and pma_delete, but
+// only up to the slot of the next push, so items pushed later still go
+// after all existing items. If the streamed items get too dense, they are
+// respaced over the entire file, which grows if needed.
+pma_range pma_stream_insert_before(pma_stream* stream, uint64_t key,
+		const void* value, uint64_t insert_before_index);
+pma_range pma_stream_delete(pma_stream* stream, uint64_t index);
+// Ends the stream. The tail left empty by the room the stream did not use
+// is rebalanced like after pma_delete, which may resize the file.
+pma_range pma_stream_end(pma_stream* stream);
 
 #endif
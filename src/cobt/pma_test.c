@@ -14,24 +14,107 @@
 void test_cobt_pma(void) {
 	pma file;
 	memset(&file, 0, sizeof(file));
-	pma_init(&file);
+	pma_init(&file, sizeof(uint64_t));
 
 	// Fills file with (1000 => 0), (999 => 500), (998 => 1000), ...
 	for (uint64_t i = 0; i < 1000; i++) {
-		void* mock_value = (void*) (i * 500);
-		pma_insert_before(&file, (1000 - i), mock_value, file.capacity);
+		const uint64_t mock_value = i * 500;
+		pma_insert_before(&file, (1000 - i), &mock_value,
+				file.capacity);
 	}
 	uint64_t seen = 0;
 	for (uint64_t i = 0; i < file.capacity; i++) {
-		if (file.occupied[i]) {
+		if (pma_is_occupied(&file, i)) {
 			CHECK(file.keys[i] == (1000 - seen),
 					"expected key %" PRIu64 ", found "
 					"%" PRIu64 ".", seen, file.keys[i]);
-			assert(file.values[i] == (void*) (seen * 500));
+			assert(*(uint64_t*) pma_get_value(&file, i) ==
+					seen * 500);
 			++seen;
 		}
 	}
 	assert(seen == 1000);
 
+	// Bitmap scans agree with slot-by-slot checks.
+	uint64_t previous = UINT64_MAX;
+	for (uint64_t i = 0; i <= file.capacity; i++) {
+		uint64_t next = i;
+		while (next < file.capacity && !pma_is_occupied(&file, next)) {
+			++next;
+		}
+		ASSERT(pma_next_occupied(&file, i) == next);
+		ASSERT(pma_previous_occupied(&file, i) == previous);
+		if (i < file.capacity && pma_is_occupied(&file, i)) {
+			previous = i;
+		}
+	}
+
+	pma_destroy(&file);
+
+	// Batches go into an empty file, then between its items.
+	memset(&file, 0, sizeof(file));
+	pma_init(&file, sizeof(uint64_t));
+	uint64_t keys[1000], before[1000];
+	pma_range windows[1000];
+	for (uint64_t i = 0; i < 1000; i++) {
+		keys[i] = i * 10 + 10;
+		before[i] = file.capacity;
+	}
+	ASSERT(pma_insert_batch(&file, keys, keys, before, 1000,
+				windows) == 1);
+	uint64_t batched = 0;
+	for (uint64_t i = pma_next_occupied(&file, 0); i < file.capacity;
+			i = pma_next_occupied(&file, i + 1)) {
+		if (file.keys[i] % 200 == 10) {
+			before[batched] = i;
+			keys[batched] = file.keys[i] - 5;
+			++batched;
+		}
+	}
+	const uint64_t spread = pma_insert_batch(&file, keys, keys, before,
+			batched, windows);
+	ASSERT(spread > 0 && spread <= batched);
+	ASSERT(file.size == 1000 + batched);
+	seen = 0;
+	previous = 0;
+	for (uint64_t i = pma_next_occupied(&file, 0); i < file.capacity;
+			i = pma_next_occupied(&file, i + 1)) {
+		ASSERT(seen == 0 || file.keys[i] > previous);
+		ASSERT(*(uint64_t*) pma_get_value(&file, i) == file.keys[i]);
+		previous = file.keys[i];
+		++seen;
+	}
+	ASSERT(seen == file.size);
+	pma_destroy(&file);
+
+	// Streams take more inserts at one spot than they have room for.
+	memset(&file, 0, sizeof(file));
+	pma_stream stream;
+	pma_stream_start(&file, 100, sizeof(uint64_t), &stream);
+	uint64_t inserted = 999;
+	for (uint64_t i = 1; i <= 100; i++) {
+		const uint64_t pushed = i * 1000;
+		pma_stream_push(&stream, pushed, &pushed);
+		for (uint64_t j = 0; j < 3; j++, inserted--) {
+			pma_stream_insert_before(&stream, inserted, &inserted,
+					pma_next_occupied(&file, 0));
+		}
+	}
+	ASSERT(file.size == 400);
+	for (uint64_t i = 0; i < 100; i++) {
+		pma_stream_delete(&stream, pma_next_occupied(&file, i));
+	}
+	pma_stream_end(&stream);
+	ASSERT(file.size == 300);
+	seen = 0;
+	previous = 0;
+	for (uint64_t i = pma_next_occupied(&file, 0); i < file.capacity;
+			i = pma_next_occupied(&file, i + 1)) {
+		ASSERT(seen == 0 || file.keys[i] > previous);
+		ASSERT(*(uint64_t*) pma_get_value(&file, i) == file.keys[i]);
+		previous = file.keys[i];
+		++seen;
+	}
+	ASSERT(seen == file.size && previous == 100 * 1000);
 	pma_destroy(&file);
 }
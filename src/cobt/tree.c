@@ -2,36 +2,448 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #define NO_LOG_INFO
 #include "log/log.h"
 #include "math/math.h"
 
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 static const uint64_t INFINITY = UINT64_MAX;
 
+// Trees at least this high are built by several threads.
+#define PARALLEL_BUILD_HEIGHT 20
+#define MAX_BUILD_THREADS 64
+
+// Batched lookups descend with a group of keys one level at a time,
+// prefetching the candidate children of every key before comparing.
+#define FIND_BATCH_GROUP 16
+
 static uint8_t height(const cobt_tree* this) {
 	return ceil_log2(this->backing_array_size) + 1;
 }
 
-static uint64_t tree_node_count(const cobt_tree* this) {
-	return (1 << height(this)) - 1;
-}
-
 static cobt_tree_range entire_tree(cobt_tree* this) {
 	return (cobt_tree_range) {
 		.begin = 0,
-		.end = 1 << (height(this) - 1)
+		.end = 1ULL << (height(this) - 1)
 	};
 }
 
-void cobt_tree_init(cobt_tree* this, const uint64_t* backing_array,
-		const bool* backing_array_occupied,
+static bool is_occupied(const cobt_tree* this, uint64_t index) {
+	return (this->backing_array_occupied[index / 64] >> (index % 64)) & 1;
+}
+
+static uint64_t leaf_key(const cobt_tree* this, uint64_t index) {
+	if (index < this->backing_array_size && is_occupied(this, index)) {
+		return this->backing_array[index];
+	}
+	return INFINITY;
+}
+
+// The lowest nodes of a subtree being built are either leaves, which take
+// the keys of the backing array starting at first_leaf, or nodes whose
+// children are every stride-th value of `children`.
+typedef struct {
+	const uint64_t* children;
+	uint64_t stride;
+	uint64_t first_leaf;
+} build_source;
+
+static void build_recursive(cobt_tree* this, uint64_t* nodes,
+		uint64_t height, build_source source);
+
+// Bottom subtrees [begin;end) of a tree with its top of height top_height.
+static void build_bottoms(cobt_tree* this, uint64_t* nodes,
+		uint64_t top_height, uint64_t bottom_height,
+		build_source source, uint64_t begin, uint64_t end) {
+	const uint64_t top_nodes = (1ULL << top_height) - 1,
+		      bottom_nodes = (1ULL << bottom_height) - 1,
+		      bottom_width = 1ULL << (bottom_height - 1);
+	for (uint64_t i = begin; i < end; i++) {
+		build_source bottom = source;
+		if (source.children == NULL) {
+			bottom.first_leaf += i * bottom_width;
+		} else {
+			bottom.children += 2 * i * bottom_width * source.stride;
+		}
+		build_recursive(this, nodes + top_nodes + i * bottom_nodes,
+				bottom_height, bottom);
+	}
+}
+
+static uint64_t min(uint64_t a, uint64_t b) {
+	return (a < b) ? a : b;
+}
+
+// Value of the i-th lowest node of a subtree being built.
+static uint64_t lowest_node(const cobt_tree* this, build_source source,
+		uint64_t i) {
+	if (source.children == NULL) {
+		return leaf_key(this, source.first_leaf + i);
+	}
+	return min(source.children[2 * i * source.stride],
+			source.children[(2 * i + 1) * source.stride]);
+}
+
+static void build_recursive(cobt_tree* this, uint64_t* nodes,
+		uint64_t height, build_source source) {
+	if (height == 1) {
+		nodes[0] = lowest_node(this, source, 0);
+		return;
+	}
+	if (height == 2) {
+		// Saves a third of the calls.
+		nodes[1] = lowest_node(this, source, 0);
+		nodes[2] = lowest_node(this, source, 1);
+		nodes[0] = min(nodes[1], nodes[2]);
+		return;
+	}
+	uint64_t bottom_height, top_height;
+	veb_split_height(height, &bottom_height, &top_height);
+	build_bottoms(this, nodes, top_height, bottom_height, source,
+			0, 1ULL << top_height);
+	// The lowest nodes of the top take the roots of the bottoms.
+	build_recursive(this, nodes, top_height, (build_source) {
+		.children = nodes + (1ULL << top_height) - 1,
+		.stride = (1ULL << bottom_height) - 1
+	});
+}
+
+typedef struct {
+	cobt_tree* tree;
+	uint64_t top_height, bottom_height;
+	uint64_t begin, end;
+} build_job;
+
+static void* run_build_job(void* _job) {
+	build_job* job = _job;
+	build_bottoms(job->tree, job->tree->tree, job->top_height,
+			job->bottom_height, (build_source) { .first_leaf = 0 },
+			job->begin, job->end);
+	return NULL;
+}
+
+// Builds the whole tree bottom-up. Big trees split their bottom subtrees
+// between threads.
+static void build(cobt_tree* this, uint64_t threads) {
+	const build_source leaves = { .children = NULL, .first_leaf = 0 };
+	if (height(this) < PARALLEL_BUILD_HEIGHT || threads <= 1) {
+		build_recursive(this, this->tree, height(this), leaves);
+		return;
+	}
+	uint64_t bottom_height, top_height;
+	veb_split_height(height(this), &bottom_height, &top_height);
+	const uint64_t bottoms = 1ULL << top_height;
+	if (threads > bottoms) {
+		threads = bottoms;
+	}
+
+	build_job jobs[threads];
+	pthread_t handles[threads];
+	for (uint64_t i = 0; i < threads; i++) {
+		jobs[i] = (build_job) {
+			.tree = this,
+			.top_height = top_height,
+			.bottom_height = bottom_height,
+			.begin = bottoms * i / threads,
+			.end = bottoms * (i + 1) / threads
+		};
+	}
+	// The first job runs on this thread.
+	for (uint64_t i = 1; i < threads; i++) {
+		CHECK(pthread_create(&handles[i], NULL, run_build_job,
+					&jobs[i]) == 0,
+				"cannot start tree building thread");
+	}
+	run_build_job(&jobs[0]);
+	for (uint64_t i = 1; i < threads; i++) {
+		CHECK(pthread_join(handles[i], NULL) == 0,
+				"cannot join tree building thread");
+	}
+	build_recursive(this, this->tree, top_height, (build_source) {
+		.children = this->tree + bottoms - 1,
+		.stride = (1ULL << bottom_height) - 1
+	});
+}
+
+// The blocked layout is an implicit tree of 64-byte blocks. Key i of a
+// block is the minimum of its child i (a leaf at the lowest depth), so
+// one vector comparison picks the child to descend to. All blocks have
+// BLOCK_KEYS children, except the root, which has as many as are needed
+// to cover the leaves. Blocks are in van Emde Boas order by depth.
+#define BLOCK_BITS 3
+#define BLOCK_KEYS (1 << BLOCK_BITS)
+#define MAX_BLOCK_DEPTH (64 / BLOCK_BITS + 1)
+
+typedef struct cobt_tree_block_level {
+	// Blocks at this depth have 2^fanout_bits children. They are found
+	// by the first prefix_bits bits of the indexes of their leaves.
+	uint8_t fanout_bits;
+	uint8_t prefix_bits;
+
+	// Blocks at this depth are roots of bottom trees below a top tree
+	// rooted at top_depth, which spans top_size blocks. Bottom trees take
+	// bottom_size blocks each and they are indexed by the lowest top_bits
+	// bits of the prefix.
+	uint8_t top_depth;
+	uint8_t top_bits;
+	uint64_t top_size;
+	uint64_t bottom_size;
+} block_level;
+
+static uint8_t block_depth(const cobt_tree* this) {
+	return (height(this) - 1 + BLOCK_BITS - 1) / BLOCK_BITS;
+}
+
+// Number of blocks in levels [depth;depth+count) below one block.
+static uint64_t blocks_in_levels(const block_level* levels, uint8_t depth,
+		uint8_t count) {
+	uint64_t blocks = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		blocks += 1ULL << (levels[depth + i].prefix_bits -
+				levels[depth].prefix_bits);
+	}
+	return blocks;
+}
+
+static void prepare_block_levels(block_level* levels, uint8_t depth,
+		uint8_t count) {
+	if (count <= 1) {
+		return;
+	}
+	uint64_t bottom, top;
+	veb_split_height(count, &bottom, &top);
+	block_level* split = &levels[depth + top];
+	split->top_depth = depth;
+	split->top_bits = split->prefix_bits - levels[depth].prefix_bits;
+	split->top_size = blocks_in_levels(levels, depth, top);
+	split->bottom_size = blocks_in_levels(levels, depth + top, bottom);
+	prepare_block_levels(levels, depth, top);
+	prepare_block_levels(levels, depth + top, bottom);
+}
+
+static uint64_t block_count(const cobt_tree* this) {
+	return blocks_in_levels(this->block_levels, 0, block_depth(this));
+}
+
+static uint64_t block_offset(const block_level* level, uint64_t top_position,
+		uint64_t prefix) {
+	return top_position + level->top_size +
+			(prefix & ((1ULL << level->top_bits) - 1)) *
+			level->bottom_size;
+}
+
+static uint64_t block_position(const cobt_tree* this, uint8_t depth,
+		uint64_t prefix) {
+	if (depth == 0) {
+		return 0;
+	}
+	const block_level* level = &this->block_levels[depth];
+	return block_offset(level, block_position(this, level->top_depth,
+				prefix >> level->top_bits), prefix);
+}
+
+static uint64_t* block_at(const cobt_tree* this, uint64_t position) {
+	return this->tree + position * BLOCK_KEYS;
+}
+
+// Returns the index of the last key of the block that is at most the key,
+// or 0 if there is none. Blocks are not sorted: empty children are
+// INFINITY, but the last child with its minimum at most the key is the
+// one a binary tree would descend to.
+static inline uint8_t block_last_le(const uint64_t* block, uint64_t key) {
+#if defined(__AVX512F__)
+	const unsigned le = _mm512_cmple_epu64_mask(_mm512_load_si512(block),
+			_mm512_set1_epi64(key));
+#elif defined(__AVX2__)
+	// AVX2 only compares signed 64-bit integers, so flip the sign bits.
+	const __m256i sign = _mm256_set1_epi64x(
+			(long long) 0x8000000000000000ULL);
+	const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x(key), sign);
+	const __m256i low = _mm256_xor_si256(
+			_mm256_load_si256((const __m256i*) block), sign);
+	const __m256i high = _mm256_xor_si256(
+			_mm256_load_si256((const __m256i*) (block + 4)), sign);
+	const unsigned greater_low = _mm256_movemask_pd(_mm256_castsi256_pd(
+			_mm256_cmpgt_epi64(low, needle)));
+	const unsigned greater_high = _mm256_movemask_pd(_mm256_castsi256_pd(
+			_mm256_cmpgt_epi64(high, needle)));
+	const unsigned greater = greater_low | (greater_high << 4);
+	const unsigned le = ~greater & 0xFF;
+#else
+	unsigned le = 0;
+	for (uint8_t i = 0; i < BLOCK_KEYS; i++) {
+		le |= (block[i] <= key) << i;
+	}
+#endif
+	return le ? (31 - __builtin_clz(le)) : 0;
+}
+
+static uint64_t block_min(const uint64_t* block) {
+	uint64_t minimum = block[0];
+	for (uint8_t i = 1; i < BLOCK_KEYS; i++) {
+		minimum = min(minimum, block[i]);
+	}
+	return minimum;
+}
+
+static void blocked_init(cobt_tree* this) {
+	const uint8_t depth = block_depth(this);
+	this->block_levels = calloc(depth + 1, sizeof(block_level));
+	CHECK(this->block_levels, "cannot allocate block levels");
+	uint8_t prefix_bits = 0;
+	for (uint8_t i = 0; i < depth; i++) {
+		// The root takes the bits left over by the other blocks.
+		this->block_levels[i] = (block_level) {
+			.fanout_bits = (i == 0) ?
+				(height(this) - 1 - BLOCK_BITS * (depth - 1)) :
+				BLOCK_BITS,
+			.prefix_bits = prefix_bits
+		};
+		prefix_bits += this->block_levels[i].fanout_bits;
+	}
+	prepare_block_levels(this->block_levels, 0, depth);
+
+	// A tree with one leaf has no blocks, but still allocates one.
+	const uint64_t blocks = (depth > 0) ? block_count(this) : 1;
+	CHECK(posix_memalign((void**) &this->tree,
+				BLOCK_KEYS * sizeof(uint64_t),
+				blocks * BLOCK_KEYS * sizeof(uint64_t)) == 0,
+			"cannot allocate tree blocks");
+	for (uint64_t i = 0; i < blocks * BLOCK_KEYS; i++) {
+		this->tree[i] = INFINITY;
+	}
+}
+
+static uint64_t blocked_find_le(cobt_tree* this, uint64_t key) {
+	uint64_t positions[MAX_BLOCK_DEPTH];
+	uint64_t prefix = 0;
+	const uint8_t depth = block_depth(this);
+	for (uint8_t i = 0; i < depth; i++) {
+		const block_level* level = &this->block_levels[i];
+		positions[i] = (i == 0) ? 0 : block_offset(level,
+				positions[level->top_depth], prefix);
+		const uint8_t child = block_last_le(
+				block_at(this, positions[i]), key);
+		const uint8_t last = (1 << level->fanout_bits) - 1;
+		prefix = (prefix << level->fanout_bits) |
+				((child < last) ? child : last);
+	}
+	return prefix;
+}
+
+static void blocked_find_le_batch(cobt_tree* this, const uint64_t* keys,
+		uint64_t n, uint64_t* indexes) {
+	uint64_t positions[FIND_BATCH_GROUP][MAX_BLOCK_DEPTH];
+	const uint8_t depth = block_depth(this);
+	for (uint64_t begin = 0; begin < n; begin += FIND_BATCH_GROUP) {
+		const uint64_t group = (n - begin < FIND_BATCH_GROUP) ?
+				(n - begin) : FIND_BATCH_GROUP;
+		uint64_t* prefixes = indexes + begin;
+		for (uint64_t i = 0; i < group; i++) {
+			prefixes[i] = 0;
+		}
+		for (uint8_t d = 0; d < depth; d++) {
+			const block_level* level = &this->block_levels[d];
+			for (uint64_t i = 0; i < group; i++) {
+				positions[i][d] = (d == 0) ? 0 : block_offset(
+						level,
+						positions[i][level->top_depth],
+						prefixes[i]);
+				__builtin_prefetch(block_at(this,
+							positions[i][d]));
+			}
+			const uint8_t last = (1 << level->fanout_bits) - 1;
+			for (uint64_t i = 0; i < group; i++) {
+				const uint8_t child = block_last_le(
+						block_at(this, positions[i][d]),
+						keys[begin + i]);
+				prefixes[i] = (prefixes[i] <<
+						level->fanout_bits) |
+						((child < last) ? child : last);
+			}
+		}
+	}
+}
+
+// Recomputes the keys of one block from its children.
+static void refresh_block(cobt_tree* this, uint8_t depth, uint64_t prefix) {
+	const block_level* level = &this->block_levels[depth];
+	uint64_t* block = block_at(this, block_position(this, depth, prefix));
+	const uint8_t fanout = 1 << level->fanout_bits;
+	const uint64_t first_child = prefix << level->fanout_bits;
+	if (depth + 1 == block_depth(this)) {
+		for (uint8_t i = 0; i < fanout; i++) {
+			block[i] = leaf_key(this, first_child + i);
+		}
+	} else {
+		// Siblings are roots of neighbouring bottom trees.
+		const uint64_t* child = block_at(this,
+				block_position(this, depth + 1, first_child));
+		const uint64_t stride =
+			this->block_levels[depth + 1].bottom_size * BLOCK_KEYS;
+		for (uint8_t i = 0; i < fanout; i++) {
+			block[i] = block_min(child + i * stride);
+		}
+	}
+	for (uint8_t i = fanout; i < BLOCK_KEYS; i++) {
+		block[i] = INFINITY;
+	}
+}
+
+// Refreshes the blocks above the ranges, the lowest blocks first.
+static void blocked_refresh_ranges(cobt_tree* this,
+		const cobt_tree_range* ranges, uint64_t n) {
+	for (uint8_t depth = block_depth(this); depth-- > 0;) {
+		const uint8_t shift = height(this) - 1 -
+				this->block_levels[depth].prefix_bits;
+		// Blocks above several ranges are refreshed once.
+		uint64_t next = 0;
+		for (uint64_t i = 0; i < n; i++) {
+			const uint64_t last = (ranges[i].end - 1) >> shift;
+			uint64_t prefix = ranges[i].begin >> shift;
+			if (prefix < next) {
+				prefix = next;
+			}
+			for (; prefix <= last; prefix++) {
+				refresh_block(this, depth, prefix);
+			}
+			if (last + 1 > next) {
+				next = last + 1;
+			}
+		}
+	}
+}
+
+static uint64_t tree_node_count(const cobt_tree* this) {
+	if (this->layout == COBT_TREE_BLOCKED) {
+		return block_count(this) * BLOCK_KEYS;
+	}
+	return (1ULL << height(this)) - 1;
+}
+
+void cobt_tree_init_unrefreshed(cobt_tree* this, cobt_tree_layout layout,
+		const uint64_t* backing_array,
+		const uint64_t* backing_array_occupied,
 		uint64_t backing_array_size) {
 	this->backing_array = backing_array;
 	this->backing_array_occupied = backing_array_occupied;
 	this->backing_array_size = backing_array_size;
+	this->layout = layout;
+
+	if (layout == COBT_TREE_BLOCKED) {
+		blocked_init(this);
+		this->level_data = NULL;
+		return;
+	}
+	this->block_levels = NULL;
 
 	this->tree = calloc(tree_node_count(this), sizeof(uint64_t));
 	assert(this->tree);
@@ -40,7 +452,43 @@ void cobt_tree_init(cobt_tree* this, const uint64_t* backing_array,
 	assert(this->level_data);
 
 	veb_prepare(height(this), this->level_data);
-	cobt_tree_refresh(this, entire_tree(this));
+}
+
+void cobt_tree_init(cobt_tree* this, cobt_tree_layout layout,
+		const uint64_t* backing_array,
+		const uint64_t* backing_array_occupied,
+		uint64_t backing_array_size) {
+	cobt_tree_init_unrefreshed(this, layout, backing_array,
+			backing_array_occupied, backing_array_size);
+	cobt_tree_rebuild(this, 1);
+}
+
+static uint64_t online_cpus;
+static pthread_once_t online_cpus_once = PTHREAD_ONCE_INIT;
+
+static void count_online_cpus(void) {
+	online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+uint64_t cobt_tree_online_cpus(void) {
+	pthread_once(&online_cpus_once, count_online_cpus);
+	return online_cpus;
+}
+
+void cobt_tree_rebuild(cobt_tree* this, uint64_t threads) {
+	if (this->layout == COBT_TREE_BLOCKED) {
+		const cobt_tree_range all = entire_tree(this);
+		blocked_refresh_ranges(this, &all, 1);
+		return;
+	}
+	if (threads > MAX_BUILD_THREADS) {
+		threads = MAX_BUILD_THREADS;
+	}
+	build(this, threads);
+}
+
+uint64_t cobt_tree_leaf_count(const cobt_tree* this) {
+	return 1ULL << (height(this) - 1);
 }
 
 void cobt_tree_destroy(cobt_tree* this) {
@@ -49,9 +497,24 @@ void cobt_tree_destroy(cobt_tree* this) {
 
 	free(this->level_data);
 	this->level_data = NULL;
+
+	free(this->block_levels);
+	this->block_levels = NULL;
+}
+
+uint64_t cobt_tree_memory_usage(const cobt_tree* this) {
+	if (this->layout == COBT_TREE_BLOCKED) {
+		return tree_node_count(this) * sizeof(uint64_t) +
+				(block_depth(this) + 1) * sizeof(block_level);
+	}
+	return tree_node_count(this) * sizeof(uint64_t) +
+			height(this) * sizeof(veb_level_data);
 }
 
 uint64_t cobt_tree_find_le(cobt_tree* this, uint64_t key) {
+	if (this->layout == COBT_TREE_BLOCKED) {
+		return blocked_find_le(this, key);
+	}
 	struct drilldown_track track;
 	drilldown_begin(&track);
 
@@ -72,6 +535,45 @@ uint64_t cobt_tree_find_le(cobt_tree* this, uint64_t key) {
 	return leaf_index;
 }
 
+void cobt_tree_find_le_batch(cobt_tree* this, const uint64_t* keys,
+		uint64_t n, uint64_t* indexes) {
+	if (this->layout == COBT_TREE_BLOCKED) {
+		blocked_find_le_batch(this, keys, n, indexes);
+		return;
+	}
+	struct drilldown_track tracks[FIND_BATCH_GROUP];
+	const uint8_t max = height(this) - 1;
+	for (uint64_t begin = 0; begin < n; begin += FIND_BATCH_GROUP) {
+		const uint64_t group = (n - begin < FIND_BATCH_GROUP) ?
+				(n - begin) : FIND_BATCH_GROUP;
+		for (uint64_t i = 0; i < group; i++) {
+			drilldown_begin(&tracks[i]);
+			indexes[begin + i] = 0;
+		}
+		for (uint8_t depth = 0; depth < max; depth++) {
+			for (uint64_t i = 0; i < group; i++) {
+				struct drilldown_track* track = &tracks[i];
+				drilldown_go_right(this->level_data, track);
+				const uint64_t right = track->pos[track->depth];
+				__builtin_prefetch(&this->tree[right]);
+				__builtin_prefetch(&this->tree[right -
+						this->level_data[track->depth].bottom_size]);
+			}
+			for (uint64_t i = 0; i < group; i++) {
+				struct drilldown_track* track = &tracks[i];
+				uint64_t* leaf_index = &indexes[begin + i];
+				if (keys[begin + i] >= this->tree[track->pos[track->depth]]) {
+					*leaf_index = (*leaf_index << 1) + 1;
+				} else {
+					drilldown_go_left_sibling(this->level_data,
+							track);
+					*leaf_index = *leaf_index << 1;
+				}
+			}
+		}
+	}
+}
+
 static uint64_t size(cobt_tree_range range) {
 	return range.end - range.begin;
 }
@@ -94,50 +596,56 @@ static cobt_tree_range right_half(cobt_tree_range range) {
 	};
 }
 
-static bool disjoint(cobt_tree_range a, cobt_tree_range b) {
-	return (a.begin >= b.end) || (b.begin >= a.end);
-}
-
-static bool intersect(cobt_tree_range a, cobt_tree_range b) {
-	return !disjoint(a, b);
-}
-
-static void refresh_recursive(cobt_tree* this, cobt_tree_range refresh,
-		cobt_tree_range current, struct drilldown_track* track) {
+// Refreshes the nodes of the current subtree that cover any of the n
+// sorted, disjoint ranges. All the ranges intersect the current subtree.
+static void refresh_recursive(cobt_tree* this, const cobt_tree_range* ranges,
+		uint64_t n, cobt_tree_range current,
+		struct drilldown_track* track) {
 	const uint64_t current_nid = track->pos[track->depth];
-	log_info("refresh=[%" PRIu64 ",%" PRIu64 ") "
+	log_info("refresh=[%" PRIu64 ",%" PRIu64 ")x%" PRIu64 " "
 			"current=[%" PRIu64 ",%" PRIu64 ") nid=%" PRIu64,
-			refresh.begin, refresh.end,
+			ranges[0].begin, ranges[n - 1].end, n,
 			current.begin, current.end,
 			current_nid);
 	const uint64_t old = this->tree[current_nid];
 
 	if (size(current) == 1) {
 		if (current.begin < this->backing_array_size &&
-				this->backing_array_occupied[current.begin]) {
+				is_occupied(this, current.begin)) {
 			this->tree[current_nid] = this->backing_array[current.begin];
 		} else {
 			this->tree[current_nid] = INFINITY;
 		}
 	} else {
+		// Ranges [0;left) begin in the left half, ranges [right;n)
+		// end in the right half. At most one range is in both.
+		const uint64_t middle = midpoint(current);
+		uint64_t left = 0;
+		while (left < n && ranges[left].begin < middle) {
+			++left;
+		}
+		const uint64_t right = (left > 0 &&
+				ranges[left - 1].end > middle) ?
+				(left - 1) : left;
+
 		drilldown_go_left(this->level_data, track);
-		if (intersect(refresh, left_half(current))) {
-			refresh_recursive(this, refresh,
+		if (left > 0) {
+			refresh_recursive(this, ranges, left,
 					left_half(current), track);
 		}
-		const uint64_t left = this->tree[track->pos[track->depth]];
+		const uint64_t left_min = this->tree[track->pos[track->depth]];
 		drilldown_go_up(track);
 		drilldown_go_right(this->level_data, track);
-		if (intersect(refresh, right_half(current))) {
-			refresh_recursive(this, refresh,
+		if (right < n) {
+			refresh_recursive(this, ranges + right, n - right,
 					right_half(current), track);
 		}
-		const uint64_t right = this->tree[track->pos[track->depth]];
+		const uint64_t right_min = this->tree[track->pos[track->depth]];
 		drilldown_go_up(track);
-		if (left < right) {
-			this->tree[current_nid] = left;
+		if (left_min < right_min) {
+			this->tree[current_nid] = left_min;
 		} else {
-			this->tree[current_nid] = right;
+			this->tree[current_nid] = right_min;
 		}
 	}
 	if (this->tree[current_nid] == INFINITY) {
@@ -158,9 +666,20 @@ static void refresh_recursive(cobt_tree* this, cobt_tree_range refresh,
 }
 
 void cobt_tree_refresh(cobt_tree* this, cobt_tree_range refresh) {
-	struct drilldown_track track;
-	drilldown_begin(&track);
-	refresh_recursive(this, refresh, entire_tree(this), &track);
+	if (refresh.begin < refresh.end) {
+		cobt_tree_refresh_ranges(this, &refresh, 1);
+	}
+}
+
+void cobt_tree_refresh_ranges(cobt_tree* this, const cobt_tree_range* ranges,
+		uint64_t n) {
+	if (this->layout == COBT_TREE_BLOCKED) {
+		blocked_refresh_ranges(this, ranges, n);
+	} else if (n > 0) {
+		struct drilldown_track track;
+		drilldown_begin(&track);
+		refresh_recursive(this, ranges, n, entire_tree(this), &track);
+	}
 }
 
 void cobt_tree_dump(const cobt_tree* this) {
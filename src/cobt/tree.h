@@ -5,16 +5,31 @@
 
 #include "veb_layout/veb_layout.h"
 
+typedef enum {
+	// Binary tree with one key per node.
+	COBT_TREE_BINARY,
+	// Tree of 64-byte blocks, each holding the minima of its 8 children.
+	// A block is searched with one vector comparison and the tree is
+	// 3 times lower.
+	COBT_TREE_BLOCKED
+} cobt_tree_layout;
+
+struct cobt_tree_block_level;
+
 typedef struct {
 	const uint64_t *backing_array;
-	const bool *backing_array_occupied;
+	// Bitmap, bit (i % 64) of word (i / 64) for backing_array[i].
+	const uint64_t *backing_array_occupied;
 	uint64_t backing_array_size;
 
-	// The actual tree. Its size is hyperceil(size).
+	// The actual tree. Its size is hyperceil(size) for binary trees.
 	uint64_t *tree;
 
+	cobt_tree_layout layout;
+
 	// Helper data for van Emde Boas layout navigation.
 	veb_level_data* level_data;
+	struct cobt_tree_block_level* block_levels;
 } cobt_tree;
 
 typedef struct {
@@ -23,16 +38,43 @@ typedef struct {
 	uint64_t end;
 } cobt_tree_range;
 
-void cobt_tree_init(cobt_tree*, const uint64_t* backing_array,
-		const bool* backing_array_occupied,
+void cobt_tree_init(cobt_tree*, cobt_tree_layout,
+		const uint64_t* backing_array,
+		const uint64_t* backing_array_occupied,
 		uint64_t backing_array_size);
+// Like cobt_tree_init, but leaves the tree unrefreshed, so that building
+// it can be spread over many calls. The tree is valid once refreshes in
+// increasing order have covered all cobt_tree_leaf_count leaves.
+void cobt_tree_init_unrefreshed(cobt_tree*, cobt_tree_layout,
+		const uint64_t* backing_array,
+		const uint64_t* backing_array_occupied,
+		uint64_t backing_array_size);
+uint64_t cobt_tree_leaf_count(const cobt_tree*);
+// Recomputes the entire tree bottom-up in linear time, writing every node
+// once. Big trees split their independent bottom subtrees between up to
+// `threads` threads. cobt_tree_init uses one thread, bulk operations
+// can opt into cobt_tree_online_cpus(). Blocked trees are refreshed block
+// by block on one thread.
+void cobt_tree_rebuild(cobt_tree*, uint64_t threads);
+// Number of online CPUs, queried once.
+uint64_t cobt_tree_online_cpus(void);
 void cobt_tree_destroy(cobt_tree*);
+// Bytes allocated for the tree and its van Emde Boas navigation data.
+uint64_t cobt_tree_memory_usage(const cobt_tree*);
 
 // Finds the largest index I such that backing_array[I] <= key.
 uint64_t cobt_tree_find_le(cobt_tree*, uint64_t key);
 
+// Like cobt_tree_find_le for n keys at once, overlapping their cache misses.
+void cobt_tree_find_le_batch(cobt_tree*, const uint64_t* keys, uint64_t n,
+		uint64_t* indexes);
+
 // Informs the tree about changes in a range
 void cobt_tree_refresh(cobt_tree*, cobt_tree_range refresh);
+// Like cobt_tree_refresh for n nonempty ranges, which must be sorted and
+// disjoint. Nodes above several ranges are only refreshed once.
+void cobt_tree_refresh_ranges(cobt_tree*, const cobt_tree_range* ranges,
+		uint64_t n);
 
 void cobt_tree_dump(const cobt_tree*);
 
@@ -1,16 +1,120 @@
 #include "cobt/tree_test.h"
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "cobt/tree.h"
+#include "log/log.h"
+#include "rand/rand.h"
 
-void test_cobt_tree(void) {
-	bool occupied[] = { true, true, true, true, true };
+#define FIND_CHECKS 256
+#define REFRESH_CHECKS 4
+
+// Fills a new array with sorted keys, about 2/3 of them occupied.
+static void make_array(uint64_t size, rand_generator* generator,
+		uint64_t** array, uint64_t** occupied) {
+	*array = malloc(size * sizeof(uint64_t));
+	*occupied = calloc((size + 63) / 64, sizeof(uint64_t));
+	CHECK(*array != NULL && *occupied != NULL, "cannot allocate array");
+	uint64_t key = 0;
+	for (uint64_t i = 0; i < size; i++) {
+		key += rand_next(generator, 10);
+		(*array)[i] = key;
+		if (rand_next(generator, 3) > 0) {
+			(*occupied)[i / 64] |= 1ULL << (i % 64);
+		}
+	}
+}
+
+// Checks that rebuilding a tree gives the same nodes as refreshing it.
+static void check_rebuild(uint64_t size, uint64_t threads,
+		rand_generator* generator) {
+	uint64_t *array, *occupied;
+	make_array(size, generator, &array, &occupied);
+
+	cobt_tree refreshed, rebuilt;
+	cobt_tree_init_unrefreshed(&refreshed, COBT_TREE_BINARY,
+			array, occupied, size);
+	cobt_tree_refresh(&refreshed, (cobt_tree_range) {
+		.begin = 0,
+		.end = cobt_tree_leaf_count(&refreshed)
+	});
+	cobt_tree_init_unrefreshed(&rebuilt, COBT_TREE_BINARY,
+			array, occupied, size);
+	cobt_tree_rebuild(&rebuilt, threads);
+	const uint64_t nodes = 2 * cobt_tree_leaf_count(&rebuilt) - 1;
+	CHECK(memcmp(refreshed.tree, rebuilt.tree,
+				nodes * sizeof(uint64_t)) == 0,
+			"rebuilt tree of %" PRIu64 " differs from refresh",
+			size);
+
+	cobt_tree_destroy(&refreshed);
+	cobt_tree_destroy(&rebuilt);
+	free(array);
+	free(occupied);
+}
+
+static void check_same_finds(cobt_tree* binary, cobt_tree* blocked,
+		uint64_t max_key, rand_generator* generator) {
+	uint64_t keys[FIND_CHECKS], indexes[FIND_CHECKS];
+	for (uint64_t i = 0; i < FIND_CHECKS; i++) {
+		keys[i] = (i == 0) ? UINT64_MAX : rand_next(generator, max_key);
+	}
+	cobt_tree_find_le_batch(blocked, keys, FIND_CHECKS, indexes);
+	for (uint64_t i = 0; i < FIND_CHECKS; i++) {
+		const uint64_t expected = cobt_tree_find_le(binary, keys[i]);
+		CHECK(cobt_tree_find_le(blocked, keys[i]) == expected &&
+				indexes[i] == expected,
+				"blocked tree of %" PRIu64 " finds %" PRIu64
+				" elsewhere", binary->backing_array_size,
+				keys[i]);
+	}
+}
+
+// Checks that the blocked layout finds the same indexes as the binary one,
+// also after some slots are emptied or filled and refreshed.
+static void check_blocked(uint64_t size, rand_generator* generator) {
+	uint64_t *array, *occupied;
+	make_array(size, generator, &array, &occupied);
+	const uint64_t max_key = array[size - 1] + 10;
+
+	cobt_tree binary, blocked;
+	cobt_tree_init(&binary, COBT_TREE_BINARY, array, occupied, size);
+	cobt_tree_init(&blocked, COBT_TREE_BLOCKED, array, occupied, size);
+	check_same_finds(&binary, &blocked, max_key, generator);
+
+	cobt_tree_range ranges[REFRESH_CHECKS];
+	uint64_t begin = 0;
+	for (uint64_t i = 0; i < REFRESH_CHECKS; i++) {
+		begin += rand_next(generator, size / REFRESH_CHECKS + 1);
+		const uint64_t end = (begin < size) ? (begin + 1) : 0;
+		if (end == 0) {
+			break;
+		}
+		occupied[begin / 64] ^= 1ULL << (begin % 64);
+		ranges[i] = (cobt_tree_range) { .begin = begin, .end = end };
+		cobt_tree_refresh(&binary, ranges[i]);
+		begin = end;
+		cobt_tree_refresh_ranges(&blocked, ranges, i + 1);
+		check_same_finds(&binary, &blocked, max_key, generator);
+	}
+	ASSERT(cobt_tree_memory_usage(&blocked) > 0);
+
+	cobt_tree_destroy(&binary);
+	cobt_tree_destroy(&blocked);
+	free(array);
+	free(occupied);
+}
+
+static void check_small(cobt_tree_layout layout) {
+	const uint64_t occupied[] = { 0x1F };
 	uint64_t array[] = { 10, 99999, 20, 99999, 30 };
 	const uint64_t size = sizeof(array) / sizeof(*array);
 
 	cobt_tree tree;
-	cobt_tree_init(&tree, array, occupied, size);
+	cobt_tree_init(&tree, layout, array, occupied, size);
 	assert(cobt_tree_find_le(&tree, 0) == 0);
 	assert(cobt_tree_find_le(&tree, 10) == 0);
 	assert(cobt_tree_find_le(&tree, 15) == 0);
@@ -35,5 +139,36 @@ void test_cobt_tree(void) {
 	assert(cobt_tree_find_le(&tree, 30) == 4);
 	assert(cobt_tree_find_le(&tree, 35) == 4);
 
+	// 10, 16, 25, 27, 40
+	array[1] = 16; array[3] = 27; array[4] = 40;
+	const cobt_tree_range ranges[] = {
+		{ .begin = 1, .end = 2 },
+		{ .begin = 3, .end = 5 }
+	};
+	cobt_tree_refresh_ranges(&tree, ranges, 2);
+	assert(cobt_tree_find_le(&tree, 15) == 0);
+	assert(cobt_tree_find_le(&tree, 16) == 1);
+	assert(cobt_tree_find_le(&tree, 26) == 2);
+	assert(cobt_tree_find_le(&tree, 27) == 3);
+	assert(cobt_tree_find_le(&tree, 39) == 3);
+	assert(cobt_tree_find_le(&tree, 40) == 4);
+
 	cobt_tree_destroy(&tree);
 }
+
+void test_cobt_tree(void) {
+	check_small(COBT_TREE_BINARY);
+	check_small(COBT_TREE_BLOCKED);
+
+	rand_generator generator = { .state = 0 };
+	for (uint64_t size = 1; size <= 300; size++) {
+		check_rebuild(size, 1, &generator);
+	}
+	check_rebuild(1000000, 1, &generator);
+	check_rebuild(1000000, 4, &generator);
+	for (uint64_t size = 1; size <= 600; size++) {
+		check_blocked(size, &generator);
+	}
+	check_blocked(100000, &generator);
+	check_blocked(1000000, &generator);
+}
@@ -0,0 +1,390 @@
+#include "csbtree/csbtree.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btree/search.h"
+#include "log/log.h"
+
+#define GROUP_ALIGNMENT 64
+
+// Groups of n nodes have room for the next power of two nodes, so that
+// splits only move the nodes after the split one, until the group fills.
+static uint64_t group_capacity(uint64_t nodes) {
+	uint64_t capacity = 1;
+	while (capacity < nodes) {
+		capacity *= 2;
+	}
+	return capacity;
+}
+
+static csbtree_node* alloc_group(uint64_t nodes) {
+	csbtree_node* group;
+	CHECK(posix_memalign((void**) &group, GROUP_ALIGNMENT,
+				sizeof(csbtree_node) *
+				group_capacity(nodes)) == 0,
+			"cannot allocate CSB+-tree group of %" PRIu64 " nodes",
+			nodes);
+	return group;
+}
+
+// Moves the first `nodes` nodes of a group to a new group with room
+// for `new_nodes` nodes.
+static csbtree_node* regroup(csbtree_node* group, uint64_t nodes,
+		uint64_t new_nodes) {
+	csbtree_node* new_group = alloc_group(new_nodes);
+	memcpy(new_group, group, sizeof(csbtree_node) * nodes);
+	free(group);
+	return new_group;
+}
+
+static bool is_full(const csbtree_node* node, uint8_t level) {
+	return node->key_count == ((level == 0) ?
+			CSBTREE_LEAF_MAX_KEYS : CSBTREE_INTERNAL_MAX_KEYS);
+}
+
+// Index of the child of an internal node where key belongs.
+static uint16_t child_index(const csbtree_node* node, uint64_t key) {
+	return search_count_le(node->internal.keys, node->key_count, key);
+}
+
+void csbtree_init(csbtree* this) {
+	this->root = alloc_group(1);
+	this->root->key_count = 0;
+	this->levels_above_leaves = 0;
+}
+
+static void destroy_recursive(csbtree_node* node, uint8_t level) {
+	if (level > 0) {
+		for (uint16_t i = 0; i <= node->key_count; i++) {
+			destroy_recursive(&node->internal.children[i], level - 1);
+		}
+		free(node->internal.children);
+	}
+}
+
+void csbtree_destroy(csbtree* this) {
+	destroy_recursive(this->root, this->levels_above_leaves);
+	free(this->root);
+	this->root = NULL;
+}
+
+static const csbtree_node* find_leaf(const csbtree* this, uint64_t key) {
+	const csbtree_node* node = this->root;
+	for (uint8_t level = this->levels_above_leaves; level > 0; level--) {
+		node = &node->internal.children[child_index(node, key)];
+	}
+	return node;
+}
+
+bool csbtree_find(csbtree* this, uint64_t key, uint64_t *value) {
+	const csbtree_node* leaf = find_leaf(this, key);
+	const uint16_t i = search_find(leaf->leaf.keys, leaf->key_count, key);
+	if (i == leaf->key_count) {
+		return false;
+	}
+	if (value) {
+		*value = leaf->leaf.values[i];
+	}
+	return true;
+}
+
+// Splits a full node into two new nodes. The children of an internal node
+// are moved into two new groups and its old group is freed.
+static void split_node(const csbtree_node* node, uint8_t level,
+		csbtree_node* left, csbtree_node* right, uint64_t *middle_key) {
+	if (level == 0) {
+		const uint16_t to_left = node->key_count / 2;
+		const uint16_t to_right = node->key_count - to_left;
+		left->key_count = to_left;
+		memcpy(left->leaf.keys, node->leaf.keys,
+				sizeof(uint64_t) * to_left);
+		memcpy(left->leaf.values, node->leaf.values,
+				sizeof(uint64_t) * to_left);
+		right->key_count = to_right;
+		memcpy(right->leaf.keys, node->leaf.keys + to_left,
+				sizeof(uint64_t) * to_right);
+		memcpy(right->leaf.values, node->leaf.values + to_left,
+				sizeof(uint64_t) * to_right);
+		*middle_key = right->leaf.keys[0];
+	} else {
+		const uint16_t to_left = node->key_count / 2;
+		const uint16_t to_right = node->key_count - to_left - 1;
+		*middle_key = node->internal.keys[to_left];
+
+		left->key_count = to_left;
+		memcpy(left->internal.keys, node->internal.keys,
+				sizeof(uint64_t) * to_left);
+		left->internal.children = alloc_group(to_left + 1);
+		memcpy(left->internal.children, node->internal.children,
+				sizeof(csbtree_node) * (to_left + 1));
+
+		right->key_count = to_right;
+		memcpy(right->internal.keys, node->internal.keys + to_left + 1,
+				sizeof(uint64_t) * to_right);
+		right->internal.children = alloc_group(to_right + 1);
+		memcpy(right->internal.children,
+				node->internal.children + to_left + 1,
+				sizeof(csbtree_node) * (to_right + 1));
+
+		free(node->internal.children);
+	}
+}
+
+// Splits the full child i of a non-full internal node. The parent's group
+// is only replaced if it has no room for the new child.
+static void split_child(csbtree_node* parent, uint16_t i, uint8_t child_level) {
+	const uint16_t children = parent->key_count + 1;
+	csbtree_node* group = parent->internal.children;
+	if (group_capacity(children) == children) {
+		group = regroup(group, children, children + 1);
+		parent->internal.children = group;
+	}
+
+	const csbtree_node child = group[i];
+	memmove(group + i + 2, group + i + 1,
+			sizeof(csbtree_node) * (children - i - 1));
+	uint64_t middle_key;
+	split_node(&child, child_level, &group[i], &group[i + 1], &middle_key);
+
+	memmove(parent->internal.keys + i + 1, parent->internal.keys + i,
+			sizeof(uint64_t) * (parent->key_count - i));
+	parent->internal.keys[i] = middle_key;
+	++parent->key_count;
+}
+
+static void split_root(csbtree* this) {
+	csbtree_node* group = alloc_group(2);
+	uint64_t middle_key;
+	split_node(this->root, this->levels_above_leaves, &group[0], &group[1],
+			&middle_key);
+	this->root->key_count = 1;
+	this->root->internal.keys[0] = middle_key;
+	this->root->internal.children = group;
+	++this->levels_above_leaves;
+}
+
+static bool insert_into_leaf(csbtree_node* leaf, uint64_t key,
+		uint64_t value) {
+	const uint16_t i = search_count_lt(leaf->leaf.keys, leaf->key_count,
+			key);
+	if (i < leaf->key_count && leaf->leaf.keys[i] == key) {
+		return false;
+	}
+	memmove(leaf->leaf.keys + i + 1, leaf->leaf.keys + i,
+			sizeof(uint64_t) * (leaf->key_count - i));
+	memmove(leaf->leaf.values + i + 1, leaf->leaf.values + i,
+			sizeof(uint64_t) * (leaf->key_count - i));
+	leaf->leaf.keys[i] = key;
+	leaf->leaf.values[i] = value;
+	++leaf->key_count;
+	return true;
+}
+
+// Full nodes are split on the way down, so there is always room
+// for the new child of a split node.
+bool csbtree_insert(csbtree* this, uint64_t key, uint64_t value) {
+	if (is_full(this->root, this->levels_above_leaves)) {
+		split_root(this);
+	}
+	csbtree_node* node = this->root;
+	for (uint8_t level = this->levels_above_leaves; level > 0; level--) {
+		uint16_t i = child_index(node, key);
+		if (is_full(&node->internal.children[i], level - 1)) {
+			split_child(node, i, level - 1);
+			if (key >= node->internal.keys[i]) {
+				++i;
+			}
+		}
+		node = &node->internal.children[i];
+	}
+	return insert_into_leaf(node, key, value);
+}
+
+// Removes the empty child i of an internal node with more than one child.
+// Child i's range goes to its left neighbour (or to the right one if i is
+// the leftmost child).
+static void remove_child(csbtree_node* parent, uint16_t i,
+		uint8_t child_level) {
+	const uint16_t children = parent->key_count + 1;
+	csbtree_node* group = parent->internal.children;
+	destroy_recursive(&group[i], child_level);
+	memmove(group + i, group + i + 1,
+			sizeof(csbtree_node) * (children - i - 1));
+	if (group_capacity(children - 1) < group_capacity(children)) {
+		parent->internal.children = regroup(group, children - 1,
+				children - 1);
+	}
+
+	const uint16_t removed = (i > 0) ? i - 1 : 0;
+	memmove(parent->internal.keys + removed,
+			parent->internal.keys + removed + 1,
+			sizeof(uint64_t) * (parent->key_count - removed - 1));
+	--parent->key_count;
+}
+
+// Returns whether the key was deleted. Sets *emptied if the node no longer
+// holds any key. Empty children are removed right away, so only leaves and
+// nodes with one child can become empty.
+static bool delete_recursive(csbtree_node* node, uint8_t level,
+		uint64_t key, bool *emptied) {
+	if (level == 0) {
+		const uint16_t i = search_find(node->leaf.keys, node->key_count,
+				key);
+		if (i == node->key_count) {
+			return false;
+		}
+		memmove(node->leaf.keys + i, node->leaf.keys + i + 1,
+				sizeof(uint64_t) * (node->key_count - i - 1));
+		memmove(node->leaf.values + i, node->leaf.values + i + 1,
+				sizeof(uint64_t) * (node->key_count - i - 1));
+		--node->key_count;
+		*emptied = (node->key_count == 0);
+		return true;
+	}
+
+	const uint16_t i = child_index(node, key);
+	bool child_emptied = false;
+	if (!delete_recursive(&node->internal.children[i], level - 1, key,
+				&child_emptied)) {
+		return false;
+	}
+	if (child_emptied) {
+		if (node->key_count == 0) {
+			*emptied = true;
+		} else {
+			remove_child(node, i, level - 1);
+		}
+	}
+	return true;
+}
+
+// Empty nodes are removed and a root with one child is replaced by the
+// child, so no leaf except the root is empty.
+bool csbtree_delete(csbtree* this, uint64_t key) {
+	bool emptied = false;
+	if (!delete_recursive(this->root, this->levels_above_leaves, key,
+				&emptied)) {
+		return false;
+	}
+	if (emptied) {
+		destroy_recursive(this->root, this->levels_above_leaves);
+		this->root->key_count = 0;
+		this->levels_above_leaves = 0;
+	}
+	while (this->levels_above_leaves > 0 && this->root->key_count == 0) {
+		csbtree_node* group = this->root->internal.children;
+		*this->root = group[0];
+		free(group);
+		--this->levels_above_leaves;
+	}
+	return true;
+}
+
+// No leaf below the root is empty, so if the subtree of the key holds no
+// larger key, the first leaf of the next subtree does. The search visits
+// at most two nodes per level.
+static bool find_next_recursive(const csbtree_node* node, uint8_t level,
+		uint64_t key, uint64_t *next_key) {
+	if (level == 0) {
+		const uint16_t i = search_count_le(node->leaf.keys,
+				node->key_count, key);
+		if (i == node->key_count) {
+			return false;
+		}
+		*next_key = node->leaf.keys[i];
+		return true;
+	}
+	for (uint16_t i = child_index(node, key); i <= node->key_count; i++) {
+		if (find_next_recursive(&node->internal.children[i], level - 1,
+					key, next_key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool find_prev_recursive(const csbtree_node* node, uint8_t level,
+		uint64_t key, uint64_t *prev_key) {
+	if (level == 0) {
+		const uint16_t i = search_count_lt(node->leaf.keys,
+				node->key_count, key);
+		if (i == 0) {
+			return false;
+		}
+		*prev_key = node->leaf.keys[i - 1];
+		return true;
+	}
+	for (uint16_t i = child_index(node, key) + 1; i > 0; i--) {
+		if (find_prev_recursive(&node->internal.children[i - 1],
+					level - 1, key, prev_key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool csbtree_find_next(csbtree* this, uint64_t key, uint64_t *next_key) {
+	return find_next_recursive(this->root, this->levels_above_leaves, key,
+			next_key);
+}
+
+bool csbtree_find_prev(csbtree* this, uint64_t key, uint64_t *prev_key) {
+	return find_prev_recursive(this->root, this->levels_above_leaves, key,
+			prev_key);
+}
+
+static uint64_t count_group_nodes(const csbtree_node* node, uint8_t level) {
+	if (level == 0) {
+		return 0;
+	}
+	uint64_t count = group_capacity(node->key_count + 1);
+	for (uint16_t i = 0; i <= node->key_count; i++) {
+		count += count_group_nodes(&node->internal.children[i],
+				level - 1);
+	}
+	return count;
+}
+
+uint64_t csbtree_memory_usage(const csbtree* this) {
+	// sizeof(csbtree_node) is a multiple of GROUP_ALIGNMENT,
+	// so groups have no padding.
+	return (1 + count_group_nodes(this->root, this->levels_above_leaves)) *
+			sizeof(csbtree_node);
+}
+
+// Checks that keys in the subtree are sorted and within [min;max],
+// and that the subtree is not empty.
+static void check_recursive(const csbtree_node* node, uint8_t level,
+		uint64_t min, uint64_t max) {
+	CHECK(level > 0 || node->key_count > 0, "empty leaf below the root");
+	const uint64_t* keys = (level == 0) ?
+			node->leaf.keys : node->internal.keys;
+	for (uint16_t i = 0; i < node->key_count; i++) {
+		CHECK(keys[i] >= min && keys[i] <= max,
+				"key %" PRIu64 " out of [%" PRIu64 ";%" PRIu64 "]",
+				keys[i], min, max);
+		CHECK(i == 0 || keys[i - 1] < keys[i],
+				"keys %" PRIu64 " and %" PRIu64 " not sorted",
+				keys[i - 1], keys[i]);
+	}
+	if (level == 0) {
+		return;
+	}
+	for (uint16_t i = 0; i <= node->key_count; i++) {
+		check_recursive(&node->internal.children[i], level - 1,
+				(i == 0) ? min : keys[i - 1],
+				(i == node->key_count) ? max : keys[i] - 1);
+	}
+}
+
+void csbtree_check(const csbtree* this) {
+	// An empty tree is one empty leaf.
+	if (this->levels_above_leaves == 0 && this->root->key_count == 0) {
+		return;
+	}
+	CHECK(this->levels_above_leaves == 0 || this->root->key_count > 0,
+			"root has only one child");
+	check_recursive(this->root, this->levels_above_leaves, 0, UINT64_MAX);
+}
@@ -0,0 +1,66 @@
+#ifndef CSBTREE_CSBTREE_H
+#define CSBTREE_CSBTREE_H
+
+// Cache-sensitive B+-tree (Rao & Ross, "Making B+-trees cache conscious
+// in main memory", 2000).
+//
+// All children of an internal node are stored next to each other in one
+// "node group", so the node keeps one pointer to the group instead of one
+// pointer per child. That leaves room for about twice as many keys as in
+// an internal node of btree/btree.h of the same size.
+//
+// Groups have room for the next power of two nodes. When a node splits,
+// the nodes after it move within its parent's group. Only a full group is
+// copied to a new group twice as large, so a group of k nodes is copied
+// O(log k) times as it grows.
+//
+// Deletion is lazy, like in the original CSB+-tree: nodes are never merged
+// and may stay almost empty. But empty nodes are removed, and a root with
+// one child is replaced by the child, so next and prev take O(log n).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CSBTREE_NODE_BYTES 256
+
+enum {
+	CSBTREE_LEAF_MAX_KEYS = (CSBTREE_NODE_BYTES - sizeof(uint64_t)) /
+			(sizeof(uint64_t) * 2),
+	CSBTREE_INTERNAL_MAX_KEYS = (CSBTREE_NODE_BYTES - sizeof(uint64_t) -
+			sizeof(void*)) / sizeof(uint64_t)
+};
+
+typedef struct csbtree_node {
+	uint16_t key_count;
+	union {
+		struct {
+			uint64_t keys[CSBTREE_INTERNAL_MAX_KEYS];
+			// key_count + 1 children
+			struct csbtree_node* children;
+		} internal;
+
+		struct {
+			uint64_t keys[CSBTREE_LEAF_MAX_KEYS];
+			uint64_t values[CSBTREE_LEAF_MAX_KEYS];
+		} leaf;
+	};
+} csbtree_node;
+
+typedef struct {
+	uint8_t levels_above_leaves;  // 0 == root is a leaf
+	csbtree_node* root;
+} csbtree;
+
+void csbtree_init(csbtree*);
+void csbtree_destroy(csbtree*);
+bool csbtree_find(csbtree*, uint64_t key, uint64_t *value);
+bool csbtree_insert(csbtree*, uint64_t key, uint64_t value);
+bool csbtree_delete(csbtree*, uint64_t key);
+bool csbtree_find_next(csbtree*, uint64_t key, uint64_t *next_key);
+bool csbtree_find_prev(csbtree*, uint64_t key, uint64_t *prev_key);
+
+// Bytes allocated for node groups. Does not count the csbtree struct itself.
+uint64_t csbtree_memory_usage(const csbtree*);
+void csbtree_check(const csbtree*);
+
+#endif
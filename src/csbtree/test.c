@@ -0,0 +1,105 @@
+#include "csbtree/test.h"
+
+#include "btree/btree.h"
+#include "csbtree/csbtree.h"
+#include "log/log.h"
+#include "rand/rand.h"
+
+// Splits move nodes within groups and copy full groups, so pointers into
+// groups must be taken again after each split. Ascending and random inserts
+// split at both ends and in the middle of groups.
+static void test_group_splits(void) {
+	for (uint8_t ascending = 0; ascending < 2; ascending++) {
+		csbtree tree;
+		csbtree_init(&tree);
+		rand_generator generator = { .state = 0 };
+		for (uint64_t i = 0; i < 50000; i++) {
+			const uint64_t key = ascending ? i :
+					rand_next(&generator, 1000000);
+			csbtree_insert(&tree, key, key * 3);
+			if (i % 5000 == 0) {
+				csbtree_check(&tree);
+			}
+		}
+		csbtree_check(&tree);
+
+		generator = (rand_generator) { .state = 0 };
+		for (uint64_t i = 0; i < 50000; i++) {
+			const uint64_t key = ascending ? i :
+					rand_next(&generator, 1000000);
+			uint64_t value;
+			ASSERT(csbtree_find(&tree, key, &value) &&
+					value == key * 3);
+		}
+		csbtree_destroy(&tree);
+	}
+}
+
+// The CSB+-tree should need at most as many levels as a B-tree
+// with nodes of the same size.
+static void test_fanout(void) {
+	ASSERT(CSBTREE_INTERNAL_MAX_KEYS >= 2 * BTREE_INTERNAL_MAX_KEYS - 1);
+
+	csbtree csb;
+	btree bt;
+	csbtree_init(&csb);
+	btree_init(&bt);
+	rand_generator generator = { .state = 1 };
+	for (uint64_t i = 0; i < 100000; i++) {
+		const uint64_t key = rand_next64(&generator) >> 1;
+		csbtree_insert(&csb, key, key);
+		btree_insert(&bt, key, key);
+	}
+	ASSERT(csb.levels_above_leaves <= bt.levels_above_leaves);
+	csbtree_destroy(&csb);
+	btree_destroy(&bt);
+}
+
+// Deleting a range of keys removes its leaves, so next and prev jump over
+// the range. Deleting all keys shrinks the tree back to one leaf.
+static void test_deletes(void) {
+	csbtree tree;
+	csbtree_init(&tree);
+	const uint64_t N = 50000;
+	for (uint64_t i = 0; i < N; i++) {
+		csbtree_insert(&tree, i, i);
+	}
+	for (uint64_t i = 1000; i < N - 1000; i++) {
+		ASSERT(csbtree_delete(&tree, i));
+		if (i % 5000 == 0) {
+			csbtree_check(&tree);
+		}
+	}
+	ASSERT(!csbtree_delete(&tree, 1000));
+	csbtree_check(&tree);
+
+	uint64_t key;
+	ASSERT(csbtree_find_next(&tree, 999, &key) && key == N - 1000);
+	ASSERT(csbtree_find_prev(&tree, N - 1000, &key) && key == 999);
+
+	uint64_t remaining[2000];
+	for (uint64_t i = 0; i < 1000; i++) {
+		remaining[i] = i;
+		remaining[1000 + i] = N - 1000 + i;
+	}
+	rand_generator generator = { .state = 2 };
+	for (uint64_t i = 2000; i > 0; i--) {
+		const uint64_t j = rand_next(&generator, i);
+		ASSERT(csbtree_delete(&tree, remaining[j]));
+		remaining[j] = remaining[i - 1];
+		if (i % 200 == 0) {
+			csbtree_check(&tree);
+		}
+	}
+	csbtree_check(&tree);
+	ASSERT(tree.levels_above_leaves == 0);
+	ASSERT(csbtree_memory_usage(&tree) == sizeof(csbtree_node));
+	ASSERT(!csbtree_find_next(&tree, 0, &key));
+	csbtree_destroy(&tree);
+}
+
+void test_csbtree(void) {
+	test_group_splits();
+	test_fanout();
+	test_deletes();
+}
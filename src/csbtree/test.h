@@ -0,0 +1,6 @@
+#ifndef CSBTREE_TEST_H
+#define CSBTREE_TEST_H
+
+void test_csbtree(void);
+
+#endif
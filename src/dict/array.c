@@ -162,6 +162,20 @@ static bool insert(void* _this, uint64_t key, uint64_t value) {
 	return true;
 }
 
+static bool upsert(void* _this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	data* this = _this;
+	uint64_t index;
+	if (!lookup_index(this, key, &index)) {
+		ASSERT(insert(this, key, default_value));
+		ASSERT(lookup_index(this, key, &index));
+		*slot = &this->pairs[index].value;
+		return true;
+	}
+	*slot = &this->pairs[index].value;
+	return false;
+}
+
 static bool delete(void* _this, uint64_t key) {
 	data* this = _this;
 
@@ -176,6 +190,112 @@ static bool delete(void* _this, uint64_t key) {
 	return true;
 }
 
+static uint64_t memory_usage(void* _this) {
+	data* this = _this;
+	return sizeof(data) + sizeof(pair) * this->pair_capacity;
+}
+
+static void bulk_load(void* _this, const dict_pair* pairs, uint64_t n) {
+	data* this = _this;
+	CHECK(this->pair_count == 0, "bulk loading into non-empty array");
+	if (n > this->pair_capacity) {
+		pair* new_pairs = realloc(this->pairs, sizeof(pair) * n);
+		CHECK(new_pairs, "cannot allocate %" PRIu64 " pairs", n);
+		this->pairs = new_pairs;
+		this->pair_capacity = n;
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		this->pairs[i] = (pair) {
+			.key = pairs[i].key,
+			.value = pairs[i].value
+		};
+	}
+	this->pair_count = n;
+}
+
+typedef struct {
+	data* array;
+	uint64_t index;
+} cursor;
+
+static void cursor_init(void* this, void** _cursor) {
+	cursor* new_cursor = malloc(sizeof(cursor));
+	CHECK(new_cursor, "cannot allocate memory for array cursor");
+	new_cursor->array = this;
+	*_cursor = new_cursor;
+}
+
+static void cursor_destroy(void** _cursor) {
+	free(*_cursor);
+	*_cursor = NULL;
+}
+
+static bool cursor_seek(void* _cursor, uint64_t key) {
+	cursor* this = _cursor;
+	uint64_t min_inclusive = 0, max_exclusive = this->array->pair_count;
+	// Finds the first index with a key >= key.
+	while (min_inclusive < max_exclusive) {
+		const uint64_t mid = (min_inclusive + max_exclusive) / 2;
+		if (this->array->pairs[mid].key < key) {
+			min_inclusive = mid + 1;
+		} else {
+			max_exclusive = mid;
+		}
+	}
+	this->index = min_inclusive;
+	return this->index < this->array->pair_count;
+}
+
+static bool cursor_last(void* _cursor) {
+	cursor* this = _cursor;
+	if (this->array->pair_count == 0) {
+		return false;
+	}
+	this->index = this->array->pair_count - 1;
+	return true;
+}
+
+static bool cursor_next(void* _cursor) {
+	cursor* this = _cursor;
+	if (this->index + 1 >= this->array->pair_count) {
+		return false;
+	}
+	++this->index;
+	return true;
+}
+
+static bool cursor_prev(void* _cursor) {
+	cursor* this = _cursor;
+	if (this->index == 0) {
+		return false;
+	}
+	--this->index;
+	return true;
+}
+
+static uint64_t cursor_key(void* _cursor) {
+	cursor* this = _cursor;
+	return this->array->pairs[this->index].key;
+}
+
+static uint64_t cursor_value(void* _cursor) {
+	cursor* this = _cursor;
+	return this->array->pairs[this->index].value;
+}
+
+static const dict_cursor_api cursor_api = {
+	.init = cursor_init,
+	.destroy = cursor_destroy,
+
+	.seek = cursor_seek,
+	.last = cursor_last,
+	.next = cursor_next,
+	.prev = cursor_prev,
+
+	.key = cursor_key,
+	.value = cursor_value
+};
+
 const dict_api dict_array = {
 	.init = init,
 	.destroy = destroy,
@@ -183,9 +303,14 @@ const dict_api dict_array = {
 	.insert = insert,
 	.find = find,
 	.delete = delete,
+	.upsert = upsert,
 
 	.next = next,
 	.prev = prev,
+	.cursor = &cursor_api,
+
+	.bulk_load = bulk_load,
+	.memory_usage = memory_usage,
 
 	.name = "dict_array"
 };
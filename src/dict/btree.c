@@ -4,56 +4,92 @@
 #include <stdlib.h>
 
 #include "btree/btree.h"
+#include "btree/btree_64.h"
+#include "btree/btree_128.h"
+#include "btree/btree_512.h"
+#include "btree/btree_1024.h"
+#include "btree/btree_4096.h"
+#include "btree/btree_h32.h"
 
-static void init(void** _this) {
-	btree* this = malloc(sizeof(btree));
-	assert(this);
-	btree_init(this);
-	*_this = this;
-}
-
-static void destroy(void** _this) {
-	if (_this) {
-		btree* this = *_this;
-		if (this) {
-			btree_destroy(this);
-			free(this);
-		}
-		*_this = NULL;
-	}
-}
-
-static bool find(void* this, uint64_t key, uint64_t *value) {
-	return btree_find(this, key, value);
-}
-
-static bool next(void* this, uint64_t key, uint64_t *next_key) {
-	return btree_find_next(this, key, next_key);
-}
-
-static bool prev(void* this, uint64_t key, uint64_t *prev_key) {
-	return btree_find_prev(this, key, prev_key);
-}
-
-static bool insert(void* this, uint64_t key, uint64_t value) {
-	return btree_insert(this, key, value);
-}
-
-static bool delete(void* this, uint64_t key) {
-	return btree_delete(this, key);
-}
-
-const dict_api dict_btree = {
-	.init = init,
-	.destroy = destroy,
-
-	.find = find,
-	.insert = insert,
-	.delete = delete,
-
-	.next = next,
-	.prev = prev,
-
-	.dump = NULL,
-	.name = "dict_btree"
-};
+// Bulk loaded B-trees leave room in every node, like trees built by random
+// inserts, so that later inserts do not immediately split.
+#define BULK_LOAD_FILL 0.7
+
+// dict_btree and dict_btree_256 wrap the same default B-tree.
+#define BT(x) x
+#define DICT_BT(x) x
+#define DICT_BTREE_NAME "dict_btree"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+
+#define DICT_BT(x) x##_256
+#define DICT_BTREE_NAME "dict_btree_256"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+
+#define DICT_BT(x) x##_bstar
+#define DICT_BTREE_NAME "dict_btree_bstar"
+#define DICT_BTREE_BSTAR
+#include "dict/btree_template.h"
+#undef DICT_BTREE_BSTAR
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+
+#define DICT_BT(x) x##_relaxed
+#define DICT_BTREE_NAME "dict_btree_relaxed"
+#define DICT_BTREE_RELAXED
+#include "dict/btree_template.h"
+#undef DICT_BTREE_RELAXED
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
+
+#define BT(x) x##_64
+#define DICT_BT(x) x##_64
+#define DICT_BTREE_NAME "dict_btree_64"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
+
+#define BT(x) x##_128
+#define DICT_BT(x) x##_128
+#define DICT_BTREE_NAME "dict_btree_128"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
+
+#define BT(x) x##_512
+#define DICT_BT(x) x##_512
+#define DICT_BTREE_NAME "dict_btree_512"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
+
+#define BT(x) x##_1024
+#define DICT_BT(x) x##_1024
+#define DICT_BTREE_NAME "dict_btree_1024"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
+
+#define BT(x) x##_4096
+#define DICT_BT(x) x##_4096
+#define DICT_BTREE_NAME "dict_btree_4096"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
+
+#define BT(x) x##_h32
+#define DICT_BT(x) x##_h32
+#define DICT_BTREE_NAME "dict_btree_h32"
+#include "dict/btree_template.h"
+#undef DICT_BTREE_NAME
+#undef DICT_BT
+#undef BT
@@ -3,6 +3,23 @@
 
 #include "dict/dict.h"
 
+// B-tree with the default node size (256 B).
 extern const dict_api dict_btree;
 
+// B-trees with nodes of the given number of bytes.
+// dict_btree_256 is dict_btree under another name.
+extern const dict_api dict_btree_64;
+extern const dict_api dict_btree_128;
+extern const dict_api dict_btree_256;
+extern const dict_api dict_btree_512;
+extern const dict_api dict_btree_1024;
+extern const dict_api dict_btree_4096;
+
+// The default B-tree in B*-tree mode (see btree_init_bstar).
+extern const dict_api dict_btree_bstar;
+// The default B-tree with relaxed deletion (see btree_init_relaxed).
+extern const dict_api dict_btree_relaxed;
+// B-tree with 256 B nodes and 32-bit child indices (see btree/btree_h32.h).
+extern const dict_api dict_btree_h32;
+
 #endif
@@ -0,0 +1,130 @@
+#include "dict/btree_frozen.h"
+
+#include <stdlib.h>
+
+#include "btree/btree.h"
+#include "btree/frozen.h"
+#include "log/log.h"
+
+// Queries mostly go to the snapshot, so bulk loaded trees are packed.
+#define BULK_LOAD_FILL 1.0
+// The snapshot is rebuilt once the changes since it was taken reach
+// 1/REBUILD_FRACTION of the keys, so rebuilding takes O(REBUILD_FRACTION)
+// amortized time per change. Until then, queries go to the B-tree.
+#define REBUILD_FRACTION 4
+
+typedef struct {
+	btree tree;
+	btree_frozen frozen;
+	uint64_t size;
+	// Changes to the tree since the snapshot was taken.
+	uint64_t changes;
+} btree_frozen_dict;
+
+static void init(void** _this) {
+	btree_frozen_dict* this = malloc(sizeof(btree_frozen_dict));
+	CHECK(this, "cannot allocate frozen B-tree");
+	btree_init(&this->tree);
+	btree_freeze(&this->tree, &this->frozen);
+	this->size = 0;
+	this->changes = 0;
+	*_this = this;
+}
+
+static void destroy(void** _this) {
+	if (_this) {
+		btree_frozen_dict* this = *_this;
+		if (this) {
+			btree_frozen_destroy(&this->frozen);
+			btree_destroy(&this->tree);
+			free(this);
+		}
+		*_this = NULL;
+	}
+}
+
+// Returns the snapshot if it is up to date, rebuilding it if enough
+// changes piled up. Returns NULL if queries must go to the B-tree.
+static const btree_frozen* fresh_snapshot(btree_frozen_dict* this) {
+	if (this->changes > 0 &&
+			this->changes * REBUILD_FRACTION >= this->size) {
+		btree_frozen_destroy(&this->frozen);
+		btree_freeze(&this->tree, &this->frozen);
+		this->changes = 0;
+	}
+	return (this->changes == 0) ? &this->frozen : NULL;
+}
+
+static bool find(void* _this, uint64_t key, uint64_t *value) {
+	btree_frozen_dict* this = _this;
+	const btree_frozen* snapshot = fresh_snapshot(this);
+	return snapshot ? btree_frozen_find(snapshot, key, value) :
+			btree_find(&this->tree, key, value);
+}
+
+static bool next(void* _this, uint64_t key, uint64_t *next_key) {
+	btree_frozen_dict* this = _this;
+	const btree_frozen* snapshot = fresh_snapshot(this);
+	return snapshot ? btree_frozen_find_next(snapshot, key, next_key) :
+			btree_find_next(&this->tree, key, next_key);
+}
+
+static bool prev(void* _this, uint64_t key, uint64_t *prev_key) {
+	btree_frozen_dict* this = _this;
+	const btree_frozen* snapshot = fresh_snapshot(this);
+	return snapshot ? btree_frozen_find_prev(snapshot, key, prev_key) :
+			btree_find_prev(&this->tree, key, prev_key);
+}
+
+static bool insert(void* _this, uint64_t key, uint64_t value) {
+	btree_frozen_dict* this = _this;
+	if (btree_insert(&this->tree, key, value)) {
+		++this->size;
+		++this->changes;
+		return true;
+	}
+	return false;
+}
+
+static bool delete(void* _this, uint64_t key) {
+	btree_frozen_dict* this = _this;
+	if (btree_delete(&this->tree, key)) {
+		--this->size;
+		++this->changes;
+		return true;
+	}
+	return false;
+}
+
+static void bulk_load(void* _this, const dict_pair* pairs, uint64_t n) {
+	btree_frozen_dict* this = _this;
+	// dict_pair and btree_pair have the same layout.
+	btree_bulk_load(&this->tree, (const btree_pair*) pairs, n,
+			BULK_LOAD_FILL);
+	this->size = n;
+	this->changes = n;
+	fresh_snapshot(this);
+}
+
+static uint64_t memory_usage(void* _this) {
+	btree_frozen_dict* this = _this;
+	return sizeof(btree_frozen_dict) + btree_memory_usage(&this->tree) +
+			btree_frozen_memory_usage(&this->frozen);
+}
+
+const dict_api dict_btree_frozen = {
+	.init = init,
+	.destroy = destroy,
+
+	.find = find,
+	.insert = insert,
+	.delete = delete,
+
+	.next = next,
+	.prev = prev,
+
+	.bulk_load = bulk_load,
+	.memory_usage = memory_usage,
+
+	.name = "dict_btree_frozen"
+};
@@ -0,0 +1,13 @@
+#ifndef DICT_BTREE_FROZEN_H
+#define DICT_BTREE_FROZEN_H
+
+#include "dict/dict.h"
+
+// Default B-tree answering queries from a frozen snapshot (btree/frozen.h).
+// Changes go to the B-tree. Once they add up to a quarter of the keys,
+// the next query rebuilds the snapshot; until then, queries go to the
+// B-tree. So this only pays off when reads come in long runs without
+// writes, and experiments with mixed reads and writes skip it.
+extern const dict_api dict_btree_frozen;
+
+#endif
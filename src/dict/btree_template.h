@@ -0,0 +1,142 @@
+// dict_api wrapper of one B-tree instance, included by dict/btree.c.
+// BT(x) names the B-tree instance (see btree/template.h), DICT_BT(x) names
+// the wrapper and DICT_BTREE_NAME is its name. If DICT_BTREE_BSTAR is defined,
+// the wrapped B-tree runs in B*-tree mode, if DICT_BTREE_RELAXED is defined,
+// it uses relaxed deletion. No include guard on purpose.
+
+#include "btree/template_begin.h"
+
+static void DICT_BT(init)(void** _this) {
+	btree* this = malloc(sizeof(btree));
+	assert(this);
+#if defined(DICT_BTREE_BSTAR)
+	btree_init_bstar(this);
+#elif defined(DICT_BTREE_RELAXED)
+	btree_init_relaxed(this);
+#else
+	btree_init(this);
+#endif
+	*_this = this;
+}
+
+static void DICT_BT(destroy)(void** _this) {
+	if (_this) {
+		btree* this = *_this;
+		if (this) {
+			btree_destroy(this);
+			free(this);
+		}
+		*_this = NULL;
+	}
+}
+
+static bool DICT_BT(find)(void* this, uint64_t key, uint64_t *value) {
+	return btree_find(this, key, value);
+}
+
+static bool DICT_BT(upsert)(void* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return btree_upsert(this, key, default_value, slot);
+}
+
+static uint64_t DICT_BT(memory_usage)(void* this) {
+	return sizeof(btree) + btree_memory_usage(this);
+}
+
+static void DICT_BT(find_batch)(void* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	btree_find_batch(this, keys, n, values, found);
+}
+
+static void DICT_BT(bulk_load)(void* this, const dict_pair* pairs, uint64_t n) {
+	// dict_pair and btree_pair have the same layout.
+	btree_bulk_load(this, (const btree_pair*) pairs, n, BULK_LOAD_FILL);
+}
+
+static bool DICT_BT(next)(void* this, uint64_t key, uint64_t *next_key) {
+	return btree_find_next(this, key, next_key);
+}
+
+static bool DICT_BT(prev)(void* this, uint64_t key, uint64_t *prev_key) {
+	return btree_find_prev(this, key, prev_key);
+}
+
+static bool DICT_BT(insert)(void* this, uint64_t key, uint64_t value) {
+	return btree_insert(this, key, value);
+}
+
+static bool DICT_BT(delete)(void* this, uint64_t key) {
+	return btree_delete(this, key);
+}
+
+static void DICT_BT(cursor_init)(void* this, void** _cursor) {
+	btree_cursor* cursor = malloc(sizeof(btree_cursor));
+	assert(cursor);
+	btree_cursor_init(cursor, this);
+	*_cursor = cursor;
+}
+
+static void DICT_BT(cursor_destroy)(void** _cursor) {
+	free(*_cursor);
+	*_cursor = NULL;
+}
+
+static bool DICT_BT(cursor_seek)(void* cursor, uint64_t key) {
+	return btree_cursor_seek(cursor, key);
+}
+
+static bool DICT_BT(cursor_last)(void* cursor) {
+	return btree_cursor_last(cursor);
+}
+
+static bool DICT_BT(cursor_next)(void* cursor) {
+	return btree_cursor_next(cursor);
+}
+
+static bool DICT_BT(cursor_prev)(void* cursor) {
+	return btree_cursor_prev(cursor);
+}
+
+static uint64_t DICT_BT(cursor_key)(void* cursor) {
+	return btree_cursor_key(cursor);
+}
+
+static uint64_t DICT_BT(cursor_value)(void* cursor) {
+	return btree_cursor_value(cursor);
+}
+
+static const dict_cursor_api DICT_BT(cursor_api) = {
+	.init = DICT_BT(cursor_init),
+	.destroy = DICT_BT(cursor_destroy),
+
+	.seek = DICT_BT(cursor_seek),
+	.last = DICT_BT(cursor_last),
+	.next = DICT_BT(cursor_next),
+	.prev = DICT_BT(cursor_prev),
+
+	.key = DICT_BT(cursor_key),
+	.value = DICT_BT(cursor_value)
+};
+
+const dict_api DICT_BT(dict_btree) = {
+	.init = DICT_BT(init),
+	.destroy = DICT_BT(destroy),
+
+	.find = DICT_BT(find),
+	.insert = DICT_BT(insert),
+	.delete = DICT_BT(delete),
+	.upsert = DICT_BT(upsert),
+
+	.next = DICT_BT(next),
+	.prev = DICT_BT(prev),
+	.cursor = &DICT_BT(cursor_api),
+
+	.find_batch = DICT_BT(find_batch),
+	.bulk_load = DICT_BT(bulk_load),
+	.memory_usage = DICT_BT(memory_usage),
+
+	.dump = NULL,
+	.name = DICT_BTREE_NAME
+};
+
+#include "btree/template_end.h"
@@ -0,0 +1,69 @@
+#include "dict/cbtree.h"
+
+#include <stdlib.h>
+
+#include "cbtree/cbtree.h"
+#include "log/log.h"
+
+static void init(void** _this) {
+	cbtree* this = malloc(sizeof(cbtree));
+	CHECK(this, "cannot allocate compressed B-tree");
+	cbtree_init(this);
+	*_this = this;
+}
+
+static void destroy(void** _this) {
+	if (_this) {
+		cbtree* this = *_this;
+		if (this) {
+			cbtree_destroy(this);
+			free(this);
+		}
+		*_this = NULL;
+	}
+}
+
+static bool find(void* this, uint64_t key, uint64_t *value) {
+	return cbtree_find(this, key, value);
+}
+
+static bool insert(void* this, uint64_t key, uint64_t value) {
+	return cbtree_insert(this, key, value);
+}
+
+static bool delete(void* this, uint64_t key) {
+	return cbtree_delete(this, key);
+}
+
+static bool next(void* this, uint64_t key, uint64_t *next_key) {
+	return cbtree_find_next(this, key, next_key);
+}
+
+static bool prev(void* this, uint64_t key, uint64_t *prev_key) {
+	return cbtree_find_prev(this, key, prev_key);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(cbtree) + cbtree_memory_usage(this);
+}
+
+static void check(void* this) {
+	cbtree_check(this);
+}
+
+const dict_api dict_cbtree = {
+	.init = init,
+	.destroy = destroy,
+
+	.find = find,
+	.insert = insert,
+	.delete = delete,
+
+	.next = next,
+	.prev = prev,
+
+	.memory_usage = memory_usage,
+	.check = check,
+
+	.name = "dict_cbtree"
+};
@@ -0,0 +1,8 @@
+#ifndef DICT_CBTREE_H
+#define DICT_CBTREE_H
+
+#include "dict/dict.h"
+
+extern const dict_api dict_cbtree;
+
+#endif
@@ -15,6 +15,15 @@ static void init(void** _this) {
 	*_this = this;
 }
 
+static void init_blocked(void** _this) {
+	cob* this = malloc(sizeof(cob));
+	CHECK(this, "cannot allocate memory for cob");
+
+	memset(this, 0, sizeof(cob));
+	cob_init_blocked(this);
+	*_this = this;
+}
+
 static void destroy(void** _this) {
 	if (_this) {
 		cob* this = * (cob**) _this;
@@ -28,6 +37,16 @@ static bool find(void* this, uint64_t key, uint64_t *value) {
 	return cob_find(this, key, value);
 }
 
+static void find_batch(void* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	cob_find_batch(this, keys, n, values, found);
+}
+
+static bool upsert(void* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return cob_upsert(this, key, default_value, slot);
+}
+
 static bool insert(void* this, uint64_t key, uint64_t value) {
 	return cob_insert(this, key, value);
 }
@@ -36,6 +55,21 @@ static bool delete(void* this, uint64_t key) {
 	return cob_delete(this, key);
 }
 
+static uint64_t insert_batch(void* this, const dict_pair* pairs,
+		uint64_t n) {
+	// dict_pair and cob_piece_item have the same layout.
+	return cob_insert_batch(this, (const cob_piece_item*) pairs, n);
+}
+
+static void bulk_load(void* this, const dict_pair* pairs, uint64_t n) {
+	// dict_pair and cob_piece_item have the same layout.
+	cob_bulk_load(this, (const cob_piece_item*) pairs, n);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(cob) + cob_memory_usage(this);
+}
+
 static bool next(void* this, uint64_t key, uint64_t *next_key) {
 	return cob_next_key(this, key, next_key);
 }
@@ -44,6 +78,55 @@ static bool prev(void* this, uint64_t key, uint64_t *prev_key) {
 	return cob_previous_key(this, key, prev_key);
 }
 
+static void cursor_init(void* this, void** _cursor) {
+	cob_cursor* cursor = malloc(sizeof(cob_cursor));
+	CHECK(cursor, "cannot allocate memory for cob cursor");
+	cob_cursor_init(cursor, this);
+	*_cursor = cursor;
+}
+
+static void cursor_destroy(void** _cursor) {
+	free(*_cursor);
+	*_cursor = NULL;
+}
+
+static bool cursor_seek(void* cursor, uint64_t key) {
+	return cob_cursor_seek(cursor, key);
+}
+
+static bool cursor_last(void* cursor) {
+	return cob_cursor_last(cursor);
+}
+
+static bool cursor_next(void* cursor) {
+	return cob_cursor_next(cursor);
+}
+
+static bool cursor_prev(void* cursor) {
+	return cob_cursor_prev(cursor);
+}
+
+static uint64_t cursor_key(void* cursor) {
+	return cob_cursor_key(cursor);
+}
+
+static uint64_t cursor_value(void* cursor) {
+	return cob_cursor_value(cursor);
+}
+
+static const dict_cursor_api cursor_api = {
+	.init = cursor_init,
+	.destroy = cursor_destroy,
+
+	.seek = cursor_seek,
+	.last = cursor_last,
+	.next = cursor_next,
+	.prev = cursor_prev,
+
+	.key = cursor_key,
+	.value = cursor_value
+};
+
 const dict_api dict_cobt = {
 	.init = init,
 	.destroy = destroy,
@@ -51,9 +134,37 @@ const dict_api dict_cobt = {
 	.insert = insert,
 	.find = find,
 	.delete = delete,
+	.upsert = upsert,
 
 	.next = next,
 	.prev = prev,
+	.cursor = &cursor_api,
+
+	.find_batch = find_batch,
+	.insert_batch = insert_batch,
+	.bulk_load = bulk_load,
+	.memory_usage = memory_usage,
 
 	.name = "dict_cobt"
 };
+
+const dict_api dict_cobt_blocked = {
+	.init = init_blocked,
+	.destroy = destroy,
+
+	.insert = insert,
+	.find = find,
+	.delete = delete,
+	.upsert = upsert,
+
+	.next = next,
+	.prev = prev,
+	.cursor = &cursor_api,
+
+	.find_batch = find_batch,
+	.insert_batch = insert_batch,
+	.bulk_load = bulk_load,
+	.memory_usage = memory_usage,
+
+	.name = "dict_cobt_blocked"
+};
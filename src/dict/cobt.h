@@ -4,5 +4,7 @@
 #include "dict/dict.h"
 
 extern const dict_api dict_cobt;
+// Indexes COB pieces with a tree of cache line blocks.
+extern const dict_api dict_cobt_blocked;
 
 #endif
@@ -0,0 +1,69 @@
+#include "dict/csbtree.h"
+
+#include <stdlib.h>
+
+#include "csbtree/csbtree.h"
+#include "log/log.h"
+
+static void init(void** _this) {
+	csbtree* this = malloc(sizeof(csbtree));
+	CHECK(this, "cannot allocate CSB+-tree");
+	csbtree_init(this);
+	*_this = this;
+}
+
+static void destroy(void** _this) {
+	if (_this) {
+		csbtree* this = *_this;
+		if (this) {
+			csbtree_destroy(this);
+			free(this);
+		}
+		*_this = NULL;
+	}
+}
+
+static bool find(void* this, uint64_t key, uint64_t *value) {
+	return csbtree_find(this, key, value);
+}
+
+static bool insert(void* this, uint64_t key, uint64_t value) {
+	return csbtree_insert(this, key, value);
+}
+
+static bool delete(void* this, uint64_t key) {
+	return csbtree_delete(this, key);
+}
+
+static bool next(void* this, uint64_t key, uint64_t *next_key) {
+	return csbtree_find_next(this, key, next_key);
+}
+
+static bool prev(void* this, uint64_t key, uint64_t *prev_key) {
+	return csbtree_find_prev(this, key, prev_key);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(csbtree) + csbtree_memory_usage(this);
+}
+
+static void check(void* this) {
+	csbtree_check(this);
+}
+
+const dict_api dict_csbtree = {
+	.init = init,
+	.destroy = destroy,
+
+	.find = find,
+	.insert = insert,
+	.delete = delete,
+
+	.next = next,
+	.prev = prev,
+
+	.memory_usage = memory_usage,
+	.check = check,
+
+	.name = "dict_csbtree"
+};
@@ -0,0 +1,8 @@
+#ifndef DICT_CSBTREE_H
+#define DICT_CSBTREE_H
+
+#include "dict/dict.h"
+
+extern const dict_api dict_csbtree;
+
+#endif
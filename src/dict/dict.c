@@ -1,5 +1,6 @@
 #include "dict/dict.h"
 
+#include <inttypes.h>
 #include <stdlib.h>
 
 #include "log/log.h"
@@ -38,6 +39,15 @@ bool dict_delete(dict* this, uint64_t key) {
 	return this->api->delete(this->opaque, key);
 }
 
+bool dict_upsert(dict* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	if (this->api->upsert) {
+		return this->api->upsert(this->opaque, key, default_value,
+				slot);
+	}
+	log_fatal("dict api %s doesn't implement upsert", this->api->name);
+}
+
 void dict_dump(dict* this) {
 	if (this->api->dump) {
 		this->api->dump(this->opaque);
@@ -74,6 +84,206 @@ bool dict_prev(dict* this, uint64_t key, uint64_t *prev_key) {
 	log_fatal("dict api %s doesn't implement prev", this->api->name);
 }
 
+void dict_find_batch(dict* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	if (this->api->find_batch) {
+		this->api->find_batch(this->opaque, keys, n, values, found);
+		return;
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		found[i] = this->api->find(this->opaque, keys[i],
+				values ? &values[i] : NULL);
+	}
+}
+
+uint64_t dict_insert_batch(dict* this, const dict_pair* pairs, uint64_t n) {
+	if (this->api->insert_batch) {
+		return this->api->insert_batch(this->opaque, pairs, n);
+	}
+	uint64_t inserted = 0;
+	for (uint64_t i = 0; i < n; i++) {
+		if (this->api->insert(this->opaque, pairs[i].key,
+					pairs[i].value)) {
+			++inserted;
+		}
+	}
+	return inserted;
+}
+
+void dict_bulk_load(dict* this, const dict_pair* pairs, uint64_t n) {
+	for (uint64_t i = 0; i < n; i++) {
+		CHECK(pairs[i].key != DICT_RESERVED_KEY,
+				"trying to bulk load reserved key");
+		CHECK(i == 0 || pairs[i - 1].key < pairs[i].key,
+				"bulk loaded keys not sorted and unique");
+	}
+	if (this->api->bulk_load) {
+		this->api->bulk_load(this->opaque, pairs, n);
+		return;
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		CHECK(this->api->insert(this->opaque, pairs[i].key,
+					pairs[i].value),
+				"cannot insert bulk loaded key %" PRIu64,
+				pairs[i].key);
+	}
+}
+
+uint64_t dict_memory_usage(dict* this) {
+	if (this->api->memory_usage) {
+		return this->api->memory_usage(this->opaque);
+	}
+	return 0;
+}
+
+// Cursor for ordered dictionaries without a native one: remembers the
+// current key and asks the dictionary for its neighbours.
+typedef struct {
+	dict* dict;
+	uint64_t key;
+} generic_cursor;
+
+static void generic_cursor_init(void* dict, void** _cursor) {
+	generic_cursor* cursor = malloc(sizeof(generic_cursor));
+	CHECK(cursor, "failed to allocate generic cursor");
+	cursor->dict = dict;
+	*_cursor = cursor;
+}
+
+static void generic_cursor_destroy(void** _cursor) {
+	free(*_cursor);
+	*_cursor = NULL;
+}
+
+static bool generic_cursor_seek(void* _cursor, uint64_t key) {
+	generic_cursor* cursor = _cursor;
+	if (dict_find(cursor->dict, key, NULL)) {
+		cursor->key = key;
+		return true;
+	}
+	return dict_next(cursor->dict, key, &cursor->key);
+}
+
+static bool generic_cursor_last(void* _cursor) {
+	generic_cursor* cursor = _cursor;
+	return dict_prev(cursor->dict, DICT_RESERVED_KEY, &cursor->key);
+}
+
+static bool generic_cursor_next(void* _cursor) {
+	generic_cursor* cursor = _cursor;
+	return dict_next(cursor->dict, cursor->key, &cursor->key);
+}
+
+static bool generic_cursor_prev(void* _cursor) {
+	generic_cursor* cursor = _cursor;
+	return dict_prev(cursor->dict, cursor->key, &cursor->key);
+}
+
+static uint64_t generic_cursor_key(void* _cursor) {
+	generic_cursor* cursor = _cursor;
+	return cursor->key;
+}
+
+static uint64_t generic_cursor_value(void* _cursor) {
+	generic_cursor* cursor = _cursor;
+	uint64_t value;
+	ASSERT(dict_find(cursor->dict, cursor->key, &value));
+	return value;
+}
+
+static const dict_cursor_api generic_cursor_api = {
+	.init = generic_cursor_init,
+	.destroy = generic_cursor_destroy,
+
+	.seek = generic_cursor_seek,
+	.last = generic_cursor_last,
+	.next = generic_cursor_next,
+	.prev = generic_cursor_prev,
+
+	.key = generic_cursor_key,
+	.value = generic_cursor_value
+};
+
+struct dict_cursor_s {
+	void* opaque;
+	const dict_cursor_api* api;
+	enum { BEFORE_FIRST, AT_KEY, AFTER_LAST } position;
+};
+
+void dict_cursor_init(dict* this, dict_cursor** _cursor) {
+	dict_cursor* cursor = malloc(sizeof(struct dict_cursor_s));
+	CHECK(cursor, "failed to allocate cursor for %s", this->api->name);
+	if (this->api->cursor) {
+		cursor->api = this->api->cursor;
+		cursor->api->init(this->opaque, &cursor->opaque);
+	} else if (dict_allows_order_queries(this)) {
+		cursor->api = &generic_cursor_api;
+		cursor->api->init(this, &cursor->opaque);
+	} else {
+		log_fatal("dict api %s doesn't allow order queries",
+				this->api->name);
+	}
+	cursor->position = BEFORE_FIRST;
+	*_cursor = cursor;
+}
+
+void dict_cursor_destroy(dict_cursor** _cursor) {
+	if (*_cursor) {
+		dict_cursor* cursor = *_cursor;
+		cursor->api->destroy(&cursor->opaque);
+		free(cursor);
+		*_cursor = NULL;
+	}
+}
+
+bool dict_cursor_seek(dict_cursor* cursor, uint64_t key) {
+	const bool found = cursor->api->seek(cursor->opaque, key);
+	cursor->position = found ? AT_KEY : AFTER_LAST;
+	return found;
+}
+
+bool dict_cursor_next(dict_cursor* cursor) {
+	bool found;
+	switch (cursor->position) {
+	case BEFORE_FIRST:
+		found = cursor->api->seek(cursor->opaque, 0);
+		break;
+	case AT_KEY:
+		found = cursor->api->next(cursor->opaque);
+		break;
+	default:
+		return false;
+	}
+	cursor->position = found ? AT_KEY : AFTER_LAST;
+	return found;
+}
+
+bool dict_cursor_prev(dict_cursor* cursor) {
+	bool found;
+	switch (cursor->position) {
+	case AFTER_LAST:
+		found = cursor->api->last(cursor->opaque);
+		break;
+	case AT_KEY:
+		found = cursor->api->prev(cursor->opaque);
+		break;
+	default:
+		return false;
+	}
+	cursor->position = found ? AT_KEY : BEFORE_FIRST;
+	return found;
+}
+
+uint64_t dict_cursor_key(dict_cursor* cursor) {
+	ASSERT(cursor->position == AT_KEY);
+	return cursor->api->key(cursor->opaque);
+}
+
+uint64_t dict_cursor_value(dict_cursor* cursor) {
+	ASSERT(cursor->position == AT_KEY);
+	return cursor->api->value(cursor->opaque);
+}
+
 void* dict_get_implementation(dict* this) {
 	return this->opaque;
 }
@@ -10,6 +10,30 @@
 
 typedef struct dict_s dict;
 
+typedef struct {
+	uint64_t key;
+	uint64_t value;
+} dict_pair;
+typedef struct dict_cursor_s dict_cursor;
+
+// Native cursor over an ordered dictionary. A cursor points at one key.
+// next and prev are only called on a cursor that points at a key.
+typedef struct {
+	void (*init)(void* dict, void** cursor);
+	void (*destroy)(void** cursor);
+
+	// Moves to the smallest key >= key. Returns false if there is none.
+	bool (*seek)(void* cursor, uint64_t key);
+	// Moves to the largest key. Returns false if the dictionary is empty.
+	bool (*last)(void* cursor);
+	// Move to the next/previous key. Return false if there is none.
+	bool (*next)(void* cursor);
+	bool (*prev)(void* cursor);
+
+	uint64_t (*key)(void* cursor);
+	uint64_t (*value)(void* cursor);
+} dict_cursor_api;
+
 typedef struct {
 	void (*init)(void**);
 	void (*destroy)(void**);
@@ -25,6 +49,32 @@ typedef struct {
 	bool (*next)(void*, uint64_t key, uint64_t *next_key);
 	bool (*prev)(void*, uint64_t key, uint64_t *prev_key);
 
+	// Optional extension: in-place updates. NULL if not implemented.
+	bool (*upsert)(void*, uint64_t key, uint64_t default_value,
+			uint64_t** slot);
+
+	// Optional extension: native cursors. NULL if not implemented.
+	// Ordered dictionaries without native cursors get a generic cursor
+	// built on next and prev.
+	const dict_cursor_api* cursor;
+
+	// Optional extension: batched lookups.
+	// NULL if not implemented.
+	void (*find_batch)(void*, const uint64_t* keys, uint64_t n,
+			uint64_t* values, bool* found);
+
+	// Optional extension: batched inserts.
+	// NULL if not implemented.
+	uint64_t (*insert_batch)(void*, const dict_pair* pairs, uint64_t n);
+
+	// Optional extension: building from sorted pairs.
+	// NULL if not implemented. Only called on empty dictionaries.
+	void (*bulk_load)(void*, const dict_pair* pairs, uint64_t n);
+
+	// Optional extension: memory footprint in bytes.
+	// NULL if not implemented.
+	uint64_t (*memory_usage)(void*);
+
 	// Optional
 	void (*dump)(void*);
 	void (*check)(void*);
@@ -46,12 +96,59 @@ bool MUST_USE_RESULT dict_insert(dict*, uint64_t key, uint64_t value);
 // Returns whether a pair was found and deleted.
 bool MUST_USE_RESULT dict_delete(dict*, uint64_t key);
 
+// Finds the value slot of the key in one pass, inserting key=default_value
+// if the key is missing. *slot is set to point to the stored value, which
+// may be changed in place. The slot is only valid until the dictionary
+// is next modified. Returns whether the key was inserted.
+bool dict_upsert(dict*, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
+
 // Optional extension: ordered dictionary.
 bool dict_api_allows_order_queries(const dict_api*);
 bool dict_allows_order_queries(const dict*);
 bool MUST_USE_RESULT dict_next(dict*, uint64_t key, uint64_t *next_key);
 bool MUST_USE_RESULT dict_prev(dict*, uint64_t key, uint64_t *prev_key);
 
+// Cursors walk ordered dictionaries in key order without descending from
+// the root for every key. A new cursor points before the first key, so
+// dict_cursor_next moves it to the smallest key. When a cursor runs past
+// the last key, dict_cursor_prev moves it back to the largest key.
+// Modifying the dictionary invalidates all of its cursors.
+void dict_cursor_init(dict*, dict_cursor**);
+void dict_cursor_destroy(dict_cursor**);
+// Moves the cursor to the smallest key >= key.
+// Returns whether there is such a key. If not, the cursor is past the end.
+bool dict_cursor_seek(dict_cursor*, uint64_t key);
+// Move the cursor to the next/previous key. Return whether there was one.
+bool dict_cursor_next(dict_cursor*);
+bool dict_cursor_prev(dict_cursor*);
+// Only valid while the cursor points at a key.
+uint64_t dict_cursor_key(dict_cursor*);
+uint64_t dict_cursor_value(dict_cursor*);
+
+// Looks up n keys at once. found[i] is set to whether keys[i] was found.
+// If it was and values != NULL, values[i] is set to the associated value.
+// Implementations may overlap the lookups to hide memory latency.
+// Falls back to calling dict_find for every key.
+void dict_find_batch(dict*, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found);
+
+// Inserts n pairs in any order, as if by calling dict_insert for each:
+// pairs whose keys are already present (or came earlier in the batch)
+// are skipped. Returns the number of inserted pairs.
+// Implementations may sort the batch and merge it in all at once.
+// Falls back to calling dict_insert for every pair.
+uint64_t dict_insert_batch(dict*, const dict_pair* pairs, uint64_t n);
+
+// Fills an empty dictionary with n pairs sorted by strictly increasing keys.
+// Implementations may build their structure directly in linear time.
+// Falls back to inserting the pairs one by one.
+void dict_bulk_load(dict*, const dict_pair* pairs, uint64_t n);
+
+// Returns the number of bytes the dictionary allocated, including internal
+// slack (empty slots, padding). Returns 0 if the implementation cannot tell.
+uint64_t dict_memory_usage(dict*);
+
 void dict_dump(dict*);
 void dict_check(dict*);
 
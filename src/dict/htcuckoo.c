@@ -29,6 +29,11 @@ static bool insert(void* this, uint64_t key, uint64_t value) {
 	return htcuckoo_insert(this, key, value);
 }
 
+static bool upsert(void* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return htcuckoo_upsert(this, key, default_value, slot);
+}
+
 static bool delete(void* this, uint64_t key) {
 	return htcuckoo_delete(this, key);
 }
@@ -37,6 +42,15 @@ static bool find(void* this, uint64_t key, uint64_t* value) {
 	return htcuckoo_find(this, key, value);
 }
 
+static void find_batch(void* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	htcuckoo_find_batch(this, keys, n, values, found);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(htcuckoo) + htcuckoo_memory_usage(this);
+}
+
 const dict_api dict_htcuckoo = {
 	.init = init,
 	.destroy = destroy,
@@ -44,6 +58,10 @@ const dict_api dict_htcuckoo = {
 	.find = find,
 	.insert = insert,
 	.delete = delete,
+	.upsert = upsert,
+
+	.find_batch = find_batch,
+	.memory_usage = memory_usage,
 
 	.name = "dict_htcuckoo"
 };
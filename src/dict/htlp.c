@@ -28,6 +28,11 @@ static bool insert(void* this, uint64_t key, uint64_t value) {
 	return htlp_insert(this, key, value);
 }
 
+static bool upsert(void* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return htlp_upsert(this, key, default_value, slot);
+}
+
 static bool delete(void* this, uint64_t key) {
 	return htlp_delete(this, key);
 }
@@ -36,6 +41,15 @@ static bool find(void* this, uint64_t key, uint64_t* value) {
 	return htlp_find(this, key, value);
 }
 
+static void find_batch(void* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	htlp_find_batch(this, keys, n, values, found);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(htlp) + htlp_memory_usage(this);
+}
+
 const dict_api dict_htlp = {
 	.init = init,
 	.destroy = destroy,
@@ -43,6 +57,10 @@ const dict_api dict_htlp = {
 	.find = find,
 	.insert = insert,
 	.delete = delete,
+	.upsert = upsert,
+
+	.find_batch = find_batch,
+	.memory_usage = memory_usage,
 
 	.name = "dict_htlp"
 };
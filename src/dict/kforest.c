@@ -29,10 +29,19 @@ static bool insert(void* _this, uint64_t key, uint64_t value) {
 	return kforest_insert(_this, key, value);
 }
 
+static bool upsert(void* _this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return kforest_upsert(_this, key, default_value, slot);
+}
+
 static bool delete(void* _this, uint64_t key) {
 	return kforest_delete(_this, key);
 }
 
+static uint64_t memory_usage(void* _this) {
+	return sizeof(kforest) + kforest_memory_usage(_this);
+}
+
 const dict_api dict_kforest = {
 	.init = init,
 	.destroy = destroy,
@@ -40,9 +49,12 @@ const dict_api dict_kforest = {
 	.insert = insert,
 	.find = find,
 	.delete = delete,
+	.upsert = upsert,
 
 	.next = NULL,
 	.prev = NULL,
 
+	.memory_usage = memory_usage,
+
 	.name = "dict_kforest"
 };
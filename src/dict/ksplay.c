@@ -33,14 +33,79 @@ static bool find_previous(void* this, uint64_t key, uint64_t* previous_key) {
 	return ksplay_previous_key(this, key, previous_key);
 }
 
+static void bulk_load(void* this, const dict_pair* pairs, uint64_t n) {
+	// dict_pair and ksplay_pair have the same layout.
+	ksplay_bulk_load(this, (const ksplay_pair*) pairs, n);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(ksplay) + ksplay_memory_usage(this);
+}
+
 static bool insert(void* this, uint64_t key, uint64_t value) {
 	return ksplay_insert(this, key, value);
 }
 
+static bool upsert(void* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return ksplay_upsert(this, key, default_value, slot);
+}
+
 static bool delete(void* this, uint64_t key) {
 	return ksplay_delete(this, key);
 }
 
+static void cursor_init(void* this, void** _cursor) {
+	ksplay_cursor* cursor = malloc(sizeof(ksplay_cursor));
+	CHECK(cursor, "cannot allocate memory for ksplay cursor");
+	ksplay_cursor_init(cursor, this);
+	*_cursor = cursor;
+}
+
+static void cursor_destroy(void** _cursor) {
+	ksplay_cursor_destroy(*_cursor);
+	free(*_cursor);
+	*_cursor = NULL;
+}
+
+static bool cursor_seek(void* cursor, uint64_t key) {
+	return ksplay_cursor_seek(cursor, key);
+}
+
+static bool cursor_last(void* cursor) {
+	return ksplay_cursor_last(cursor);
+}
+
+static bool cursor_next(void* cursor) {
+	return ksplay_cursor_next(cursor);
+}
+
+static bool cursor_prev(void* cursor) {
+	return ksplay_cursor_prev(cursor);
+}
+
+static uint64_t cursor_key(void* cursor) {
+	return ksplay_cursor_key(cursor);
+}
+
+static uint64_t cursor_value(void* cursor) {
+	return ksplay_cursor_value(cursor);
+}
+
+static const dict_cursor_api cursor_api = {
+	.init = cursor_init,
+	.destroy = cursor_destroy,
+
+	.seek = cursor_seek,
+	.last = cursor_last,
+	.next = cursor_next,
+	.prev = cursor_prev,
+
+	.key = cursor_key,
+	.value = cursor_value
+};
+
+
 const dict_api dict_ksplay = {
 	.init = init,
 	.destroy = destroy,
@@ -48,9 +113,14 @@ const dict_api dict_ksplay = {
 	.insert = insert,
 	.find = find,
 	.delete = delete,
+	.upsert = upsert,
 
 	.next = find_next,
 	.prev = find_previous,
+	.cursor = &cursor_api,
+
+	.bulk_load = bulk_load,
+	.memory_usage = memory_usage,
 
 	.name = "dict_ksplay"
 };
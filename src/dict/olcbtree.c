@@ -0,0 +1,69 @@
+#include "dict/olcbtree.h"
+
+#include <stdlib.h>
+
+#include "olcbtree/olcbtree.h"
+#include "log/log.h"
+
+static void init(void** _this) {
+	olcbtree* this = malloc(sizeof(olcbtree));
+	CHECK(this, "cannot allocate OLC B-tree");
+	olcbtree_init(this);
+	*_this = this;
+}
+
+static void destroy(void** _this) {
+	if (_this) {
+		olcbtree* this = *_this;
+		if (this) {
+			olcbtree_destroy(this);
+			free(this);
+		}
+		*_this = NULL;
+	}
+}
+
+static bool find(void* this, uint64_t key, uint64_t *value) {
+	return olcbtree_find(this, key, value);
+}
+
+static bool insert(void* this, uint64_t key, uint64_t value) {
+	return olcbtree_insert(this, key, value);
+}
+
+static bool delete(void* this, uint64_t key) {
+	return olcbtree_delete(this, key);
+}
+
+static bool next(void* this, uint64_t key, uint64_t *next_key) {
+	return olcbtree_find_next(this, key, next_key);
+}
+
+static bool prev(void* this, uint64_t key, uint64_t *prev_key) {
+	return olcbtree_find_prev(this, key, prev_key);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(olcbtree) + olcbtree_memory_usage(this);
+}
+
+static void check(void* this) {
+	olcbtree_check(this);
+}
+
+const dict_api dict_olcbtree = {
+	.init = init,
+	.destroy = destroy,
+
+	.find = find,
+	.insert = insert,
+	.delete = delete,
+
+	.next = next,
+	.prev = prev,
+
+	.memory_usage = memory_usage,
+	.check = check,
+
+	.name = "dict_olcbtree"
+};
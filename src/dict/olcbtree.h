@@ -0,0 +1,10 @@
+#ifndef DICT_OLCBTREE_H
+#define DICT_OLCBTREE_H
+
+#include "dict/dict.h"
+
+// Thread-safe: find, insert, delete, next and prev may be called from
+// many threads at once. See olcbtree/olcbtree.h.
+extern const dict_api dict_olcbtree;
+
+#endif
@@ -63,11 +63,32 @@ static bool find(void* _this, uint64_t key, uint64_t *value) {
 	}
 }
 
+static bool upsert(void* _this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	struct rbtree_tree* this = _this;
+	rbtree_pair* pair = rbtree_find(this, key);
+	const bool inserted = (pair == NULL);
+	if (inserted) {
+		pair = rbtree_new(this, key);
+		pair->value = default_value;
+	}
+	// Rebalancing relinks nodes without moving them.
+	*slot = &pair->value;
+	return inserted;
+}
+
 static bool delete(void* _this, uint64_t key) {
 	struct rbtree_tree* this = _this;
 	return rbtree_delete(this, key);
 }
 
+static uint64_t memory_usage(void* _this) {
+	struct rbtree_tree* this = _this;
+	// Every pair lives in its own bucket.
+	return sizeof(struct rbtree_tree) +
+			this->count * sizeof(rbtree_bucket);
+}
+
 // TODO: next, prev
 
 const dict_api dict_rbtree = {
@@ -77,9 +98,12 @@ const dict_api dict_rbtree = {
 	.insert = insert,
 	.find = find,
 	.delete = delete,
+	.upsert = upsert,
 
 	// .next = next,
 	// .prev = prev,
 
+	.memory_usage = memory_usage,
+
 	.name = "dict_rbtree"
 };
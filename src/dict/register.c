@@ -6,19 +6,32 @@
 
 #include "dict/array.h"
 #include "dict/btree.h"
+#include "dict/btree_frozen.h"
+#include "dict/cbtree.h"
 #include "dict/cobt.h"
+#include "dict/csbtree.h"
 #include "dict/htcuckoo.h"
 #include "dict/htlp.h"
 #include "dict/kforest.h"
 #include "dict/ksplay.h"
+#include "dict/olcbtree.h"
 #include "dict/rbtree.h"
+#include "dict/sharded.h"
 #include "dict/splay.h"
 
 const dict_api* DICT_API_REGISTER[] = {
-	&dict_array, &dict_btree, &dict_cobt,
+	&dict_array, &dict_btree, &dict_cbtree, &dict_cobt, &dict_csbtree,
+	&dict_cobt_blocked,
+	&dict_btree_64, &dict_btree_128, &dict_btree_256,
+	&dict_btree_512, &dict_btree_1024, &dict_btree_4096, &dict_btree_h32,
+	&dict_btree_bstar, &dict_btree_relaxed, &dict_btree_frozen,
 	&dict_htlp, &dict_htcuckoo,
 	&dict_kforest, &dict_ksplay, &dict_splay,
 	&dict_rbtree,
+	&dict_olcbtree,
+	&dict_sharded_btree, &dict_sharded_cobt,
+	&dict_sharded_htlp, &dict_sharded_htcuckoo,
+	&dict_sharded_splay,
 	NULL
 };
 
@@ -0,0 +1,378 @@
+#include "dict/sharded.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "dict/btree.h"
+#include "dict/cobt.h"
+#include "dict/htcuckoo.h"
+#include "dict/htlp.h"
+#include "dict/splay.h"
+#include "htable/hash.h"
+#include "log/log.h"
+#include "rand/rand.h"
+
+// Shards are aligned to cache lines, so that threads locking neighbouring
+// shards don't fight over one line.
+typedef struct {
+	_Alignas(64) pthread_rwlock_t lock;
+	dict* dict;
+} shard;
+
+typedef struct {
+	// Set if finds on the inner dictionary modify it (e.g. splaying).
+	bool exclusive_reads;
+	uint64_t shard_count;
+	sth hash;
+	shard* shards;
+} sharded;
+
+static void sharded_init(void** _this, const dict_api* inner,
+		uint64_t shard_count, bool exclusive_reads) {
+	sharded* this = malloc(sizeof(sharded));
+	CHECK(this, "cannot allocate sharded %s", inner->name);
+	this->exclusive_reads = exclusive_reads;
+	this->shard_count = shard_count;
+
+	rand_generator rand;
+	rand_seed_with_time(&rand);
+	sth_init(&this->hash, shard_count, &rand);
+
+	CHECK(posix_memalign((void**) &this->shards, 64,
+			sizeof(shard) * shard_count) == 0,
+			"cannot allocate %" PRIu64 " shards", shard_count);
+	for (uint64_t i = 0; i < shard_count; i++) {
+		CHECK(pthread_rwlock_init(&this->shards[i].lock, NULL) == 0,
+				"cannot initialize shard lock");
+		dict_init(&this->shards[i].dict, inner);
+	}
+	*_this = this;
+}
+
+static void destroy(void** _this) {
+	if (_this) {
+		sharded* this = *_this;
+		if (this) {
+			for (uint64_t i = 0; i < this->shard_count; i++) {
+				dict_destroy(&this->shards[i].dict);
+				pthread_rwlock_destroy(&this->shards[i].lock);
+			}
+			free(this->shards);
+			free(this);
+		}
+		*_this = NULL;
+	}
+}
+
+static shard* route(sharded* this, uint64_t key) {
+	return &this->shards[sth_hash(&this->hash, key)];
+}
+
+static void lock_for_reading(sharded* this, shard* target) {
+	if (this->exclusive_reads) {
+		ASSERT(pthread_rwlock_wrlock(&target->lock) == 0);
+	} else {
+		ASSERT(pthread_rwlock_rdlock(&target->lock) == 0);
+	}
+}
+
+static void lock_for_writing(shard* target) {
+	ASSERT(pthread_rwlock_wrlock(&target->lock) == 0);
+}
+
+static void unlock(shard* target) {
+	ASSERT(pthread_rwlock_unlock(&target->lock) == 0);
+}
+
+static bool find(void* _this, uint64_t key, uint64_t *value) {
+	sharded* this = _this;
+	shard* target = route(this, key);
+	lock_for_reading(this, target);
+	const bool found = dict_find(target->dict, key, value);
+	unlock(target);
+	return found;
+}
+
+static bool insert(void* _this, uint64_t key, uint64_t value) {
+	shard* target = route(_this, key);
+	lock_for_writing(target);
+	const bool inserted = dict_insert(target->dict, key, value);
+	unlock(target);
+	return inserted;
+}
+
+static bool delete(void* _this, uint64_t key) {
+	shard* target = route(_this, key);
+	lock_for_writing(target);
+	const bool deleted = dict_delete(target->dict, key);
+	unlock(target);
+	return deleted;
+}
+
+// Every shard holds keys from the whole key space, so the neighbour of
+// a key is the closest of the neighbours within each shard.
+static bool next(void* _this, uint64_t key, uint64_t *next_key) {
+	sharded* this = _this;
+	bool found = false;
+	for (uint64_t i = 0; i < this->shard_count; i++) {
+		shard* target = &this->shards[i];
+		uint64_t candidate;
+		lock_for_reading(this, target);
+		if (dict_next(target->dict, key, &candidate) &&
+				(!found || candidate < *next_key)) {
+			*next_key = candidate;
+			found = true;
+		}
+		unlock(target);
+	}
+	return found;
+}
+
+static bool prev(void* _this, uint64_t key, uint64_t *prev_key) {
+	sharded* this = _this;
+	bool found = false;
+	for (uint64_t i = 0; i < this->shard_count; i++) {
+		shard* target = &this->shards[i];
+		uint64_t candidate;
+		lock_for_reading(this, target);
+		if (dict_prev(target->dict, key, &candidate) &&
+				(!found || candidate > *prev_key)) {
+			*prev_key = candidate;
+			found = true;
+		}
+		unlock(target);
+	}
+	return found;
+}
+
+// Walks all shards in key order, merging the heads of the shards: the
+// closest key of every shard in the direction of the walk. No shard cursor
+// outlives the shard lock, so heads are found by seeking a new cursor
+// under the lock. Stepping only moves the head of the current shard, then
+// picks the closest head. Turning around moves all heads once.
+typedef struct {
+	sharded* dict;
+	// heads[i] is the head of shard i if has_head[i] is set.
+	uint64_t* heads;
+	uint64_t* values;
+	bool* has_head;
+	// Whether the heads are above the current key (or below it).
+	bool forward;
+	// Shard holding the current key.
+	uint64_t shard;
+	uint64_t key;
+	uint64_t value;
+} sharded_cursor;
+
+static void cursor_init(void* _this, void** _cursor) {
+	sharded* this = _this;
+	sharded_cursor* cursor = malloc(sizeof(sharded_cursor));
+	CHECK(cursor, "cannot allocate sharded cursor");
+	cursor->dict = this;
+	cursor->heads = malloc(sizeof(uint64_t) * this->shard_count);
+	cursor->values = malloc(sizeof(uint64_t) * this->shard_count);
+	cursor->has_head = malloc(sizeof(bool) * this->shard_count);
+	CHECK(cursor->heads && cursor->values && cursor->has_head,
+			"cannot allocate sharded cursor");
+	cursor->forward = true;
+	*_cursor = cursor;
+}
+
+static void cursor_destroy(void** _cursor) {
+	sharded_cursor* cursor = *_cursor;
+	free(cursor->heads);
+	free(cursor->values);
+	free(cursor->has_head);
+	free(cursor);
+	*_cursor = NULL;
+}
+
+// Moves to the smallest (or largest) head.
+static bool pick_head(sharded_cursor* cursor) {
+	bool found = false;
+	for (uint64_t i = 0; i < cursor->dict->shard_count; i++) {
+		if (cursor->has_head[i] && (!found || (cursor->forward ?
+				cursor->heads[i] < cursor->key :
+				cursor->heads[i] > cursor->key))) {
+			cursor->key = cursor->heads[i];
+			cursor->value = cursor->values[i];
+			cursor->shard = i;
+			found = true;
+		}
+	}
+	return found;
+}
+
+// Finds the head of shard i: its closest key to `key` in the given
+// direction, which may be `key` itself unless `strict` is set.
+static void find_head(sharded_cursor* cursor, uint64_t i, uint64_t key,
+		bool forward, bool strict) {
+	shard* target = &cursor->dict->shards[i];
+	lock_for_reading(cursor->dict, target);
+	dict_cursor* inner;
+	dict_cursor_init(target->dict, &inner);
+	bool found = dict_cursor_seek(inner, key);
+	if (forward) {
+		if (found && strict && dict_cursor_key(inner) == key) {
+			found = dict_cursor_next(inner);
+		}
+	} else if (!found || dict_cursor_key(inner) > key ||
+			(strict && dict_cursor_key(inner) == key)) {
+		// Past the end, dict_cursor_prev moves to the largest key.
+		found = dict_cursor_prev(inner);
+	}
+	cursor->has_head[i] = found;
+	if (found) {
+		cursor->heads[i] = dict_cursor_key(inner);
+		cursor->values[i] = dict_cursor_value(inner);
+	}
+	dict_cursor_destroy(&inner);
+	unlock(target);
+}
+
+// Finds the heads of all shards and picks the closest one.
+static bool cursor_pick(sharded_cursor* cursor, uint64_t key, bool forward,
+		bool strict) {
+	for (uint64_t i = 0; i < cursor->dict->shard_count; i++) {
+		find_head(cursor, i, key, forward, strict);
+	}
+	cursor->forward = forward;
+	return pick_head(cursor);
+}
+
+static bool cursor_seek(void* cursor, uint64_t key) {
+	return cursor_pick(cursor, key, true, false);
+}
+
+static bool cursor_last(void* cursor) {
+	// DICT_RESERVED_KEY can't be looked up, but it is never stored,
+	// so the largest stored key is at most DICT_RESERVED_KEY - 1.
+	return cursor_pick(cursor, DICT_RESERVED_KEY - 1, false, false);
+}
+
+// Heads behind the current key are the closest keys of their shards on
+// the other side of it, so one step turns every head around.
+static bool cursor_step(sharded_cursor* cursor, bool forward) {
+	if (cursor->forward == forward) {
+		find_head(cursor, cursor->shard, cursor->key, forward, true);
+		return pick_head(cursor);
+	}
+	return cursor_pick(cursor, cursor->key, forward, true);
+}
+
+static bool cursor_next(void* cursor) {
+	return cursor_step(cursor, true);
+}
+
+static bool cursor_prev(void* cursor) {
+	return cursor_step(cursor, false);
+}
+
+static uint64_t cursor_key(void* _cursor) {
+	sharded_cursor* cursor = _cursor;
+	return cursor->key;
+}
+
+static uint64_t cursor_value(void* _cursor) {
+	sharded_cursor* cursor = _cursor;
+	return cursor->value;
+}
+
+static const dict_cursor_api cursor_api = {
+	.init = cursor_init,
+	.destroy = cursor_destroy,
+
+	.seek = cursor_seek,
+	.last = cursor_last,
+	.next = cursor_next,
+	.prev = cursor_prev,
+
+	.key = cursor_key,
+	.value = cursor_value
+};
+
+// Splits the pairs by shard. Every shard gets a sorted subsequence,
+// so shards can use their own bulk loading.
+static void bulk_load(void* _this, const dict_pair* pairs, uint64_t n) {
+	sharded* this = _this;
+	// Pairs of shard i go to scattered[offsets[i]..offsets[i + 1]).
+	uint64_t* offsets = calloc(this->shard_count + 1, sizeof(uint64_t));
+	uint64_t* filled = calloc(this->shard_count, sizeof(uint64_t));
+	dict_pair* scattered = malloc(sizeof(dict_pair) * n);
+	CHECK(offsets && filled && scattered,
+			"cannot allocate %" PRIu64 " pairs", n);
+
+	for (uint64_t i = 0; i < n; i++) {
+		++offsets[sth_hash(&this->hash, pairs[i].key) + 1];
+	}
+	for (uint64_t i = 0; i < this->shard_count; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		const uint64_t target = sth_hash(&this->hash, pairs[i].key);
+		scattered[offsets[target] + filled[target]++] = pairs[i];
+	}
+	for (uint64_t i = 0; i < this->shard_count; i++) {
+		shard* target = &this->shards[i];
+		lock_for_writing(target);
+		dict_bulk_load(target->dict, &scattered[offsets[i]],
+				offsets[i + 1] - offsets[i]);
+		unlock(target);
+	}
+
+	free(scattered);
+	free(filled);
+	free(offsets);
+}
+
+static uint64_t memory_usage(void* _this) {
+	sharded* this = _this;
+	uint64_t bytes = sizeof(sharded) + sizeof(shard) * this->shard_count;
+	for (uint64_t i = 0; i < this->shard_count; i++) {
+		shard* target = &this->shards[i];
+		lock_for_reading(this, target);
+		bytes += dict_memory_usage(target->dict);
+		unlock(target);
+	}
+	return bytes;
+}
+
+static void check(void* _this) {
+	sharded* this = _this;
+	for (uint64_t i = 0; i < this->shard_count; i++) {
+		shard* target = &this->shards[i];
+		lock_for_writing(target);
+		dict_check(target->dict);
+		unlock(target);
+	}
+}
+
+#define SHARDED_ORDERED(x) x
+#define SHARDED_UNORDERED(x) NULL
+
+#define DEFINE_SHARDED(inner, exclusive_reads, ordering) \
+	static void init_##inner(void** _this) { \
+		sharded_init(_this, &dict_##inner, DICT_SHARDED_SHARDS, \
+				exclusive_reads); \
+	} \
+	const dict_api dict_sharded_##inner = { \
+		.init = init_##inner, \
+		.destroy = destroy, \
+		.find = find, \
+		.insert = insert, \
+		.delete = delete, \
+		.next = ordering(next), \
+		.prev = ordering(prev), \
+		.cursor = ordering(&cursor_api), \
+		.bulk_load = bulk_load, \
+		.memory_usage = memory_usage, \
+		.check = check, \
+		.name = "dict_sharded_" #inner \
+	};
+
+DEFINE_SHARDED(btree, false, SHARDED_ORDERED)
+DEFINE_SHARDED(cobt, false, SHARDED_ORDERED)
+DEFINE_SHARDED(htlp, false, SHARDED_UNORDERED)
+DEFINE_SHARDED(htcuckoo, false, SHARDED_UNORDERED)
+DEFINE_SHARDED(splay, true, SHARDED_ORDERED)
@@ -0,0 +1,26 @@
+#ifndef DICT_SHARDED_H
+#define DICT_SHARDED_H
+
+#include "dict/dict.h"
+
+// Thread-safe dictionaries built from DICT_SHARDED_SHARDS instances of an
+// inner dictionary. Keys are routed to shards by simple tabulation hashing
+// and every shard is guarded by its own reader-writer lock.
+//
+// next, prev and cursors merge the answers of all shards. They lock one
+// shard at a time, so they may miss concurrent changes to other shards.
+// Cursors remember the keys and values they found, so they stay safe to
+// use while other threads write.
+// upsert is not provided, because its slot would outlive the lock.
+// Statistics counters of the inner structures (e.g. PMA_COUNTERS) are not
+// synchronized.
+#define DICT_SHARDED_SHARDS 64
+
+extern const dict_api dict_sharded_btree;
+extern const dict_api dict_sharded_cobt;
+extern const dict_api dict_sharded_htlp;
+extern const dict_api dict_sharded_htcuckoo;
+// Splaying changes the tree on every find, so reads lock shards exclusively.
+extern const dict_api dict_sharded_splay;
+
+#endif
@@ -23,10 +23,24 @@ static bool find(void* this, uint64_t key, uint64_t *value) {
 	return splay_find(this, key, value);
 }
 
+static void bulk_load(void* this, const dict_pair* pairs, uint64_t n) {
+	// dict_pair and splay_pair have the same layout.
+	splay_bulk_load(this, (const splay_pair*) pairs, n);
+}
+
+static uint64_t memory_usage(void* this) {
+	return sizeof(splay_tree) + splay_memory_usage(this);
+}
+
 static bool insert(void* this, uint64_t key, uint64_t value) {
 	return splay_insert(this, key, value);
 }
 
+static bool upsert(void* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	return splay_upsert(this, key, default_value, slot);
+}
+
 static bool delete(void* this, uint64_t key) {
 	return splay_delete(this, key);
 }
@@ -39,6 +53,56 @@ static bool prev(void* this, uint64_t key, uint64_t *previous_key) {
 	return splay_previous_key(this, key, previous_key);
 }
 
+static void cursor_init(void* this, void** _cursor) {
+	splay_cursor* cursor = malloc(sizeof(splay_cursor));
+	CHECK(cursor, "cannot allocate memory for splay cursor");
+	splay_cursor_init(cursor, this);
+	*_cursor = cursor;
+}
+
+static void cursor_destroy(void** _cursor) {
+	splay_cursor_destroy(*_cursor);
+	free(*_cursor);
+	*_cursor = NULL;
+}
+
+static bool cursor_seek(void* cursor, uint64_t key) {
+	return splay_cursor_seek(cursor, key);
+}
+
+static bool cursor_last(void* cursor) {
+	return splay_cursor_last(cursor);
+}
+
+static bool cursor_next(void* cursor) {
+	return splay_cursor_next(cursor);
+}
+
+static bool cursor_prev(void* cursor) {
+	return splay_cursor_prev(cursor);
+}
+
+static uint64_t cursor_key(void* cursor) {
+	return splay_cursor_key(cursor);
+}
+
+static uint64_t cursor_value(void* cursor) {
+	return splay_cursor_value(cursor);
+}
+
+static const dict_cursor_api cursor_api = {
+	.init = cursor_init,
+	.destroy = cursor_destroy,
+
+	.seek = cursor_seek,
+	.last = cursor_last,
+	.next = cursor_next,
+	.prev = cursor_prev,
+
+	.key = cursor_key,
+	.value = cursor_value
+};
+
 const dict_api dict_splay = {
 	.init = init,
 	.destroy = destroy,
@@ -46,9 +110,14 @@ const dict_api dict_splay = {
 	.insert = insert,
 	.find = find,
 	.delete = delete,
+	.upsert = upsert,
 
 	.next = next,
 	.prev = prev,
+	.cursor = &cursor_api,
+
+	.bulk_load = bulk_load,
+	.memory_usage = memory_usage,
 
 	.name = "dict_splay"
 };
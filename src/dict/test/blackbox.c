@@ -68,6 +68,22 @@ static void check_equivalence(dict* instance, uint64_t N,
 	}
 }
 
+static void check_batch_equivalence(dict* instance, uint64_t N,
+		uint64_t* keys, uint64_t* values, bool* present) {
+	uint64_t *found_values = calloc(N, sizeof(uint64_t));
+	bool *found = calloc(N, sizeof(bool));
+	dict_find_batch(instance, keys, N, found_values, found);
+	for (uint64_t i = 0; i < N; i++) {
+		CHECK(found[i] == present[i], "batched lookup of %" PRIu64
+				" disagrees with expected presence", keys[i]);
+		if (found[i]) {
+			ASSERT(found_values[i] == values[i]);
+		}
+	}
+	free(found_values);
+	free(found);
+}
+
 static void test_with_maximum_size(const dict_api* api, uint64_t N) {
 	dict* instance;
 	dict_init(&instance, api);
@@ -110,13 +126,137 @@ static void test_with_maximum_size(const dict_api* api, uint64_t N) {
 		}
 
 		check_equivalence(instance, N, keys, values, present);
+		if (iteration % 16 == 0) {
+			check_batch_equivalence(instance, N, keys,
+					values, present);
+		}
+	}
+
+	dict_destroy(&instance);
+
+	free(keys);
+	free(values);
+	free(present);
+}
+
+// Counts occurrences of random keys through upserts, like word counting.
+static void test_upsert(const dict_api* api, uint64_t N) {
+	if (!api->upsert) {
+		return;
+	}
+	dict* instance;
+	dict_init(&instance, api);
+
+	srand(0);
+	uint64_t *keys = calloc(N, sizeof(uint64_t));
+	uint64_t *counts = calloc(N, sizeof(uint64_t));
+	bool *present = calloc(N, sizeof(bool));
+
+	keys[0] = rand() % 1000;
+	for (uint64_t i = 1; i < N; i++) {
+		keys[i] = keys[i - 1] + 1 + rand() % 1000;
+	}
+
+	for (uint64_t iteration = 0; iteration < 20000; iteration++) {
+		const uint64_t i = rand() % N;
+		if (present[i] && rand() % 8 == 0) {
+			delete(instance, keys[i]);
+			present[i] = false;
+			counts[i] = 0;
+		} else {
+			uint64_t* slot;
+			const bool inserted = dict_upsert(instance, keys[i],
+					1, &slot);
+			CHECK(inserted == !present[i], "upsert of %" PRIu64
+					" should%s insert", keys[i],
+					present[i] ? " not" : "");
+			if (!inserted) {
+				ASSERT(*slot == counts[i]);
+				++*slot;
+			}
+			present[i] = true;
+			++counts[i];
+		}
+		if (iteration % 64 == 0) {
+			check_equivalence(instance, N, keys, counts, present);
+		}
+	}
+	check_equivalence(instance, N, keys, counts, present);
+
+	dict_destroy(&instance);
+
+	free(keys);
+	free(counts);
+	free(present);
+}
+
+// Inserts batches of mostly ascending runs of keys, some of them present
+// or repeated, and deletes a few keys between the batches.
+static void test_insert_batch(const dict_api* api, uint64_t N) {
+	dict* instance;
+	dict_init(&instance, api);
+
+	srand(0);
+	uint64_t *keys = calloc(N, sizeof(uint64_t));
+	uint64_t *values = calloc(N, sizeof(uint64_t));
+	bool *present = calloc(N, sizeof(bool));
+	dict_pair *batch = calloc(N, sizeof(dict_pair));
+	uint64_t *batch_indexes = calloc(N, sizeof(uint64_t));
+
+	keys[0] = rand() % 1000;
+	for (uint64_t i = 1; i < N; i++) {
+		keys[i] = keys[i - 1] + 1 + rand() % 1000;
+	}
+
+	for (uint64_t round = 0; round < 64; round++) {
+		const uint64_t size = 1 + rand() % (N / 8);
+		uint64_t i = rand() % N;
+		for (uint64_t j = 0; j < size; j++) {
+			if (rand() % 64 == 0) {
+				// Start a new run.
+				i = rand() % N;
+			}
+			i = (i + 1 + rand() % 4) % N;
+			batch_indexes[j] = i;
+			batch[j] = (dict_pair) {
+				.key = keys[i],
+				.value = rand()
+			};
+		}
+		uint64_t expected = 0;
+		for (uint64_t j = 0; j < size; j++) {
+			if (!present[batch_indexes[j]]) {
+				present[batch_indexes[j]] = true;
+				values[batch_indexes[j]] = batch[j].value;
+				++expected;
+			}
+		}
+		const uint64_t inserted = dict_insert_batch(instance, batch,
+				size);
+		CHECK(inserted == expected, "batch inserted %" PRIu64 " "
+				"pairs, expected %" PRIu64, inserted, expected);
+
+		for (uint64_t j = 0; j < N / 64; j++) {
+			const uint64_t k = rand() % N;
+			if (present[k]) {
+				delete(instance, keys[k]);
+				present[k] = false;
+			}
+		}
+		dict_check(instance);
+		if (round % 8 == 0) {
+			check_equivalence(instance, N, keys, values, present);
+		}
 	}
+	check_equivalence(instance, N, keys, values, present);
 
 	dict_destroy(&instance);
 
 	free(keys);
 	free(values);
 	free(present);
+	free(batch);
+	free(batch_indexes);
 }
 
 static void test_regular(const dict_api* api, uint64_t N) {
@@ -140,6 +280,27 @@ static void test_regular(const dict_api* api, uint64_t N) {
 	dict_destroy(&table);
 }
 
+static void test_memory_usage(const dict_api* api, uint64_t N) {
+	if (!api->memory_usage) {
+		return;
+	}
+	dict* table;
+	dict_init(&table, api);
+	const uint64_t empty_bytes = dict_memory_usage(table);
+	CHECK(empty_bytes > 0, "%s reports no memory usage", api->name);
+
+	for (uint64_t i = 0; i < N; i++) {
+		insert(table, i * 3, i * 7);
+	}
+	// Every pair takes at least its key and value.
+	const uint64_t bytes = dict_memory_usage(table);
+	CHECK(bytes >= N * 2 * sizeof(uint64_t) && bytes >= empty_bytes,
+			"%s reports %" PRIu64 " bytes for %" PRIu64 " pairs",
+			api->name, bytes, N);
+
+	dict_destroy(&table);
+}
+
 static void fails_on_duplicate_insertion(const dict_api* api) {
 	dict* table;
 	dict_init(&table, api);
@@ -171,6 +332,17 @@ void test_dict_blackbox(const dict_api* api) {
 	test_with_maximum_size(api, 100);
 	test_with_maximum_size(api, 200);
 
+	test_upsert(api, 10);
+	test_upsert(api, 100);
+	test_upsert(api, 1000);
+
+	test_insert_batch(api, 100);
+	test_insert_batch(api, 20000);
+
+	test_memory_usage(api, 10);
+	test_memory_usage(api, 1000);
+	test_memory_usage(api, 100000);
+
 	// TODO: more complex deletion tests.
 	// TODO: find accepts NULLs
 }
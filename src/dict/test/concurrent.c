@@ -0,0 +1,90 @@
+#include "dict/test/concurrent.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "dict/test/toycrypt.h"
+#include "log/log.h"
+
+static uint64_t make_key(uint64_t i) {
+	return toycrypt(i, 0x0123456789ABCDEFLL);
+}
+
+static uint64_t make_value(uint64_t i) {
+	return toycrypt(i, 0xFEDCBA9876543210LL);
+}
+
+// Thread t owns pairs i with i % threads == t. It deletes the pairs with
+// odd i / threads after inserting them.
+typedef struct {
+	dict* dict;
+	uint64_t thread;
+	uint64_t threads;
+	uint64_t N;
+} worker_args;
+
+static bool deleted_in_the_end(uint64_t i, uint64_t threads) {
+	return (i / threads) % 2 == 1;
+}
+
+static void* worker(void* _args) {
+	worker_args* args = _args;
+	for (uint64_t i = args->thread; i < args->N; i += args->threads) {
+		CHECK(dict_insert(args->dict, make_key(i), make_value(i)),
+				"cannot insert %" PRIu64, make_key(i));
+	}
+	for (uint64_t i = args->thread; i < args->N; i += args->threads) {
+		uint64_t value;
+		CHECK(dict_find(args->dict, make_key(i), &value) &&
+				value == make_value(i),
+				"lost %" PRIu64, make_key(i));
+		if (deleted_in_the_end(i, args->threads)) {
+			CHECK(dict_delete(args->dict, make_key(i)),
+					"cannot delete %" PRIu64, make_key(i));
+		}
+	}
+	return NULL;
+}
+
+void test_dict_concurrent(const dict_api* api, uint64_t threads, uint64_t N) {
+	log_info("test_dict_concurrent(%s, %" PRIu64 " threads, %" PRIu64 ")",
+			api->name, threads, N);
+	dict* table;
+	dict_init(&table, api);
+
+	pthread_t* handles = malloc(sizeof(pthread_t) * threads);
+	worker_args* args = malloc(sizeof(worker_args) * threads);
+	CHECK(handles && args, "cannot allocate %" PRIu64 " threads", threads);
+	for (uint64_t t = 0; t < threads; t++) {
+		args[t] = (worker_args) {
+			.dict = table,
+			.thread = t,
+			.threads = threads,
+			.N = N
+		};
+		CHECK(pthread_create(&handles[t], NULL, worker, &args[t]) == 0,
+				"cannot start thread %" PRIu64, t);
+	}
+	for (uint64_t t = 0; t < threads; t++) {
+		CHECK(pthread_join(handles[t], NULL) == 0,
+				"cannot join thread %" PRIu64, t);
+	}
+
+	dict_check(table);
+	for (uint64_t i = 0; i < N; i++) {
+		uint64_t value;
+		if (deleted_in_the_end(i, threads)) {
+			CHECK(!dict_find(table, make_key(i), NULL),
+					"%" PRIu64 " not deleted", make_key(i));
+		} else {
+			CHECK(dict_find(table, make_key(i), &value) &&
+					value == make_value(i),
+					"lost %" PRIu64, make_key(i));
+		}
+	}
+
+	free(args);
+	free(handles);
+	dict_destroy(&table);
+}
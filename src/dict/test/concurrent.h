@@ -0,0 +1,10 @@
+#ifndef DICT_TEST_CONCURRENT_H
+#define DICT_TEST_CONCURRENT_H
+
+#include "dict/dict.h"
+
+// Lets several threads insert, find and delete disjoint sets of keys
+// at the same time, then checks the final contents of the dictionary.
+void test_dict_concurrent(const dict_api* api, uint64_t threads, uint64_t N);
+
+#endif
@@ -84,6 +84,83 @@ static void check_equivalence(dict* instance, uint64_t N,
 	}
 }
 
+static void check_cursor_walk(dict* instance, uint64_t N,
+		uint64_t *keys, uint64_t *values, bool *present) {
+	dict_cursor* cursor;
+	dict_cursor_init(instance, &cursor);
+
+	// Forward walk from the beginning.
+	for (uint64_t i = 0; i < N; i++) {
+		if (present[i]) {
+			CHECK(dict_cursor_next(cursor),
+					"cursor ended before %" PRIu64, keys[i]);
+			CHECK(dict_cursor_key(cursor) == keys[i],
+					"cursor at %" PRIu64 ", expected %" PRIu64,
+					dict_cursor_key(cursor), keys[i]);
+			ASSERT(dict_cursor_value(cursor) == values[i]);
+		}
+	}
+	ASSERT(!dict_cursor_next(cursor));
+
+	// Backward walk from past the end.
+	for (uint64_t i = N; i > 0; i--) {
+		if (present[i - 1]) {
+			CHECK(dict_cursor_prev(cursor),
+					"cursor ended before %" PRIu64, keys[i - 1]);
+			CHECK(dict_cursor_key(cursor) == keys[i - 1],
+					"cursor at %" PRIu64 ", expected %" PRIu64,
+					dict_cursor_key(cursor), keys[i - 1]);
+		}
+	}
+	ASSERT(!dict_cursor_prev(cursor));
+
+	// Turns around at every key.
+	for (uint64_t i = 0; i < N; i++) {
+		if (!present[i]) {
+			continue;
+		}
+		uint64_t previous = i, next = i + 1;
+		while (previous > 0 && !present[previous - 1]) {
+			--previous;
+		}
+		while (next < N && !present[next]) {
+			++next;
+		}
+		ASSERT(dict_cursor_seek(cursor, keys[i]));
+		if (previous > 0) {
+			ASSERT(dict_cursor_prev(cursor));
+			ASSERT(dict_cursor_key(cursor) == keys[previous - 1]);
+			ASSERT(dict_cursor_next(cursor));
+			ASSERT(dict_cursor_key(cursor) == keys[i]);
+		}
+		if (next < N) {
+			ASSERT(dict_cursor_next(cursor));
+			ASSERT(dict_cursor_key(cursor) == keys[next]);
+			ASSERT(dict_cursor_prev(cursor));
+			ASSERT(dict_cursor_key(cursor) == keys[i]);
+			ASSERT(dict_cursor_value(cursor) == values[i]);
+		}
+	}
+
+	// Seeks to every key and just after it.
+	for (uint64_t i = 0; i < N; i++) {
+		for (uint64_t delta = 0; delta < 2; delta++) {
+			uint64_t expected = i + delta;
+			while (expected < N && !present[expected]) {
+				++expected;
+			}
+			if (expected < N) {
+				ASSERT(dict_cursor_seek(cursor, keys[i] + delta));
+				ASSERT(dict_cursor_key(cursor) == keys[expected]);
+			} else {
+				ASSERT(!dict_cursor_seek(cursor, keys[i] + delta));
+			}
+		}
+	}
+
+	dict_cursor_destroy(&cursor);
+}
+
 static void test_with_maximum_size(const dict_api* api, uint64_t N) {
 	dict* instance;
 	dict_init(&instance, api);
@@ -132,6 +209,9 @@ static void test_with_maximum_size(const dict_api* api, uint64_t N) {
 
 		dict_check(instance);
 		check_equivalence(instance, N, keys, values, present);
+		if (iteration % 16 == 0) {
+			check_cursor_walk(instance, N, keys, values, present);
+		}
 	}
 
 	dict_destroy(&instance);
@@ -141,8 +221,63 @@ static void test_with_maximum_size(const dict_api* api, uint64_t N) {
 	free(present);
 }
 
+// Bulk loads a random subset of N keys, then toggles every key
+// to check that the loaded structure stays usable.
+static void test_bulk_load(const dict_api* api, uint64_t N) {
+	dict* instance;
+	dict_init(&instance, api);
+
+	uint64_t *keys = calloc(N, sizeof(uint64_t));
+	uint64_t *values = calloc(N, sizeof(uint64_t));
+	bool *present = calloc(N, sizeof(bool));
+	dict_pair *pairs = calloc(N, sizeof(dict_pair));
+
+	uint64_t loaded = 0;
+	for (uint64_t i = 0; i < N; i++) {
+		keys[i] = (i == 0 ? 0 : keys[i - 1]) + 1 + rand() % 1000;
+		values[i] = rand();
+		present[i] = rand() % 2;
+		if (present[i]) {
+			pairs[loaded++] = (dict_pair) {
+				.key = keys[i],
+				.value = values[i]
+			};
+		}
+	}
+	dict_bulk_load(instance, pairs, loaded);
+	dict_check(instance);
+	check_equivalence(instance, N, keys, values, present);
+	check_cursor_walk(instance, N, keys, values, present);
+
+	for (uint64_t j = 0; j < N; j++) {
+		const uint64_t i = (j * 7919) % N;
+		if (present[i]) {
+			ASSERT(dict_delete(instance, keys[i]));
+		} else {
+			ASSERT(dict_insert(instance, keys[i], values[i]));
+		}
+		present[i] = !present[i];
+		dict_check(instance);
+	}
+	check_equivalence(instance, N, keys, values, present);
+
+	dict_destroy(&instance);
+
+	free(keys);
+	free(values);
+	free(present);
+	free(pairs);
+}
+
 void test_ordered_dict_blackbox(const dict_api* api) {
 	test_with_maximum_size(api, 10);
 	test_with_maximum_size(api, 100);
 	test_with_maximum_size(api, 1000);
+
+	srand(0);
+	for (uint64_t N = 1; N < 100; N++) {
+		test_bulk_load(api, N);
+	}
+	test_bulk_load(api, 1000);
+	test_bulk_load(api, 10000);
 }
@@ -0,0 +1,191 @@
+#include "ebr/ebr.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "log/log.h"
+
+#define ACTIVE 1
+#define INITIAL_EPOCH 2
+
+// Retiring threads try to advance the global epoch every this many objects.
+#define ADVANCE_INTERVAL 64
+
+// Thread indices are shared by all domains. Indices of exited threads
+// are reused, so short-lived threads don't run out of slots.
+static pthread_mutex_t indices_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t index_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t index_key;
+static uint64_t free_indices[EBR_MAX_THREADS];
+static uint64_t free_index_count = 0;
+// Indices >= used_indices were never given out, so their slots are unused.
+static _Atomic uint64_t used_indices = 0;
+static _Thread_local uint64_t thread_index = UINT64_MAX;
+
+// Called on thread exit with the index + 1 (keys are only destroyed
+// if they are not NULL).
+static void release_index(void* index_plus_one) {
+	ASSERT(pthread_mutex_lock(&indices_lock) == 0);
+	free_indices[free_index_count++] = (uint64_t) index_plus_one - 1;
+	ASSERT(pthread_mutex_unlock(&indices_lock) == 0);
+}
+
+static void create_index_key(void) {
+	CHECK(pthread_key_create(&index_key, release_index) == 0,
+			"cannot create EBR thread index key");
+}
+
+static uint64_t get_thread_index(void) {
+	if (thread_index != UINT64_MAX) {
+		return thread_index;
+	}
+	ASSERT(pthread_once(&index_key_once, create_index_key) == 0);
+	ASSERT(pthread_mutex_lock(&indices_lock) == 0);
+	if (free_index_count > 0) {
+		thread_index = free_indices[--free_index_count];
+	} else {
+		thread_index = atomic_load(&used_indices);
+		CHECK(thread_index < EBR_MAX_THREADS,
+				"more than %d threads use EBR", EBR_MAX_THREADS);
+		atomic_store(&used_indices, thread_index + 1);
+	}
+	ASSERT(pthread_mutex_unlock(&indices_lock) == 0);
+	ASSERT(pthread_setspecific(index_key,
+				(void*) (thread_index + 1)) == 0);
+	return thread_index;
+}
+
+uint64_t ebr_thread_index(void) {
+	return get_thread_index();
+}
+
+void ebr_init(ebr* this, void (*reclaim)(void* context, void* object),
+		void* context) {
+	atomic_init(&this->epoch, INITIAL_EPOCH);
+	this->reclaim = reclaim;
+	this->context = context;
+	CHECK(posix_memalign((void**) &this->slots, 64,
+			sizeof(ebr_slot) * EBR_MAX_THREADS) == 0,
+			"cannot allocate EBR slots");
+	for (uint64_t i = 0; i < EBR_MAX_THREADS; i++) {
+		ebr_slot* slot = &this->slots[i];
+		atomic_init(&slot->announced, 0);
+		slot->epoch = INITIAL_EPOCH;
+		for (uint8_t j = 0; j < 3; j++) {
+			slot->limbo[j] = (ebr_limbo) {
+				.objects = NULL, .count = 0, .capacity = 0,
+				.epoch = 0
+			};
+		}
+	}
+}
+
+static void reclaim_limbo(ebr* this, ebr_limbo* limbo) {
+	for (uint64_t i = 0; i < limbo->count; i++) {
+		this->reclaim(this->context, limbo->objects[i]);
+	}
+	limbo->count = 0;
+}
+
+void ebr_destroy(ebr* this) {
+	for (uint64_t i = 0; i < EBR_MAX_THREADS; i++) {
+		ebr_slot* slot = &this->slots[i];
+		ASSERT(atomic_load(&slot->announced) == 0);
+		for (uint8_t j = 0; j < 3; j++) {
+			reclaim_limbo(this, &slot->limbo[j]);
+			free(slot->limbo[j].objects);
+		}
+	}
+	free(this->slots);
+	this->slots = NULL;
+}
+
+// Reclaims the objects of every limbo list whose tag is at least 2 below
+// the global epoch.
+static void reclaim_old(ebr* this, ebr_slot* slot, uint64_t global_epoch) {
+	for (uint8_t j = 0; j < 3; j++) {
+		if (slot->limbo[j].epoch + 2 <= global_epoch) {
+			reclaim_limbo(this, &slot->limbo[j]);
+		}
+	}
+}
+
+void ebr_enter(ebr* this) {
+	ebr_slot* slot = &this->slots[get_thread_index()];
+	uint64_t epoch;
+	// If the epoch advanced before the announcement became visible,
+	// objects retired 2 epochs ago may already be reclaimed, so the
+	// announcement must be redone.
+	do {
+		epoch = atomic_load(&this->epoch);
+		atomic_store(&slot->announced, (epoch << 1) | ACTIVE);
+	} while (atomic_load(&this->epoch) != epoch);
+
+	if (epoch != slot->epoch) {
+		reclaim_old(this, slot, epoch);
+		slot->epoch = epoch;
+	}
+}
+
+void ebr_exit(ebr* this) {
+	atomic_store_explicit(&this->slots[get_thread_index()].announced, 0,
+			memory_order_release);
+}
+
+static void try_advance(ebr* this) {
+	uint64_t epoch = atomic_load(&this->epoch);
+	const uint64_t slots = atomic_load(&used_indices);
+	for (uint64_t i = 0; i < slots; i++) {
+		const uint64_t announced = atomic_load(
+				&this->slots[i].announced);
+		if ((announced & ACTIVE) && (announced >> 1) != epoch) {
+			return;
+		}
+	}
+	// Losing the race means someone else advanced it.
+	atomic_compare_exchange_strong(&this->epoch, &epoch, epoch + 1);
+}
+
+static void limbo_push(ebr_limbo* limbo, void* object) {
+	if (limbo->count == limbo->capacity) {
+		limbo->capacity = (limbo->capacity == 0) ?
+				ADVANCE_INTERVAL : limbo->capacity * 2;
+		limbo->objects = realloc(limbo->objects,
+				sizeof(void*) * limbo->capacity);
+		CHECK(limbo->objects, "cannot grow EBR limbo list to %" PRIu64,
+				limbo->capacity);
+	}
+	limbo->objects[limbo->count++] = object;
+}
+
+void ebr_retire(ebr* this, void* object) {
+	ebr_slot* slot = &this->slots[get_thread_index()];
+	ASSERT(atomic_load_explicit(&slot->announced,
+				memory_order_relaxed) & ACTIVE);
+	// The retiring thread may still be one epoch behind. Readers that
+	// entered since can hold the object, so the tag is the global epoch
+	// read after the object was unlinked.
+	const uint64_t epoch = atomic_load(&this->epoch);
+	ebr_limbo* limbo = &slot->limbo[epoch % 3];
+	if (limbo->epoch != epoch) {
+		// Left over from epoch - 3 or earlier, which is old enough.
+		reclaim_limbo(this, limbo);
+		limbo->epoch = epoch;
+	}
+	limbo_push(limbo, object);
+	if (limbo->count % ADVANCE_INTERVAL == 0) {
+		try_advance(this);
+	}
+}
+
+uint64_t ebr_memory_usage(const ebr* this) {
+	uint64_t bytes = sizeof(ebr_slot) * EBR_MAX_THREADS;
+	for (uint64_t i = 0; i < EBR_MAX_THREADS; i++) {
+		for (uint8_t j = 0; j < 3; j++) {
+			bytes += sizeof(void*) * this->slots[i].limbo[j].capacity;
+		}
+	}
+	return bytes;
+}
@@ -0,0 +1,70 @@
+#ifndef EBR_EBR_H
+#define EBR_EBR_H
+
+// Epoch-based reclamation (Fraser, "Practical lock-freedom", 2004).
+//
+// Lock-free readers may still hold pointers to an object after a writer
+// has unlinked it, so the writer retires the object instead of freeing it.
+// Threads announce the global epoch when they enter a critical section.
+// The global epoch only advances once every thread inside a critical
+// section has announced it. Retired objects are tagged with the global
+// epoch e read after they were unlinked, so only threads that entered
+// in epoch e or earlier can hold them. They are reclaimed once the global
+// epoch reaches e + 2, which means all of those threads have left.
+//
+// Entering and leaving a critical section writes only the calling thread's
+// own cache line. Every thread has one slot in each domain, found by
+// a thread index that is reused after the thread exits.
+// Critical sections must not be nested.
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define EBR_MAX_THREADS 256
+
+typedef struct {
+	void** objects;
+	uint64_t count;
+	uint64_t capacity;
+	// Tag of all objects in the list, if there are any.
+	uint64_t epoch;
+} ebr_limbo;
+
+typedef struct {
+	// (announced epoch << 1) | 1 inside a critical section, 0 outside.
+	_Alignas(64) _Atomic uint64_t announced;
+	// Epoch announced last. Objects retired by this thread with tag e
+	// are in limbo[e % 3]. Live tags are within 1 of the announced
+	// epoch, so they never share a list.
+	uint64_t epoch;
+	ebr_limbo limbo[3];
+} ebr_slot;
+
+typedef struct {
+	_Atomic uint64_t epoch;
+	// Called on retired objects once no thread can reach them.
+	void (*reclaim)(void* context, void* object);
+	void* context;
+	ebr_slot* slots;
+} ebr;
+
+void ebr_init(ebr*, void (*reclaim)(void* context, void* object),
+		void* context);
+// Reclaims all retired objects. No thread may be in a critical section.
+void ebr_destroy(ebr*);
+
+void ebr_enter(ebr*);
+void ebr_exit(ebr*);
+// Must be called within a critical section, after the object was unlinked.
+void ebr_retire(ebr*, void* object);
+
+// Index of the calling thread's slot, below EBR_MAX_THREADS. It is the same
+// in all domains, and it only passes to another thread after this one
+// exits. Reclamation runs on the thread that retired the objects, except
+// in ebr_destroy.
+uint64_t ebr_thread_index(void);
+
+// Bytes of the slots and limbo lists. Does not count the ebr struct itself.
+uint64_t ebr_memory_usage(const ebr*);
+
+#endif
@@ -0,0 +1,123 @@
+#include "ebr/test.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdbool.h>
+
+#include "ebr/ebr.h"
+#include "log/log.h"
+
+#define OBJECTS 1000
+// Retiring this many objects in one epoch tries to advance it.
+#define ADVANCING_BATCH 64
+
+static void count_reclaimed(void* context, void* object) {
+	bool* reclaimed = context;
+	const uint64_t i = (bool*) object - reclaimed;
+	ASSERT(!reclaimed[i]);
+	reclaimed[i] = true;
+}
+
+typedef struct {
+	ebr* domain;
+	sem_t entered;
+	sem_t leave;
+} pinning_thread;
+
+static void* pin(void* _this) {
+	pinning_thread* this = _this;
+	ebr_enter(this->domain);
+	ASSERT(sem_post(&this->entered) == 0);
+	ASSERT(sem_wait(&this->leave) == 0);
+	ebr_exit(this->domain);
+	return NULL;
+}
+
+// Retires objects [begin;begin+OBJECTS) one per critical section.
+static void retire_objects(ebr* domain, bool* reclaimed, uint64_t begin) {
+	for (uint64_t i = begin; i < begin + OBJECTS; i++) {
+		ebr_enter(domain);
+		ebr_retire(domain, &reclaimed[i]);
+		ebr_exit(domain);
+	}
+}
+
+static uint64_t count_true(const bool* flags, uint64_t n) {
+	uint64_t count = 0;
+	for (uint64_t i = 0; i < n; i++) {
+		count += flags[i];
+	}
+	return count;
+}
+
+// A thread staying in a critical section holds back all reclamation.
+// Once it leaves, retired objects are reclaimed as the epoch advances.
+static void test_pinned_epoch(void) {
+	static bool reclaimed[2 * OBJECTS];
+	ebr domain;
+	ebr_init(&domain, count_reclaimed, reclaimed);
+
+	pinning_thread pinning = { .domain = &domain };
+	ASSERT(sem_init(&pinning.entered, 0, 0) == 0);
+	ASSERT(sem_init(&pinning.leave, 0, 0) == 0);
+	pthread_t thread;
+	ASSERT(pthread_create(&thread, NULL, pin, &pinning) == 0);
+	ASSERT(sem_wait(&pinning.entered) == 0);
+
+	retire_objects(&domain, reclaimed, 0);
+	ASSERT(count_true(reclaimed, OBJECTS) == 0);
+
+	ASSERT(sem_post(&pinning.leave) == 0);
+	ASSERT(pthread_join(thread, NULL) == 0);
+	retire_objects(&domain, reclaimed, OBJECTS);
+	// Only the last few batches can still wait for reclamation.
+	ASSERT(count_true(reclaimed, OBJECTS) == OBJECTS);
+	ASSERT(count_true(reclaimed + OBJECTS, OBJECTS) >= OBJECTS / 2);
+
+	ebr_destroy(&domain);
+	ASSERT(count_true(reclaimed, 2 * OBJECTS) == 2 * OBJECTS);
+	sem_destroy(&pinning.entered);
+	sem_destroy(&pinning.leave);
+}
+
+// The retiring thread can lag one epoch behind a reader that entered
+// after it. The reader can see the object until the retiring thread unlinks
+// it, so the object has to outlive the reader's critical section.
+static void test_lagging_retire(void) {
+	// One batch advances the epoch, then one object, then 2 more rounds.
+	static bool reclaimed[ADVANCING_BATCH + 1 + 2 * OBJECTS];
+	bool* const lagging = &reclaimed[ADVANCING_BATCH];
+	ebr domain;
+	ebr_init(&domain, count_reclaimed, reclaimed);
+
+	ebr_enter(&domain);
+	for (uint64_t i = 0; i < ADVANCING_BATCH; i++) {
+		ebr_retire(&domain, &reclaimed[i]);
+	}
+	// The epoch advanced, so the reader enters in a newer epoch.
+	pinning_thread reader = { .domain = &domain };
+	ASSERT(sem_init(&reader.entered, 0, 0) == 0);
+	ASSERT(sem_init(&reader.leave, 0, 0) == 0);
+	pthread_t thread;
+	ASSERT(pthread_create(&thread, NULL, pin, &reader) == 0);
+	ASSERT(sem_wait(&reader.entered) == 0);
+	ebr_retire(&domain, lagging);
+	ebr_exit(&domain);
+
+	retire_objects(&domain, reclaimed, ADVANCING_BATCH + 1);
+	ASSERT(!*lagging);
+
+	ASSERT(sem_post(&reader.leave) == 0);
+	ASSERT(pthread_join(thread, NULL) == 0);
+	retire_objects(&domain, reclaimed, ADVANCING_BATCH + 1 + OBJECTS);
+	ASSERT(*lagging);
+
+	ebr_destroy(&domain);
+	sem_destroy(&reader.entered);
+	sem_destroy(&reader.leave);
+}
+
+void test_ebr(void) {
+	test_pinned_epoch();
+	test_lagging_retire();
+}
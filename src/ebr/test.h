@@ -0,0 +1,6 @@
+#ifndef EBR_TEST_H
+#define EBR_TEST_H
+
+void test_ebr(void);
+
+#endif
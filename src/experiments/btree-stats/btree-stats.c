@@ -9,13 +9,9 @@
 #include "log/log.h"
 #include "util/count_of.h"
 
-int main(int argc, char** argv) {
-	(void) argc; (void) argv;
-
+static void print_stats(const dict_api* api, uint64_t N) {
 	dict* tree;
-	dict_init(&tree, &dict_btree);
-
-	const uint64_t N = 1000 * 1000;
+	dict_init(&tree, api);
 
 	for (uint64_t i = 0; i < N; ++i) {
 		const uint64_t key = toycrypt(i, 42);
@@ -23,18 +19,32 @@ int main(int argc, char** argv) {
 		ASSERT(dict_insert(tree, key, value));
 	}
 
-	log_info("inserted %" PRIu64 " keys. internal n keys histogram:", N);
+	log_info("%s: inserted %" PRIu64 " keys. internal n keys histogram:",
+			api->name, N);
 	btree_stats stats = btree_collect_stats(dict_get_implementation(tree));
-	for (uint8_t i = 0; i < 100; ++i) {
+	for (uint16_t i = 0; i <= BTREE_INTERNAL_MAX_KEYS; ++i) {
 		if (stats.internal_n_keys_histogram[i] > 0) {
-			log_info("[%" PRIu8 "] = %" PRIu64, i, stats.internal_n_keys_histogram[i]);
+			log_info("[%" PRIu16 "] = %" PRIu64, i, stats.internal_n_keys_histogram[i]);
 		}
 	}
 
 	const double avg_kvp_depth = ((double) stats.total_kvp_path_length) / stats.total_kvps;
 	log_info("average key-value pair depth: %.2lf", avg_kvp_depth);
 	log_info("effective branching factor: %.2lf", pow(N, 1.0 / avg_kvp_depth));
+	log_info("leaves: %" PRIu64 ", %.1lf%% full", stats.leaf_count,
+			100.0 * stats.total_kvps /
+			(stats.leaf_count * BTREE_LEAF_MAX_KEYS));
+	log_info("memory: %" PRIu64 " bytes", dict_memory_usage(tree));
 
 	dict_destroy(&tree);
+}
+
+// The B*-tree should have fuller nodes and shallower paths.
+int main(int argc, char** argv) {
+	(void) argc; (void) argv;
+
+	const uint64_t N = 1000 * 1000;
+	print_stats(&dict_btree, N);
+	print_stats(&dict_btree_bstar, N);
 	return 0;
 }
@@ -162,16 +162,13 @@ static void load_records(const char* path) {
 
 		const uint64_t position_code = build_position_code(pr.lat_x100,
 				pr.lon_x100);
-		uint64_t value;
-		if (dict_find(id_map, position_code, &value)) {
-			ASSERT(dict_delete(id_map, position_code));
-			++value;
+		// The ID counts earlier records at the same position.
+		uint64_t* last_id;
+		if (dict_upsert(id_map, position_code, 0, &last_id)) {
+			pr.id = 0;
 		} else {
-			value = 0;
+			pr.id = ++*last_id;
 		}
-		ASSERT(dict_insert(id_map, position_code, value));
-
-		pr.id = value;
 		ASSERT(pr.id < (1ULL << 20ULL));
 
 		// log_info("time=%.10s lat_x100=%.5s lon_x100=%.5s wind_dir_deg=%.3s",
@@ -244,23 +241,26 @@ static void query_close_points(dict* map, const int lat, const int lon) {
 	uint64_t total_wind_speed = 0;
 	uint64_t total_sea_level_pressure = 0;
 
-	uint64_t next;
-	uint64_t prev;
+	// Walk away from the key in both directions.
+	dict_cursor *forward, *backward;
+	dict_cursor_init(map, &forward);
+	dict_cursor_init(map, &backward);
 
-	bool got_next = dict_next(map, key, &next);
-	bool got_prev = dict_prev(map, key, &prev);
+	bool got_next = dict_cursor_seek(forward, key + 1);
+	dict_cursor_seek(backward, key);
+	bool got_prev = dict_cursor_prev(backward);
 
 	uint64_t even_odd = 0;
 	while ((wind_speed_count < CLOSE || sea_level_pressure_count < CLOSE) &&
 			(got_prev || got_next)) {
 		uint64_t value;
 		if (got_next && (!got_prev || even_odd % 2 == 0)) {
-			ASSERT(dict_find(map, next, &value));
-			got_next = dict_next(map, next, &next);
+			value = dict_cursor_value(forward);
+			got_next = dict_cursor_next(forward);
 		} else {
 			ASSERT(got_prev);
-			ASSERT(dict_find(map, prev, &value));
-			got_prev = dict_prev(map, prev, &prev);
+			value = dict_cursor_value(backward);
+			got_prev = dict_cursor_prev(backward);
 		}
 		if (wind_speed_count < CLOSE) {
 			collect_wind_speed(value,
@@ -274,6 +274,9 @@ static void query_close_points(dict* map, const int lat, const int lon) {
 		++even_odd;
 	}
 
+	dict_cursor_destroy(&forward);
+	dict_cursor_destroy(&backward);
+
 	if (FLAGS.dump_averages) {
 		const double pressure = (double) total_sea_level_pressure / sea_level_pressure_count;
 		const double speed = (double) total_wind_speed / wind_speed_count;
@@ -0,0 +1,111 @@
+#include "experiments/parallel/flags.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// NOTE: <argp.h> MUST be included after <string.h>.
+// Including <string.h> after <argp.h> creates infinite-loop memcpy/memmove
+// and friends on lab computers for some reason.
+#include <argp.h>
+
+#include "dict/olcbtree.h"
+#include "dict/register.h"
+#include "dict/sharded.h"
+#include "log/log.h"
+#include "util/count_of.h"
+#include "util/human.h"
+
+static int parse_option(int key, char *arg, struct argp_state *state) {
+	(void) state;
+	switch (key) {
+	case 'n':
+		FLAGS.size = parse_human_i(arg);
+		break;
+	case 'o':
+		FLAGS.operations = parse_human_i(arg);
+		break;
+	case 'r':
+		FLAGS.find_percentage = parse_human_i(arg);
+		break;
+	case 'w':
+		FLAGS.insert_percentage = parse_human_i(arg);
+		break;
+	case 'd':
+		FLAGS.delete_percentage = parse_human_i(arg);
+		break;
+	case 't':
+		FLAGS.max_threads = parse_human_i(arg);
+		CHECK(FLAGS.max_threads > 0, "need at least 1 thread");
+		break;
+	case 'a': {
+		dict_api_list_parse(arg, FLAGS.measured_apis,
+				COUNT_OF(FLAGS.measured_apis));
+		break;
+	}
+	case ARGP_KEY_ARG:
+		log_fatal("unexpected argument: %s", arg);
+		break;
+	}
+	return 0;
+}
+
+// Only thread-safe dictionaries can be measured.
+static dict_api const * const DEFAULT_APIS[] = {
+	&dict_sharded_btree,
+	&dict_sharded_cobt,
+	&dict_sharded_htcuckoo,
+	&dict_sharded_htlp,
+	&dict_olcbtree,
+	NULL
+};
+
+static void set_defaults(void) {
+	FLAGS.size = 1024 * 1024;
+	FLAGS.operations = 1024 * 1024;
+	FLAGS.find_percentage = 90;
+	FLAGS.insert_percentage = 5;
+	FLAGS.delete_percentage = 5;
+	FLAGS.max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memcpy(FLAGS.measured_apis, DEFAULT_APIS, sizeof(DEFAULT_APIS));
+}
+
+void parse_flags(int argc, char** argv) {
+	set_defaults();
+
+	struct argp_option options[] = {
+		{
+			.name = 0, .key = 'n', .arg = "SIZE", .flags = 0,
+			.doc = "Start with SIZE pairs", .group = 0
+		}, {
+			.name = 0, .key = 'o', .arg = "OPS", .flags = 0,
+			.doc = "Do OPS operations in every thread", .group = 0
+		}, {
+			.name = 0, .key = 'r', .arg = "PERCENT", .flags = 0,
+			.doc = "Finds make up PERCENT of operations", .group = 0
+		}, {
+			.name = 0, .key = 'w', .arg = "PERCENT", .flags = 0,
+			.doc = "Inserts make up PERCENT of operations", .group = 0
+		}, {
+			.name = 0, .key = 'd', .arg = "PERCENT", .flags = 0,
+			.doc = "Deletes make up PERCENT of operations", .group = 0
+		}, {
+			.name = 0, .key = 't', .arg = "THREADS", .flags = 0,
+			.doc = "Use up to THREADS threads (default: all cores)",
+			.group = 0
+		}, {
+			.name = 0, .key = 'a', .arg = "APIs", .flags = 0,
+			.doc = "Measured APIs (must be thread-safe)", .group = 0
+		}, { 0 }
+	};
+	struct argp argp = {
+		.options = options, .parser = parse_option,
+		.args_doc = NULL, .doc = NULL, .children = NULL,
+		.help_filter = NULL, .argp_domain = NULL
+	};
+	CHECK(!argp_parse(&argp, argc, argv, 0, 0, 0), "argp_parse failed");
+	CHECK(FLAGS.find_percentage + FLAGS.insert_percentage +
+			FLAGS.delete_percentage == 100,
+			"operation percentages must add up to 100");
+}
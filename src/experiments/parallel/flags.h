@@ -0,0 +1,23 @@
+#ifndef EXPERIMENTS_PARALLEL_FLAGS_H
+#define EXPERIMENTS_PARALLEL_FLAGS_H
+
+#include <inttypes.h>
+#include "dict/dict.h"
+
+struct {
+	// Number of pairs in the dictionary before workers start.
+	uint64_t size;
+	// Number of operations done by every worker.
+	uint64_t operations;
+	// Percentages of finds, inserts and deletes. They add up to 100.
+	uint64_t find_percentage;
+	uint64_t insert_percentage;
+	uint64_t delete_percentage;
+	// Worker counts go from 1 to max_threads.
+	uint64_t max_threads;
+	const dict_api* measured_apis[20];
+} FLAGS;
+
+void parse_flags(int argc, char** argv);
+
+#endif
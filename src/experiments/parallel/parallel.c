@@ -0,0 +1,153 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "experiments/parallel/flags.h"
+#include "experiments/performance/experiment.h"
+#include "log/log.h"
+#include "measurement/measurement.h"
+#include "measurement/stopwatch.h"
+#include "rand/rand.h"
+#include "util/consume.h"
+
+// Measures throughput of a shared dictionary under a mix of finds, inserts
+// and deletes done by 1 to FLAGS.max_threads threads pinned to cores.
+//
+// The dictionary starts with keys 0..size-1 and operations pick keys
+// from 0..2*size-1, so about half of finds hit and inserts and deletes
+// keep the size stable.
+
+typedef struct {
+	dict* dict;
+	uint64_t thread;
+	pthread_barrier_t* start;
+
+	measurement_results* results;
+	uint64_t time_nsec;
+} worker;
+
+static void pin_to_core(uint64_t core) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core % sysconf(_SC_NPROCESSORS_ONLN), &set);
+	CHECK(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0,
+			"cannot pin thread to core %" PRIu64, core);
+}
+
+static void* run_worker(void* _this) {
+	worker* this = _this;
+	pin_to_core(this->thread);
+	rand_generator generator = { .state = this->thread + 1 };
+
+	pthread_barrier_wait(this->start);
+	// Counters only count the calling thread.
+	measurement* measurement = measurement_begin();
+	stopwatch watch = stopwatch_start();
+
+	for (uint64_t i = 0; i < FLAGS.operations; i++) {
+		const uint64_t k = rand_next(&generator, 2 * FLAGS.size);
+		const uint64_t choice = rand_next(&generator, 100);
+		if (choice < FLAGS.find_percentage) {
+			uint64_t value;
+			consume_bool(dict_find(this->dict, make_key(k), &value));
+		} else if (choice < FLAGS.find_percentage +
+				FLAGS.insert_percentage) {
+			consume_bool(dict_insert(this->dict, make_key(k),
+						make_value(k)));
+		} else {
+			consume_bool(dict_delete(this->dict, make_key(k)));
+		}
+	}
+
+	this->results = measurement_end(measurement);
+	this->time_nsec = stopwatch_read_ns(watch);
+	return NULL;
+}
+
+static json_t* measure(const dict_api* api, uint64_t threads) {
+	dict* dict = seed_bulk(api, FLAGS.size);
+
+	pthread_barrier_t start;
+	CHECK(pthread_barrier_init(&start, NULL, threads + 1) == 0,
+			"cannot create barrier");
+	worker* workers = calloc(threads, sizeof(worker));
+	pthread_t* handles = calloc(threads, sizeof(pthread_t));
+	CHECK(workers && handles, "cannot allocate %" PRIu64 " workers",
+			threads);
+	for (uint64_t i = 0; i < threads; i++) {
+		workers[i] = (worker) {
+			.dict = dict,
+			.thread = i,
+			.start = &start
+		};
+		CHECK(pthread_create(&handles[i], NULL, run_worker,
+					&workers[i]) == 0,
+				"cannot start worker %" PRIu64, i);
+	}
+
+	pthread_barrier_wait(&start);
+	stopwatch watch = stopwatch_start();
+	for (uint64_t i = 0; i < threads; i++) {
+		CHECK(pthread_join(handles[i], NULL) == 0,
+				"cannot join worker %" PRIu64, i);
+	}
+	const uint64_t time_nsec = stopwatch_read_ns(watch);
+	pthread_barrier_destroy(&start);
+
+	json_t* point = json_object();
+	json_object_set_new(point, "experiment", json_string("parallel"));
+	json_object_set_new(point, "implementation", json_string(api->name));
+	json_object_set_new(point, "size", json_integer(FLAGS.size));
+	json_object_set_new(point, "threads", json_integer(threads));
+	json_object_set_new(point, "find_percentage",
+			json_integer(FLAGS.find_percentage));
+	json_object_set_new(point, "insert_percentage",
+			json_integer(FLAGS.insert_percentage));
+	json_object_set_new(point, "delete_percentage",
+			json_integer(FLAGS.delete_percentage));
+	json_object_set_new(point, "time_ns", json_integer(time_nsec));
+	json_object_set_new(point, "ops_per_sec",
+			json_real(threads * FLAGS.operations * 1e9 / time_nsec));
+
+	json_t* per_thread = json_array();
+	for (uint64_t i = 0; i < threads; i++) {
+		json_t* thread = json_object();
+		json_object_set_new(thread, "thread", json_integer(i));
+		json_object_set_new(thread, "time_ns",
+				json_integer(workers[i].time_nsec));
+		json_object_set_new(thread, "metrics",
+				measurement_results_to_json(workers[i].results));
+		json_array_append_new(per_thread, thread);
+		measurement_results_release(workers[i].results);
+	}
+	json_object_set_new(point, "per_thread", per_thread);
+
+	log_info("%s, %" PRIu64 " threads: %.0f ops/sec", api->name, threads,
+			threads * FLAGS.operations * 1e9 / time_nsec);
+
+	free(handles);
+	free(workers);
+	dict_destroy(&dict);
+	return point;
+}
+
+int main(int argc, char** argv) {
+	parse_flags(argc, argv);
+
+	json_t* json_results = json_array();
+	for (int i = 0; FLAGS.measured_apis[i]; ++i) {
+		for (uint64_t threads = 1; threads <= FLAGS.max_threads;
+				++threads) {
+			json_array_append_new(json_results,
+					measure(FLAGS.measured_apis[i], threads));
+		}
+	}
+
+	CHECK(!json_dump_file(json_results,
+				"experiments/parallel/results.json",
+				JSON_INDENT(2)), "cannot dump results");
+	json_decref(json_results);
+	return 0;
+}
@@ -40,10 +40,8 @@ dict* seed(const dict_api* api, uint64_t size) {
 	return dict;
 }
 
-struct pair { uint64_t key, value; };
-
 static int cmp_pair(const void* _x, const void* _y) {
-	struct pair const *x = _x, *y = _y;
+	dict_pair const *x = _x, *y = _y;
 	if (x->key < y->key) {
 		return -1;
 	} else if (x->key == y->key) {
@@ -53,6 +51,17 @@ static int cmp_pair(const void* _x, const void* _y) {
 	}
 }
 
+static dict_pair* sorted_pairs(uint64_t size) {
+	dict_pair *pairs = calloc(size, sizeof(dict_pair));
+	ASSERT(pairs);
+	for (uint64_t i = 0; i < size; i++) {
+		pairs[i].key = make_key(i);
+		pairs[i].value = make_value(i);
+	}
+	qsort(pairs, size, sizeof(dict_pair), cmp_pair);
+	return pairs;
+}
+
 // Like plain 'seed', but runs faster (since it doesn't insert at random).
 dict* seed_bulk(const dict_api* api, uint64_t size) {
 	dict* dict;
@@ -60,14 +69,7 @@ dict* seed_bulk(const dict_api* api, uint64_t size) {
 
 	if (api == &dict_array) {
 		// Arrays are fast when we insert in sorted order.
-		struct pair *pairs;
-		pairs = calloc(size, sizeof(struct pair));
-		ASSERT(pairs);
-		for (uint64_t i = 0; i < size; i++) {
-			pairs[i].key = make_key(i);
-			pairs[i].value = make_value(i);
-		}
-		qsort(pairs, size, sizeof(struct pair), cmp_pair);
+		dict_pair *pairs = sorted_pairs(size);
 		for (uint64_t i = 0; i < size; i++) {
 			insert(dict, pairs[i].key, pairs[i].value);
 		}
@@ -80,3 +82,16 @@ dict* seed_bulk(const dict_api* api, uint64_t size) {
 	}
 	return dict;
 }
+
+// Builds the dictionary with dict_bulk_load. The result usually has
+// a different shape than one built by inserts (e.g. B-tree nodes are packed
+// to a fixed fill factor), so results are not comparable with 'seed_bulk'.
+dict* seed_bulk_load(const dict_api* api, uint64_t size) {
+	dict* dict;
+	dict_init(&dict, api);
+
+	dict_pair *pairs = sorted_pairs(size);
+	dict_bulk_load(dict, pairs, size);
+	free(pairs);
+	return dict;
+}
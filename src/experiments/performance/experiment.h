@@ -9,6 +9,10 @@
 struct metrics {
 	measurement_results* results;
 	uint64_t time_nsec;
+	// Footprint of the dictionary holding `pairs` pairs at the end of
+	// the measurement, as reported by dict_memory_usage.
+	uint64_t memory_bytes;
+	uint64_t pairs;
 };
 
 uint64_t make_key(uint64_t i);
@@ -16,6 +20,7 @@ uint64_t make_value(uint64_t i);
 
 dict* seed(const dict_api* api, uint64_t size);
 dict* seed_bulk(const dict_api* api, uint64_t size);
+dict* seed_bulk_load(const dict_api* api, uint64_t size);
 
 void check_contains(dict* dict, uint64_t key, uint64_t value);
 void check_not_contains(dict* dict, uint64_t key);
@@ -38,6 +38,9 @@ static int parse_option(int key, char *arg, struct argp_state *state) {
 	case 'b':
 		FLAGS.base = parse_human_d(arg);
 		break;
+	case 'l':
+		FLAGS.bulk_load = true;
+		break;
 	case 'a': {
 		dict_api_list_parse(arg, FLAGS.measured_apis,
 				COUNT_OF(FLAGS.measured_apis));
@@ -66,6 +69,7 @@ static void set_defaults(void) {
 	FLAGS.minimum = 1;
 	FLAGS.maximum = 1024 * 1024 * 1024;
 	FLAGS.base = 1.2;
+	FLAGS.bulk_load = false;
 
 	// TODO: use dict_register_grab, and filter out unreasonably slow APIs
 	// later. It would be interesting to see, for example,
@@ -86,6 +90,10 @@ void parse_flags(int argc, char** argv) {
 		}, {
 			.name = 0, .key = 'b', .arg = "BASE", .flags = 0,
 			.doc = "Multiply by BASE at each iteration", .group = 0
+		}, {
+			.name = "bulk_load", .key = 'l', .arg = 0, .flags = 0,
+			.doc = "Seed read-only experiments by bulk loading",
+			.group = 0
 		}, {
 			.name = 0, .key = 'a', .arg = "APIs", .flags = 0,
 			.doc = "Measured APIs", .group = 0
@@ -2,12 +2,15 @@
 #define EXPERIMENTS_PERFORMANCE_FLAGS_H
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include "dict/dict.h"
 
 struct {
 	uint64_t minimum;
 	uint64_t maximum;
 	double base;
+	// Seed read-only experiments with dict_bulk_load instead of inserts.
+	bool bulk_load;
 	const dict_api* measured_apis[20];
 } FLAGS;
 
@@ -2,34 +2,29 @@
 
 #include <assert.h>
 
+#include "experiments/performance/flags.h"
 #include "log/log.h"
 #include "measurement/stopwatch.h"
 #include "util/consume.h"
 
 static void iterate_ltr(dict* dict) {
-	uint64_t min = 0;
-	bool found = dict_find(dict, min, NULL);
-	if (!found) {
-		found = dict_next(dict, min, &min);
-	}
-
-	uint64_t current_key = min;
+	dict_cursor* cursor;
+	dict_cursor_init(dict, &cursor);
+	bool found = dict_cursor_seek(cursor, 0);
 	while (found) {
-		uint64_t value;
-		ASSERT(dict_find(dict, current_key, &value));
-		consume64(value);
-
-		uint64_t next_key;
-		found = dict_next(dict, current_key, &next_key);
+		const uint64_t current_key = dict_cursor_key(cursor);
+		consume64(dict_cursor_value(cursor));
+		found = dict_cursor_next(cursor);
 		if (found) {
-			ASSERT(next_key > current_key);
+			ASSERT(dict_cursor_key(cursor) > current_key);
 		}
-		current_key = next_key;
 	}
+	dict_cursor_destroy(&cursor);
 }
 
 struct metrics measure_ltr_scan(const dict_api* api, uint64_t size) {
-	dict* table = seed_bulk(api, size);
+	dict* table = FLAGS.bulk_load ? seed_bulk_load(api, size) :
+			seed_bulk(api, size);
 
 	const int K = 3;  // for cache warmup
 	for (int i = 0; i < K; i++) {
@@ -40,10 +35,14 @@ struct metrics measure_ltr_scan(const dict_api* api, uint64_t size) {
 	stopwatch watch_just_find = stopwatch_start();
 	iterate_ltr(table);
 	measurement_results* results_just_find = measurement_end(measurement_just_find);
+	const uint64_t time_just_find_ns = stopwatch_read_ns(watch_just_find);
+	const uint64_t memory_bytes = dict_memory_usage(table);
 	dict_destroy(&table);
 
 	return (struct metrics) {
 		.results = results_just_find,
-		.time_nsec = stopwatch_read_ns(watch_just_find)
+		.time_nsec = time_just_find_ns,
+		.memory_bytes = memory_bytes,
+		.pairs = size
 	};
 }
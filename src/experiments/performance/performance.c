@@ -5,6 +5,7 @@
 #include <math.h>
 
 #include "cobt/cobt.h"
+#include "dict/btree_frozen.h"
 #include "dict/cobt.h"
 #include "dict/dict.h"
 #include "dict/htcuckoo.h"
@@ -29,6 +30,11 @@ static void add_common_keys(json_t* point, const char* experiment,
 	json_object_set_new(point, "metrics",
 			measurement_results_to_json(result.results));
 	json_object_set_new(point, "time_ns", json_integer(result.time_nsec));
+	json_object_set_new(point, "memory_bytes",
+			json_integer(result.memory_bytes));
+	json_object_set_new(point, "bytes_per_pair", (result.pairs > 0) ?
+			json_real((double) result.memory_bytes / result.pairs) :
+			json_null());
 }
 
 int main(int argc, char** argv) {
@@ -106,6 +112,31 @@ int main(int argc, char** argv) {
 			measurement_results_release(result.results);
 		}
 
+		for (int i = 0; FLAGS.measured_apis[i]; ++i) {
+			result = measure_serial(FLAGS.measured_apis[i],
+					SERIAL_JUST_FIND_BATCHED, size, 100);
+
+			json_t* point = json_object();
+			add_common_keys(point, "serial-findonly-batched", size,
+					FLAGS.measured_apis[i], result);
+			json_object_set_new(point, "success_percentage",
+					json_integer(100));
+			json_array_append_new(json_results, point);
+			measurement_results_release(result.results);
+		}
+		for (int i = 0; FLAGS.measured_apis[i]; ++i) {
+			result = measure_serial(FLAGS.measured_apis[i],
+					SERIAL_JUST_FIND_BATCHED, size, 0);
+
+			json_t* point = json_object();
+			add_common_keys(point, "serial-findonly-batched", size,
+					FLAGS.measured_apis[i], result);
+			json_object_set_new(point, "success_percentage",
+					json_integer(0));
+			json_array_append_new(json_results, point);
+			measurement_results_release(result.results);
+		}
+
 		for (int i = 0; FLAGS.measured_apis[i]; ++i) {
 			result = measure_working_set(FLAGS.measured_apis[i], size, 1000);
 
@@ -153,6 +184,13 @@ int main(int argc, char** argv) {
 		}
 
 		for (int i = 0; FLAGS.measured_apis[i]; ++i) {
+			const dict_api* api = FLAGS.measured_apis[i];
+			if (api == &dict_btree_frozen) {
+				// See dict/btree_frozen.h.
+				log_info("%s is for read-only workloads, "
+						"skipping.", api->name);
+				continue;
+			}
 			// TODO: Only measure if there are enough words
 			// in the file.
 			result = measure_word_frequency(FLAGS.measured_apis[i],
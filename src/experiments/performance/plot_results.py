@@ -125,6 +125,13 @@ def plot_all_experiments():
                title=('Serial, find-only, %d%%' % success_rate))
     save_to('serial-findonly-%d.png' % success_rate)
 
+  for success_rate in [100, 0]:
+    new_figure(EXPORT_FIGSIZE_FULLWIDTH)
+    plot_graph(data=load_data(experiment='serial-findonly-batched',
+                              success_percentage=success_rate),
+               title=('Serial, batched find-only, %d%%' % success_rate))
+    save_to('serial-findonly-batched-%d.png' % success_rate)
+
   new_figure(EXPORT_FIGSIZE)
   plot_graph(data=load_data(working_set_size=1000, experiment='workingset'),
              title='Random finds in 1k working set')
@@ -1,9 +1,39 @@
 #include "experiments/performance/serial.h"
 
+#include "experiments/performance/flags.h"
 #include "log/log.h"
 #include "measurement/stopwatch.h"
 #include "rand/rand.h"
 
+#define BATCH_SIZE 64
+
+static void find_batched(dict* table, rand_generator* generator,
+		uint64_t size, uint64_t success_percentage) {
+	uint64_t keys[BATCH_SIZE], values[BATCH_SIZE],
+			expected_values[BATCH_SIZE];
+	bool found[BATCH_SIZE], expected_found[BATCH_SIZE];
+	for (uint64_t done = 0; done < size; done += BATCH_SIZE) {
+		const uint64_t batch = (size - done < BATCH_SIZE) ?
+				(size - done) : BATCH_SIZE;
+		for (uint64_t i = 0; i < batch; i++) {
+			const int k = rand_next(generator, size);
+			expected_found[i] =
+				rand_next(generator, 100) < success_percentage;
+			if (expected_found[i]) {
+				keys[i] = make_key(k);
+				expected_values[i] = make_value(k);
+			} else {
+				keys[i] = make_key(k + size);
+			}
+		}
+		dict_find_batch(table, keys, batch, values, found);
+		for (uint64_t i = 0; i < batch; i++) {
+			ASSERT(found[i] == expected_found[i]);
+			ASSERT(!found[i] || values[i] == expected_values[i]);
+		}
+	}
+}
+
 struct metrics measure_serial(const dict_api* api, serial_mode mode,
 		uint64_t size, uint64_t success_percentage) {
 	measurement* measurement_just_insert = measurement_begin();
@@ -12,9 +42,10 @@ struct metrics measure_serial(const dict_api* api, serial_mode mode,
 	uint64_t time_just_insert_ns;
 
 	dict* table;
-	if (mode == SERIAL_JUST_FIND) {
+	if (mode == SERIAL_JUST_FIND || mode == SERIAL_JUST_FIND_BATCHED) {
 		// Be fast if I don't care about insertion speed.
-		table = seed_bulk(api, size);
+		table = FLAGS.bulk_load ? seed_bulk_load(api, size) :
+				seed_bulk(api, size);
 	} else {
 		table = seed(api, size);
 	}
@@ -26,17 +57,23 @@ struct metrics measure_serial(const dict_api* api, serial_mode mode,
 
 	rand_generator generator = { .state = 0 };
 	// TODO: separate size/reads
-	for (uint64_t i = 0; i < size; i++) {
-		const int k = rand_next(&generator, size);
-		// Let every read be a hit.
-		if (rand_next(&generator, 100) < success_percentage) {
-			check_contains(table, make_key(k), make_value(k));
-		} else {
-			check_not_contains(table, make_key(k + size));
+	if (mode == SERIAL_JUST_FIND_BATCHED) {
+		find_batched(table, &generator, size, success_percentage);
+	} else {
+		for (uint64_t i = 0; i < size; i++) {
+			const int k = rand_next(&generator, size);
+			// Let every read be a hit.
+			if (rand_next(&generator, 100) < success_percentage) {
+				check_contains(table, make_key(k), make_value(k));
+			} else {
+				check_not_contains(table, make_key(k + size));
+			}
 		}
 	}
 
 	measurement_results *results_just_find = measurement_end(measurement_just_find);
+	const uint64_t time_just_find_ns = stopwatch_read_ns(watch_just_find);
+	const uint64_t memory_bytes = dict_memory_usage(table);
 	dict_destroy(&table);
 
 	switch (mode) {
@@ -44,13 +81,18 @@ struct metrics measure_serial(const dict_api* api, serial_mode mode,
 		measurement_results_release(results_just_find);
 		return (struct metrics) {
 			.results = results_just_insert,
-			.time_nsec = time_just_insert_ns
+			.time_nsec = time_just_insert_ns,
+			.memory_bytes = memory_bytes,
+			.pairs = size
 		};
 	case SERIAL_JUST_FIND:
+	case SERIAL_JUST_FIND_BATCHED:
 		measurement_results_release(results_just_insert);
 		return (struct metrics) {
 			.results = results_just_find,
-			.time_nsec = stopwatch_read_ns(watch_just_find)
+			.time_nsec = time_just_find_ns,
+			.memory_bytes = memory_bytes,
+			.pairs = size
 		};
 	default:
 		log_fatal("internal error");
@@ -3,7 +3,12 @@
 
 #include "experiments/performance/experiment.h"
 
-typedef enum { SERIAL_JUST_FIND, SERIAL_JUST_INSERT } serial_mode;
+typedef enum {
+	SERIAL_JUST_FIND,
+	// Like SERIAL_JUST_FIND, but looks keys up through dict_find_batch.
+	SERIAL_JUST_FIND_BATCHED,
+	SERIAL_JUST_INSERT
+} serial_mode;
 struct metrics measure_serial(const dict_api* api, serial_mode mode,
 		uint64_t size, uint64_t success_percentage);
 
@@ -57,17 +57,17 @@ static uint64_t hash_word(const char* word) {
 	return fnv1_hash_str(word);
 }
 
-static void add_word(dict* dict, char* word) {
+// Returns whether the word was seen for the first time.
+static bool add_word(dict* dict, char* word) {
 	normalize(word);
 	uint64_t key = hash_word(word);
 
-	uint64_t count;
-	if (dict_find(dict, key, &count)) {
-		ASSERT(dict_delete(dict, key));
-		ASSERT(dict_insert(dict, key, count + 1));
-	} else {
-		ASSERT(dict_insert(dict, key, 1));
+	uint64_t* count;
+	if (!dict_upsert(dict, key, 1, &count)) {
+		++*count;
+		return false;
 	}
+	return true;
 }
 
 static void report_count(dict* dict, const char* word) {
@@ -92,7 +92,7 @@ void deinit_word_frequency(void) {
 
 struct metrics measure_word_frequency(const dict_api* api, uint64_t size) {
 	const char* delimiters = " ,.?!*<>()[]:;'\n";
-	uint64_t words = 0;
+	uint64_t words = 0, distinct_words = 0;
 	char* content_copy = strdup(content);
 	char* ptr = strtok(content_copy, delimiters);
 
@@ -103,7 +103,9 @@ struct metrics measure_word_frequency(const dict_api* api, uint64_t size) {
 	stopwatch watch = stopwatch_start();
 
 	while (ptr && words < size) {
-		add_word(dict, ptr);
+		if (add_word(dict, ptr)) {
+			++distinct_words;
+		}
 		ptr = strtok(NULL, delimiters);
 		++words;
 	}
@@ -122,11 +124,14 @@ struct metrics measure_word_frequency(const dict_api* api, uint64_t size) {
 		report_count(dict, "world");
 	}
 
+	const uint64_t memory_bytes = dict_memory_usage(dict);
 	dict_destroy(&dict);
 	free(content_copy);
 
 	return (struct metrics) {
 		.results = results,
-		.time_nsec = time_nsec
+		.time_nsec = time_nsec,
+		.memory_bytes = memory_bytes,
+		.pairs = distinct_words
 	};
 }
@@ -1,5 +1,6 @@
 #include "experiments/performance/working_set.h"
 
+#include "experiments/performance/flags.h"
 #include "measurement/measurement.h"
 #include "measurement/stopwatch.h"
 #include "rand/rand.h"
@@ -9,7 +10,8 @@ struct metrics measure_working_set(const dict_api* api, uint64_t size,
 	const uint64_t used_ws_size =
 			working_set_size < size ? working_set_size : size;
 
-	dict* table = seed_bulk(api, size);
+	dict* table = FLAGS.bulk_load ? seed_bulk_load(api, size) :
+			seed_bulk(api, size);
 
 	measurement* measurement_just_find = measurement_begin();
 	stopwatch watch_just_find = stopwatch_start();
@@ -22,10 +24,14 @@ struct metrics measure_working_set(const dict_api* api, uint64_t size,
 
 	measurement_results* results_just_find =
 			measurement_end(measurement_just_find);
+	const uint64_t time_just_find_ns = stopwatch_read_ns(watch_just_find);
+	const uint64_t memory_bytes = dict_memory_usage(table);
 	dict_destroy(&table);
 
 	return (struct metrics) {
 		.results = results_just_find,
-		.time_nsec = stopwatch_read_ns(watch_just_find)
+		.time_nsec = time_just_find_ns,
+		.memory_bytes = memory_bytes,
+		.pairs = size
 	};
 }
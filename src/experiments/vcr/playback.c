@@ -118,10 +118,15 @@ struct metrics measure_recording(const dict_api* api, recording* record,
 	measurement* measurement = measurement_begin();
 	stopwatch watch = stopwatch_start();
 	rand_generator rand = { .state = 0 };
+	uint64_t pairs = 0;
+	// The last dictionary is kept, so that its memory usage is computed
+	// outside the measurement.
+	dict* dict = NULL;
 
 	for (int repeat = 0; repeat < repetitions; ++repeat) {
-		dict* dict;
+		dict_destroy(&dict);
 		dict_init(&dict, api);
+		pairs = 0;
 
 		for (uint64_t i = 0; i < record->length; ++i) {
 			const recorded_operation operation = record->operations[i];
@@ -138,7 +143,9 @@ struct metrics measure_recording(const dict_api* api, recording* record,
 				// Note: dict_insert may fail (since
 				// the recording may have been cleaned).
 				value = rand_next(&rand, UINT64_MAX);
-				if (!dict_insert(dict, operation.key, value)) {
+				if (dict_insert(dict, operation.key, value)) {
+					++pairs;
+				} else {
 					log_verbose(1, "insert failure");
 				}
 				break;
@@ -146,21 +153,28 @@ struct metrics measure_recording(const dict_api* api, recording* record,
 			case DELETE: {
 				// Note: dict_delete may fail (since
 				// the recording may have been cleaned).
-				if (!dict_delete(dict, operation.key)) {
+				if (dict_delete(dict, operation.key)) {
+					--pairs;
+				} else {
 					log_verbose(1, "delete failure");
 				}
 				break;
 			}
 			}
 		}
-
-		dict_destroy(&dict);
 	}
 
 	measurement_results* results = measurement_end(measurement);
 	uint64_t time_nsec = stopwatch_read_ns(watch);
+	uint64_t memory_bytes = 0;
+	if (dict != NULL) {
+		memory_bytes = dict_memory_usage(dict);
+		dict_destroy(&dict);
+	}
 	return (struct metrics) {
 		.results = results,
-		.time_nsec = time_nsec
+		.time_nsec = time_nsec,
+		.memory_bytes = memory_bytes,
+		.pairs = pairs
 	};
 }
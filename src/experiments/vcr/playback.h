@@ -10,6 +10,10 @@
 struct metrics {
 	measurement_results* results;
 	uint64_t time_nsec;
+	// Footprint of the dictionary holding `pairs` pairs at the end of
+	// the measurement, as reported by dict_memory_usage.
+	uint64_t memory_bytes;
+	uint64_t pairs;
 };
 
 typedef enum { FIND, INSERT, DELETE } operation_type;
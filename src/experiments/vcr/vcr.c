@@ -28,6 +28,13 @@ int main(int argc, char** argv) {
 				measurement_results_to_json(result.results));
 		json_object_set_new(point, "time_ns",
 				json_integer(result.time_nsec));
+		json_object_set_new(point, "memory_bytes",
+				json_integer(result.memory_bytes));
+		json_object_set_new(point, "bytes_per_pair",
+				(result.pairs > 0) ?
+				json_real((double) result.memory_bytes /
+						result.pairs) :
+				json_null());
 		json_array_append_new(json_results, point);
 		measurement_results_release(result.results);
 
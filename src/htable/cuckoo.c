@@ -169,6 +169,11 @@ void htcuckoo_destroy(htcuckoo* this) {
 	destroy_half(&this->right);
 }
 
+uint64_t htcuckoo_memory_usage(const htcuckoo* this) {
+	// Both halves hold keys, values and backptr.
+	return 2 * 3 * sizeof(uint64_t) * this->half_capacity;
+}
+
 typedef enum { LEFT, RIGHT } half_t;
 
 static void swap_halves(cuckoo_half** x, cuckoo_half** y) {
@@ -452,6 +457,70 @@ bool htcuckoo_find(htcuckoo* this, uint64_t key, uint64_t *value) {
 	return false;
 }
 
+static uint64_t* find_slot(htcuckoo* this, uint64_t key) {
+	const uint64_t hash_l = half_hash(&this->left, key),
+			hash_r = half_hash(&this->right, key);
+	if (this->left.keys[hash_l] == key) {
+		return &this->left.values[hash_l];
+	}
+	if (this->right.keys[hash_r] == key) {
+		return &this->right.values[hash_r];
+	}
+	return NULL;
+}
+
+bool htcuckoo_upsert(htcuckoo* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	*slot = find_slot(this, key);
+	if (*slot != NULL) {
+		return false;
+	}
+	// Inserting may move other keys around or rehash everything,
+	// so look for the slot only afterwards.
+	ASSERT(htcuckoo_insert(this, key, default_value));
+	*slot = find_slot(this, key);
+	return true;
+}
+
+#define FIND_BATCH_GROUP 16
+
+void htcuckoo_find_batch(htcuckoo* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	uint64_t hashes_l[FIND_BATCH_GROUP], hashes_r[FIND_BATCH_GROUP];
+	for (uint64_t begin = 0; begin < n; begin += FIND_BATCH_GROUP) {
+		const uint64_t group = (n - begin < FIND_BATCH_GROUP) ?
+				(n - begin) : FIND_BATCH_GROUP;
+		// Both candidate slots of every key in the group are fetched
+		// in parallel.
+		for (uint64_t i = 0; i < group; i++) {
+			hashes_l[i] = half_hash(&this->left, keys[begin + i]);
+			hashes_r[i] = half_hash(&this->right, keys[begin + i]);
+			__builtin_prefetch(&this->left.keys[hashes_l[i]]);
+			__builtin_prefetch(&this->right.keys[hashes_r[i]]);
+			if (values) {
+				__builtin_prefetch(&this->left.values[hashes_l[i]]);
+				__builtin_prefetch(&this->right.values[hashes_r[i]]);
+			}
+		}
+		for (uint64_t i = 0; i < group; i++) {
+			const uint64_t key = keys[begin + i];
+			if (this->left.keys[hashes_l[i]] == key) {
+				found[begin + i] = true;
+				if (values) {
+					values[begin + i] = this->left.values[hashes_l[i]];
+				}
+			} else if (this->right.keys[hashes_r[i]] == key) {
+				found[begin + i] = true;
+				if (values) {
+					values[begin + i] = this->right.values[hashes_r[i]];
+				}
+			} else {
+				found[begin + i] = false;
+			}
+		}
+	}
+}
+
 bool htcuckoo_insert(htcuckoo* this, uint64_t key, uint64_t value) {
 	// log_info("insert(%" PRIu64 "=%" PRIu64 ")", key, value);
 	if (htcuckoo_find(this, key, NULL)) {
@@ -40,8 +40,18 @@ typedef struct {
 
 void htcuckoo_init(htcuckoo* this, rand_generator rand);
 void htcuckoo_destroy(htcuckoo* this);
+// Bytes allocated for keys, values and backptr of both halves.
+// Does not count the htcuckoo struct itself.
+uint64_t htcuckoo_memory_usage(const htcuckoo* this);
 bool htcuckoo_delete(htcuckoo* this, uint64_t key);
 bool htcuckoo_find(htcuckoo* this, uint64_t key, uint64_t *value);
+void htcuckoo_find_batch(htcuckoo* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found);
 bool htcuckoo_insert(htcuckoo* this, uint64_t key, uint64_t value);
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the table is next modified.
+bool htcuckoo_upsert(htcuckoo* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
 
 #endif
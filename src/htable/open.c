@@ -177,16 +177,11 @@ static int8_t resize_to_fit(htlp* this, uint64_t to_fit) {
 	return 0;
 }
 
+// key_hash: Must be hash(this, key).
 // key_slot: Required.
 // last_slot_with_hash: Optional.
-static bool scan(htlp* this, uint64_t key,
+static bool scan_hashed(htlp* this, uint64_t key, uint64_t key_hash,
 		uint64_t* key_slot, uint64_t* last_slot_with_hash) {
-	// Special case for empty hash tables.
-	if (this->capacity == 0) {
-		return false;
-	}
-
-	const uint64_t key_hash = hash(this, key);
 	uint64_t index = key_hash;
 	const uint64_t keys_with_hash = this->keys_with_hash[index];
 
@@ -225,6 +220,16 @@ static bool scan(htlp* this, uint64_t key,
 	return found;
 }
 
+static bool scan(htlp* this, uint64_t key,
+		uint64_t* key_slot, uint64_t* last_slot_with_hash) {
+	// Special case for empty hash tables.
+	if (this->capacity == 0) {
+		return false;
+	}
+	return scan_hashed(this, key, hash(this, key),
+			key_slot, last_slot_with_hash);
+}
+
 bool htlp_delete(htlp* this, uint64_t key) {
 	log_verbose(1, "htlp_delete(%" PRIx64 ")", key);
 	if (this->pair_count == 0) {
@@ -269,6 +274,39 @@ bool htlp_find(htlp* this, uint64_t key, uint64_t *value) {
 	}
 }
 
+#define FIND_BATCH_GROUP 16
+
+void htlp_find_batch(htlp* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found) {
+	if (this->capacity == 0) {
+		for (uint64_t i = 0; i < n; i++) {
+			found[i] = false;
+		}
+		return;
+	}
+	uint64_t hashes[FIND_BATCH_GROUP];
+	for (uint64_t begin = 0; begin < n; begin += FIND_BATCH_GROUP) {
+		const uint64_t group = (n - begin < FIND_BATCH_GROUP) ?
+				(n - begin) : FIND_BATCH_GROUP;
+		// Compute all hashes first, so that the chains of the whole
+		// group are fetched in parallel.
+		for (uint64_t i = 0; i < group; i++) {
+			hashes[i] = hash(this, keys[begin + i]);
+			__builtin_prefetch(&this->keys_with_hash[hashes[i]]);
+			__builtin_prefetch(&this->keys[hashes[i]]);
+			__builtin_prefetch(&this->values[hashes[i]]);
+		}
+		for (uint64_t i = 0; i < group; i++) {
+			uint64_t found_at;
+			found[begin + i] = scan_hashed(this, keys[begin + i],
+					hashes[i], &found_at, NULL);
+			if (found[begin + i] && values) {
+				values[begin + i] = this->values[found_at];
+			}
+		}
+	}
+}
+
 bool htlp_insert(htlp* this, uint64_t key, uint64_t value) {
 	if (resize_to_fit(this, this->pair_count + 1)) {
 		log_error("failed to resize to fit one more element");
@@ -277,6 +315,21 @@ bool htlp_insert(htlp* this, uint64_t key, uint64_t value) {
 	return insert_noresize(this, key, value);
 }
 
+bool htlp_upsert(htlp* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	uint64_t found_at;
+	if (scan(this, key, &found_at, NULL)) {
+		*slot = &this->values[found_at];
+		return false;
+	}
+	// The insertion may resize the table, so look for the slot after it.
+	CHECK(htlp_insert(this, key, default_value),
+			"failed to insert %" PRIu64, key);
+	ASSERT(scan(this, key, &found_at, NULL));
+	*slot = &this->values[found_at];
+	return true;
+}
+
 void htlp_init(htlp* this, rand_generator rand) {
 	*this = (htlp) {
 		.capacity = 0,
@@ -290,6 +343,17 @@ void htlp_init(htlp* this, rand_generator rand) {
 	};
 }
 
+// Arrays are allocated aligned to 64 bytes.
+static uint64_t aligned_size(uint64_t bytes) {
+	return (bytes + 63) / 64 * 64;
+}
+
+uint64_t htlp_memory_usage(const htlp* this) {
+	return aligned_size(sizeof(uint64_t) * this->capacity) +
+			aligned_size(sizeof(uint64_t) * this->capacity) +
+			aligned_size(sizeof(uint32_t) * this->capacity);
+}
+
 void htlp_destroy(htlp* this) {
 	if (this->keys) {
 		free(this->keys);
@@ -27,8 +27,18 @@ typedef struct {
 
 void htlp_init(htlp* this, rand_generator rand);
 void htlp_destroy(htlp* this);
+// Bytes allocated for keys, values and keys_with_hash, including alignment.
+// Does not count the htlp struct itself.
+uint64_t htlp_memory_usage(const htlp* this);
 bool htlp_delete(htlp* this, uint64_t key);
 bool htlp_find(htlp* this, uint64_t key, uint64_t *value);
+void htlp_find_batch(htlp* this, const uint64_t* keys, uint64_t n,
+		uint64_t* values, bool* found);
 bool htlp_insert(htlp* this, uint64_t key, uint64_t value);
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the table is next modified.
+bool htlp_upsert(htlp* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
 
 #endif
@@ -14,6 +14,8 @@
 	#define kforest_tree_delete btree_delete
 	#define kforest_tree_insert btree_insert
 	#define kforest_tree_find btree_find
+	#define kforest_tree_upsert btree_upsert
+	#define kforest_tree_memory_usage btree_memory_usage
 
 	// This dropping algorithm would be probably biased in general, but
 	// since we are only dropping from full trees, it should be more or
@@ -34,7 +36,7 @@
 			--node.levels_above_leaves;
 		}
 
-		const uint8_t leaf_keys = get_n_leaf_keys(node.persisted);
+		const uint16_t leaf_keys = get_n_leaf_keys(node.persisted);
 		assert(leaf_keys > 0);
 		uint64_t key_index = rand_next(generator, leaf_keys);
 		*key = node.persisted->leaf.keys[key_index];
@@ -46,29 +48,25 @@
 	#define kforest_tree_delete cob_delete
 	#define kforest_tree_insert cob_insert
 	#define kforest_tree_find cob_find
+	#define kforest_tree_upsert cob_upsert
+	#define kforest_tree_memory_usage cob_memory_usage
 
-	// Point to random spot in the backing PMA, then find the next occupied
+	// Point to random spot in the backing PMAs, then find the next occupied
 	// piece. Select a random key from that piece.
 	// The selected key should be more or less random.
 	static void get_random_pair(rand_generator* generator, cob* tree,
 			uint64_t *key, uint64_t *value) {
-		uint64_t piece_pick = rand_next(generator, tree->file.capacity);
-		uint64_t i;
-		for (i = 0; i < tree->file.capacity; ++i) {
-			if (tree->file.occupied[(piece_pick + i) %
-					tree->file.capacity]) {
-				break;
-			}
-		}
-		CHECK(i < tree->file.capacity, "random pick from empty cobt");
-		piece_pick = (piece_pick + i) % tree->file.capacity;
-		cob_piece_item* piece = pma_get_value(&tree->file, piece_pick);
-
-		uint8_t idx = rand_next(generator, tree->piece);
-		for (i = 0; i < tree->piece; ++i) {
-			if (piece[(idx + i) % tree->piece].key != COB_EMPTY) {
-				*key = piece[(idx + i) % tree->piece].key;
-				*value = piece[(idx + i) % tree->piece].value;
+		uint8_t piece_size;
+		const cob_piece_item* piece = cob_piece_near(tree,
+				rand_next(generator, cob_slot_count(tree)),
+				&piece_size);
+		CHECK(piece != NULL, "random pick from empty cobt");
+
+		uint8_t idx = rand_next(generator, piece_size);
+		for (uint8_t i = 0; i < piece_size; ++i) {
+			if (piece[(idx + i) % piece_size].key != COB_EMPTY) {
+				*key = piece[(idx + i) % piece_size].key;
+				*value = piece[(idx + i) % piece_size].value;
 				return;
 			}
 		}
@@ -185,6 +183,15 @@ void kforest_destroy(kforest* this) {
 	free(this->tree_sizes);
 }
 
+uint64_t kforest_memory_usage(kforest* this) {
+	uint64_t bytes = this->tree_capacity *
+			(sizeof(kforest_tree) + sizeof(uint64_t));
+	for (uint64_t i = 0; i < this->tree_capacity; ++i) {
+		bytes += kforest_tree_memory_usage(&this->trees[i]);
+	}
+	return bytes;
+}
+
 static void drop_random_pair(rand_generator* generator, kforest_tree* tree,
 		uint64_t *dropped_key, uint64_t *dropped_value) {
 	get_random_pair(generator, tree, dropped_key, dropped_value);
@@ -268,6 +275,21 @@ bool kforest_insert(kforest* this, uint64_t key, uint64_t value) {
 	return true;
 }
 
+bool kforest_upsert(kforest* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	log_verbose(1, "kforest_upsert(%" PRIu64 ")", key);
+
+	// Finding the key promotes it to tree 0, which is tiny.
+	const bool found = kforest_find(this, key, NULL);
+	if (!found) {
+		make_space(this);
+		++this->tree_sizes[0];
+	}
+	ASSERT(kforest_tree_upsert(&this->trees[0], key, default_value,
+				slot) == !found);
+	return !found;
+}
+
 bool kforest_delete(kforest* this, uint64_t key) {
 	log_verbose(1, "kforest_delete(%" PRIu64 ")", key);
 
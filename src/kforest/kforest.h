@@ -10,7 +10,7 @@
 	#include "btree/btree.h"
 	typedef btree kforest_tree;
 	// TODO: Can we genericize this?
-	#define KFOREST_K LEAF_MAX_KEYS
+	#define KFOREST_K BTREE_LEAF_MAX_KEYS
 #elif defined(KFOREST_COBT)
 	#include "cobt/cobt.h"
 	typedef cob kforest_tree;
@@ -42,7 +42,15 @@ void kforest_destroy(kforest*);
 bool kforest_find(kforest*, uint64_t key, uint64_t *value);
 bool kforest_insert(kforest*, uint64_t key, uint64_t value);
 bool kforest_delete(kforest*, uint64_t key);
-
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the forest is next accessed.
+bool kforest_upsert(kforest*, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
+
+// Bytes allocated for the trees and their sizes.
+// Does not count the kforest struct itself.
+uint64_t kforest_memory_usage(kforest*);
 void kforest_check_invariants(kforest*);
 
 #endif
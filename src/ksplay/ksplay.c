@@ -154,6 +154,41 @@ void ksplay_init(ksplay* this) {
 	this->size = 0;
 }
 
+// Builds a node with key_count keys, whose subtrees contain `units` full
+// nodes (with K-1 keys) in total. Subtrees get equal shares of the nodes.
+static node* build_balanced(const ksplay_pair* pairs, uint8_t key_count,
+		uint64_t units) {
+	node* built = malloc(sizeof(node));
+	CHECK(built, "cannot allocate ksplay node");
+	node_init(built);
+	const uint8_t child_count = key_count + 1;
+	for (uint8_t i = 0; i < child_count; ++i) {
+		const uint64_t child_units = units / child_count +
+				((i < units % child_count) ? 1 : 0);
+		built->children[i] = (child_units == 0) ? NULL :
+			build_balanced(pairs, KSPLAY_K - 1, child_units - 1);
+		pairs += child_units * (KSPLAY_K - 1);
+		if (i < key_count) {
+			built->pairs[i] = *pairs;
+			++pairs;
+		}
+	}
+	return built;
+}
+
+void ksplay_bulk_load(ksplay* this, const ksplay_pair* pairs, uint64_t n) {
+	CHECK(this->size == 0, "bulk loading into non-empty ksplay");
+	if (n == 0) {
+		return;
+	}
+	// Non-root nodes must have exactly K-1 keys. The root takes the rest.
+	const uint8_t root_keys = (n - 1) % (KSPLAY_K - 1) + 1;
+	free(this->root);
+	this->root = build_balanced(pairs, root_keys,
+			(n - root_keys) / (KSPLAY_K - 1));
+	this->size = n;
+}
+
 // TODO: refactor destroying
 typedef struct {
 	node* x;
@@ -199,6 +234,35 @@ void ksplay_destroy(ksplay* this) {
 	free(stack);
 }
 
+uint64_t ksplay_memory_usage(ksplay* this) {
+	// K-splay trees may be deep, so walk them with an explicit stack.
+	uint64_t nodes = 0;
+	uint64_t size = 0;
+	uint64_t cap = 8;
+	node** stack = malloc(sizeof(node*) * cap);
+	CHECK(stack, "failed to alloc %" PRIu64 " stack items", cap);
+	stack[size++] = this->root;
+
+	while (size > 0) {
+		node* top = stack[--size];
+		++nodes;
+		for (uint8_t i = 0; i <= node_key_count(top); ++i) {
+			if (top->children[i] == NULL) {
+				continue;
+			}
+			if (size == cap) {
+				cap *= 2;
+				stack = realloc(stack, sizeof(node*) * cap);
+				CHECK(stack, "failed to alloc %" PRIu64 " "
+						"stack items", cap);
+			}
+			stack[size++] = top->children[i];
+		}
+	}
+	free(stack);
+	return nodes * sizeof(node);
+}
+
 #ifdef KSPLAY_STACK_STATIC
 static ksplay_node* GLOBAL_NODE_BUFFER[1024];
 #endif
@@ -847,6 +911,41 @@ removed:
 	return true;
 }
 
+// Plain descent without K-splaying.
+static uint64_t* find_slot(ksplay* this, uint64_t key) {
+	node* current = this->root;
+	while (current != NULL) {
+		const uint8_t key_count = node_key_count(current);
+		uint8_t i;
+		for (i = 0; i < key_count; ++i) {
+			if (current->pairs[i].key == key) {
+				return &current->pairs[i].value;
+			}
+			if (current->pairs[i].key > key) {
+				break;
+			}
+		}
+		current = current->children[i];
+	}
+	return NULL;
+}
+
+bool ksplay_upsert(ksplay* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot) {
+	ksplay_node_buffer stack = ksplay_walk_to(this, key);
+	node* target = stack.nodes[stack.count - 1];
+	const bool inserted = node_insert(target, key, default_value);
+	if (inserted) {
+		++this->size;
+	}
+	ksplay_ksplay(this, &stack);
+	// K-splaying moves pairs between nodes, but leaves the key
+	// close to the root.
+	*slot = find_slot(this, key);
+	ASSERT(*slot != NULL);
+	return inserted;
+}
+
 bool ksplay_find(ksplay* this, uint64_t key, uint64_t *value) {
 	IF_LOG_VERBOSE(1) {
 		log_info("find(%" PRIu64 ")", key);
@@ -919,6 +1018,141 @@ bool ksplay_previous_key(ksplay* this, uint64_t key, uint64_t *previous_key) {
 	return found;
 }
 
+static void cursor_push(ksplay_cursor* cursor, node* pushed,
+		uint8_t index) {
+	if (cursor->depth == cursor->capacity) {
+		cursor->capacity = cursor->capacity ? cursor->capacity * 2 : 32;
+		cursor->path = realloc(cursor->path,
+				sizeof(ksplay_cursor_frame) * cursor->capacity);
+		CHECK(cursor->path, "failed to grow cursor path");
+	}
+	cursor->path[cursor->depth++] = (ksplay_cursor_frame) {
+		.current = pushed,
+		.index = index
+	};
+}
+
+static ksplay_cursor_frame* cursor_top(const ksplay_cursor* cursor) {
+	return &cursor->path[cursor->depth - 1];
+}
+
+static void cursor_descend_leftmost(ksplay_cursor* cursor, node* current) {
+	for (; current != NULL; current = current->children[0]) {
+		cursor_push(cursor, current, 0);
+	}
+}
+
+static void cursor_descend_rightmost(ksplay_cursor* cursor, node* current) {
+	while (true) {
+		const uint8_t key_count = node_key_count(current);
+		if (current->children[key_count] == NULL) {
+			cursor_push(cursor, current, key_count - 1);
+			return;
+		}
+		cursor_push(cursor, current, key_count);
+		current = current->children[key_count];
+	}
+}
+
+// Pops frames until some frame points at a key. Used after running off
+// the right end of a subtree.
+static bool cursor_settle_forward(ksplay_cursor* cursor) {
+	while (cursor->depth > 0) {
+		ksplay_cursor_frame* top = cursor_top(cursor);
+		if (top->index < node_key_count(top->current)) {
+			return true;
+		}
+		--cursor->depth;
+	}
+	return false;
+}
+
+// Pops frames until some frame has a key left of the child we came from.
+static bool cursor_settle_backward(ksplay_cursor* cursor) {
+	while (cursor->depth > 0) {
+		ksplay_cursor_frame* top = cursor_top(cursor);
+		if (top->index > 0) {
+			--top->index;
+			return true;
+		}
+		--cursor->depth;
+	}
+	return false;
+}
+
+void ksplay_cursor_init(ksplay_cursor* cursor, ksplay* tree) {
+	cursor->tree = tree;
+	cursor->path = NULL;
+	cursor->depth = 0;
+	cursor->capacity = 0;
+}
+
+void ksplay_cursor_destroy(ksplay_cursor* cursor) {
+	free(cursor->path);
+	cursor->path = NULL;
+}
+
+bool ksplay_cursor_seek(ksplay_cursor* cursor, uint64_t key) {
+	cursor->depth = 0;
+	node* current = cursor->tree->root;
+	while (current != NULL) {
+		const uint8_t key_count = node_key_count(current);
+		uint8_t i;
+		for (i = 0; i < key_count; ++i) {
+			if (current->pairs[i].key >= key) {
+				break;
+			}
+		}
+		cursor_push(cursor, current, i);
+		if (i < key_count && current->pairs[i].key == key) {
+			return true;
+		}
+		current = current->children[i];
+	}
+	return cursor_settle_forward(cursor);
+}
+
+bool ksplay_cursor_last(ksplay_cursor* cursor) {
+	cursor->depth = 0;
+	if (cursor->tree->root == NULL ||
+			node_key_count(cursor->tree->root) == 0) {
+		return false;
+	}
+	cursor_descend_rightmost(cursor, cursor->tree->root);
+	return true;
+}
+
+bool ksplay_cursor_next(ksplay_cursor* cursor) {
+	ksplay_cursor_frame* top = cursor_top(cursor);
+	++top->index;
+	node* child = top->current->children[top->index];
+	if (child != NULL) {
+		cursor_descend_leftmost(cursor, child);
+		return true;
+	}
+	return cursor_settle_forward(cursor);
+}
+
+bool ksplay_cursor_prev(ksplay_cursor* cursor) {
+	ksplay_cursor_frame* top = cursor_top(cursor);
+	node* child = top->current->children[top->index];
+	if (child != NULL) {
+		cursor_descend_rightmost(cursor, child);
+		return true;
+	}
+	return cursor_settle_backward(cursor);
+}
+
+uint64_t ksplay_cursor_key(const ksplay_cursor* cursor) {
+	const ksplay_cursor_frame* top = cursor_top(cursor);
+	return top->current->pairs[top->index].key;
+}
+
+uint64_t ksplay_cursor_value(const ksplay_cursor* cursor) {
+	const ksplay_cursor_frame* top = cursor_top(cursor);
+	return top->current->pairs[top->index].value;
+}
+
 static void _dump_dot(node* current_node, FILE* output) {
 	fprintf(output, "    node%p[label = \"{%p|{",
 			current_node, current_node);
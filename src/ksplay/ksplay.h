@@ -43,15 +43,54 @@ typedef struct {
 
 void ksplay_init(ksplay* this);
 void ksplay_destroy(ksplay* this);
+// Bytes allocated for the nodes of the tree.
+// Does not count the ksplay struct itself.
+uint64_t ksplay_memory_usage(ksplay* this);
 
 bool ksplay_insert(ksplay* this, uint64_t key, uint64_t value);
 bool ksplay_delete(ksplay* this, uint64_t key);
 bool ksplay_find(ksplay* this, uint64_t key, uint64_t *value);
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the tree is next K-splayed.
+bool ksplay_upsert(ksplay* this, uint64_t key, uint64_t default_value,
+		uint64_t** slot);
 bool ksplay_next_key(ksplay* this, uint64_t key, uint64_t* next_key);
 bool ksplay_previous_key(ksplay* this, uint64_t key, uint64_t* previous_key);
+// Builds a balanced tree from n pairs with sorted unique keys.
+// The tree must be empty.
+void ksplay_bulk_load(ksplay* this, const ksplay_pair* pairs, uint64_t n);
 
 void ksplay_dump(ksplay* tree);
 
+typedef struct {
+	ksplay_node* current;
+	// In the top frame: index of the current pair.
+	// In lower frames: index of the child we descended into.
+	uint8_t index;
+} ksplay_cursor_frame;
+
+// Walks the tree in key order without K-splaying. Keeps the path from the
+// root to the current node. Invalidated by any operation that K-splays.
+typedef struct {
+	ksplay* tree;
+	ksplay_cursor_frame* path;
+	uint64_t depth;
+	uint64_t capacity;
+} ksplay_cursor;
+
+void ksplay_cursor_init(ksplay_cursor* cursor, ksplay* tree);
+void ksplay_cursor_destroy(ksplay_cursor* cursor);
+// Moves to the smallest key >= key. Returns false if there is no such key.
+bool ksplay_cursor_seek(ksplay_cursor* cursor, uint64_t key);
+// Moves to the largest key. Returns false if the tree is empty.
+bool ksplay_cursor_last(ksplay_cursor* cursor);
+// Move to the next/previous key. Return false if there is none.
+bool ksplay_cursor_next(ksplay_cursor* cursor);
+bool ksplay_cursor_prev(ksplay_cursor* cursor);
+uint64_t ksplay_cursor_key(const ksplay_cursor* cursor);
+uint64_t ksplay_cursor_value(const ksplay_cursor* cursor);
+
 // Internal methods, exposed for testing.
 typedef struct {
 	ksplay_node** nodes;
@@ -6,6 +6,7 @@
 
 #define CLZ64(x) (__builtin_clzll(x))
 #define CTZ64(x) (__builtin_ctzll(x))
+#define POPCOUNT64(x) (__builtin_popcountll(x))
 #define floor_log2(x) (sizeof(uint64_t) * 8 - 1 - CLZ64(x))
 
 // TODO: (x & (x - 1)) == 0
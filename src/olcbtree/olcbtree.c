@@ -0,0 +1,564 @@
+#include "olcbtree/olcbtree.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btree/search.h"
+#include "log/log.h"
+
+#define OBSOLETE 1
+#define LOCKED 2
+
+// Optimistic reads race with writers, so fields that readers use to find
+// other memory (key counts, child pointers) are loaded exactly once,
+// and are only used after the node's version has been validated.
+#define READ_ONCE(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+static void pause_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// Returns false if the node is write-locked or obsolete.
+static bool read_lock(olcbtree_node* node, uint64_t *version) {
+	*version = atomic_load_explicit(&node->version, memory_order_acquire);
+	if (*version & (LOCKED | OBSOLETE)) {
+		pause_cpu();
+		return false;
+	}
+	return true;
+}
+
+// Returns whether the node is unchanged since it was read-locked,
+// i.e. whether everything read from it since then is consistent.
+static bool validate(olcbtree_node* node, uint64_t version) {
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&node->version,
+			memory_order_relaxed) == version;
+}
+
+// Returns false if the node changed since it was read-locked.
+static bool upgrade_to_write_lock(olcbtree_node* node, uint64_t version) {
+	return atomic_compare_exchange_strong(&node->version, &version,
+			version + LOCKED);
+}
+
+static void write_unlock(olcbtree_node* node) {
+	atomic_fetch_add_explicit(&node->version, LOCKED,
+			memory_order_release);
+}
+
+static void write_unlock_obsolete(olcbtree_node* node) {
+	atomic_fetch_add_explicit(&node->version, LOCKED | OBSOLETE,
+			memory_order_release);
+}
+
+static uint16_t max_keys(const olcbtree_node* node) {
+	return node->is_leaf ?
+			OLCBTREE_LEAF_MAX_KEYS : OLCBTREE_INTERNAL_MAX_KEYS;
+}
+
+// Clamped, so a torn read can't send searches out of the node.
+static uint16_t read_key_count(olcbtree_node* node) {
+	const uint16_t key_count = READ_ONCE(node->key_count);
+	return (key_count > max_keys(node)) ? max_keys(node) : key_count;
+}
+
+static olcbtree_node* alloc_node(olcbtree* this, bool is_leaf) {
+	olcbtree_node* node = slab_alloc(&this->nodes[ebr_thread_index()]);
+	atomic_init(&node->version, 0);
+	node->key_count = 0;
+	node->is_leaf = is_leaf;
+	return node;
+}
+
+static void reclaim_node(void* _this, void* node) {
+	olcbtree* this = _this;
+	// Nodes may go back to a slab other than the one they came from.
+	// Chunks are only released in olcbtree_destroy, all at once.
+	slab_free(&this->nodes[ebr_thread_index()], node);
+}
+
+void olcbtree_init(olcbtree* this) {
+	this->nodes = malloc(sizeof(slab) * EBR_MAX_THREADS);
+	CHECK(this->nodes != NULL, "cannot allocate OLC B-tree slabs");
+	for (uint64_t i = 0; i < EBR_MAX_THREADS; i++) {
+		slab_init(&this->nodes[i], sizeof(olcbtree_node));
+	}
+	ebr_init(&this->reclamation, reclaim_node, this);
+	atomic_init(&this->root, alloc_node(this, true));
+}
+
+void olcbtree_destroy(olcbtree* this) {
+	// Retired nodes go back to the slabs, which are then released whole.
+	ebr_destroy(&this->reclamation);
+	for (uint64_t i = 0; i < EBR_MAX_THREADS; i++) {
+		slab_destroy(&this->nodes[i]);
+	}
+	free(this->nodes);
+	this->nodes = NULL;
+	atomic_store(&this->root, NULL);
+}
+
+// The root may be replaced between loading the pointer and read-locking
+// the node, so the pointer is checked again.
+static bool read_lock_root(olcbtree* this, olcbtree_node** root,
+		uint64_t *version) {
+	*root = atomic_load_explicit(&this->root, memory_order_acquire);
+	return read_lock(*root, version) &&
+			*root == atomic_load_explicit(&this->root,
+					memory_order_acquire);
+}
+
+// Read-locks the child of a read-locked internal node. The child pointer
+// is validated before it is followed, and the parent again after the child
+// is read-locked, so that the child wasn't split away from the key.
+static bool read_lock_child(olcbtree_node* node, uint64_t version,
+		uint16_t i, olcbtree_node** child, uint64_t *child_version) {
+	*child = READ_ONCE(node->internal.children[i]);
+	return validate(node, version) &&
+			read_lock(*child, child_version) &&
+			validate(node, version);
+}
+
+typedef struct {
+	olcbtree_node* leaf;
+	uint64_t leaf_version;
+	// NULL if the leaf is the root.
+	olcbtree_node* parent;
+	uint64_t parent_version;
+	// Keys of the leaf are in [lower;upper).
+	bool has_lower, has_upper;
+	uint64_t lower, upper;
+} leaf_position;
+
+// Descends to the leaf where the key belongs, leaving the leaf and its
+// parent read-locked. Returns false if the descent must restart.
+static bool descend(olcbtree* this, uint64_t key, leaf_position* position) {
+	olcbtree_node* node;
+	uint64_t version;
+	if (!read_lock_root(this, &node, &version)) {
+		return false;
+	}
+	position->parent = NULL;
+	position->parent_version = 0;
+	position->has_lower = position->has_upper = false;
+	while (!node->is_leaf) {
+		const uint16_t key_count = read_key_count(node);
+		const uint16_t i = search_count_le(node->internal.keys,
+				key_count, key);
+		if (i > 0) {
+			position->has_lower = true;
+			position->lower = node->internal.keys[i - 1];
+		}
+		if (i < key_count) {
+			position->has_upper = true;
+			position->upper = node->internal.keys[i];
+		}
+		olcbtree_node* child;
+		uint64_t child_version;
+		if (!read_lock_child(node, version, i, &child,
+					&child_version)) {
+			return false;
+		}
+		position->parent = node;
+		position->parent_version = version;
+		node = child;
+		version = child_version;
+	}
+	position->leaf = node;
+	position->leaf_version = version;
+	return true;
+}
+
+bool olcbtree_find(olcbtree* this, uint64_t key, uint64_t *value) {
+	ebr_enter(&this->reclamation);
+	bool found;
+	uint64_t found_value = 0;
+	while (true) {
+		leaf_position position;
+		if (!descend(this, key, &position)) {
+			continue;
+		}
+		olcbtree_node* leaf = position.leaf;
+		const uint16_t key_count = read_key_count(leaf);
+		const uint16_t i = search_find(leaf->leaf.keys, key_count, key);
+		found = (i < key_count);
+		if (found) {
+			found_value = leaf->leaf.values[i];
+		}
+		if (validate(leaf, position.leaf_version)) {
+			break;
+		}
+	}
+	ebr_exit(&this->reclamation);
+	if (found && value) {
+		*value = found_value;
+	}
+	return found;
+}
+
+static void split_leaf(olcbtree_node* node, olcbtree_node* right,
+		uint64_t *middle_key) {
+	const uint16_t to_left = node->key_count / 2;
+	const uint16_t to_right = node->key_count - to_left;
+	memcpy(right->leaf.keys, node->leaf.keys + to_left,
+			sizeof(uint64_t) * to_right);
+	memcpy(right->leaf.values, node->leaf.values + to_left,
+			sizeof(uint64_t) * to_right);
+	right->key_count = to_right;
+	node->key_count = to_left;
+	*middle_key = right->leaf.keys[0];
+}
+
+static void split_internal(olcbtree_node* node, olcbtree_node* right,
+		uint64_t *middle_key) {
+	const uint16_t to_left = node->key_count / 2;
+	const uint16_t to_right = node->key_count - to_left - 1;
+	*middle_key = node->internal.keys[to_left];
+	memcpy(right->internal.keys, node->internal.keys + to_left + 1,
+			sizeof(uint64_t) * to_right);
+	memcpy(right->internal.children, node->internal.children + to_left + 1,
+			sizeof(olcbtree_node*) * (to_right + 1));
+	right->key_count = to_right;
+	node->key_count = to_left;
+}
+
+static void insert_child(olcbtree_node* node, uint64_t key,
+		olcbtree_node* child) {
+	ASSERT(node->key_count < OLCBTREE_INTERNAL_MAX_KEYS);
+	const uint16_t i = search_count_le(node->internal.keys,
+			node->key_count, key);
+	memmove(node->internal.keys + i + 1, node->internal.keys + i,
+			sizeof(uint64_t) * (node->key_count - i));
+	memmove(node->internal.children + i + 2, node->internal.children + i + 1,
+			sizeof(olcbtree_node*) * (node->key_count - i));
+	node->internal.keys[i] = key;
+	node->internal.children[i + 1] = child;
+	++node->key_count;
+}
+
+// Splits a full node and adds the new right half to its parent, which has
+// room for it. If the node is the root, a new root is made.
+// The caller restarts either way, so failing to lock needs no handling.
+static void split(olcbtree* this, olcbtree_node* parent,
+		uint64_t parent_version, olcbtree_node* node, uint64_t version) {
+	if (parent != NULL && !upgrade_to_write_lock(parent, parent_version)) {
+		return;
+	}
+	if (!upgrade_to_write_lock(node, version)) {
+		if (parent != NULL) {
+			write_unlock(parent);
+		}
+		return;
+	}
+	// The root is only replaced while it is write-locked.
+	ASSERT(parent != NULL || atomic_load(&this->root) == node);
+
+	olcbtree_node* right = alloc_node(this, node->is_leaf);
+	uint64_t middle_key;
+	if (node->is_leaf) {
+		split_leaf(node, right, &middle_key);
+	} else {
+		split_internal(node, right, &middle_key);
+	}
+	if (parent == NULL) {
+		olcbtree_node* root = alloc_node(this, false);
+		root->key_count = 1;
+		root->internal.keys[0] = middle_key;
+		root->internal.children[0] = node;
+		root->internal.children[1] = right;
+		atomic_store_explicit(&this->root, root, memory_order_release);
+	} else {
+		insert_child(parent, middle_key, right);
+		write_unlock(parent);
+	}
+	write_unlock(node);
+}
+
+static bool insert_into_leaf(olcbtree_node* leaf, uint64_t key,
+		uint64_t value) {
+	const uint16_t i = search_count_lt(leaf->leaf.keys, leaf->key_count,
+			key);
+	if (i < leaf->key_count && leaf->leaf.keys[i] == key) {
+		return false;
+	}
+	memmove(leaf->leaf.keys + i + 1, leaf->leaf.keys + i,
+			sizeof(uint64_t) * (leaf->key_count - i));
+	memmove(leaf->leaf.values + i + 1, leaf->leaf.values + i,
+			sizeof(uint64_t) * (leaf->key_count - i));
+	leaf->leaf.keys[i] = key;
+	leaf->leaf.values[i] = value;
+	++leaf->key_count;
+	return true;
+}
+
+// Full nodes are split on the way down, restarting after every split.
+// Returns false if the insert must restart.
+static bool try_insert(olcbtree* this, uint64_t key, uint64_t value,
+		bool *inserted) {
+	olcbtree_node *node, *parent = NULL;
+	uint64_t version, parent_version = 0;
+	if (!read_lock_root(this, &node, &version)) {
+		return false;
+	}
+	while (true) {
+		if (read_key_count(node) == max_keys(node)) {
+			// If the parent was full, it would have been split.
+			split(this, parent, parent_version, node, version);
+			return false;
+		}
+		if (node->is_leaf) {
+			break;
+		}
+		const uint16_t i = search_count_le(node->internal.keys,
+				read_key_count(node), key);
+		olcbtree_node* child;
+		uint64_t child_version;
+		if (!read_lock_child(node, version, i, &child,
+					&child_version)) {
+			return false;
+		}
+		parent = node;
+		parent_version = version;
+		node = child;
+		version = child_version;
+	}
+	if (!upgrade_to_write_lock(node, version)) {
+		return false;
+	}
+	*inserted = insert_into_leaf(node, key, value);
+	write_unlock(node);
+	return true;
+}
+
+bool olcbtree_insert(olcbtree* this, uint64_t key, uint64_t value) {
+	ebr_enter(&this->reclamation);
+	bool inserted;
+	while (!try_insert(this, key, value, &inserted)) {}
+	ebr_exit(&this->reclamation);
+	return inserted;
+}
+
+static void remove_from_leaf(olcbtree_node* leaf, uint16_t i) {
+	memmove(leaf->leaf.keys + i, leaf->leaf.keys + i + 1,
+			sizeof(uint64_t) * (leaf->key_count - i - 1));
+	memmove(leaf->leaf.values + i, leaf->leaf.values + i + 1,
+			sizeof(uint64_t) * (leaf->key_count - i - 1));
+	--leaf->key_count;
+}
+
+// Removes child i > 0 and the key before it.
+static void remove_child(olcbtree_node* node, uint16_t i) {
+	ASSERT(i > 0 && i <= node->key_count);
+	memmove(node->internal.keys + i - 1, node->internal.keys + i,
+			sizeof(uint64_t) * (node->key_count - i));
+	memmove(node->internal.children + i, node->internal.children + i + 1,
+			sizeof(olcbtree_node*) * (node->key_count - i));
+	--node->key_count;
+}
+
+// Removes an emptied leaf from its parent. Its keys go to the left
+// neighbour, or to the right neighbour if the leaf is the first child.
+static void unlink_leaf(olcbtree_node* parent, olcbtree_node* leaf,
+		uint64_t key) {
+	const uint16_t i = search_count_le(parent->internal.keys,
+			parent->key_count, key);
+	ASSERT(parent->internal.children[i] == leaf);
+	if (i > 0) {
+		remove_child(parent, i);
+	} else {
+		parent->internal.children[0] = parent->internal.children[1];
+		remove_child(parent, 1);
+	}
+}
+
+// Returns false if the delete must restart.
+static bool try_delete(olcbtree* this, uint64_t key, bool *deleted) {
+	olcbtree_node* root;
+	uint64_t root_version;
+	if (!read_lock_root(this, &root, &root_version)) {
+		return false;
+	}
+	if (!root->is_leaf && read_key_count(root) == 0) {
+		olcbtree_node* child = READ_ONCE(root->internal.children[0]);
+		if (upgrade_to_write_lock(root, root_version)) {
+			atomic_store_explicit(&this->root, child,
+					memory_order_release);
+			write_unlock_obsolete(root);
+			ebr_retire(&this->reclamation, root);
+		}
+		return false;
+	}
+
+	leaf_position position;
+	if (!descend(this, key, &position)) {
+		return false;
+	}
+	olcbtree_node* leaf = position.leaf;
+	olcbtree_node* parent = position.parent;
+	if (!upgrade_to_write_lock(leaf, position.leaf_version)) {
+		return false;
+	}
+	const uint16_t i = search_find(leaf->leaf.keys, leaf->key_count, key);
+	*deleted = (i < leaf->key_count);
+	if (!*deleted || leaf->key_count > 1 || parent == NULL) {
+		if (*deleted) {
+			remove_from_leaf(leaf, i);
+		}
+		write_unlock(leaf);
+		return true;
+	}
+
+	// The leaf is about to become empty.
+	if (!upgrade_to_write_lock(parent, position.parent_version)) {
+		write_unlock(leaf);
+		return false;
+	}
+	remove_from_leaf(leaf, i);
+	if (parent->key_count == 0) {
+		// The only child stays, so that all leaves keep the same depth.
+		write_unlock(parent);
+		write_unlock(leaf);
+		return true;
+	}
+	unlink_leaf(parent, leaf, key);
+	write_unlock(parent);
+	write_unlock_obsolete(leaf);
+	ebr_retire(&this->reclamation, leaf);
+	return true;
+}
+
+bool olcbtree_delete(olcbtree* this, uint64_t key) {
+	ebr_enter(&this->reclamation);
+	bool deleted;
+	while (!try_delete(this, key, &deleted)) {}
+	ebr_exit(&this->reclamation);
+	return deleted;
+}
+
+// Finds the smallest key >= key. If the leaf has none, the answer is at
+// least the upper bound of the leaf, so the search continues from there.
+static bool find_at_least(olcbtree* this, uint64_t key, uint64_t *found) {
+	while (true) {
+		leaf_position position;
+		if (!descend(this, key, &position)) {
+			continue;
+		}
+		olcbtree_node* leaf = position.leaf;
+		const uint16_t key_count = read_key_count(leaf);
+		const uint16_t i = search_count_lt(leaf->leaf.keys, key_count,
+				key);
+		const uint64_t candidate = (i < key_count) ?
+				leaf->leaf.keys[i] : 0;
+		if (!validate(leaf, position.leaf_version)) {
+			continue;
+		}
+		if (i < key_count) {
+			*found = candidate;
+			return true;
+		}
+		if (!position.has_upper) {
+			return false;
+		}
+		key = position.upper;
+	}
+}
+
+// Finds the largest key <= key, continuing below the lower bound of the leaf
+// if the leaf has none.
+static bool find_at_most(olcbtree* this, uint64_t key, uint64_t *found) {
+	while (true) {
+		leaf_position position;
+		if (!descend(this, key, &position)) {
+			continue;
+		}
+		olcbtree_node* leaf = position.leaf;
+		const uint16_t key_count = read_key_count(leaf);
+		const uint16_t i = search_count_le(leaf->leaf.keys, key_count,
+				key);
+		const uint64_t candidate = (i > 0) ? leaf->leaf.keys[i - 1] : 0;
+		if (!validate(leaf, position.leaf_version)) {
+			continue;
+		}
+		if (i > 0) {
+			*found = candidate;
+			return true;
+		}
+		if (!position.has_lower || position.lower == 0) {
+			return false;
+		}
+		key = position.lower - 1;
+	}
+}
+
+bool olcbtree_find_next(olcbtree* this, uint64_t key, uint64_t *next_key) {
+	if (key == UINT64_MAX) {
+		return false;
+	}
+	ebr_enter(&this->reclamation);
+	const bool found = find_at_least(this, key + 1, next_key);
+	ebr_exit(&this->reclamation);
+	return found;
+}
+
+bool olcbtree_find_prev(olcbtree* this, uint64_t key, uint64_t *prev_key) {
+	if (key == 0) {
+		return false;
+	}
+	ebr_enter(&this->reclamation);
+	const bool found = find_at_most(this, key - 1, prev_key);
+	ebr_exit(&this->reclamation);
+	return found;
+}
+
+uint64_t olcbtree_memory_usage(olcbtree* this) {
+	uint64_t bytes = 0;
+	for (uint64_t i = 0; i < EBR_MAX_THREADS; i++) {
+		bytes += slab_memory_usage(&this->nodes[i]);
+	}
+	return bytes + ebr_memory_usage(&this->reclamation);
+}
+
+// Checks that keys in the subtree are sorted and within [min;max],
+// that leaves are at the same depth and that no node is locked.
+static void check_recursive(olcbtree_node* node, uint64_t min, uint64_t max,
+		uint64_t depth, uint64_t *leaf_depth) {
+	const uint64_t version = atomic_load(&node->version);
+	CHECK((version & (LOCKED | OBSOLETE)) == 0,
+			"node %p has version %" PRIu64, node, version);
+	CHECK(node->key_count <= max_keys(node),
+			"node %p has %" PRIu16 " keys", node, node->key_count);
+	const uint64_t* keys = node->is_leaf ?
+			node->leaf.keys : node->internal.keys;
+	for (uint16_t i = 0; i < node->key_count; i++) {
+		CHECK(keys[i] >= min && keys[i] <= max,
+				"key %" PRIu64 " out of [%" PRIu64 ";%" PRIu64 "]",
+				keys[i], min, max);
+		CHECK(i == 0 || keys[i - 1] < keys[i],
+				"keys %" PRIu64 " and %" PRIu64 " not sorted",
+				keys[i - 1], keys[i]);
+	}
+	if (node->is_leaf) {
+		if (*leaf_depth == UINT64_MAX) {
+			*leaf_depth = depth;
+		}
+		CHECK(depth == *leaf_depth, "leaves at depths %" PRIu64
+				" and %" PRIu64, depth, *leaf_depth);
+		return;
+	}
+	for (uint16_t i = 0; i <= node->key_count; i++) {
+		check_recursive(node->internal.children[i],
+				(i == 0) ? min : keys[i - 1],
+				(i == node->key_count) ? max : keys[i] - 1,
+				depth + 1, leaf_depth);
+	}
+}
+
+void olcbtree_check(olcbtree* this) {
+	uint64_t leaf_depth = UINT64_MAX;
+	check_recursive(atomic_load(&this->root), 0, UINT64_MAX, 0,
+			&leaf_depth);
+}
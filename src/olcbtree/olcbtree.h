@@ -0,0 +1,93 @@
+#ifndef OLCBTREE_OLCBTREE_H
+#define OLCBTREE_OLCBTREE_H
+
+// Concurrent B+-tree with optimistic lock coupling (Leis et al., "The ART
+// of practical synchronization", 2016).
+//
+// Every node carries a version lock. Readers don't write shared memory:
+// they remember the versions of the nodes they pass and restart from the
+// root if any of them changed before they were done with it. Writers
+// descend the same way and lock only the nodes they modify. Full nodes
+// are split on the way down like in btree/btree.h, which locks the parent
+// and the child being split, but never more.
+//
+// Deletion is lazy: nodes are never merged. A leaf that becomes empty is
+// removed from its parent if the parent has other children, and a root
+// with a single child is replaced by the child. Removed nodes are retired
+// to epoch-based reclamation (ebr/ebr.h), so readers still looking at them
+// stay safe.
+//
+// Internal nodes below the root are never removed, so that all leaves keep
+// the same depth. An internal node left with one child keeps it, even if
+// it is an empty leaf. So the tree does not shrink with its keys: after
+// mass deletes, it still holds every internal node it had at its largest
+// (except removed roots) and up to one empty leaf under each of them.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ebr/ebr.h"
+#include "slab/slab.h"
+
+#define OLCBTREE_NODE_BYTES 256
+
+enum {
+	// The first 16 bytes hold the version, key count and node type.
+	OLCBTREE_LEAF_MAX_KEYS = (OLCBTREE_NODE_BYTES - 16) /
+			(sizeof(uint64_t) * 2),
+	OLCBTREE_INTERNAL_MAX_KEYS = (OLCBTREE_NODE_BYTES - 16 -
+			sizeof(void*)) / (sizeof(uint64_t) + sizeof(void*))
+};
+
+typedef struct olcbtree_node {
+	// Bit 0: obsolete (removed from the tree), bit 1: write-locked.
+	// Every write unlock adds 4.
+	_Atomic uint64_t version;
+	uint16_t key_count;
+	bool is_leaf;
+	union {
+		struct {
+			uint64_t keys[OLCBTREE_INTERNAL_MAX_KEYS];
+			struct olcbtree_node* children[
+				OLCBTREE_INTERNAL_MAX_KEYS + 1];
+		} internal;
+
+		struct {
+			uint64_t keys[OLCBTREE_LEAF_MAX_KEYS];
+			uint64_t values[OLCBTREE_LEAF_MAX_KEYS];
+		} leaf;
+	};
+} olcbtree_node;
+
+typedef struct {
+	// Changed only while the old root is write-locked.
+	_Atomic(olcbtree_node*) root;
+	ebr reclamation;
+	// One slab per EBR thread index, so that threads allocate and free
+	// nodes without locking. Nodes are allocated by splits and freed by
+	// reclamation, which runs on the thread that retired them. That is
+	// a cross-thread free: the node goes to the reclaiming thread's slab,
+	// even if another thread's slab allocated it.
+	slab* nodes;
+} olcbtree;
+
+void olcbtree_init(olcbtree*);
+void olcbtree_destroy(olcbtree*);
+
+// These may be called concurrently from any number of threads.
+bool olcbtree_find(olcbtree*, uint64_t key, uint64_t *value);
+bool olcbtree_insert(olcbtree*, uint64_t key, uint64_t value);
+bool olcbtree_delete(olcbtree*, uint64_t key);
+// Not atomic as a whole: keys inserted or deleted during the call
+// may or may not be seen.
+bool olcbtree_find_next(olcbtree*, uint64_t key, uint64_t *next_key);
+bool olcbtree_find_prev(olcbtree*, uint64_t key, uint64_t *prev_key);
+
+// Bytes of the slab chunks and reclamation lists. Does not count
+// the olcbtree struct itself. Must not run concurrently with changes.
+uint64_t olcbtree_memory_usage(olcbtree*);
+// Must not run concurrently with changes.
+void olcbtree_check(olcbtree*);
+
+#endif
@@ -0,0 +1,134 @@
+#include "olcbtree/test.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "log/log.h"
+#include "olcbtree/olcbtree.h"
+#include "rand/rand.h"
+
+// Odd keys 1, 3, ..., 2N-1 stay in the tree. Writers keep inserting and
+// deleting even keys between them, splitting and removing leaves, while
+// readers check that they always see the odd keys and their neighbours.
+#define N 50000
+#define WRITERS 4
+#define READERS 4
+#define WRITER_ROUNDS 20
+
+typedef struct {
+	olcbtree* tree;
+	uint64_t thread;
+	atomic_bool* writers_done;
+} worker_args;
+
+static void* write_even_keys(void* _args) {
+	worker_args* args = _args;
+	for (uint64_t round = 0; round < WRITER_ROUNDS; round++) {
+		for (uint64_t j = args->thread; j < N; j += WRITERS) {
+			ASSERT(olcbtree_insert(args->tree, 2 * j + 2, j));
+		}
+		for (uint64_t j = args->thread; j < N; j += WRITERS) {
+			ASSERT(olcbtree_delete(args->tree, 2 * j + 2));
+		}
+	}
+	return NULL;
+}
+
+static void* read_odd_keys(void* _args) {
+	worker_args* args = _args;
+	rand_generator generator = { .state = args->thread };
+	while (!atomic_load(args->writers_done)) {
+		const uint64_t j = rand_next(&generator, N);
+		const uint64_t key = 2 * j + 1;
+		uint64_t value, next, prev;
+		ASSERT(olcbtree_find(args->tree, key, &value) && value == ~key);
+		ASSERT(!olcbtree_find(args->tree, 2 * N + 1, NULL));
+
+		if (j < N - 1) {
+			ASSERT(olcbtree_find_next(args->tree, key, &next));
+			ASSERT(next == key + 1 || next == key + 2);
+		} else if (olcbtree_find_next(args->tree, key, &next)) {
+			ASSERT(next == key + 1);
+		}
+		if (j > 0) {
+			ASSERT(olcbtree_find_prev(args->tree, key, &prev));
+			ASSERT(prev == key - 1 || prev == key - 2);
+		} else {
+			ASSERT(!olcbtree_find_prev(args->tree, key, &prev));
+		}
+	}
+	return NULL;
+}
+
+static void test_concurrent_reads(void) {
+	olcbtree tree;
+	olcbtree_init(&tree);
+	for (uint64_t j = 0; j < N; j++) {
+		ASSERT(olcbtree_insert(&tree, 2 * j + 1, ~(2 * j + 1)));
+	}
+	olcbtree_check(&tree);
+
+	atomic_bool writers_done;
+	atomic_init(&writers_done, false);
+	pthread_t writers[WRITERS], readers[READERS];
+	worker_args writer_args[WRITERS], reader_args[READERS];
+	for (uint64_t t = 0; t < WRITERS; t++) {
+		writer_args[t] = (worker_args) {
+			.tree = &tree, .thread = t, .writers_done = &writers_done
+		};
+		ASSERT(pthread_create(&writers[t], NULL, write_even_keys,
+					&writer_args[t]) == 0);
+	}
+	for (uint64_t t = 0; t < READERS; t++) {
+		reader_args[t] = (worker_args) {
+			.tree = &tree, .thread = t, .writers_done = &writers_done
+		};
+		ASSERT(pthread_create(&readers[t], NULL, read_odd_keys,
+					&reader_args[t]) == 0);
+	}
+	for (uint64_t t = 0; t < WRITERS; t++) {
+		ASSERT(pthread_join(writers[t], NULL) == 0);
+	}
+	atomic_store(&writers_done, true);
+	for (uint64_t t = 0; t < READERS; t++) {
+		ASSERT(pthread_join(readers[t], NULL) == 0);
+	}
+
+	olcbtree_check(&tree);
+	for (uint64_t j = 0; j < N; j++) {
+		ASSERT(olcbtree_find(&tree, 2 * j + 1, NULL));
+		ASSERT(!olcbtree_find(&tree, 2 * j + 2, NULL));
+	}
+	olcbtree_destroy(&tree);
+}
+
+// Removed leaves are reclaimed and reused, so refilling an emptied tree
+// doesn't take new memory every time.
+static void test_reclamation(void) {
+	olcbtree tree;
+	olcbtree_init(&tree);
+	uint64_t first_round_usage = 0;
+	for (uint64_t round = 0; round < 10; round++) {
+		for (uint64_t i = 0; i < N; i++) {
+			ASSERT(olcbtree_insert(&tree, i, i));
+		}
+		if (round == 0) {
+			first_round_usage = olcbtree_memory_usage(&tree);
+		}
+		for (uint64_t i = 0; i < N; i++) {
+			ASSERT(olcbtree_delete(&tree, i));
+		}
+		olcbtree_check(&tree);
+	}
+	const uint64_t usage = olcbtree_memory_usage(&tree);
+	CHECK(usage < 2 * first_round_usage,
+			"%" PRIu64 " B used after 10 rounds, %" PRIu64
+			" B after 1", usage, first_round_usage);
+	olcbtree_destroy(&tree);
+}
+
+void test_olcbtree(void) {
+	test_concurrent_reads();
+	test_reclamation();
+}
@@ -0,0 +1,6 @@
+#ifndef OLCBTREE_TEST_H
+#define OLCBTREE_TEST_H
+
+void test_olcbtree(void);
+
+#endif
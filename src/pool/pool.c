@@ -0,0 +1,107 @@
+#include "pool/pool.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "log/log.h"
+#include "util/huge_page.h"
+
+// Reservations smaller than this are not worth retrying.
+#define MIN_RESERVED_BYTES HUGE_PAGE_BYTES
+
+// A pool can't commit more than physical memory, so reserving more address
+// space than that only wastes it. Indices are 32-bit, which caps it too.
+static uint64_t max_reserved_bytes(uint64_t slot_bytes) {
+	const uint64_t physical = (uint64_t) sysconf(_SC_PHYS_PAGES) *
+			sysconf(_SC_PAGESIZE);
+	uint64_t slots = 1ULL << 32;
+	if (physical / slot_bytes + 1 < slots) {
+		slots = physical / slot_bytes + 1;
+	}
+	// Mappings are trimmed at huge page boundaries.
+	return (slots * slot_bytes + HUGE_PAGE_BYTES - 1) /
+			HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+}
+
+void pool_init(pool* this, uint64_t slot_bytes) {
+	this->slot_bytes = (slot_bytes + POOL_ALIGNMENT - 1) /
+			POOL_ALIGNMENT * POOL_ALIGNMENT;
+	this->reserved_bytes = max_reserved_bytes(this->slot_bytes);
+	// PROT_NONE mappings don't count against overcommit limits, but they
+	// do count against RLIMIT_AS, so settle for less if that runs out.
+	while (true) {
+		this->base = map_huge_page_aligned(this->reserved_bytes,
+				PROT_NONE, MAP_NORESERVE);
+		if (this->base != MAP_FAILED ||
+				this->reserved_bytes / 2 < MIN_RESERVED_BYTES) {
+			break;
+		}
+		this->reserved_bytes = this->reserved_bytes / 2 /
+				HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+	}
+	CHECK(this->base != MAP_FAILED,
+			"cannot reserve %" PRIu64 " bytes for pool",
+			this->reserved_bytes);
+	this->committed_bytes = 0;
+	this->next_growth_bytes = POOL_MIN_GROWTH_BYTES;
+	this->unused = 1;
+	this->free_list = 0;
+}
+
+void pool_destroy(pool* this) {
+	if (this->base != NULL) {
+		ASSERT(munmap(this->base, this->reserved_bytes) == 0);
+	}
+	this->base = NULL;
+	this->reserved_bytes = this->committed_bytes = 0;
+	this->unused = 1;
+	this->free_list = 0;
+}
+
+static void grow(pool* this) {
+	uint64_t bytes = this->next_growth_bytes;
+	while (bytes < this->slot_bytes) {
+		bytes *= 2;
+	}
+	if (bytes >= HUGE_PAGE_BYTES) {
+		// Keep large steps ending on huge page boundaries.
+		bytes = (this->committed_bytes + bytes) / HUGE_PAGE_BYTES *
+				HUGE_PAGE_BYTES - this->committed_bytes;
+	}
+	if (this->committed_bytes + bytes > this->reserved_bytes) {
+		bytes = this->reserved_bytes - this->committed_bytes;
+	}
+	CHECK(bytes >= this->slot_bytes, "pool of %" PRIu64 " B slots full",
+			this->slot_bytes);
+	CHECK(mprotect(this->base + this->committed_bytes, bytes,
+				PROT_READ | PROT_WRITE) == 0,
+			"cannot commit %" PRIu64 " bytes of pool", bytes);
+	this->committed_bytes += bytes;
+	if (this->next_growth_bytes < POOL_MAX_GROWTH_BYTES) {
+		this->next_growth_bytes *= 2;
+	}
+}
+
+void* pool_alloc(pool* this) {
+	if (this->free_list != 0) {
+		void* slot = pool_slot(this, this->free_list);
+		this->free_list = *(uint32_t*) slot;
+		return slot;
+	}
+	CHECK(this->unused < (1ULL << 32), "pool indices exhausted");
+	while ((this->unused + 1) * this->slot_bytes > this->committed_bytes) {
+		grow(this);
+	}
+	return pool_slot(this, this->unused++);
+}
+
+void pool_free(pool* this, void* slot) {
+	*(uint32_t*) slot = this->free_list;
+	this->free_list = pool_index(this, slot);
+}
+
+uint64_t pool_memory_usage(const pool* this) {
+	return this->committed_bytes;
+}
@@ -0,0 +1,52 @@
+#ifndef POOL_POOL_H
+#define POOL_POOL_H
+
+// Allocator of fixed-size slots addressed by 32-bit indices, e.g. the nodes
+// of one tree that refers to them by index instead of by pointer.
+//
+// Address space for the slots is reserved up front without committing
+// memory, and is made accessible as the pool grows, so slots never move:
+// pointers to them stay valid and an index turns into a slot by one
+// multiply-add. Committed memory grows by chunks of doubling size, up to
+// POOL_MAX_GROWTH_BYTES. The reservation covers as many slots as 32-bit
+// indices or physical memory allow, whichever is fewer, or less if the
+// address space limit (RLIMIT_AS) is in the way.
+//
+// Index 0 is never handed out, so it can stand for "no slot".
+// Freed slots go to a free list and are reused first. Not thread-safe.
+
+#include <stdint.h>
+
+#define POOL_ALIGNMENT 64
+#define POOL_MIN_GROWTH_BYTES (16 << 10)
+#define POOL_MAX_GROWTH_BYTES (2 << 20)
+
+typedef struct {
+	char* base;
+	uint64_t slot_bytes;  // Rounded up to POOL_ALIGNMENT.
+	uint64_t reserved_bytes;
+	uint64_t committed_bytes;
+	uint64_t next_growth_bytes;
+	// Slots [1;unused) were handed out at some point.
+	uint64_t unused;
+	// Freed slots, linked through their first 4 bytes. 0 ends the list.
+	uint32_t free_list;
+} pool;
+
+void pool_init(pool*, uint64_t slot_bytes);
+void pool_destroy(pool*);
+// Returns a POOL_ALIGNMENT-aligned slot of slot_bytes.
+void* pool_alloc(pool*);
+void pool_free(pool*, void* slot);
+// Bytes of committed memory, including unused slots.
+uint64_t pool_memory_usage(const pool*);
+
+static inline void* pool_slot(const pool* this, uint32_t index) {
+	return this->base + index * this->slot_bytes;
+}
+
+static inline uint32_t pool_index(const pool* this, const void* slot) {
+	return ((const char*) slot - this->base) / this->slot_bytes;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include "pool/test.h"
+
+#include <string.h>
+
+#include "log/log.h"
+#include "pool/pool.h"
+
+#define SLOTS 10000
+
+// Tests what sets pools apart from slabs: indices, growing without moving
+// slots and reusing freed indices.
+static void test_slot_size(uint64_t slot_bytes) {
+	pool allocator;
+	pool_init(&allocator, slot_bytes);
+	ASSERT(pool_memory_usage(&allocator) == 0);
+
+	// Indices round-trip and are handed out densely from 1.
+	static uint32_t indices[SLOTS];
+	for (uint64_t i = 0; i < SLOTS; i++) {
+		unsigned char* slot = pool_alloc(&allocator);
+		ASSERT((uint64_t) slot % POOL_ALIGNMENT == 0);
+		indices[i] = pool_index(&allocator, slot);
+		ASSERT(indices[i] == i + 1);
+		ASSERT(pool_slot(&allocator, indices[i]) == slot);
+		memset(slot, i % 256, slot_bytes);
+	}
+	// The pool grew past its first chunk without moving any slot.
+	const uint64_t usage = pool_memory_usage(&allocator);
+	ASSERT(usage > POOL_MIN_GROWTH_BYTES);
+	ASSERT(usage >= (SLOTS + 1) * allocator.slot_bytes);
+	for (uint64_t i = 0; i < SLOTS; i++) {
+		const unsigned char* slot = pool_slot(&allocator, indices[i]);
+		for (uint64_t j = 0; j < slot_bytes; j++) {
+			ASSERT(slot[j] == i % 256);
+		}
+	}
+
+	// Freed indices are reused, the last freed first, before the pool
+	// grows.
+	for (uint64_t i = 0; i < SLOTS; i += 2) {
+		pool_free(&allocator, pool_slot(&allocator, indices[i]));
+	}
+	for (uint64_t i = SLOTS; i >= 2; i -= 2) {
+		ASSERT(pool_index(&allocator, pool_alloc(&allocator)) ==
+				indices[i - 2]);
+	}
+	ASSERT(pool_memory_usage(&allocator) == usage);
+	ASSERT(pool_index(&allocator, pool_alloc(&allocator)) == SLOTS + 1);
+
+	pool_destroy(&allocator);
+	ASSERT(pool_memory_usage(&allocator) == 0);
+}
+
+void test_pool(void) {
+	test_slot_size(8);
+	test_slot_size(100);
+	test_slot_size(256);
+	test_slot_size(4096);
+}
@@ -0,0 +1,6 @@
+#ifndef POOL_TEST_H
+#define POOL_TEST_H
+
+void test_pool(void);
+
+#endif
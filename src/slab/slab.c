@@ -0,0 +1,111 @@
+#include "slab/slab.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "log/log.h"
+#include "util/huge_page.h"
+
+// Every chunk starts with a header, padded to SLAB_ALIGNMENT.
+typedef struct {
+	void* next;
+	uint64_t bytes;
+} chunk_header;
+
+#define HEADER_BYTES SLAB_ALIGNMENT
+
+// Full-size chunks are exactly one x86-64 huge page.
+_Static_assert(SLAB_MAX_CHUNK_BYTES == HUGE_PAGE_BYTES,
+		"full-size slab chunks must be huge pages");
+
+void slab_init(slab* this, uint64_t slot_bytes) {
+	this->slot_bytes = (slot_bytes + SLAB_ALIGNMENT - 1) /
+			SLAB_ALIGNMENT * SLAB_ALIGNMENT;
+	this->next_chunk_bytes = SLAB_MIN_CHUNK_BYTES;
+	while (this->next_chunk_bytes < HEADER_BYTES + this->slot_bytes) {
+		this->next_chunk_bytes *= 2;
+	}
+	this->chunks = NULL;
+	this->chunk_bytes_total = 0;
+	this->bump = this->bump_end = NULL;
+	this->free_list = NULL;
+	this->try_hugetlb = true;
+}
+
+void slab_destroy(slab* this) {
+	chunk_header* chunk = this->chunks;
+	while (chunk != NULL) {
+		chunk_header* next = chunk->next;
+		ASSERT(munmap(chunk, chunk->bytes) == 0);
+		chunk = next;
+	}
+	this->chunks = NULL;
+	this->chunk_bytes_total = 0;
+	this->bump = this->bump_end = NULL;
+	this->free_list = NULL;
+}
+
+static void* map(uint64_t bytes, int flags) {
+	return mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+}
+
+static void* map_chunk(slab* this, uint64_t bytes) {
+	void* chunk = MAP_FAILED;
+	if (bytes == HUGE_PAGE_BYTES) {
+		if (this->try_hugetlb) {
+			chunk = map(bytes, MAP_HUGETLB);
+			// Most likely no huge pages are reserved.
+			this->try_hugetlb = (chunk != MAP_FAILED);
+		}
+		if (chunk == MAP_FAILED) {
+			chunk = map_huge_page_aligned(bytes,
+					PROT_READ | PROT_WRITE, 0);
+		}
+	} else {
+		chunk = map(bytes, 0);
+	}
+	CHECK(chunk != MAP_FAILED,
+			"cannot map slab chunk of %" PRIu64 " bytes", bytes);
+	return chunk;
+}
+
+static void add_chunk(slab* this) {
+	const uint64_t bytes = this->next_chunk_bytes;
+	chunk_header* chunk = map_chunk(this, bytes);
+	chunk->next = this->chunks;
+	chunk->bytes = bytes;
+	this->chunks = chunk;
+	this->chunk_bytes_total += bytes;
+
+	this->bump = (char*) chunk + HEADER_BYTES;
+	this->bump_end = (char*) chunk + bytes;
+	if (this->next_chunk_bytes < SLAB_MAX_CHUNK_BYTES) {
+		this->next_chunk_bytes *= 2;
+	}
+}
+
+void* slab_alloc(slab* this) {
+	if (this->free_list != NULL) {
+		void* slot = this->free_list;
+		this->free_list = *(void**) slot;
+		return slot;
+	}
+	if (this->bump_end - this->bump < (ptrdiff_t) this->slot_bytes) {
+		// The rest of the current chunk is left unused.
+		add_chunk(this);
+	}
+	void* slot = this->bump;
+	this->bump += this->slot_bytes;
+	return slot;
+}
+
+void slab_free(slab* this, void* slot) {
+	*(void**) slot = this->free_list;
+	this->free_list = slot;
+}
+
+uint64_t slab_memory_usage(const slab* this) {
+	return this->chunk_bytes_total;
+}
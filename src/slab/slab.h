@@ -0,0 +1,47 @@
+#ifndef SLAB_SLAB_H
+#define SLAB_SLAB_H
+
+// Allocator of fixed-size slots, e.g. the nodes of one tree.
+//
+// Slots are carved from large mmap'd chunks, so neighbouring nodes share
+// pages and TLB entries. Chunk sizes double from SLAB_MIN_CHUNK_BYTES up to
+// SLAB_MAX_CHUNK_BYTES, so small trees stay small. Full-size chunks are
+// backed by huge pages (MAP_HUGETLB) if the system has some reserved,
+// otherwise they are advised for transparent huge pages.
+//
+// Freed slots go to a free list and are reused before new slots are carved.
+// slab_destroy releases everything in O(number of chunks).
+// Not thread-safe.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SLAB_ALIGNMENT 64
+#define SLAB_MIN_CHUNK_BYTES (16 << 10)
+#define SLAB_MAX_CHUNK_BYTES (2 << 20)
+
+typedef struct {
+	uint64_t slot_bytes;  // Rounded up to SLAB_ALIGNMENT.
+	// Size of the next chunk to allocate.
+	uint64_t next_chunk_bytes;
+	// The newest chunk first, linked through their headers.
+	void* chunks;
+	uint64_t chunk_bytes_total;
+	// Never used slots of the newest chunk are [bump;bump_end).
+	char* bump;
+	char* bump_end;
+	// Freed slots, linked through their first bytes.
+	void* free_list;
+	// Cleared after the first failed MAP_HUGETLB attempt.
+	bool try_hugetlb;
+} slab;
+
+void slab_init(slab*, uint64_t slot_bytes);
+void slab_destroy(slab*);
+// Returns a SLAB_ALIGNMENT-aligned slot of slot_bytes.
+void* slab_alloc(slab*);
+void slab_free(slab*, void* slot);
+// Bytes of all chunks, including unused slots.
+uint64_t slab_memory_usage(const slab*);
+
+#endif
@@ -0,0 +1,48 @@
+#include "slab/test.h"
+
+#include <string.h>
+
+#include "log/log.h"
+#include "slab/slab.h"
+
+#define SLOTS 10000
+
+static void test_slot_size(uint64_t slot_bytes) {
+	slab allocator;
+	slab_init(&allocator, slot_bytes);
+	ASSERT(slab_memory_usage(&allocator) == 0);
+
+	static unsigned char* slots[SLOTS];
+	for (uint64_t i = 0; i < SLOTS; i++) {
+		slots[i] = slab_alloc(&allocator);
+		ASSERT((uint64_t) slots[i] % SLAB_ALIGNMENT == 0);
+		memset(slots[i], i % 256, slot_bytes);
+	}
+	// Slots don't overlap.
+	for (uint64_t i = 0; i < SLOTS; i++) {
+		for (uint64_t j = 0; j < slot_bytes; j++) {
+			ASSERT(slots[i][j] == i % 256);
+		}
+	}
+	const uint64_t usage = slab_memory_usage(&allocator);
+	ASSERT(usage >= SLOTS * slot_bytes);
+
+	// Freed slots are reused before new chunks are mapped.
+	for (uint64_t i = 0; i < SLOTS; i += 2) {
+		slab_free(&allocator, slots[i]);
+	}
+	for (uint64_t i = 0; i < SLOTS; i += 2) {
+		slots[i] = slab_alloc(&allocator);
+	}
+	ASSERT(slab_memory_usage(&allocator) == usage);
+
+	slab_destroy(&allocator);
+	ASSERT(slab_memory_usage(&allocator) == 0);
+}
+
+void test_slab(void) {
+	test_slot_size(8);
+	test_slot_size(100);
+	test_slot_size(256);
+	test_slot_size(4096);
+}
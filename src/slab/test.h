@@ -0,0 +1,6 @@
+#ifndef SLAB_TEST_H
+#define SLAB_TEST_H
+
+void test_slab(void);
+
+#endif
@@ -103,6 +103,38 @@ static node* make_node(uint64_t key, uint64_t value) {
 	return new_node;
 }
 
+bool splay_upsert(splay_tree* tree, splay_key key, splay_value default_value,
+		splay_value** slot) {
+	if (tree->root != NULL) {
+		tree->root = _splay(tree->root, key);
+		if (tree->root->key == key) {
+			*slot = &tree->root->value;
+			return false;
+		}
+	}
+	// The neighbour of the key is now the root, so the insertion
+	// splays just one node.
+	ASSERT(splay_insert(tree, key, default_value));
+	*slot = &tree->root->value;
+	return true;
+}
+
+static node* build_balanced(const splay_pair* pairs, uint64_t n) {
+	if (n == 0) {
+		return NULL;
+	}
+	const uint64_t middle = n / 2;
+	node* root = make_node(pairs[middle].key, pairs[middle].value);
+	root->left = build_balanced(pairs, middle);
+	root->right = build_balanced(pairs + middle + 1, n - middle - 1);
+	return root;
+}
+
+void splay_bulk_load(splay_tree* tree, const splay_pair* pairs, uint64_t n) {
+	CHECK(tree->root == NULL, "bulk loading into non-empty splay tree");
+	tree->root = build_balanced(pairs, n);
+}
+
 bool splay_insert(splay_tree* tree, uint64_t key, uint64_t value) {
 	node* new_node;
 	if (tree->root == NULL) {
@@ -248,3 +280,127 @@ bool splay_previous_key(splay_tree* this, splay_key key,
 		}
 	}
 }
+
+static void cursor_push(splay_cursor* cursor, node* pushed) {
+	if (cursor->depth == cursor->capacity) {
+		cursor->capacity = cursor->capacity ? cursor->capacity * 2 : 32;
+		cursor->path = realloc(cursor->path,
+				sizeof(node*) * cursor->capacity);
+		CHECK(cursor->path, "failed to grow cursor path");
+	}
+	cursor->path[cursor->depth++] = pushed;
+}
+
+static node* cursor_top(const splay_cursor* cursor) {
+	return cursor->path[cursor->depth - 1];
+}
+
+// Pops nodes until the popped node is a left child. Its parent is then
+// the next node.
+static bool cursor_up_from_right(splay_cursor* cursor) {
+	while (cursor->depth > 1) {
+		node* child = cursor->path[--cursor->depth];
+		if (cursor_top(cursor)->left == child) {
+			return true;
+		}
+	}
+	cursor->depth = 0;
+	return false;
+}
+
+// Pops nodes until the popped node is a right child. Its parent is then
+// the previous node.
+static bool cursor_up_from_left(splay_cursor* cursor) {
+	while (cursor->depth > 1) {
+		node* child = cursor->path[--cursor->depth];
+		if (cursor_top(cursor)->right == child) {
+			return true;
+		}
+	}
+	cursor->depth = 0;
+	return false;
+}
+
+void splay_cursor_init(splay_cursor* cursor, splay_tree* tree) {
+	cursor->tree = tree;
+	cursor->path = NULL;
+	cursor->depth = 0;
+	cursor->capacity = 0;
+}
+
+void splay_cursor_destroy(splay_cursor* cursor) {
+	free(cursor->path);
+	cursor->path = NULL;
+}
+
+bool splay_cursor_seek(splay_cursor* cursor, splay_key key) {
+	cursor->depth = 0;
+	node* current = cursor->tree->root;
+	while (current != NULL) {
+		cursor_push(cursor, current);
+		if (key == current->key) {
+			return true;
+		}
+		current = (key < current->key) ? current->left : current->right;
+	}
+	if (cursor->depth == 0) {
+		return false;
+	}
+	if (cursor_top(cursor)->key > key) {
+		return true;
+	}
+	return cursor_up_from_right(cursor);
+}
+
+bool splay_cursor_last(splay_cursor* cursor) {
+	cursor->depth = 0;
+	for (node* current = cursor->tree->root; current != NULL;
+			current = current->right) {
+		cursor_push(cursor, current);
+	}
+	return cursor->depth > 0;
+}
+
+bool splay_cursor_next(splay_cursor* cursor) {
+	node* current = cursor_top(cursor)->right;
+	if (current == NULL) {
+		return cursor_up_from_right(cursor);
+	}
+	for (; current != NULL; current = current->left) {
+		cursor_push(cursor, current);
+	}
+	return true;
+}
+
+bool splay_cursor_prev(splay_cursor* cursor) {
+	node* current = cursor_top(cursor)->left;
+	if (current == NULL) {
+		return cursor_up_from_left(cursor);
+	}
+	for (; current != NULL; current = current->right) {
+		cursor_push(cursor, current);
+	}
+	return true;
+}
+
+splay_key splay_cursor_key(const splay_cursor* cursor) {
+	return cursor_top(cursor)->key;
+}
+
+splay_value splay_cursor_value(const splay_cursor* cursor) {
+	return cursor_top(cursor)->value;
+}
+
+uint64_t splay_memory_usage(splay_tree* this) {
+	// Splay trees may be deep, so count nodes with a cursor, which keeps
+	// its path on the heap.
+	uint64_t nodes = 0;
+	splay_cursor cursor;
+	splay_cursor_init(&cursor, this);
+	for (bool found = splay_cursor_seek(&cursor, 0); found;
+			found = splay_cursor_next(&cursor)) {
+		++nodes;
+	}
+	splay_cursor_destroy(&cursor);
+	return nodes * sizeof(node);
+}
@@ -21,9 +21,23 @@ typedef struct {
 bool splay_find(splay_tree* this, splay_key key, splay_value* value);
 bool splay_insert(splay_tree* this, splay_key key, splay_value value);
 bool splay_delete(splay_tree* this, splay_key key);
+// Points *slot at the value of the key, inserting key=default_value if the
+// key is missing. Returns whether the key was inserted.
+// The slot is valid until the tree is next splayed.
+bool splay_upsert(splay_tree* this, splay_key key, splay_value default_value,
+		splay_value** slot);
 void splay_init(splay_tree** this);
 void splay_destroy(splay_tree** this);
 
+typedef struct {
+	splay_key key;
+	splay_value value;
+} splay_pair;
+
+// Builds a perfectly balanced tree from n pairs with sorted unique keys.
+// The tree must be empty.
+void splay_bulk_load(splay_tree* this, const splay_pair* pairs, uint64_t n);
+
 // Actually splays up the last node found on the path here.
 void splay(splay_tree* tree, splay_key key);
 
@@ -31,4 +45,29 @@ bool splay_next_key(splay_tree* this, splay_key key, splay_key* next_key);
 bool splay_previous_key(splay_tree* this, splay_key key,
 		splay_key* previous_key);
 
+// Walks the tree in key order without splaying. Keeps the path from the root
+// to the current node. Invalidated by any operation that splays.
+typedef struct {
+	splay_tree* tree;
+	splay_node** path;  // path[depth - 1] is the current node
+	uint64_t depth;
+	uint64_t capacity;
+} splay_cursor;
+
+void splay_cursor_init(splay_cursor* cursor, splay_tree* tree);
+void splay_cursor_destroy(splay_cursor* cursor);
+// Moves to the smallest key >= key. Returns false if there is no such key.
+bool splay_cursor_seek(splay_cursor* cursor, splay_key key);
+// Moves to the largest key. Returns false if the tree is empty.
+bool splay_cursor_last(splay_cursor* cursor);
+// Move to the next/previous key. Return false if there is none.
+bool splay_cursor_next(splay_cursor* cursor);
+bool splay_cursor_prev(splay_cursor* cursor);
+splay_key splay_cursor_key(const splay_cursor* cursor);
+splay_value splay_cursor_value(const splay_cursor* cursor);
+
+// Bytes allocated for the nodes of the tree. Does not splay.
+// Does not count the splay_tree struct itself.
+uint64_t splay_memory_usage(splay_tree* this);
+
 #endif
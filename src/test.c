@@ -2,23 +2,35 @@
 #include <stdlib.h>
 
 #include "btree/test.h"
+#include "cbtree/test.h"
 #include "cobt/test.h"
+#include "csbtree/test.h"
 #include "dict/array.h"
 #include "dict/btree.h"
+#include "dict/btree_frozen.h"
+#include "dict/cbtree.h"
 #include "dict/cobt.h"
+#include "dict/csbtree.h"
 #include "dict/htcuckoo.h"
 #include "dict/htlp.h"
 #include "dict/kforest.h"
 #include "dict/ksplay.h"
+#include "dict/olcbtree.h"
 #include "dict/rbtree.h"
+#include "dict/sharded.h"
 #include "dict/splay.h"
 #include "dict/test/blackbox.h"
+#include "dict/test/concurrent.h"
 #include "dict/test/large.h"
 #include "dict/test/ordered_dict_blackbox.h"
+#include "ebr/test.h"
 #include "ksplay/test.h"
 #include "log/log.h"
 #include "math/test.h"
+#include "olcbtree/test.h"
+#include "pool/test.h"
 #include "rand/test.h"
+#include "slab/test.h"
 #include "veb_layout/test.h"
 
 void run_unit_tests(void) {
@@ -26,36 +38,86 @@ void run_unit_tests(void) {
 	test_cobt();
 
 	test_btree();
+	test_cbtree();
+	test_csbtree();
+	test_olcbtree();
 
+	test_ebr();
 	test_math();
+	test_pool();
 	test_rand();
+	test_slab();
 	test_veb_layout();
 
 	test_dict_blackbox(&dict_array);
 	test_dict_blackbox(&dict_btree);
+	test_dict_blackbox(&dict_btree_64);
+	test_dict_blackbox(&dict_btree_128);
+	test_dict_blackbox(&dict_btree_512);
+	test_dict_blackbox(&dict_btree_1024);
+	test_dict_blackbox(&dict_btree_4096);
+	test_dict_blackbox(&dict_btree_h32);
+	test_dict_blackbox(&dict_btree_bstar);
+	test_dict_blackbox(&dict_btree_relaxed);
+	test_dict_blackbox(&dict_btree_frozen);
+	test_dict_blackbox(&dict_cbtree);
 	test_dict_blackbox(&dict_cobt);
+	test_dict_blackbox(&dict_cobt_blocked);
+	test_dict_blackbox(&dict_csbtree);
 	test_dict_blackbox(&dict_htcuckoo);
 	test_dict_blackbox(&dict_htlp);
 	test_dict_blackbox(&dict_kforest);
 	test_dict_blackbox(&dict_ksplay);
+	test_dict_blackbox(&dict_olcbtree);
 	test_dict_blackbox(&dict_rbtree);
 	test_dict_blackbox(&dict_splay);
+	test_dict_blackbox(&dict_sharded_btree);
+	test_dict_blackbox(&dict_sharded_htlp);
 
 	test_ordered_dict_blackbox(&dict_array);
 	test_ordered_dict_blackbox(&dict_btree);
+	test_ordered_dict_blackbox(&dict_btree_64);
+	test_ordered_dict_blackbox(&dict_btree_4096);
+	test_ordered_dict_blackbox(&dict_btree_h32);
+	test_ordered_dict_blackbox(&dict_btree_bstar);
+	test_ordered_dict_blackbox(&dict_btree_relaxed);
+	test_ordered_dict_blackbox(&dict_btree_frozen);
+	test_ordered_dict_blackbox(&dict_cbtree);
 	test_ordered_dict_blackbox(&dict_cobt);
+	test_ordered_dict_blackbox(&dict_cobt_blocked);
+	test_ordered_dict_blackbox(&dict_csbtree);
 	test_ordered_dict_blackbox(&dict_ksplay);
+	test_ordered_dict_blackbox(&dict_olcbtree);
 	test_ordered_dict_blackbox(&dict_splay);
+	test_ordered_dict_blackbox(&dict_sharded_cobt);
+	test_ordered_dict_blackbox(&dict_sharded_splay);
 
 	test_dict_large(&dict_array, 1 << 10);
 	test_dict_large(&dict_btree, 1 << 20);
+	test_dict_large(&dict_btree_64, 1 << 20);
+	test_dict_large(&dict_btree_4096, 1 << 20);
+	test_dict_large(&dict_btree_h32, 1 << 20);
+	test_dict_large(&dict_btree_bstar, 1 << 20);
+	test_dict_large(&dict_btree_relaxed, 1 << 20);
+	test_dict_large(&dict_cbtree, 1 << 20);
 	test_dict_large(&dict_cobt, 1 << 20);
+	test_dict_large(&dict_cobt_blocked, 1 << 20);
+	test_dict_large(&dict_csbtree, 1 << 20);
 	test_dict_large(&dict_htcuckoo, 1 << 20);
 	test_dict_large(&dict_htlp, 1 << 20);
 	test_dict_large(&dict_kforest, 1 << 20);
 	test_dict_large(&dict_ksplay, 1 << 20);
+	test_dict_large(&dict_olcbtree, 1 << 20);
 	test_dict_large(&dict_rbtree, 1 << 20);
 	test_dict_large(&dict_splay, 1 << 20);
+
+	test_dict_concurrent(&dict_sharded_btree, 8, 1 << 18);
+	test_dict_concurrent(&dict_sharded_cobt, 8, 1 << 18);
+	test_dict_concurrent(&dict_sharded_htlp, 8, 1 << 18);
+	test_dict_concurrent(&dict_sharded_htcuckoo, 8, 1 << 18);
+	test_dict_concurrent(&dict_sharded_splay, 8, 1 << 16);
+	test_dict_concurrent(&dict_olcbtree, 8, 1 << 18);
+	test_dict_concurrent(&dict_olcbtree, 32, 1 << 18);
 }
 
 int main(int argc, char** argv) {
@@ -0,0 +1,26 @@
+#include "util/huge_page.h"
+
+#include <sys/mman.h>
+
+#include "log/log.h"
+
+void* map_huge_page_aligned(uint64_t bytes, int protection, int flags) {
+	char* mapped = mmap(NULL, bytes + HUGE_PAGE_BYTES, protection,
+			MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	if (mapped == MAP_FAILED) {
+		return MAP_FAILED;
+	}
+	char* aligned = (char*) (((uint64_t) mapped + HUGE_PAGE_BYTES - 1) /
+			HUGE_PAGE_BYTES * HUGE_PAGE_BYTES);
+	if (aligned > mapped) {
+		ASSERT(munmap(mapped, aligned - mapped) == 0);
+	}
+	const uint64_t tail = (mapped + bytes + HUGE_PAGE_BYTES) -
+			(aligned + bytes);
+	if (tail > 0) {
+		ASSERT(munmap(aligned + bytes, tail) == 0);
+	}
+	// Only a hint, so failures are harmless.
+	madvise(aligned, bytes, MADV_HUGEPAGE);
+	return aligned;
+}
@@ -0,0 +1,15 @@
+#ifndef UTIL_HUGE_PAGE_H
+#define UTIL_HUGE_PAGE_H
+
+#include <stdint.h>
+
+// Size of an x86-64 transparent huge page.
+#define HUGE_PAGE_BYTES (2 << 20)
+
+// Maps anonymous private memory starting at a huge page boundary and asks
+// for it to be backed by transparent huge pages, which only back aligned
+// ranges. Protection and extra flags are passed to mmap. Returns MAP_FAILED
+// if the memory cannot be mapped.
+void* map_huge_page_aligned(uint64_t bytes, int protection, int flags);
+
+#endif
@@ -10,7 +10,7 @@ static uint64_t m_exp2(uint64_t x) {
 	return 1ULL << x;
 }
 
-static void split_height(uint64_t height, uint64_t* bottom, uint64_t* top) {
+void veb_split_height(uint64_t height, uint64_t* bottom, uint64_t* top) {
 	*bottom = hyperfloor(height - 1);
 	*top = height - *bottom;
 }
@@ -34,7 +34,7 @@ void build_veb_layout(uint64_t height,
 				veb_pointer_add(leaf_source, leaf_stride));
 	} else {
 		uint64_t bottom_height, top_height;
-		split_height(height, &bottom_height, &top_height);
+		veb_split_height(height, &bottom_height, &top_height);
 
 		const uint64_t nodes_in_top_block = m_exp2(top_height) - 1;
 		const uint64_t number_of_bottom_blocks = m_exp2(top_height);
@@ -213,7 +213,7 @@ static void __attribute__((unused)) veb_get_children_UNCACHED(uint64_t node, uin
 
 	while (height > 1) {
 		uint64_t bottom_height, top_height;
-		split_height(height, &bottom_height, &top_height);
+		veb_split_height(height, &bottom_height, &top_height);
 
 		const uint64_t nodes_in_top_block = m_exp2(top_height) - 1;
 		const uint64_t nodes_in_bottom_block =
@@ -248,7 +248,7 @@ recursive_call:
 		return true;
 	} else {
 		uint64_t bottom_height, top_height;
-		split_height(height, &bottom_height, &top_height);
+		veb_split_height(height, &bottom_height, &top_height);
 
 		const uint64_t nodes_in_top_block = m_exp2(top_height) - 1;
 		const uint64_t nodes_in_bottom_block =
@@ -302,7 +302,7 @@ recursive_call:
 		return offset;
 	} else {
 		uint64_t bottom_height, top_height;
-		split_height(height, &bottom_height, &top_height);
+		veb_split_height(height, &bottom_height, &top_height);
 
 		const uint64_t nodes_in_top_block = m_exp2(top_height) - 1;
 		const uint64_t nodes_in_bottom_block =
@@ -326,7 +326,7 @@ veb_level_data veb_get_level_data(uint64_t height, uint64_t level) {
 			level, height);
 	assert(level > 0);
 	uint64_t bottom_height, top_height;
-	split_height(height, &bottom_height, &top_height);
+	veb_split_height(height, &bottom_height, &top_height);
 	log_verbose(1, "height %" PRIu64 " => top=%" PRIu64 " bottom=%" PRIu64,
 			height, top_height, bottom_height);
 
@@ -12,6 +12,9 @@ typedef struct {
 } veb_level_data;
 veb_level_data veb_get_level_data(uint64_t height, uint64_t level);
 void veb_prepare(uint64_t height, veb_level_data* levels);
+// A tree of the given height is laid out as its top tree, followed by
+// 2^top bottom trees. Their heights add up to the height.
+void veb_split_height(uint64_t height, uint64_t* bottom, uint64_t* top);
 
 struct drilldown_track {
 	uint64_t pos[50];  /* TODO: maybe dynamic alloc? */